@@ -16,6 +16,7 @@
 
 import { FileHashCacheSession } from "./FileHashCacheSession";
 import {
+  CACHE_MAX_SHARDS,
   H_FILE_COUNT,
   HEADER_SIZE,
   S_CACHE_PATH,
@@ -26,21 +27,30 @@ import {
   S_FILE_COUNT,
   S_FILE_HANDLE,
   S_FINGERPRINT,
+  S_FLAG_CHUNKED_HASH,
+  S_FLAG_PATCHABLE,
+  S_FLAGS,
   S_LOCK_TIMEOUT,
   S_PAYLOAD0,
   S_PAYLOAD1,
   S_PAYLOAD2,
   S_PAYLOAD3,
+  S_SHARDS,
   S_STATUS,
   S_VERSION,
   STATE_HEADER_SIZE,
 } from "./file-hash-cache-format";
 import {
+  CachePathLookup,
   cacheClose,
   cacheIsLocked,
   cacheOpen,
   cacheStatHash,
   cacheWaitUnlocked,
+  cacheWatch,
+  cacheWatchClose,
+  cacheWatchPending,
+  cacheWatchSupported,
   cacheWriteNew,
   decodeEncodedPaths,
   emptyBuf,
@@ -51,7 +61,7 @@ import {
 } from "./file-hash-cache-internal";
 import { resolveDir, resolveRoot } from "./file-hash-cache-utils";
 import { bufferAlloc } from "./functions";
-import { encodeNormalizedPaths, normalizeFilePaths, pathResolve, toRelativePath } from "./utils";
+import { encodeNormalizedPaths, normalizeFilePaths, pathResolve } from "./utils";
 
 export type { FileHashCacheEntries, FileHashCacheEntry } from "./FileHashCacheEntries";
 export { FileHashCacheSession } from "./FileHashCacheSession";
@@ -79,6 +89,30 @@ export { FileHashCacheSession } from "./FileHashCacheSession";
  */
 export type CacheStatus = "upToDate" | "statsDirty" | "changed" | "stale" | "staleVersion" | "missing" | "lockFailed";
 
+/**
+ * Per-file result of a `fullScan` open — the values stored in
+ * {@link FileHashCacheSession.changes}, one byte per tracked file.
+ *
+ * - `UNCHANGED`   — stat matched the cached entry (or the file was not
+ *                   invalidated since the last open, see {@link FileHashCache.invalidate}).
+ * - `STATS_DIRTY` — stat metadata changed but the content hash still matches.
+ * - `CHANGED`     — content changed (size or hash mismatch).
+ * - `MISSING`     — the file could not be stat'ed (deleted or unreadable).
+ * - `ADDED`       — the file is not in the cached file list.
+ *
+ * Files that were in the cached list but are no longer tracked have no
+ * entry; they are listed in {@link FileHashCacheSession.removedFiles}.
+ */
+export const FileChangeKind = {
+  UNCHANGED: 0,
+  STATS_DIRTY: 1,
+  CHANGED: 2,
+  MISSING: 3,
+  ADDED: 4,
+} as const;
+
+export type FileChangeKind = (typeof FileChangeKind)[keyof typeof FileChangeKind];
+
 /** Options for the {@link FileHashCache} constructor. */
 export interface FileHashCacheOptions {
   /** Path to the cache file. */
@@ -97,6 +131,25 @@ export interface FileHashCacheOptions {
   /** Lock acquisition timeout in ms. `-1` (default) = block forever,
    *  `0` = non-blocking try, `>0` = timeout. */
   lockTimeoutMs?: number;
+  /** Stat-match every file on open instead of stopping at the first change, and
+   *  report a per-file {@link FileChangeKind} in {@link FileHashCacheSession.changes}.
+   *  Default: `false`. */
+  fullScan?: boolean;
+  /** Split the cache into this many shard files (0-64) plus a small manifest at
+   *  `cachePath`, so a write rewrites only the shards whose entries changed.
+   *  Files are assigned by parent directory. `0` or `1` (default) = single file. */
+  shards?: number;
+  /** Always store the cache body uncompressed, so that a later write with the
+   *  same file list and payload sizes patches only the changed entries in place
+   *  instead of rewriting the file. Larger file, much cheaper small writes.
+   *  Default: `false`. */
+  patchable?: boolean;
+  /** Hash files of 16 MiB or more as a tree of 4 MiB chunks read and hashed in
+   *  parallel, instead of streaming each one on a single thread. The digests
+   *  differ from the default mode, so the mode is stored in the cache file and
+   *  a cache written in the other mode opens as `"stale"`. Cache only: the
+   *  digest functions always stream. Default: `false`. */
+  chunkedHashing?: boolean;
 }
 
 /**
@@ -114,6 +167,14 @@ export interface FileHashCacheConfigOptions {
   files?: Iterable<string> | null;
   /** Override lock acquisition timeout in ms. */
   lockTimeoutMs?: number;
+  /** Override full-scan mode (see {@link FileHashCacheOptions.fullScan}). */
+  fullScan?: boolean;
+  /** Override the shard count (see {@link FileHashCacheOptions.shards}). */
+  shards?: number;
+  /** Override patchable mode (see {@link FileHashCacheOptions.patchable}). */
+  patchable?: boolean;
+  /** Override chunked hashing (see {@link FileHashCacheOptions.chunkedHashing}). */
+  chunkedHashing?: boolean;
 }
 
 /**
@@ -149,6 +210,9 @@ export interface FileHashCacheWriteOptions {
   lockTimeoutMs?: number;
 }
 
+/** Dirty hint of an open with nothing invalidated: every entry is trusted. */
+const NO_DIRTY_INDICES = new Uint32Array(0);
+
 /**
  * Per-cachePath wait slot, allocated **only on contention**.
  *
@@ -234,6 +298,9 @@ function lazySlotPromise(
  * cache.files = newFileList;
  * cache.invalidate(["src/foo.ts"]);
  * using session2 = await cache.open();
+ *
+ * // Native watch mode (Linux): the next opens stat only what changed
+ * cache.watch();
  * ```
  */
 export class FileHashCache {
@@ -246,6 +313,7 @@ export class FileHashCache {
   #version: number;
   #fingerprint: Uint8Array | null = null;
   #lockTimeoutMs: number;
+  #fullScan: boolean;
 
   /** NUL-separated encoded paths (relative) for C++. Source of truth for file identity. */
   #encodedPaths: Buffer;
@@ -257,10 +325,18 @@ export class FileHashCache {
    * Dirty-tracking state, merged into a single field:
    *  - `"all"`  — everything dirty (initial state, after `files` reset, etc.)
    *  - `null`   — nothing dirty (clean; written or opened-upToDate)
-   *  - `Set`    — specific relative paths dirty; always non-empty by invariant
-   *               (we normalize empty sets back to `null`).
+   *  - `Set`    — indices of the dirty entries of the current file list;
+   *               always non-empty by invariant (we normalize empty sets
+   *               back to `null`).
    */
-  #dirty: Set<string> | "all" | null = "all";
+  #dirty: Set<number> | "all" | null = "all";
+  /** Path → index lookup of the current file list, rebuilt when it changes. */
+  #pathLookup: CachePathLookup | null = null;
+
+  /** Whether {@link watch} is on. */
+  #watching: boolean = false;
+  /** Native watcher of the current file list (cacheWatch External), built lazily by open(). */
+  #watcher: object | null = null;
 
   /** Whether open() has ever been called successfully. */
   #opened: boolean = false;
@@ -289,10 +365,22 @@ export class FileHashCache {
    * Normalizes and encodes file paths immediately (no I/O).
    */
   public constructor(options: FileHashCacheOptions) {
-    const { cachePath, files, rootPath: rootPathOpt, version, fingerprint, lockTimeoutMs } = options;
+    const {
+      cachePath,
+      files,
+      rootPath: rootPathOpt,
+      version,
+      fingerprint,
+      lockTimeoutMs,
+      fullScan,
+      shards,
+      patchable,
+      chunkedHashing,
+    } = options;
     const rootPath = rootPathOpt ?? null;
     this.#version = (version ?? 0) >>> 0;
     this.#lockTimeoutMs = lockTimeoutMs ?? -1;
+    this.#fullScan = fullScan === true;
     // Use setter for validation
     this.fingerprint = fingerprint ?? null;
 
@@ -327,6 +415,15 @@ export class FileHashCache {
     sb.write(resolvedCachePath, S_CACHE_PATH, pathBytes, "utf8");
     this.#stateBuf = sb;
     this.#cachePath = resolvedCachePath;
+    if (shards !== undefined) {
+      this.shards = shards;
+    }
+    if (patchable) {
+      this.patchable = true;
+    }
+    if (chunkedHashing) {
+      this.chunkedHashing = true;
+    }
   }
 
   /** Resolved cache file path (immutable after construction). */
@@ -376,6 +473,7 @@ export class FileHashCache {
     this.#rootPath = root;
     this.#absoluteFiles = null;
     this.#dirty = "all";
+    this.#dropWatcher();
   }
 
   /** User-defined cache version (u32). */
@@ -414,6 +512,59 @@ export class FileHashCache {
     // anyway because the value passed to C++ may be deducted by JS-mutex wait time.
   }
 
+  /**
+   * Full-scan mode. When `true`, {@link open} stat-matches every file instead of
+   * stopping at the first change, and the session reports what happened to each
+   * one in {@link FileHashCacheSession.changes}. Costs a full stat pass (plus
+   * re-hashing of files whose metadata changed) on every non-`upToDate` open.
+   */
+  public get fullScan(): boolean {
+    return this.#fullScan;
+  }
+  public set fullScan(value: boolean) {
+    this.#fullScan = value;
+  }
+
+  /**
+   * Number of shard files the next write splits the cache into (0-64).
+   * `0` or `1` = single file. Reading works for either layout regardless.
+   */
+  public get shards(): number {
+    return this.#stateBuf.readUInt8(S_SHARDS);
+  }
+  public set shards(value: number) {
+    if (!Number.isInteger(value) || value < 0 || value > CACHE_MAX_SHARDS) {
+      throw new RangeError(`FileHashCache: shards must be an integer between 0 and ${CACHE_MAX_SHARDS}`);
+    }
+    this.#stateBuf.writeUInt8(value, S_SHARDS);
+  }
+
+  /**
+   * Patchable mode. When `true`, writes store the body uncompressed, and a write
+   * whose layout matches the file on disk only rewrites the bytes that changed.
+   * Has no effect on sharded caches.
+   */
+  public get patchable(): boolean {
+    return (this.#stateBuf.readUInt8(S_FLAGS) & S_FLAG_PATCHABLE) !== 0;
+  }
+  public set patchable(value: boolean) {
+    const flags = this.#stateBuf.readUInt8(S_FLAGS);
+    this.#stateBuf.writeUInt8(value ? flags | S_FLAG_PATCHABLE : flags & ~S_FLAG_PATCHABLE, S_FLAGS);
+  }
+
+  /**
+   * Chunked hashing. When `true`, files of 16 MiB or more are hashed as a tree
+   * of 4 MiB chunks on several threads. A session keeps the mode it was opened
+   * with; a change takes effect at the next {@link open}.
+   */
+  public get chunkedHashing(): boolean {
+    return (this.#stateBuf.readUInt8(S_FLAGS) & S_FLAG_CHUNKED_HASH) !== 0;
+  }
+  public set chunkedHashing(value: boolean) {
+    const flags = this.#stateBuf.readUInt8(S_FLAGS);
+    this.#stateBuf.writeUInt8(value ? flags | S_FLAG_CHUNKED_HASH : flags & ~S_FLAG_CHUNKED_HASH, S_FLAGS);
+  }
+
   /**
    * Current file list as absolute resolved paths (sorted).
    * `null` before the first open when constructed without `files` (reuse-from-disk mode).
@@ -449,12 +600,13 @@ export class FileHashCache {
     }
     this.#dirty = "all";
     this.#sbInSync = false;
+    this.#dropWatcher();
   }
 
   /**
    * Set multiple configuration options at once.
    *
-   * Equivalent to setting individual properties (version, fingerprint, files, rootPath, lockTimeoutMs).
+   * Equivalent to setting individual properties (version, fingerprint, files, rootPath, lockTimeoutMs, fullScan, shards, patchable, chunkedHashing).
    * Can be called between `open()` and `write()` to change what gets written.
    *
    * @param opts Configuration options. Omitted fields keep the current value.
@@ -483,6 +635,18 @@ export class FileHashCache {
     if (opts.lockTimeoutMs !== undefined) {
       this.lockTimeoutMs = opts.lockTimeoutMs;
     }
+    if (opts.fullScan !== undefined) {
+      this.fullScan = opts.fullScan;
+    }
+    if (opts.shards !== undefined) {
+      this.shards = opts.shards;
+    }
+    if (opts.patchable !== undefined) {
+      this.patchable = opts.patchable;
+    }
+    if (opts.chunkedHashing !== undefined) {
+      this.chunkedHashing = opts.chunkedHashing;
+    }
   }
 
   // - Dirty marking
@@ -490,7 +654,7 @@ export class FileHashCache {
   /**
    * Mark specific files as dirty. On the next {@link open}, the C++ stat-match
    * will only stat these files (plus any previously invalidated files), skipping
-   * stat for all other entries.
+   * stat for all other entries. Paths that are not in the file list are ignored.
    */
   public invalidate(paths: Iterable<string>): void {
     let dirty = this.#dirty;
@@ -498,14 +662,14 @@ export class FileHashCache {
       return;
     }
     if (dirty === null) {
-      dirty = new Set<string>();
+      dirty = new Set<number>();
       this.#dirty = dirty;
     }
-    const root = this.#rootPath;
+    const lookup = this._pathLookup;
     for (const p of paths) {
-      const rel = root ? toRelativePath(root, p) : p;
-      if (rel) {
-        dirty.add(rel);
+      const index = lookup.indexOf(p);
+      if (index >= 0) {
+        dirty.add(index);
       }
     }
     if (dirty.size === 0) {
@@ -518,11 +682,59 @@ export class FileHashCache {
     this.#dirty = "all";
   }
 
+  /**
+   * Watch the tracked files natively (Linux inotify) instead of relying on
+   * {@link invalidate}. The watcher is built on the next {@link open} (which
+   * stat-matches everything once) and rebuilt whenever `files` or `rootPath`
+   * change. From then on each open stats only the entries the kernel
+   * reported as changed, created, deleted or renamed since the previous
+   * open; {@link invalidate} still adds to that set.
+   *
+   * A kernel queue overflow or a renamed or deleted tracked directory makes
+   * the next open stat everything. Files in directories that could not be
+   * watched (missing, or the inotify watch limit reached) are stat-matched on
+   * every open.
+   *
+   * @returns `false` where no native watcher is available (non-Linux
+   *   platforms); the cache then keeps using {@link invalidate} alone.
+   */
+  public watch(): boolean {
+    if (!cacheWatchSupported) {
+      return false;
+    }
+    this.#watching = true;
+    return true;
+  }
+
+  /** Stop native watching and release the watcher's inotify descriptor. */
+  public unwatch(): void {
+    this.#watching = false;
+    this.#dropWatcher();
+  }
+
+  /** Whether {@link watch} is on. */
+  public get watching(): boolean {
+    return this.#watching;
+  }
+
+  /** Close the native watcher. Changes it recorded but no open consumed make everything dirty. */
+  #dropWatcher(): void {
+    const w = this.#watcher;
+    if (w !== null) {
+      this.#watcher = null;
+      if (cacheWatchPending(w)) {
+        this.#dirty = "all";
+      }
+      cacheWatchClose(w);
+    }
+  }
+
   /**
    * Whether the cache should be opened (or re-opened).
    *
    * Returns `true` when the cache has never been opened, files/version/fingerprint
-   * changed, or invalidateAll/invalidate was called.
+   * changed, invalidateAll/invalidate was called, or the native watcher
+   * (see {@link watch}) saw a tracked file change.
    */
   public get needsOpen(): boolean {
     if (!this.#opened) {
@@ -531,6 +743,10 @@ export class FileHashCache {
     if (this.#dirty !== null) {
       return true;
     }
+    const w = this.#watcher;
+    if (w !== null && cacheWatchPending(w)) {
+      return true;
+    }
     if (this.#version !== this.#lastWrittenVersion) {
       return true;
     }
@@ -742,6 +958,16 @@ export class FileHashCache {
     return this.#encodedPaths;
   }
 
+  /** @internal Path → index lookup of the current file list. */
+  public get _pathLookup(): CachePathLookup {
+    let lookup = this.#pathLookup;
+    if (lookup === null || lookup.encodedPaths !== this.#encodedPaths || lookup.rootPath !== this.#rootPath) {
+      lookup = new CachePathLookup(this.#encodedPaths, this.#fileCount, this.#rootPath);
+      this.#pathLookup = lookup;
+    }
+    return lookup;
+  }
+
   /** @internal */
   public get _stateBuf(): Buffer {
     return this.#stateBuf;
@@ -1042,34 +1268,62 @@ export class FileHashCache {
     elapsedWaitMs: number
   ): Promise<FileHashCacheSession> {
     let dataBuf: Buffer;
+    let changes: Buffer | null = null;
+    let removed: Buffer | null = null;
     try {
       if (this.#activeSession !== null) {
         this.#detachActiveSession();
       }
       this.#syncStateBuf(deductTimeout(lockTimeoutMs, elapsedWaitMs));
 
-      // Build dirty paths buffer for C++ watch-mode optimization.
-      //   `dirty === "all"`  → dirtyBuf=null           (stat everything)
-      //   `dirty === null`   → dirtyBuf=emptyBuf()     (nothing dirty)
-      //   `dirty` is a Set   → encoded paths           (stat just these)
-      let dirtyBuf: Buffer | null = null;
+      // Build the native watcher before the stat-match, so nothing changed
+      // after it goes unseen. What changed before it is unknown: stat all.
+      // null (inotify unavailable) keeps the invalidate()-only behavior.
+      let watcher = this.#watcher;
+      if (watcher === null && this.#watching && this.#fileCount > 0) {
+        watcher = cacheWatch(this.#encodedPaths, this.#rootPath, this.#fileCount);
+        if (watcher !== null) {
+          this.#watcher = watcher;
+          this.#dirty = "all";
+        }
+      }
+
+      // Build the dirty hint for C++ watch-mode optimization.
+      //   `dirty === "all"`  → dirtyIndices=null       (stat everything)
+      //   `dirty === null`   → empty Uint32Array       (nothing dirty)
+      //   `dirty` is a Set   → entry indices           (stat just these)
+      let dirtyIndices: Uint32Array | null = null;
       let dirtyCount = 0;
       const dirty = this.#dirty;
       if (dirty === null) {
-        dirtyBuf = emptyBuf();
+        dirtyIndices = NO_DIRTY_INDICES;
       } else if (dirty !== "all") {
-        const dirtyArray = Array.from(dirty);
-        dirtyBuf = encodeNormalizedPaths(dirtyArray);
-        dirtyCount = dirtyArray.length;
+        dirtyIndices = Uint32Array.from(dirty);
+        dirtyCount = dirtyIndices.length;
       }
 
       const sb = this.#stateBuf;
-      if (signal) {
+      if (this.#fullScan) {
+        const cancelCb = setupCancel(sb, signal);
+        try {
+          [dataBuf, changes, removed] = await cacheOpen(
+            sb,
+            this.#encodedPaths,
+            this.#rootPath,
+            dirtyIndices,
+            dirtyCount,
+            true,
+            watcher
+          );
+        } finally {
+          teardownCancel(signal, cancelCb);
+        }
+      } else if (signal) {
         // Race path: attach abort listener; tear it down via try/finally so an
         // abort during the C++ work cannot leak the listener.
         const cancelCb = setupCancel(sb, signal);
         try {
-          dataBuf = await cacheOpen(sb, this.#encodedPaths, this.#rootPath, dirtyBuf, dirtyCount);
+          dataBuf = await cacheOpen(sb, this.#encodedPaths, this.#rootPath, dirtyIndices, dirtyCount, false, watcher);
         } finally {
           teardownCancel(signal, cancelCb);
         }
@@ -1077,7 +1331,7 @@ export class FileHashCache {
         // Hot path: no signal, no listener to tear down. Inline the cancel
         // flag clear (single 4-byte write) and skip the inner try/finally.
         sb.writeUInt32LE(0, S_CANCEL_FLAG);
-        dataBuf = await cacheOpen(sb, this.#encodedPaths, this.#rootPath, dirtyBuf, dirtyCount);
+        dataBuf = await cacheOpen(sb, this.#encodedPaths, this.#rootPath, dirtyIndices, dirtyCount, false, watcher);
       }
 
       this.#dirty = null;
@@ -1093,7 +1347,15 @@ export class FileHashCache {
         }
       }
 
-      const session = new FileHashCacheSession(this, dataBuf, sb, this.#rootPath, this.#lockTimeoutMs);
+      const session = new FileHashCacheSession(
+        this,
+        dataBuf,
+        sb,
+        this.#rootPath,
+        this.#lockTimeoutMs,
+        changes,
+        removed
+      );
       this.#activeSession = session;
 
       if (session.status === "upToDate") {
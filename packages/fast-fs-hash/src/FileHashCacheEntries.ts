@@ -10,6 +10,7 @@
 
 import type { FileHashCacheSession } from "./FileHashCacheSession";
 import { ENTRY_STRIDE, HEADER_SIZE } from "./file-hash-cache-format";
+import type { CachePathLookup } from "./file-hash-cache-internal";
 import { hashToHex } from "./functions";
 
 /**
@@ -28,10 +29,17 @@ export class FileHashCacheEntries {
   /** Pre-allocated array of entry objects. Properties are lazy-loaded from dataBuf. */
   readonly #items: readonly FileHashCacheEntry[];
 
+  /** Path → index lookup of the file list the entries were resolved for. */
+  readonly #lookup: CachePathLookup;
+
   /** @internal */
-  public constructor(session: FileHashCacheSession, dataBuf: Buffer) {
+  public constructor(
+    session: FileHashCacheSession,
+    dataBuf: Buffer,
+    files: readonly string[],
+    lookup: CachePathLookup
+  ) {
     this.session = session;
-    const files = session.files;
     const fc = files.length;
     this.length = fc;
     const items = new Array<FileHashCacheEntry>(fc);
@@ -39,6 +47,7 @@ export class FileHashCacheEntries {
       items[i] = new FileHashCacheEntry(dataBuf, i, files[i]);
     }
     this.#items = items;
+    this.#lookup = lookup;
   }
 
   /** Get a file entry by index. Returns `undefined` if out of range. */
@@ -46,15 +55,10 @@ export class FileHashCacheEntries {
     return this.#items[index];
   }
 
-  /** Find a file entry by absolute path. Returns `undefined` if not found. */
+  /** Find a file entry by absolute path. Returns `undefined` if not found. O(log n). */
   public find(path: string): FileHashCacheEntry | undefined {
-    const items = this.#items;
-    for (let i = 0; i < items.length; i++) {
-      if (items[i].path === path) {
-        return items[i];
-      }
-    }
-    return undefined;
+    const item = this.#items[this.#lookup.indexOf(path)];
+    return item !== undefined && item.path === path ? item : undefined;
   }
 
   /** Iterate all entries. */
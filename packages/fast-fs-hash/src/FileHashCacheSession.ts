@@ -77,6 +77,17 @@ export class FileHashCacheSession {
   /** Payload f64 value (slot 3) read from disk. `0` when status is `'missing'`. */
   public readonly payloadValue3: number;
 
+  /**
+   * Per-file change report, only produced when the cache has
+   * {@link FileHashCache.fullScan} enabled: one `FileChangeKind` byte per
+   * entry of {@link files}, in the same order. Zero-copy view of native memory.
+   *
+   * `null` when full scan is off, or when there was nothing to compare against
+   * (status `'missing'`, `'stale'`, `'staleVersion'`, `'lockFailed'`, or the
+   * open was cancelled).
+   */
+  public readonly changes: Uint8Array | null;
+
   readonly #cache: FileHashCache;
   /** 0 = open, 1 = writing, 2 = closed */
   #state: number;
@@ -87,6 +98,8 @@ export class FileHashCacheSession {
   #compressedPayloads: readonly Buffer[] | null;
   #uncompressedPayloads: readonly Buffer[] | null;
   #resolvedEntries: FileHashCacheEntries | null;
+  #removed: Buffer | null;
+  #removedFiles: readonly string[] | null;
 
   /** @internal */
   public constructor(
@@ -94,7 +107,9 @@ export class FileHashCacheSession {
     dataBuf: Buffer,
     stateBuf: Buffer,
     openRootPath: string,
-    lockTimeoutMs: number
+    lockTimeoutMs: number,
+    changes: Uint8Array | null = null,
+    removed: Buffer | null = null
   ) {
     this.#cache = cache;
     this.#state = 0;
@@ -105,6 +120,8 @@ export class FileHashCacheSession {
     this.#compressedPayloads = null;
     this.#uncompressedPayloads = null;
     this.#resolvedEntries = null;
+    this.#removed = removed;
+    this.#removedFiles = null;
 
     this.status = STATUS_MAP[stateBuf.readUInt32LE(S_STATUS)] ?? "missing";
     const callerVersion = cache.version;
@@ -120,6 +137,7 @@ export class FileHashCacheSession {
     this.payloadValue1 = dataBuf.readDoubleLE(H_PAYLOAD1_BYTE);
     this.payloadValue2 = dataBuf.readDoubleLE(H_PAYLOAD2_BYTE);
     this.payloadValue3 = dataBuf.readDoubleLE(H_PAYLOAD3_BYTE);
+    this.changes = changes;
   }
 
   /** The parent {@link FileHashCache} that created this session. */
@@ -194,10 +212,40 @@ export class FileHashCacheSession {
     return f;
   }
 
+  /**
+   * Files the cached list had that {@link files} no longer does, as absolute
+   * paths in list order — the counterpart of {@link changes}, which has no
+   * slot for them. Empty when the list did not shrink. `null` whenever
+   * {@link changes} is. Lazily decoded.
+   */
+  public get removedFiles(): readonly string[] | null {
+    if (this.changes === null) {
+      return null;
+    }
+    let r = this.#removedFiles;
+    if (!r) {
+      // Every path is NUL-terminated.
+      const rel: string[] = [];
+      const buf = this.#removed;
+      if (buf) {
+        let start = 0;
+        for (let end = buf.indexOf(0); end >= 0; end = buf.indexOf(0, start)) {
+          rel.push(buf.toString("utf8", start, end));
+          start = end + 1;
+        }
+      }
+      const rp = this.rootPath;
+      r = rp ? toAbsolutePaths(rp, rel) : rel;
+      this.#removedFiles = r;
+    }
+    return r;
+  }
+
   /**
    * Release the exclusive lock and mark this session as disposed. Safe to call multiple times.
    * If called while {@link resolve} or {@link write} is in progress, cancels the operation
-   * via the cancel flag and closes immediately.
+   * via the cancel flag and closes immediately. With `FAST_FS_HASH_MMAP_MIN`, a mapped body
+   * still in use is copied out on a pool thread first, so the lock is released shortly after.
    */
   public close(): void {
     if (this.#state >= 2) {
@@ -230,8 +278,9 @@ export class FileHashCacheSession {
    * Resolve all file entries — complete stat + hash for every tracked file.
    *
    * After `open()`, some entries may be only partially resolved (CacheOpen exits
-   * early on the first change). This method completes stat + hash for ALL files,
-   * then returns a {@link FileHashCacheEntries} snapshot with per-file metadata.
+   * early on the first change unless {@link FileHashCache.fullScan} is set).
+   * This method completes stat + hash for ALL files, then returns a
+   * {@link FileHashCacheEntries} snapshot with per-file metadata.
    *
    * Can be called before `write()`. The resolved data is reused by write.
    * Cannot be called after `write()` or `close()`.
@@ -248,17 +297,21 @@ export class FileHashCacheSession {
       throw new Error("FileHashCacheSession: " + (this.#state >= 2 ? "already closed" : "operation in progress"));
     }
     this.#state = 1;
-    const cache = this.#cache;
     const sb = this.#stateBuf;
     const dataBuf = this.#dataBuf;
-    sb.writeUInt32LE(cache.fileCount, S_FILE_COUNT);
-    sb.writeUInt32LE(1, S_FLAGS); // resolveOnly
+    // The entries are indexed by the list resolved here, whatever the
+    // cache is reconfigured to while this awaits.
+    const cache = this.#cache;
+    const lookup = cache._pathLookup;
+    const files = cache.files ?? [];
+    sb.writeUInt32LE(lookup.fileCount, S_FILE_COUNT);
+    sb.writeUInt8(sb.readUInt8(S_FLAGS) | 1, S_FLAGS); // resolveOnly
     const cancelCb = setupCancel(sb, signal);
     try {
-      await cacheWrite(sb, dataBuf, cache._encodedPaths, cache.rootPath, null, null);
+      await cacheWrite(sb, dataBuf, lookup.encodedPaths, lookup.rootPath, null, null);
     } finally {
       teardownCancel(signal, cancelCb);
-      sb.writeUInt32LE(0, S_FLAGS);
+      sb.writeUInt8(sb.readUInt8(S_FLAGS) & ~1, S_FLAGS);
       if (this.#state === 1) {
         this.#state = 0; // back to open (session still holds the lock)
       }
@@ -267,7 +320,7 @@ export class FileHashCacheSession {
     if (this.#state >= 2) {
       throw new Error("FileHashCacheSession: closed during resolve");
     }
-    const entries = new FileHashCacheEntries(this, dataBuf);
+    const entries = new FileHashCacheEntries(this, dataBuf, files, lookup);
     this.#resolvedEntries = entries;
     return entries;
   }
@@ -10,6 +10,7 @@
 
 import { bufferAllocUnsafe, effectiveConcurrency, encodeFilePaths } from "./functions";
 import { binding } from "./init-native";
+import type { TaskPriority } from "./public-types";
 import { resolvedPromise } from "./utils";
 
 const {
@@ -332,13 +333,19 @@ export class XxHash128Stream {
    * Reads multiple files sequentially and returns the aggregate 128-bit digest.
    * @param paths Array of file paths.
    * @param throwOnError If false, skips unreadable files. Default true.
+   * @param priority Native pool scheduling class. Default `'interactive'`.
    */
-  public static digestFilesSequential(paths: readonly string[], throwOnError?: boolean): Promise<Buffer> {
+  public static digestFilesSequential(
+    paths: readonly string[],
+    throwOnError?: boolean,
+    priority?: TaskPriority
+  ): Promise<Buffer> {
     return encodedPathsDigestFilesSequentialTo(
       encodeFilePaths(paths),
       bufferAllocUnsafe(16),
       undefined,
-      throwOnError
+      throwOnError,
+      priority
     ) as Promise<Buffer>;
   }
 
@@ -348,14 +355,22 @@ export class XxHash128Stream {
    * @param out Destination buffer.
    * @param outOffset Byte offset into `out`. Default 0.
    * @param throwOnError If false, skips unreadable files. Default true.
+   * @param priority Native pool scheduling class. Default `'interactive'`.
    */
   public static digestFilesSequentialTo<TOut extends Uint8Array>(
     paths: readonly string[],
     out: TOut,
     outOffset?: number,
-    throwOnError?: boolean
+    throwOnError?: boolean,
+    priority?: TaskPriority
   ): Promise<TOut> {
-    return encodedPathsDigestFilesSequentialTo(encodeFilePaths(paths), out, outOffset, throwOnError) as Promise<TOut>;
+    return encodedPathsDigestFilesSequentialTo(
+      encodeFilePaths(paths),
+      out,
+      outOffset,
+      throwOnError,
+      priority
+    ) as Promise<TOut>;
   }
 
   /**
@@ -363,18 +378,21 @@ export class XxHash128Stream {
    * @param paths Array of file paths.
    * @param concurrency Max parallel reads. Default 8.
    * @param throwOnError If false, skips unreadable files. Default true.
+   * @param priority Native pool scheduling class. Default `'interactive'`.
    */
   public static digestFilesParallel(
     paths: readonly string[],
     concurrency = 0,
-    throwOnError?: boolean
+    throwOnError?: boolean,
+    priority?: TaskPriority
   ): Promise<Buffer> {
     return encodedPathsDigestFilesParallelTo(
       encodeFilePaths(paths),
       effectiveConcurrency(paths.length, concurrency),
       bufferAllocUnsafe(16),
       undefined,
-      throwOnError
+      throwOnError,
+      priority
     ) as Promise<Buffer>;
   }
 
@@ -385,20 +403,23 @@ export class XxHash128Stream {
    * @param outOffset Byte offset into `out`. Default 0.
    * @param concurrency Max parallel reads. Default 8.
    * @param throwOnError If false, skips unreadable files. Default true.
+   * @param priority Native pool scheduling class. Default `'interactive'`.
    */
   public static digestFilesParallelTo<TOut extends Uint8Array>(
     paths: readonly string[],
     out: TOut,
     outOffset?: number,
     concurrency = 0,
-    throwOnError?: boolean
+    throwOnError?: boolean,
+    priority?: TaskPriority
   ): Promise<TOut> {
     return encodedPathsDigestFilesParallelTo(
       encodeFilePaths(paths),
       effectiveConcurrency(paths.length, concurrency),
       out,
       outOffset,
-      throwOnError
+      throwOnError,
+      priority
     ) as Promise<TOut>;
   }
 }
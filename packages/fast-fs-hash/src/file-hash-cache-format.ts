@@ -48,7 +48,9 @@ export const MAGIC_ID_MASK = 0x00ffffff;
  *  equality compare against this value misses non-LZ4 bodies. */
 export const MAGIC = MAGIC_ID;
 
-/** Body encoding stored in the high byte of the magic word.
+/** Body encoding stored in the high byte of the magic word. Bit 7 of that
+ *  byte is not part of the encoding: it marks caches written with chunked
+ *  hashing (see {@link S_FLAG_CHUNKED_HASH}).
  *  Keep in sync with `BodyFormat` in
  *  `packages/fast-fs-hash/src/native/file-hash-cache/file-hash-cache-format.h`. */
 export enum BodyFormat {
@@ -56,6 +58,19 @@ export enum BodyFormat {
   LZ4 = 0,
   /** Body stored uncompressed (writer chose this when LZ4 didn't help). */
   PLAIN = 1,
+  /** Manifest of a sharded cache: entries, paths and compressed payloads live
+   *  in `<cachePath>.shard-<k>` / `<cachePath>.shard-p` files (see `shards`). */
+  SHARDED = 2,
+  /** Large body cut into independently LZ4-compressed 1 MiB blocks, encoded
+   *  and decoded in parallel. */
+  LZ4_BLOCKS = 3,
+  /** Read only: LZ4 body whose file entries are stored column by column.
+   *  Written by earlier builds; superseded by {@link BodyFormat.CODED}. */
+  COLUMNAR = 4,
+  /** LZ4 body behind a 16-byte coding header, whose file entries are stored
+   *  column by column, delta coded, and whose paths are stored as a
+   *  directory table (caches with 256 or more files). */
+  CODED = 5,
 }
 
 /** Fixed on-disk header size in bytes. */
@@ -106,6 +121,9 @@ export const CACHE_MAX_COMPRESSED_PAYLOADS_SIZE = 128 * 1024 * 1024;
 /** Maximum total uncompressed payload size (128 MiB, matches C++ CACHE_MAX_UNCOMPRESSED_PAYLOADS). */
 export const CACHE_MAX_UNCOMPRESSED_PAYLOADS_SIZE = 128 * 1024 * 1024;
 
+/** Maximum shard count for a sharded cache (matches C++ CACHE_MAX_SHARDS). */
+export const CACHE_MAX_SHARDS = 64;
+
 // - CacheStateBuf offsets
 
 /** Fixed header size of the state buffer (excluding variable-length cachePath). */
@@ -153,8 +171,17 @@ export const S_FILE_COUNT = 84;
 /** State byte 88: cachePathLen (u32, JS→C++). */
 export const S_CACHE_PATH_LEN = 88;
 
-/** State byte 92: flags (u32, JS→C++). Bit 0 = resolveOnly. */
+/** State byte 92: flags (u32, JS→C++). Bit 0 = resolveOnly, bit 1 = patchable, bit 2 = chunked hashing, bits 8-15 = shard count (see {@link S_SHARDS}). */
 export const S_FLAGS = 92;
 
+/** {@link S_FLAGS} bit 1: write single-file bodies PLAIN so later writes can patch them in place. */
+export const S_FLAG_PATCHABLE = 2;
+
+/** {@link S_FLAGS} bit 2: hash files of 16 MiB or more as a tree of 4 MiB chunks, in parallel. */
+export const S_FLAG_CHUNKED_HASH = 4;
+
+/** State byte 93: shard count for writes (u8, JS→C++). 0 or 1 = single-file layout. */
+export const S_SHARDS = 93;
+
 /** State byte 96+: null-terminated UTF-8 cachePath (immutable after construction). */
 export const S_CACHE_PATH = 96;
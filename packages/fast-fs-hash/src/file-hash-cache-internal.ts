@@ -21,6 +21,7 @@ import {
 } from "./file-hash-cache-format";
 import { bufferAlloc } from "./functions";
 import { binding } from "./init-native";
+import { toRelativePath } from "./utils";
 
 export const {
   cacheOpen,
@@ -31,6 +32,12 @@ export const {
   cacheClose,
   cacheStatHash,
   cacheFireCancel,
+  cacheWatch,
+  cacheWatchPending,
+  cacheWatchClose,
+  cacheWatchSupported,
+  cachePathTable,
+  cachePathIndex,
 } = binding;
 
 let _emptyBufCached: Buffer | undefined;
@@ -167,6 +174,39 @@ export function decodeEncodedPaths(encoded: Buffer, fc: number): string[] {
   return result;
 }
 
+/**
+ * Path → entry index lookup over one encoded file list. The native table
+ * (cachePathTable) is built on the first lookup, then each lookup is a
+ * binary search in C++ instead of a scan of the decoded paths.
+ */
+export class CachePathLookup {
+  public readonly encodedPaths: Buffer;
+  public readonly fileCount: number;
+  public readonly rootPath: string;
+  #table: object | null | undefined = undefined;
+
+  public constructor(encodedPaths: Buffer, fileCount: number, rootPath: string) {
+    this.encodedPaths = encodedPaths;
+    this.fileCount = fileCount;
+    this.rootPath = rootPath;
+  }
+
+  /** Entry index of `path` (absolute, or relative to rootPath), or -1 if it is not in the list. */
+  public indexOf(path: string): number {
+    const root = this.rootPath;
+    const rel = root ? toRelativePath(root, path) : path;
+    if (!rel) {
+      return -1;
+    }
+    let table = this.#table;
+    if (table === undefined) {
+      table = this.fileCount > 0 ? cachePathTable(this.encodedPaths, this.fileCount) : null;
+      this.#table = table;
+    }
+    return table === null ? -1 : cachePathIndex(table, this.encodedPaths, rel);
+  }
+}
+
 /** Read compressed payload buffers from a dataBuf. Returns zero-copy slices. */
 export function readCompressedPayloads(dataBuf: Buffer): readonly Buffer[] {
   const fc = dataBuf.readUInt32LE(H_FILE_COUNT);
@@ -17,7 +17,14 @@
 import { homedir } from "node:os";
 import { hashesToHexArray, hashToHex } from "./functions";
 import { binding } from "./init-native";
-import type { NearestProjectFiles, ProjectRoot } from "./public-types";
+import type {
+  HashMemoStats,
+  NearestProjectFiles,
+  ProjectRoot,
+  TaskPriority,
+  ThreadPoolStats,
+  ThreadPoolTuning,
+} from "./public-types";
 import { findCommonRootPath, normalizeFilePaths, toRelativePath } from "./utils";
 import { XxHash128Stream } from "./XxHash128Stream";
 
@@ -30,8 +37,19 @@ export type {
   FileHashCacheSession,
   FileHashCacheWriteOptions,
 } from "./FileHashCache";
-export { FileHashCache } from "./FileHashCache";
-export type { IXxHash128Functions, NearestProjectFiles, ProjectRoot } from "./public-types";
+export { FileChangeKind, FileHashCache } from "./FileHashCache";
+export type {
+  HashMemoStats,
+  IXxHash128Functions,
+  NearestProjectFiles,
+  ProjectRoot,
+  TaskPriority,
+  ThreadPoolStats,
+  ThreadPoolThreadStats,
+  ThreadPoolTuning,
+  ThreadPoolTuningProfile,
+  ThreadPoolTuningSample,
+} from "./public-types";
 export { XxHash128Stream };
 
 /**
@@ -117,9 +135,13 @@ export const digestFileTo: <TOut extends Uint8Array = Buffer>(
  * Read multiple files sequentially and return the aggregate 128-bit digest.
  * @param paths Array of file paths.
  * @param throwOnError If false, skips unreadable files. Default true.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
-export const digestFilesSequential: (paths: readonly string[], throwOnError?: boolean) => Promise<Buffer> =
-  XxHash128Stream.digestFilesSequential;
+export const digestFilesSequential: (
+  paths: readonly string[],
+  throwOnError?: boolean,
+  priority?: TaskPriority
+) => Promise<Buffer> = XxHash128Stream.digestFilesSequential;
 
 /**
  * Read multiple files sequentially and write the aggregate digest into `out`.
@@ -127,12 +149,14 @@ export const digestFilesSequential: (paths: readonly string[], throwOnError?: bo
  * @param out Destination buffer.
  * @param outOffset Byte offset into `out`. Default 0.
  * @param throwOnError If false, skips unreadable files. Default true.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
 export const digestFilesSequentialTo: <TOut extends Uint8Array>(
   paths: readonly string[],
   out: TOut,
   outOffset?: number,
-  throwOnError?: boolean
+  throwOnError?: boolean,
+  priority?: TaskPriority
 ) => Promise<TOut> = XxHash128Stream.digestFilesSequentialTo;
 
 /**
@@ -140,11 +164,13 @@ export const digestFilesSequentialTo: <TOut extends Uint8Array>(
  * @param paths Array of file paths.
  * @param concurrency Max parallel reads. Default 8.
  * @param throwOnError If false, skips unreadable files. Default true.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
 export const digestFilesParallel: (
   paths: readonly string[],
   concurrency?: number,
-  throwOnError?: boolean
+  throwOnError?: boolean,
+  priority?: TaskPriority
 ) => Promise<Buffer> = XxHash128Stream.digestFilesParallel;
 
 /**
@@ -154,13 +180,15 @@ export const digestFilesParallel: (
  * @param outOffset Byte offset into `out`. Default 0.
  * @param concurrency Max parallel reads. Default 8.
  * @param throwOnError If false, skips unreadable files. Default true.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
 export const digestFilesParallelTo: <TOut extends Uint8Array>(
   paths: readonly string[],
   out: TOut,
   outOffset?: number,
   concurrency?: number,
-  throwOnError?: boolean
+  throwOnError?: boolean,
+  priority?: TaskPriority
 ) => Promise<TOut> = XxHash128Stream.digestFilesParallelTo;
 
 /**
@@ -199,9 +227,14 @@ export const lz4CompressBlockTo: (
  * @param input Data to compress.
  * @param offset Start offset in bytes. Default 0.
  * @param length Number of bytes to compress. Default rest of buffer.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
-export const lz4CompressBlockAsync: (input: Uint8Array, offset?: number, length?: number) => Promise<Buffer> =
-  binding.lz4CompressBlockAsync;
+export const lz4CompressBlockAsync: (
+  input: Uint8Array,
+  offset?: number,
+  length?: number,
+  priority?: TaskPriority
+) => Promise<Buffer> = binding.lz4CompressBlockAsync;
 
 /**
  * Decompress LZ4 block data (synchronous, new allocation). `uncompressedSize` must match exactly.
@@ -241,12 +274,14 @@ export const lz4DecompressBlockTo: (
  * @param uncompressedSize Expected decompressed size in bytes.
  * @param offset Start offset in `input`. Default 0.
  * @param length Number of compressed bytes. Default rest of buffer.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
 export const lz4DecompressBlockAsync: (
   input: Uint8Array,
   uncompressedSize: number,
   offset?: number,
-  length?: number
+  length?: number,
+  priority?: TaskPriority
 ) => Promise<Buffer> = binding.lz4DecompressBlockAsync;
 
 /**
@@ -375,9 +410,12 @@ export async function digestFilesToHexArray(
  * Returns the compressed data and the original uncompressed size (needed for decompression).
  * Max file size: 512 MiB.
  * @param path File path.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
-export const lz4ReadAndCompress: (path: string) => Promise<{ data: Buffer; uncompressedSize: number }> =
-  binding.lz4ReadAndCompress;
+export const lz4ReadAndCompress: (
+  path: string,
+  priority?: TaskPriority
+) => Promise<{ data: Buffer; uncompressedSize: number }> = binding.lz4ReadAndCompress;
 
 /**
  * Decompress LZ4 data and write to a file asynchronously on a pool thread.
@@ -385,18 +423,57 @@ export const lz4ReadAndCompress: (path: string) => Promise<{ data: Buffer; uncom
  * @param compressedData LZ4-compressed data.
  * @param uncompressedSize Original uncompressed size (from lz4ReadAndCompress).
  * @param path Output file path.
+ * @param priority Native pool scheduling class. Default `'interactive'`.
  */
 export const lz4DecompressAndWrite: (
   compressedData: Uint8Array,
   uncompressedSize: number,
-  path: string
+  path: string,
+  priority?: TaskPriority
 ) => Promise<boolean> = binding.lz4DecompressAndWrite;
 
 /**
  * Wake idle native pool threads so they can self-terminate and free memory.
  * Threads with pending work will continue running — this is not a shutdown.
  * Threads respawn automatically when new work arrives.
+ * The pool is shared by the main thread and all worker_threads, so this
+ * affects every thread in the process.
  */
 export const threadPoolTrim: () => void = binding.poolTrim;
 
+/**
+ * Effective CPU budget the native pool sizes itself against: online CPUs,
+ * clamped on Linux by the process affinity mask and the cgroup CPU quota
+ * (v2 `cpu.max`, v1 `cpu.cfs_quota_us`). A 2-CPU container on a 64-core host
+ * reports 2. Detected once per process.
+ */
+export const threadPoolCpuBudget: () => number = binding.poolCpuBudget;
+
+/**
+ * Snapshot of the native thread pool counters: live/idle threads, tasks run,
+ * spin hits vs. semaphore sleeps, queue high-water mark, `expand()` calls and
+ * per-thread busy/idle time. The pool is process-wide, so this covers work
+ * from all worker_threads. Counters are always on and cost one relaxed
+ * store each — use this to tune `FAST_FS_HASH_POOL_IDLE_TIMEOUT_MS`.
+ */
+export const threadPoolStats: () => ThreadPoolStats = binding.poolStats;
+
+/**
+ * Snapshot of the thread-count autotuner. With `FAST_FS_HASH_AUTOTUNE=1` (or
+ * `FAST_FS_HASH_AUTOTUNE_PROFILE=<file>`), large parallel calls measure their
+ * throughput and the native side hill-climbs the thread cap separately for
+ * each operation and device. Calls with an explicit `concurrency` are never
+ * tuned. Off by default; `enabled` is false and `profiles` empty then.
+ */
+export const threadPoolTuning: () => ThreadPoolTuning = binding.poolTuning;
+
+/**
+ * Counters of the process-wide file hash memo. Files larger than one read
+ * buffer are memoized by their full stat identity (device, inode, mtime,
+ * ctime, size), so every `FileHashCache` and `digestFilesParallel()` call in
+ * the process — and every hardlink of one inode — reads a file once while
+ * it is unchanged. Sized by `FAST_FS_HASH_HASH_MEMO_ENTRIES` (0 disables).
+ */
+export const hashMemoStats: () => HashMemoStats = binding.hashMemoStats;
+
 export { findCommonRootPath, hashesToHexArray, hashToHex, normalizeFilePaths, toRelativePath };
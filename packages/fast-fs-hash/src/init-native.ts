@@ -6,7 +6,14 @@
  */
 
 import { resolve } from "node:path";
-import type { NearestProjectFiles, ProjectRoot } from "./public-types";
+import type {
+  HashMemoStats,
+  NearestProjectFiles,
+  ProjectRoot,
+  TaskPriority,
+  ThreadPoolStats,
+  ThreadPoolTuning,
+} from "./public-types";
 import { DIST_DIR } from "./utils";
 
 /** Shape of the native binding export. */
@@ -31,13 +38,15 @@ export interface BindingExportNative {
     concurrency: number,
     output: Uint8Array,
     outputOffset?: number,
-    throwOnError?: boolean
+    throwOnError?: boolean,
+    priority?: TaskPriority
   ): Promise<Uint8Array>;
   encodedPathsDigestFilesSequentialTo(
     pathsBuf: Uint8Array,
     output: Uint8Array,
     outputOffset?: number,
-    throwOnError?: boolean
+    throwOnError?: boolean,
+    priority?: TaskPriority
   ): Promise<Uint8Array>;
   streamAllocState(seedLow: number, seedHigh: number): object;
   streamReset(state: object, seedLow: number, seedHigh: number): void;
@@ -58,9 +67,20 @@ export interface BindingExportNative {
     stateBuf: Uint8Array,
     encodedPaths: Uint8Array,
     rootPath: string,
-    dirtyPaths?: Uint8Array | null,
-    dirtyCount?: number
+    dirtyIndices?: Uint32Array | null,
+    dirtyCount?: number,
+    fullScan?: false,
+    watcher?: object | null
   ): Promise<Buffer>;
+  cacheOpen(
+    stateBuf: Uint8Array,
+    encodedPaths: Uint8Array,
+    rootPath: string,
+    dirtyIndices: Uint32Array | null,
+    dirtyCount: number,
+    fullScan: true,
+    watcher?: object | null
+  ): Promise<[dataBuf: Buffer, changes: Buffer | null, removed: Buffer | null]>;
   cacheWrite(
     stateBuf: Uint8Array,
     dataBuf: Uint8Array,
@@ -81,6 +101,13 @@ export interface BindingExportNative {
   cacheWaitUnlocked(stateBuf: Uint8Array, lockTimeoutMs?: number): Promise<boolean>;
   cacheFireCancel(stateBuf: Uint8Array): void;
   cacheStatHash(stateBuf: Uint8Array): boolean;
+  cacheWatch(encodedPaths: Uint8Array, rootPath: string, fileCount: number): object | null;
+  cacheWatchPending(watcher: object): boolean;
+  cacheWatchClose(watcher: object): void;
+  /** Whether cacheWatch can return a watcher on this platform. */
+  readonly cacheWatchSupported: boolean;
+  cachePathTable(encodedPaths: Uint8Array, fileCount: number): object | null;
+  cachePathIndex(table: object, encodedPaths: Uint8Array, relPath: string): number;
   cacheFileStatGet(stateBuf: Uint8Array): void;
   filesEqual(pathA: string, pathB: string): Promise<boolean>;
   findProjectRoot(startPath: string, homePath?: string, stopPath?: string): Promise<ProjectRoot>;
@@ -88,6 +115,10 @@ export interface BindingExportNative {
   findNearestProjectFiles(startPath: string, homePath?: string, stopPath?: string): Promise<NearestProjectFiles>;
   findNearestProjectFilesSync(startPath: string, homePath?: string, stopPath?: string): NearestProjectFiles;
   poolTrim(): void;
+  poolCpuBudget(): number;
+  poolStats(): ThreadPoolStats;
+  poolTuning(): ThreadPoolTuning;
+  hashMemoStats(): HashMemoStats;
   lz4CompressBlock(input: Uint8Array, offset?: number, length?: number): Buffer;
   lz4CompressBlockTo(
     input: Uint8Array,
@@ -96,7 +127,12 @@ export interface BindingExportNative {
     inputOffset?: number,
     inputLength?: number
   ): number;
-  lz4CompressBlockAsync(input: Uint8Array, offset?: number, length?: number): Promise<Buffer>;
+  lz4CompressBlockAsync(
+    input: Uint8Array,
+    offset?: number,
+    length?: number,
+    priority?: TaskPriority
+  ): Promise<Buffer>;
   lz4DecompressBlock(input: Uint8Array, uncompressedSize: number, offset?: number, length?: number): Buffer;
   lz4DecompressBlockTo(
     input: Uint8Array,
@@ -110,11 +146,17 @@ export interface BindingExportNative {
     input: Uint8Array,
     uncompressedSize: number,
     offset?: number,
-    length?: number
+    length?: number,
+    priority?: TaskPriority
   ): Promise<Buffer>;
   lz4CompressBound(inputSize: number): number;
-  lz4ReadAndCompress(path: string): Promise<{ data: Buffer; uncompressedSize: number }>;
-  lz4DecompressAndWrite(compressedData: Uint8Array, uncompressedSize: number, path: string): Promise<boolean>;
+  lz4ReadAndCompress(path: string, priority?: TaskPriority): Promise<{ data: Buffer; uncompressedSize: number }>;
+  lz4DecompressAndWrite(
+    compressedData: Uint8Array,
+    uncompressedSize: number,
+    path: string,
+    priority?: TaskPriority
+  ): Promise<boolean>;
   getCpuFeatures(): { avx2: boolean; avx512: boolean };
 }
 
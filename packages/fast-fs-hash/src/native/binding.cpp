@@ -16,6 +16,115 @@ static Napi::Value poolTrim(const Napi::CallbackInfo & info) {
   return info.Env().Undefined();
 }
 
+static Napi::Value poolCpuBudget(const Napi::CallbackInfo & info) {
+  return Napi::Number::New(info.Env(), static_cast<double>(fast_fs_hash::ThreadPool::hardware_concurrency()));
+}
+
+static Napi::Value poolStats(const Napi::CallbackInfo & info) {
+  auto env = info.Env();
+  auto * addon = fast_fs_hash::AddonData::get(env);
+  if (!addon) [[unlikely]] {
+    return env.Undefined();
+  }
+
+  fast_fs_hash::ThreadPool::Stats stats;
+  addon->pool.stats(stats);
+
+  double tasks = 0;
+  double spinHits = 0;
+  double sleeps = 0;
+  auto threads = Napi::Array::New(env, static_cast<size_t>(stats.slot_count));
+  for (int i = 0; i < stats.slot_count; ++i) {
+    const auto & t = stats.threads[i];
+    auto th = Napi::Object::New(env);
+    th.Set("slot", Napi::Number::New(env, i));
+    th.Set("live", Napi::Boolean::New(env, t.live));
+    th.Set("tasks", Napi::Number::New(env, static_cast<double>(t.tasks)));
+    th.Set("spinHits", Napi::Number::New(env, static_cast<double>(t.spin_hits)));
+    th.Set("sleeps", Napi::Number::New(env, static_cast<double>(t.sleeps)));
+    th.Set("busyNs", Napi::Number::New(env, static_cast<double>(t.busy_ns)));
+    th.Set("idleNs", Napi::Number::New(env, static_cast<double>(t.idle_ns)));
+    threads.Set(static_cast<uint32_t>(i), th);
+    tasks += static_cast<double>(t.tasks);
+    spinHits += static_cast<double>(t.spin_hits);
+    sleeps += static_cast<double>(t.sleeps);
+  }
+
+  auto obj = Napi::Object::New(env);
+  obj.Set("threadCount", Napi::Number::New(env, stats.thread_count));
+  obj.Set("idleCount", Napi::Number::New(env, stats.idle_count));
+  obj.Set("maxThreads", Napi::Number::New(env, stats.max_threads));
+  obj.Set("tasksExecuted", Napi::Number::New(env, tasks));
+  obj.Set("spinHits", Napi::Number::New(env, spinHits));
+  obj.Set("sleeps", Napi::Number::New(env, sleeps));
+  obj.Set("queueHighWater", Napi::Number::New(env, static_cast<double>(stats.queue_high_water)));
+  obj.Set("expandCalls", Napi::Number::New(env, static_cast<double>(stats.expand_calls)));
+  obj.Set("threads", threads);
+  return obj;
+}
+
+static Napi::Value poolTuning(const Napi::CallbackInfo & info) {
+  using fast_fs_hash::ThreadTuner;
+  static const char * const OP_NAMES[fast_fs_hash::TUNE_OP_COUNT] = {"cacheStat", "cacheHash", "hashFiles"};
+
+  auto env = info.Env();
+  auto obj = Napi::Object::New(env);
+  obj.Set("enabled", Napi::Boolean::New(env, ThreadTuner::enabled()));
+  const char * path = ThreadTuner::profile_path();
+  obj.Set("profilePath", path ? Napi::Value(Napi::String::New(env, path)) : env.Null());
+
+  auto * profiles = new (std::nothrow) ThreadTuner::Profile[ThreadTuner::MAX_PROFILES];
+  const int n = profiles && ThreadTuner::enabled()
+    ? ThreadTuner::instance().snapshot(profiles, ThreadTuner::MAX_PROFILES)
+    : 0;
+  auto arr = Napi::Array::New(env, static_cast<size_t>(n));
+  for (int i = 0; i < n; ++i) {
+    const auto & p = profiles[i];
+    auto po = Napi::Object::New(env);
+    po.Set("op", Napi::String::New(env, OP_NAMES[static_cast<int>(p.op)]));
+    po.Set("device", Napi::Number::New(env, static_cast<double>(p.device)));
+    po.Set("threads", Napi::Number::New(env, p.current));
+    auto samples = Napi::Array::New(env);
+    uint32_t k = 0;
+    for (int t = 1; t <= ThreadTuner::MAX_THREADS; ++t) {
+      const auto & c = p.cells[t];
+      if (!c.samples) {
+        continue;
+      }
+      auto so = Napi::Object::New(env);
+      so.Set("threads", Napi::Number::New(env, t));
+      so.Set("filesPerSec", Napi::Number::New(env, c.files_per_sec));
+      so.Set("bytesPerSec", Napi::Number::New(env, c.bytes_per_sec));
+      so.Set("samples", Napi::Number::New(env, c.samples));
+      samples.Set(k++, so);
+    }
+    po.Set("samples", samples);
+    arr.Set(static_cast<uint32_t>(i), po);
+  }
+  delete[] profiles;
+  obj.Set("profiles", arr);
+  return obj;
+}
+
+static Napi::Value hashMemoStats(const Napi::CallbackInfo & info) {
+  using fast_fs_hash::HashMemo;
+  auto env = info.Env();
+  const size_t capacity = HashMemo::capacity();
+  auto obj = Napi::Object::New(env);
+  obj.Set("capacity", Napi::Number::New(env, static_cast<double>(capacity)));
+  if (capacity == 0) {
+    obj.Set("entries", Napi::Number::New(env, 0));
+    obj.Set("hits", Napi::Number::New(env, 0));
+    obj.Set("misses", Napi::Number::New(env, 0));
+    return obj;
+  }
+  const HashMemo & memo = HashMemo::instance();
+  obj.Set("entries", Napi::Number::New(env, static_cast<double>(memo.entries())));
+  obj.Set("hits", Napi::Number::New(env, static_cast<double>(memo.hits())));
+  obj.Set("misses", Napi::Number::New(env, static_cast<double>(memo.misses())));
+  return obj;
+}
+
 static Napi::Value getCpuFeatures(const Napi::CallbackInfo & info) {
   auto env = info.Env();
   auto obj = Napi::Object::New(env);
@@ -83,6 +192,19 @@ static Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports.Set("cacheStatHash", Napi::Function::New(env, fast_fs_hash::bindCacheStatHash));
   exports.Set("cacheFileStatGet", Napi::Function::New(env, fast_fs_hash::bindCacheFileStatGet));
 
+  // Native cache watcher (Linux inotify)
+  exports.Set("cacheWatch", Napi::Function::New(env, fast_fs_hash::bindCacheWatch));
+  exports.Set("cacheWatchPending", Napi::Function::New(env, fast_fs_hash::bindCacheWatchPending));
+  exports.Set("cacheWatchClose", Napi::Function::New(env, fast_fs_hash::bindCacheWatchClose));
+  exports.Set("cacheWatchSupported", Napi::Boolean::New(env, fast_fs_hash::CacheWatcher::supported()));
+
+  // Relative path → cache entry index
+  exports.Set("cachePathTable", Napi::Function::New(env, fast_fs_hash::bindCachePathTable));
+  exports.Set("cachePathIndex", Napi::Function::New(env, fast_fs_hash::bindCachePathIndex));
+
+  // Test-only hooks: not used by the library and not in the TS typings
+  exports.Set("cachePathsUnsafe", Napi::Function::New(env, fast_fs_hash::bindCachePathsUnsafe));
+
   // File comparison
   exports.Set("filesEqual", Napi::Function::New(env, fast_fs_hash::bindFilesEqual));
 
@@ -98,6 +220,12 @@ static Napi::Object Init(Napi::Env env, Napi::Object exports) {
 
   // Pool management
   exports.Set("poolTrim", Napi::Function::New(env, poolTrim));
+  exports.Set("poolCpuBudget", Napi::Function::New(env, poolCpuBudget));
+  exports.Set("poolStats", Napi::Function::New(env, poolStats));
+  exports.Set("poolTuning", Napi::Function::New(env, poolTuning));
+
+  // Process-wide file hash memo
+  exports.Set("hashMemoStats", Napi::Function::New(env, hashMemoStats));
 
   // LZ4 block compression
   exports.Set("lz4CompressBlock", Napi::Function::New(env, lz4_functions::lz4CompressBlock));
@@ -3,7 +3,9 @@
 
 #include "ThreadPool.h"
 #include "../io/FfshFile.h"
+#include "../io/PrivateFileMap.h"
 #include <uv.h>
+#include <condition_variable>
 #include <unordered_map>
 
 namespace fast_fs_hash {
@@ -13,15 +15,21 @@ namespace fast_fs_hash {
   /**
    * Per-addon-instance state. One per napi_env.
    *
-   * Uses a raw uv_async_t for pool→JS completion signaling.
+   * The compute pool is process-wide (SharedThreadPool); each env keeps its
+   * own completion list and raw uv_async_t for pool→JS signaling.
    * The handle is ref'd while AddonWorkers are in-flight so the
    * event loop stays alive until all results are delivered.
    */
   struct AddonData {
-    ThreadPool pool;
+    ThreadPool & pool;
     uv_async_t * async;
     std::atomic<AddonWorker *> head{nullptr};
     std::atomic<int> pending{0};
+    /** Tasks queued on the pool by this env that have not signaled yet.
+     *  Unlike `pending` (decremented by drain_cb_ on the JS thread), this
+     *  drops as soon as the pool thread is done with this AddonData, so the
+     *  cleanup hook can wait on it without running the event loop. */
+    std::atomic<int> in_pool{0};
     napi_async_cleanup_hook_handle cleanup_hook_ = nullptr;
     /** Set true at the start of async_cleanup_hook_. Guards drain_cb_ against
      *  calling napi functions (Resolve/Reject) after the env starts tearing
@@ -31,7 +39,7 @@ namespace fast_fs_hash {
      *  fatal `ThrowAsJavaScriptException` on the worker thread. */
     std::atomic<bool> closing{false};
 
-    /** Active lock cancels — JS-thread-only list. fire_all() before pool.shutdown()
+    /** Active lock cancels — JS-thread-only list. fire_all() before draining this env's tasks
      *  to unblock threads polling on flock(LOCK_NB) (POSIX) or LockFileEx (Win32). */
     FfshFile::LockCancelList active_cancels;
 
@@ -39,21 +47,35 @@ namespace fast_fs_hash {
      *  All operations are JS-thread-only (register in OnOK, take/close in binding/close). */
     std::unordered_map<int32_t, FfshFile> heldFiles;
 
+    /** Mapped cache bodies backed by a held file, keyed like heldFiles. Each
+     *  owns one PrivateFileMap reference, dropped via release_lock() before
+     *  the file's lock goes away. */
+    std::unordered_map<int32_t, PrivateFileMap *> heldMaps;
+
     /** Register a locked file, transferring ownership to this map. JS thread only.
+     *  `map` (optional) is a mapping of the file that must be detached before
+     *  the lock is released; a reference is taken.
      *  Returns the raw fd value (for embedding in the JS-side header). */
-    int32_t registerHeldFile(FfshFile && f) noexcept {
+    int32_t registerHeldFile(FfshFile && f, PrivateFileMap * map = nullptr) noexcept {
       const int32_t key = static_cast<int32_t>(f.fd);
       if (key < 0) [[unlikely]] {
         return FFSH_FILE_HANDLE_INVALID;
       }
       this->heldFiles.emplace(key, std::move(f));
+      if (map) {
+        map->retain();
+        this->heldMaps.emplace(key, map);
+      }
       return key;
     }
 
     /** Take ownership of a held file back from JS (e.g. before passing to CacheWriter).
-     *  Returns the FfshFile (caller owns it). JS thread only. */
-    FfshFile takeHeldFile(int32_t key) noexcept {
+     *  Returns the FfshFile (caller owns it). The file's mapping reference, if any,
+     *  moves to `*map`; the caller must release_lock() it before closing the file.
+     *  JS thread only. */
+    FfshFile takeHeldFile(int32_t key, PrivateFileMap ** map) noexcept {
       FfshFile result;
+      *map = nullptr;
       if (key == FFSH_FILE_HANDLE_INVALID) [[unlikely]] {
         return result;
       }
@@ -62,17 +84,43 @@ namespace fast_fs_hash {
         result = std::move(it->second);
         this->heldFiles.erase(it);
       }
+      auto mit = this->heldMaps.find(key);
+      if (mit != this->heldMaps.end()) {
+        *map = mit->second;
+        this->heldMaps.erase(mit);
+      }
       return result;
     }
 
-    /** Close and unregister a held file. JS thread only. */
+    /** Close and unregister a held file. JS thread only.
+     *  A mapping the Buffer still uses is detached on a pool thread, which
+     *  then closes the file: the lock stays held until the copy is done. */
     void closeHeldFile(int32_t key) noexcept {
       if (key == FFSH_FILE_HANDLE_INVALID) [[unlikely]] {
         return;
       }
+      auto mit = this->heldMaps.find(key);
+      if (mit != this->heldMaps.end()) {
+        PrivateFileMap * const map = mit->second;
+        this->heldMaps.erase(mit);
+        auto fit = this->heldFiles.find(key);
+        if (map->needs_detach() && fit != this->heldFiles.end()) {
+          auto * task = new (std::nothrow) DetachAndCloseTask(this, map, std::move(fit->second));
+          this->heldFiles.erase(fit);
+          if (task) [[likely]] {
+            this->task_queued();
+            this->pool.enqueue(*task);
+            return;
+          }
+          // OOM: the file is already closed; the Buffer keeps a file-backed mapping.
+        }
+        map->release_lock();
+      }
       this->heldFiles.erase(key);  // FfshFile destructor closes the fd
     }
 
+    explicit AddonData(ThreadPool & p) noexcept : pool(p) {}
+
     /** Retrieve the AddonData for the current napi_env. */
     static FSH_FORCE_INLINE AddonData * get(napi_env env) noexcept {
       void * data = nullptr;
@@ -98,7 +146,62 @@ namespace fast_fs_hash {
       }
     }
 
+    /** Env teardown has started: long-running pool work should bail. */
+    FSH_FORCE_INLINE bool stopping() const noexcept { return this->closing.load(std::memory_order_relaxed); }
+
+    /** A task of this env was queued on the pool. JS-thread-only. */
+    FSH_FORCE_INLINE void task_queued() noexcept { this->in_pool.fetch_add(1, std::memory_order_relaxed); }
+
+    /** A task of this env signaled completion. Called on the pool thread as
+     *  its very last access to this AddonData — the cleanup hook may free it
+     *  as soon as the count reaches zero. */
+    FSH_FORCE_INLINE void task_signaled() noexcept {
+      if (this->in_pool.fetch_sub(1, std::memory_order_seq_cst) == 1) [[unlikely]] {
+        wake_drain_waiters_();
+      }
+    }
+
    private:
+    /** closeHeldFile's pool task: detach the mapping, then close (unlock) the file. */
+    struct DetachAndCloseTask final : AddonTask {
+      AddonData * addon;
+      PrivateFileMap * map;
+      FfshFile file;
+
+      DetachAndCloseTask(AddonData * d, PrivateFileMap * m, FfshFile && f) noexcept :
+        addon(d), map(m), file(std::move(f)) {}
+
+      void run() noexcept override {
+        this->map->release_lock();
+        this->file.close();
+        AddonData * const d = this->addon;
+        delete this;
+        d->task_signaled();
+      }
+    };
+
+    // Process-wide, so task_signaled() never touches a freed AddonData.
+    static inline std::mutex drain_mu_;
+    static inline std::condition_variable drain_cv_;
+    static inline std::atomic<int> drain_waiters_{0};
+
+    static void wake_drain_waiters_() noexcept {
+      if (drain_waiters_.load(std::memory_order_seq_cst) != 0) {
+        std::lock_guard<std::mutex> lock(drain_mu_);
+        drain_cv_.notify_all();
+      }
+    }
+
+    /** Block until every task this env queued has signaled. */
+    void wait_drained_() noexcept {
+      drain_waiters_.fetch_add(1, std::memory_order_seq_cst);
+      {
+        std::unique_lock<std::mutex> lock(drain_mu_);
+        drain_cv_.wait(lock, [this] { return this->in_pool.load(std::memory_order_seq_cst) == 0; });
+      }
+      drain_waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
     static void drain_cb_(uv_async_t * handle);
     static void async_cleanup_hook_(napi_async_cleanup_hook_handle hook, void * data);
     static void on_async_close_(uv_handle_t * handle);
@@ -6,12 +6,20 @@
 #define _FAST_FS_HASH_ADDON_DATA_IMPL_H
 
 #include "AddonWorker.h"
+#include "ThreadTuner.h"
 
 namespace fast_fs_hash {
 
   inline void AddonData::init(napi_env env) {
-    auto * d = new (std::nothrow) AddonData();
+    ThreadPool * pool = SharedThreadPool::acquire();
+    if (!pool) [[unlikely]] {
+      napi_throw_error(env, nullptr, "fast-fs-hash: out of memory allocating ThreadPool");
+      return;
+    }
+
+    auto * d = new (std::nothrow) AddonData(*pool);
     if (!d) [[unlikely]] {
+      SharedThreadPool::release();
       napi_throw_error(env, nullptr, "fast-fs-hash: out of memory allocating AddonData");
       return;
     }
@@ -19,6 +27,7 @@ namespace fast_fs_hash {
     auto * handle = new (std::nothrow) uv_async_t();
     if (!handle) [[unlikely]] {
       delete d;
+      SharedThreadPool::release();
       napi_throw_error(env, nullptr, "fast-fs-hash: out of memory allocating async handle");
       return;
     }
@@ -63,12 +72,23 @@ namespace fast_fs_hash {
   inline void AddonData::async_cleanup_hook_(napi_async_cleanup_hook_handle hook, void * data) {
     auto * d = static_cast<AddonData *>(data);
 
-    // Publish closing BEFORE shutting down the pool. Pool threads may signal()
-    // during drain and queue uv_async_send; drain_cb_ now bails on this flag.
+    // Publish closing BEFORE draining. Pool threads may signal() during the
+    // drain and queue uv_async_send; drain_cb_ now bails on this flag, and
+    // long-running work polls stopping() to finish early.
     d->closing.store(true, std::memory_order_release);
 
     d->active_cancels.fire_all();
-    d->pool.shutdown();
+
+    // The pool is shared with other envs, so instead of shutting it down,
+    // wait for this env's own tasks (queued ones still run, then bail).
+    // After this no pool thread touches `d`.
+    d->wait_drained_();
+    SharedThreadPool::release();
+
+    // Samples only mark the autotune profile dirty; persist it now.
+    if (ThreadTuner::enabled()) {
+      ThreadTuner::instance().flush();
+    }
 
     AddonWorker * head = d->head.exchange(nullptr, std::memory_order_acquire);
     while (head) {
@@ -78,7 +98,12 @@ namespace fast_fs_hash {
     }
 
     // Close any locked files still held by this env (e.g., abandoned FileHashCache instances).
-    // FfshFile destructors release locks and close fds.
+    // FfshFile destructors release locks and close fds. Mappings are not
+    // detached: no JS runs in this env any more, so nothing reads them again.
+    for (auto & kv : d->heldMaps) {
+      kv.second->release();
+    }
+    d->heldMaps.clear();
     d->heldFiles.clear();
 
     d->cleanup_hook_ = hook;
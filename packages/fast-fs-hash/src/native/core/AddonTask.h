@@ -5,11 +5,23 @@
 
 namespace fast_fs_hash {
 
+  /** ThreadPool scheduling class. Lower value is dequeued first. */
+  enum class TaskPriority : uint8_t {
+    /** Latency-sensitive work (cache validation, single-file ops). Default. */
+    INTERACTIVE = 0,
+    /** Bulk work — only dequeued when no interactive task is waiting. */
+    BACKGROUND = 1,
+  };
+
+  static constexpr int TASK_PRIORITY_COUNT = 2;
+
   /** Base class for tasks queued on the ThreadPool.
-   *  Provides an intrusive next_ pointer for the spinlock-guarded FIFO queue
-   *  and a virtual run() method called by the worker thread. */
+   *  Provides an intrusive next_ pointer for the spinlock-guarded FIFO queue,
+   *  the lane it is queued on, and a virtual run() method called by the
+   *  worker thread. */
   struct AddonTask {
     AddonTask * next_ = nullptr;
+    TaskPriority priority_ = TaskPriority::INTERACTIVE;
 
     /** Execute this task on a worker thread. Must not throw. */
     virtual void run() noexcept = 0;
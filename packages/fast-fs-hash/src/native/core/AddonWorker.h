@@ -5,6 +5,96 @@
 
 namespace fast_fs_hash {
 
+  /** Parse the optional JS `TaskPriority` argument at info[idx]. The string
+   *  "background" selects BACKGROUND; anything else (including a missing or
+   *  undefined argument) is INTERACTIVE. */
+  inline TaskPriority readTaskPriority(const Napi::CallbackInfo & info, size_t idx) noexcept {
+    if (info.Length() <= idx) {
+      return TaskPriority::INTERACTIVE;
+    }
+    char buf[16];
+    size_t len = 0;
+    if (napi_get_value_string_utf8(info.Env(), info[idx], buf, sizeof(buf), &len) != napi_ok) {
+      return TaskPriority::INTERACTIVE;
+    }
+    return len == 10 && memcmp(buf, "background", 10) == 0 ? TaskPriority::BACKGROUND : TaskPriority::INTERACTIVE;
+  }
+
+  /** Default inline cutoff for in-memory work (LZ4 decompression of a JS buffer). */
+  static constexpr size_t DEFAULT_INLINE_MAX_BYTES = 16 * 1024;
+
+  /** Default inline cutoff for file-backed work. Lower than for buffers:
+   *  a cold page cache turns the read into real I/O on the JS thread. */
+  static constexpr size_t DEFAULT_INLINE_MAX_FILE_BYTES = 8 * 1024;
+
+  /** Parse a byte-count env var (0 allowed, disables inlining). */
+  inline size_t readInlineThresholdEnv(const char * name, size_t fallback) noexcept {
+    const char * env = std::getenv(name);
+    if (env && env[0] != '\0') {
+      char * end = nullptr;
+      const long long val = std::strtoll(env, &end, 10);
+      if (end != env && val >= 0 && val <= (1LL << 30)) {
+        return static_cast<size_t>(val);
+      }
+    }
+    return fallback;
+  }
+
+  /** In-memory inline cutoff in bytes. Read once from FAST_FS_HASH_INLINE_MAX_BYTES. */
+  inline size_t inlineMaxBytes() noexcept {
+    static const size_t v = readInlineThresholdEnv("FAST_FS_HASH_INLINE_MAX_BYTES", DEFAULT_INLINE_MAX_BYTES);
+    return v;
+  }
+
+  /** File-backed inline cutoff in bytes. Read once from FAST_FS_HASH_INLINE_MAX_FILE_BYTES. */
+  inline size_t inlineMaxFileBytes() noexcept {
+    static const size_t v =
+      readInlineThresholdEnv("FAST_FS_HASH_INLINE_MAX_FILE_BYTES", DEFAULT_INLINE_MAX_FILE_BYTES);
+    return v;
+  }
+
+  /**
+   * Inline-or-pool predictor for one file-backed call kind.
+   *
+   * A file's size is unknown until it is opened, and opening it on the JS
+   * thread is the blocking I/O inlining must avoid. So the decision is made
+   * from the calls that came before: every call reports what it read and how
+   * long it took, wherever it ran. After STREAK cheap calls in a row (at most
+   * inlineMaxFileBytes() read in at most MAX_NS) the next ones run inline;
+   * one expensive call — a large file, a cold page cache, a slow mount —
+   * sends the following ones back to the pool until a new streak builds up.
+   */
+  class InlineFileGate : NonCopyable {
+   public:
+    static constexpr uint32_t STREAK = 8;
+    /** About one pool round trip: slower work gains nothing from inlining. */
+    static constexpr uint64_t MAX_NS = 20'000;
+
+    bool shouldInline() const noexcept {
+      return inlineMaxFileBytes() != 0 && this->streak_.load(std::memory_order_relaxed) >= STREAK;
+    }
+
+    /** Report one finished call. Racy by design: a lost update only delays a switch. */
+    void record(uint64_t bytes, uint64_t ns) noexcept {
+      if (bytes <= inlineMaxFileBytes() && ns <= MAX_NS) {
+        const uint32_t s = this->streak_.load(std::memory_order_relaxed);
+        if (s < STREAK) {
+          this->streak_.store(s + 1, std::memory_order_relaxed);
+        }
+      } else {
+        this->streak_.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    static uint64_t now_ns() noexcept {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+   private:
+    std::atomic<uint32_t> streak_{0};
+  };
+
   /**
    * Async work with completion signaled back to the JS thread.
    *
@@ -15,24 +105,61 @@ namespace fast_fs_hash {
    * IMPORTANT: After signal(), `this` may be deleted by the JS thread
    * at any time. Do not access any member after calling it.
    *
-   * Use Queue() to run on the compute ThreadPool.
+   * Use Queue() to run on the compute ThreadPool, or QueueAdaptive() to run
+   * tiny work inline: for a few microseconds of work the pool hop (enqueue,
+   * wake, uv_async_send, drain_cb_) costs more than the work itself.
    */
   class AddonWorker : public AddonTask {
    public:
     AddonWorker(Napi::Env pEnv, Napi::Promise::Deferred pDeferred) noexcept
       : deferred(pDeferred), addon(AddonData::get(pEnv)), env(pEnv) {}
 
-    /** Queue on the compute thread pool. Ref's the event loop handle. */
-    void Queue() {
+    /** Queue on the compute thread pool. Ref's the event loop handle.
+     *  BACKGROUND work only runs when no INTERACTIVE task is waiting; any
+     *  ForkJob it submits inherits the same priority. */
+    void Queue(TaskPriority priority = TaskPriority::INTERACTIVE) {
       AddonData * d = this->addon;
       if (!d) [[unlikely]] {
         delete this;
         return;
       }
+      this->priority_ = priority;
       d->ref_pending();
+      d->task_queued();
       d->pool.enqueue(*this);
     }
 
+    /**
+     * Run Execute() synchronously on the JS thread and settle the promise
+     * before returning, so the caller hands back an already-resolved promise.
+     * Only for work known to take a few microseconds. Deletes `this`.
+     */
+    void RunInline() {
+      this->inline_ = true;
+      this->Execute();
+      Napi::Env e(this->env);
+      if (this->error_) [[unlikely]] {
+        this->OnError(Napi::Error::New(e, this->error_));
+      } else {
+        this->OnOK();
+      }
+      delete this;
+    }
+
+    /**
+     * RunInline() when the known work size is at most `maxInlineBytes` and the
+     * call is interactive, otherwise Queue(). A zero threshold disables
+     * inlining. BACKGROUND work always goes to the pool — it asked not to
+     * compete with the caller.
+     */
+    void QueueAdaptive(size_t workBytes, size_t maxInlineBytes, TaskPriority priority = TaskPriority::INTERACTIVE) {
+      if (workBytes <= maxInlineBytes && maxInlineBytes != 0 && priority == TaskPriority::INTERACTIVE) {
+        this->RunInline();
+      } else {
+        this->Queue(priority);
+      }
+    }
+
     void run() noexcept override {
       this->Execute();
     }
@@ -50,6 +177,9 @@ namespace fast_fs_hash {
 
     /** Signal successful completion. `this` may be deleted after this call. */
     void signal() {
+      if (this->inline_) [[unlikely]] {
+        return;  // RunInline() settles the promise itself.
+      }
       AddonData * d = this->addon;
       if (!d) [[unlikely]] {
         delete this;
@@ -67,6 +197,7 @@ namespace fast_fs_hash {
       }
 
       uv_async_send(d->async);
+      d->task_signaled();
     }
 
     /** Signal error + completion. `this` may be deleted after this call. */
@@ -79,6 +210,7 @@ namespace fast_fs_hash {
     friend struct AddonData;
 
     const char * error_ = nullptr;
+    bool inline_ = false;
   };
 
 }  // namespace fast_fs_hash
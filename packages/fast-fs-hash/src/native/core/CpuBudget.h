@@ -0,0 +1,286 @@
+#ifndef _FAST_FS_HASH_CPU_BUDGET_H
+#define _FAST_FS_HASH_CPU_BUDGET_H
+
+#include "includes.h"
+
+#include <cstdio>
+
+#ifdef __linux__
+#  include <sched.h>
+#endif
+
+namespace fast_fs_hash {
+
+  /**
+   * Effective CPU budget of this process — how many threads can actually run
+   * at once, not how many cores the host has.
+   *
+   * Linux: min(online CPUs, sched_getaffinity mask, cgroup CPU quota). The
+   * quota is read from cgroup v2 `cpu.max` and cgroup v1
+   * `cpu.cfs_quota_us / cpu.cfs_period_us`, walking from the process's own
+   * cgroup (per /proc/self/cgroup) up to the mount root and taking the
+   * tightest limit. A fractional quota rounds up: 1.5 CPUs → 2.
+   * Other platforms: online CPU count.
+   *
+   * The cgroup mount root defaults to /sys/fs/cgroup and can be overridden
+   * with FAST_FS_HASH_CGROUP_ROOT (used by tests to point at a fake tree).
+   */
+  namespace cpu_budget {
+
+    static constexpr size_t PATH_CAP = 4096;
+
+    /** Number of online CPUs (sysconf / GetSystemInfo). Never 0. */
+    inline unsigned online_cpus() noexcept {
+#ifdef _WIN32
+      SYSTEM_INFO si;
+      GetSystemInfo(&si);
+      return si.dwNumberOfProcessors > 0 ? static_cast<unsigned>(si.dwNumberOfProcessors) : 1u;
+#else
+      const long n = sysconf(_SC_NPROCESSORS_ONLN);
+      return n > 0 ? static_cast<unsigned>(n) : 1u;
+#endif
+    }
+
+#ifdef __linux__
+
+    /** CPUs in this thread's affinity mask, or 0 if unknown. */
+    inline unsigned affinity_cpus() noexcept {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        const int n = CPU_COUNT(&set);
+        return n > 0 ? static_cast<unsigned>(n) : 0u;
+      }
+      // EINVAL: the kernel mask is wider than cpu_set_t (>1024 CPUs).
+      for (int cpus = 2048; cpus <= 65536; cpus *= 2) {
+        cpu_set_t * dyn = CPU_ALLOC(cpus);
+        if (!dyn) {
+          return 0;
+        }
+        const size_t sz = CPU_ALLOC_SIZE(cpus);
+        CPU_ZERO_S(sz, dyn);
+        const int rc = sched_getaffinity(0, sz, dyn);
+        const int n = rc == 0 ? CPU_COUNT_S(sz, dyn) : 0;
+        CPU_FREE(dyn);
+        if (rc == 0) {
+          return n > 0 ? static_cast<unsigned>(n) : 0u;
+        }
+        if (errno != EINVAL) {
+          return 0;
+        }
+      }
+      return 0;
+    }
+
+    /** Read a small text file into buf (NUL-terminated). Returns bytes read, or -1. */
+    inline ssize_t read_small_file(const char * path, char * buf, size_t cap) noexcept {
+      const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        return -1;
+      }
+      size_t len = 0;
+      while (len + 1 < cap) {
+        const ssize_t r = ::read(fd, buf + len, cap - 1 - len);
+        if (r < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          ::close(fd);
+          return -1;
+        }
+        if (r == 0) {
+          break;
+        }
+        len += static_cast<size_t>(r);
+      }
+      ::close(fd);
+      buf[len] = '\0';
+      return static_cast<ssize_t>(len);
+    }
+
+    /** ceil(quota / period), at least 1. 0 when either is non-positive (no limit). */
+    inline unsigned quota_to_cpus(long long quota, long long period) noexcept {
+      if (quota <= 0 || period <= 0) {
+        return 0;
+      }
+      const long long n = (quota + period - 1) / period;
+      if (n < 1) {
+        return 1;
+      }
+      return n > 65536 ? 65536u : static_cast<unsigned>(n);
+    }
+
+    /** Parse a cgroup v2 `cpu.max` file ("max 100000" or "200000 100000"). 0 = unlimited/unreadable. */
+    inline unsigned read_cpu_max(const char * path) noexcept {
+      char buf[128];
+      if (read_small_file(path, buf, sizeof(buf)) <= 0) {
+        return 0;
+      }
+      if (buf[0] == 'm') {
+        return 0;  // "max"
+      }
+      char * end = nullptr;
+      const long long quota = std::strtoll(buf, &end, 10);
+      if (end == buf) {
+        return 0;
+      }
+      const long long period = std::strtoll(end, nullptr, 10);
+      return quota_to_cpus(quota, period);
+    }
+
+    /** Parse cgroup v1 cpu.cfs_quota_us + cpu.cfs_period_us in dir. 0 = unlimited/unreadable. */
+    inline unsigned read_cfs_quota(const char * dir) noexcept {
+      char path[PATH_CAP];
+      char buf[64];
+      if (std::snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir) >= static_cast<int>(sizeof(path))) {
+        return 0;
+      }
+      if (read_small_file(path, buf, sizeof(buf)) <= 0) {
+        return 0;
+      }
+      const long long quota = std::strtoll(buf, nullptr, 10);  // -1 = unlimited
+      if (quota <= 0) {
+        return 0;
+      }
+      if (std::snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir) >= static_cast<int>(sizeof(path))) {
+        return 0;
+      }
+      if (read_small_file(path, buf, sizeof(buf)) <= 0) {
+        return 0;
+      }
+      return quota_to_cpus(quota, std::strtoll(buf, nullptr, 10));
+    }
+
+    /** Keep the tighter of two limits, where 0 means "no limit". */
+    FSH_FORCE_INLINE unsigned tighter(unsigned a, unsigned b) noexcept {
+      if (a == 0) {
+        return b;
+      }
+      return (b != 0 && b < a) ? b : a;
+    }
+
+    /**
+     * Walk from base + rel up to base, applying reader at every level.
+     * v2 limits nest (a child can't exceed its parent), so the minimum wins.
+     * @param v1 true to read cfs_quota_us pairs, false to read cpu.max.
+     */
+    inline unsigned walk_cgroup(const char * base, const char * rel, bool v1) noexcept {
+      char dir[PATH_CAP];
+      const int n = std::snprintf(dir, sizeof(dir), "%s%s", base, rel);
+      if (n <= 0 || n >= static_cast<int>(sizeof(dir))) {
+        return 0;
+      }
+      const size_t base_len = std::strlen(base);
+      size_t len = static_cast<size_t>(n);
+      while (len > base_len && dir[len - 1] == '/') {
+        dir[--len] = '\0';
+      }
+
+      char file[PATH_CAP];
+      unsigned limit = 0;
+      for (;;) {
+        if (v1) {
+          limit = tighter(limit, read_cfs_quota(dir));
+        } else if (std::snprintf(file, sizeof(file), "%s/cpu.max", dir) < static_cast<int>(sizeof(file))) {
+          limit = tighter(limit, read_cpu_max(file));
+        }
+        if (len <= base_len) {
+          break;
+        }
+        while (len > base_len && dir[len - 1] != '/') {
+          --len;
+        }
+        while (len > base_len && dir[len - 1] == '/') {
+          --len;
+        }
+        dir[len] = '\0';
+      }
+      return limit;
+    }
+
+    /** True if the comma-separated controller list contains exactly "cpu". */
+    inline bool has_cpu_controller(const char * list, size_t len) noexcept {
+      size_t i = 0;
+      while (i < len) {
+        size_t j = i;
+        while (j < len && list[j] != ',') {
+          ++j;
+        }
+        if (j - i == 3 && std::memcmp(list + i, "cpu", 3) == 0) {
+          return true;
+        }
+        i = j + 1;
+      }
+      return false;
+    }
+
+    /**
+     * CPU quota from cgroups under root, or 0 if unlimited / not found.
+     * Reads /proc/self/cgroup to locate this process's own cgroup; when the
+     * path does not exist under root (e.g. a namespaced or fake root) the walk
+     * still ends at root itself.
+     */
+    inline unsigned cgroup_cpus(const char * root) noexcept {
+      char self[4096];
+      if (read_small_file("/proc/self/cgroup", self, sizeof(self)) < 0) {
+        self[0] = '\0';
+      }
+
+      // "hierarchy-id:controllers:path" — v2 is "0::/path".
+      const char * v2_path = "";
+      const char * v1_path = "";
+      char v2_buf[PATH_CAP];
+      char v1_buf[PATH_CAP];
+      for (char * line = self; *line;) {
+        char * eol = std::strchr(line, '\n');
+        if (eol) {
+          *eol = '\0';
+        }
+        char * c1 = std::strchr(line, ':');
+        char * c2 = c1 ? std::strchr(c1 + 1, ':') : nullptr;
+        if (c2) {
+          const size_t ctl_len = static_cast<size_t>(c2 - c1 - 1);
+          if (ctl_len == 0 && c1 - line == 1 && line[0] == '0') {
+            std::snprintf(v2_buf, sizeof(v2_buf), "%s", c2 + 1);
+            v2_path = v2_buf;
+          } else if (has_cpu_controller(c1 + 1, ctl_len)) {
+            std::snprintf(v1_buf, sizeof(v1_buf), "%s", c2 + 1);
+            v1_path = v1_buf;
+          }
+        }
+        if (!eol) {
+          break;
+        }
+        line = eol + 1;
+      }
+
+      unsigned limit = walk_cgroup(root, v2_path, false);
+
+      char mount[PATH_CAP];
+      if (std::snprintf(mount, sizeof(mount), "%s/cpu,cpuacct", root) < static_cast<int>(sizeof(mount))) {
+        limit = tighter(limit, walk_cgroup(mount, v1_path, true));
+      }
+      if (std::snprintf(mount, sizeof(mount), "%s/cpu", root) < static_cast<int>(sizeof(mount))) {
+        limit = tighter(limit, walk_cgroup(mount, v1_path, true));
+      }
+      return limit;
+    }
+
+#endif
+
+    /** Compute the effective CPU budget (uncached). Never 0. */
+    inline unsigned detect() noexcept {
+      unsigned n = online_cpus();
+#ifdef __linux__
+      n = tighter(n, affinity_cpus());
+      const char * root = std::getenv("FAST_FS_HASH_CGROUP_ROOT");
+      n = tighter(n, cgroup_cpus(root && root[0] != '\0' ? root : "/sys/fs/cgroup"));
+#endif
+      return n > 0 ? n : 1u;
+    }
+
+  }  // namespace cpu_budget
+
+}  // namespace fast_fs_hash
+
+#endif
@@ -5,6 +5,11 @@
 
 #ifdef __APPLE__
 #  include <dispatch/dispatch.h>
+#elif defined(__linux__)
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <time.h>
+#  include <errno.h>
 #elif !defined(_WIN32)
 #  include <semaphore.h>
 #  include <time.h>
@@ -34,17 +39,24 @@ namespace fast_fs_hash {
    * Lightweight platform counting semaphore + timed wait.
    *
    * macOS: dispatch_semaphore (user-space fast path).
-   * Linux: POSIX sem_t.
+   * Linux: futex word holding the count. post(n) is one atomic add plus at
+   *   most one FUTEX_WAKE(n), skipped entirely when nobody sleeps; waiters
+   *   spin briefly in user space before FUTEX_WAIT_BITSET with an absolute
+   *   CLOCK_MONOTONIC deadline (immune to wall-clock jumps).
+   * Other POSIX: sem_t.
    * Windows: Win32 Semaphore.
    */
   class Semaphore : NonCopyable {
    public:
+    /** pause iterations a waiter spins before sleeping (~1-2 µs). */
+    static constexpr int SPIN_ITERS = 64;
+
     inline Semaphore() noexcept {
 #ifdef __APPLE__
       this->sem_ = dispatch_semaphore_create(0);
 #elif defined(_WIN32)
       this->sem_ = CreateSemaphoreW(nullptr, 0, 0x7FFFFFFF, nullptr);
-#else
+#elif !defined(__linux__)
       sem_init(&this->sem_, 0, 0);
 #endif
     }
@@ -58,38 +70,93 @@ namespace fast_fs_hash {
       if (this->sem_) {
         CloseHandle(this->sem_);
       }
-#else
+#elif !defined(__linux__)
       sem_destroy(&this->sem_);
 #endif
     }
 
     /** Post (signal) the semaphore, waking one waiting thread. */
-    FSH_FORCE_INLINE void post() noexcept {
+    FSH_FORCE_INLINE void post() noexcept { this->post(1); }
+
+    /** Post n signals at once, waking up to n waiting threads. No-op for n <= 0. */
+    FSH_FORCE_INLINE void post(int n) noexcept {
+      if (n <= 0) {
+        return;
+      }
 #ifdef __APPLE__
-      dispatch_semaphore_signal(this->sem_);
+      for (int i = 0; i < n; ++i) {
+        dispatch_semaphore_signal(this->sem_);
+      }
 #elif defined(_WIN32)
-      ReleaseSemaphore(this->sem_, 1, nullptr);
+      ReleaseSemaphore(this->sem_, n, nullptr);
+#elif defined(__linux__)
+      this->count_.fetch_add(static_cast<uint32_t>(n), std::memory_order_release);
+      // Pairs with the seq_cst waiters_ increment in wait_for_ms: either we
+      // see the sleeper, or the sleeper's re-check sees our count.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (this->waiters_.load(std::memory_order_relaxed) != 0) {
+        syscall(SYS_futex, &this->count_, FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+      }
 #else
-      sem_post(&this->sem_);
+      for (int i = 0; i < n; ++i) {
+        sem_post(&this->sem_);
+      }
 #endif
     }
 
-    /** Wait up to ms milliseconds. Returns true if signaled, false on timeout. */
-    inline bool wait_for_ms(int ms) noexcept {
+    /**
+     * Wait up to ms milliseconds. Returns true if signaled, false on timeout.
+     * If slept is non-null it is set to whether the call blocked in the
+     * kernel (false when the Linux spin phase caught the signal).
+     */
+    inline bool wait_for_ms(int ms, bool * slept = nullptr) noexcept {
+#if defined(__linux__)
+      if (slept) {
+        *slept = false;
+      }
+#else
+      if (slept) {
+        *slept = true;
+      }
+#endif
 #ifdef __APPLE__
       return dispatch_semaphore_wait(
         this->sem_, dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(ms) * 1000000)) == 0;
 #elif defined(_WIN32)
       return WaitForSingleObject(this->sem_, ms) == WAIT_OBJECT_0;
+#elif defined(__linux__)
+      for (int i = 0; i < SPIN_ITERS; ++i) {
+        if (this->try_acquire_()) {
+          return true;
+        }
+        cpu_pause();
+      }
+
+      if (slept) {
+        *slept = true;
+      }
+      struct timespec deadline;
+      deadline_after_ms_(CLOCK_MONOTONIC, ms, deadline);
+      this->waiters_.fetch_add(1, std::memory_order_seq_cst);
+      bool acquired = false;
+      for (;;) {
+        if (this->try_acquire_()) {
+          acquired = true;
+          break;
+        }
+        // Sleeps only while the count is still 0; returns EAGAIN otherwise.
+        const long rc = syscall(
+          SYS_futex, &this->count_, FUTEX_WAIT_BITSET_PRIVATE, 0u, &deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+        if (rc != 0 && errno == ETIMEDOUT) {
+          acquired = this->try_acquire_();
+          break;
+        }
+      }
+      this->waiters_.fetch_sub(1, std::memory_order_relaxed);
+      return acquired;
 #else
       struct timespec ts;
-      clock_gettime(CLOCK_REALTIME, &ts);
-      ts.tv_sec += ms / 1000;
-      ts.tv_nsec += (ms % 1000) * 1000000L;
-      if (ts.tv_nsec >= 1000000000L) [[unlikely]] {
-        ts.tv_sec++;
-        ts.tv_nsec -= 1000000000L;
-      }
+      deadline_after_ms_(CLOCK_REALTIME, ms, ts);
       for (;;) {
         if (sem_timedwait(&this->sem_, &ts) == 0) [[likely]] {
           return true;
@@ -102,10 +169,40 @@ namespace fast_fs_hash {
     }
 
    private:
+#if !defined(__APPLE__) && !defined(_WIN32)
+    static FSH_FORCE_INLINE void deadline_after_ms_(clockid_t clock, int ms, struct timespec & ts) noexcept {
+      clock_gettime(clock, &ts);
+      ts.tv_sec += ms / 1000;
+      ts.tv_nsec += (ms % 1000) * 1000000L;
+      if (ts.tv_nsec >= 1000000000L) [[unlikely]] {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+      }
+    }
+#endif
+
+#ifdef __linux__
+    /** Take one signal if the count is non-zero. */
+    FSH_FORCE_INLINE bool try_acquire_() noexcept {
+      uint32_t c = this->count_.load(std::memory_order_relaxed);
+      while (c != 0) {
+        if (this->count_.compare_exchange_weak(c, c - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+      return false;
+    }
+#endif
+
 #ifdef __APPLE__
     dispatch_semaphore_t sem_;
 #elif defined(_WIN32)
     HANDLE sem_;
+#elif defined(__linux__)
+    /** The futex word: number of pending signals. */
+    std::atomic<uint32_t> count_{0};
+    /** Threads past the spin phase that may be (about to be) in FUTEX_WAIT. */
+    std::atomic<uint32_t> waiters_{0};
 #else
     sem_t sem_;
 #endif
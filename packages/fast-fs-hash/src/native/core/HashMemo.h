@@ -0,0 +1,221 @@
+#ifndef _FAST_FS_HASH_HASH_MEMO_H
+#define _FAST_FS_HASH_HASH_MEMO_H
+
+#include "../includes.h"
+#include "Hash128.h"
+#include "NonCopyable.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace fast_fs_hash {
+
+  /** Default FAST_FS_HASH_HASH_MEMO_ENTRIES. */
+  static constexpr size_t HASH_MEMO_DEFAULT_ENTRIES = 16384;
+
+  /** Full stat identity of an open file. Timestamps are nanoseconds since
+   *  the Unix epoch. Two files with equal identities have the same content
+   *  as long as neither was written within one timestamp tick of the other:
+   *  a write always moves ctime, which cannot be set from user space, but
+   *  only to the filesystem's granularity (see HashMemo::settled). */
+  struct FileIdentity {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t mtimeNs;
+    uint64_t ctimeNs;
+    uint64_t size;
+
+    FSH_FORCE_INLINE bool operator==(const FileIdentity & o) const noexcept {
+      return this->ino == o.ino && this->mtimeNs == o.mtimeNs && this->ctimeNs == o.ctimeNs && this->size == o.size &&
+        this->dev == o.dev;
+    }
+    FSH_FORCE_INLINE bool operator!=(const FileIdentity & o) const noexcept { return !(*this == o); }
+  };
+
+  /**
+   * Process-wide memo of file content hashes, keyed by FileIdentity and
+   * hashing mode.
+   *
+   * Every FileHashCache instance and every digestFiles* call in the process
+   * shares it, so a file that several caches track — or that a hardlinked
+   * store exposes under many paths — is read once while its stat stays the
+   * same. Consulted only for files that do not fit in one read buffer; a
+   * smaller file is hashed by the read that would precede the lookup.
+   *
+   * Only "settled" identities are stored: both timestamps a whole
+   * RACY_WINDOW_NS older than the start of the hash that produced them. A
+   * same-size rewrite inside one timestamp tick keeps the identity, so a
+   * file modified that recently may still change under the same key (git's
+   * racy-clean problem). Once settled, any later write moves ctime.
+   *
+   * Bounded by FAST_FS_HASH_HASH_MEMO_ENTRIES (default
+   * HASH_MEMO_DEFAULT_ENTRIES, rounded up to a power of two, 0 disables).
+   * Slots are 4-way set associative and split over SHARDS independently
+   * locked shards; the least recently used way of a full set is replaced.
+   */
+  class HashMemo : NonCopyable {
+   public:
+    static constexpr uint32_t SHARDS = 64;
+    static constexpr uint32_t WAYS = 4;
+
+    /** Hash of the whole file stream (hash_large_file). */
+    static constexpr uint8_t MODE_STREAM = 0;
+    /** Chunk-tree hash (hash_chunk_tree). */
+    static constexpr uint8_t MODE_CHUNK_TREE = 1;
+
+    /** Slot count; 0 = memo off. */
+    static size_t capacity() noexcept {
+      static const size_t v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_HASH_MEMO_ENTRIES");
+        size_t n = HASH_MEMO_DEFAULT_ENTRIES;
+        if (env && env[0] != '\0') {
+          char * end = nullptr;
+          const unsigned long long val = std::strtoull(env, &end, 10);
+          if (end != env) {
+            n = val > (1ull << 24) ? (1u << 24) : static_cast<size_t>(val);
+          }
+        }
+        if (n == 0) {
+          return size_t{0};
+        }
+        size_t p = SHARDS * WAYS;
+        while (p < n) {
+          p <<= 1;
+        }
+        return p;
+      }();
+      return v;
+    }
+
+    static FSH_FORCE_INLINE bool enabled() noexcept { return capacity() != 0; }
+
+    /** Coarsest timestamp granularity guarded against: FAT's 2 s mtime
+     *  (HFS+ and many NFS servers stamp whole seconds, older kernels a
+     *  jiffy). */
+    static constexpr uint64_t RACY_WINDOW_NS = 2'000'000'000ULL;
+
+    /** Wall clock in nanoseconds since the Unix epoch: a hash start time. */
+    static uint64_t now_ns() noexcept {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+    }
+
+    /** Whether a hash of `id` that started at `startNs` may be stored:
+     *  mtime and ctime are both at least RACY_WINDOW_NS older, so a later
+     *  write lands in a later tick. Future timestamps (clock skew) never are. */
+    static FSH_FORCE_INLINE bool settled(const FileIdentity & id, uint64_t startNs) noexcept {
+      const uint64_t t = id.mtimeNs > id.ctimeNs ? id.mtimeNs : id.ctimeNs;
+      return t <= startNs && startNs - t >= RACY_WINDOW_NS;
+    }
+
+    static HashMemo & instance() noexcept {
+      // Leaked on purpose: pool threads may still hash files during static destruction.
+      static HashMemo * memo = new HashMemo();
+      return *memo;
+    }
+
+    /** Copy the hash memoized for (id, mode) into `out`. Counts a hit or a miss. */
+    bool find(const FileIdentity & id, uint8_t mode, Hash128 & out) noexcept {
+      if (!this->slots_) [[unlikely]] {
+        return false;
+      }
+      const uint64_t h = key_hash_(id, mode);
+      Shard & shard = this->shards_[h & (SHARDS - 1)];
+      Slot * const set = this->set_of_(h);
+      {
+        std::lock_guard<std::mutex> lock(shard.mu);
+        for (uint32_t w = 0; w < WAYS; ++w) {
+          Slot & s = set[w];
+          if (s.used && s.mode == mode && s.id == id) {
+            s.tick = ++shard.tick;
+            out = s.hash;
+            this->hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+          }
+        }
+      }
+      this->misses_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    /** Remember `hash` for (id, mode). */
+    void store(const FileIdentity & id, uint8_t mode, const Hash128 & hash) noexcept {
+      if (!this->slots_) [[unlikely]] {
+        return;
+      }
+      const uint64_t h = key_hash_(id, mode);
+      Shard & shard = this->shards_[h & (SHARDS - 1)];
+      Slot * const set = this->set_of_(h);
+      std::lock_guard<std::mutex> lock(shard.mu);
+      Slot * victim = &set[0];
+      for (uint32_t w = 0; w < WAYS; ++w) {
+        Slot & s = set[w];
+        if (!s.used || (s.mode == mode && s.id == id)) {
+          victim = &s;
+          break;
+        }
+        if (s.tick < victim->tick) {
+          victim = &s;
+        }
+      }
+      if (!victim->used) {
+        victim->used = true;
+        this->entries_.fetch_add(1, std::memory_order_relaxed);
+      }
+      victim->id = id;
+      victim->mode = mode;
+      victim->hash = hash;
+      victim->tick = ++shard.tick;
+    }
+
+    uint64_t hits() const noexcept { return this->hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const noexcept { return this->misses_.load(std::memory_order_relaxed); }
+    uint64_t entries() const noexcept { return this->entries_.load(std::memory_order_relaxed); }
+
+   private:
+    struct Slot {
+      FileIdentity id;
+      Hash128 hash;
+      uint32_t tick;
+      uint8_t mode;
+      bool used;
+    };
+
+    struct alignas(64) Shard {
+      std::mutex mu;
+      uint32_t tick = 0;
+    };
+
+    Shard shards_[SHARDS];
+    Slot * slots_ = nullptr;
+    size_t setMask_ = 0;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> entries_{0};
+
+    HashMemo() noexcept {
+      const size_t cap = capacity();
+      if (cap != 0) {
+        this->slots_ = new (std::nothrow) Slot[cap]();
+        this->setMask_ = cap / WAYS - 1;
+      }
+    }
+
+    static FSH_FORCE_INLINE uint64_t key_hash_(const FileIdentity & id, uint8_t mode) noexcept {
+      uint64_t h = (id.ino ^ (id.dev << 40) ^ mode) * 0x9E3779B97F4A7C15ULL;
+      h ^= (id.mtimeNs ^ id.size) * 0xC2B2AE3D27D4EB4FULL;
+      return h ^ (h >> 29);
+    }
+
+    /** The low bits of a set index are its shard index (there are at least
+     *  SHARDS sets), so each set is guarded by exactly one shard lock. */
+    FSH_FORCE_INLINE Slot * set_of_(uint64_t h) const noexcept {
+      return this->slots_ + (static_cast<size_t>(h) & this->setMask_) * WAYS;
+    }
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
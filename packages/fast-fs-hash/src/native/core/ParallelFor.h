@@ -0,0 +1,81 @@
+#ifndef _FAST_FS_HASH_PARALLEL_FOR_H
+#define _FAST_FS_HASH_PARALLEL_FOR_H
+
+#include "ThreadPool.h"
+
+#include <thread>
+
+namespace fast_fs_hash {
+
+  /**
+   * Run fn(i) for every i in [0, count) on the calling thread plus up to
+   * `helpers` pool threads; returns once all of them have run.
+   *
+   * For short CPU-bound items (LZ4 blocks) inside a worker that is already
+   * on a pool thread and has to finish synchronously. The caller claims
+   * items too, so the loop completes even when no pool thread is free, and
+   * it only ever waits for items another thread has already claimed and is
+   * running — never for a queued task. Helpers that start after the range
+   * is drained find nothing to claim and never call fn. The shared state is
+   * refcounted (caller + the job's tasks) so those late helpers never touch
+   * freed memory.
+   */
+  template <typename Fn>
+  inline void poolParallelFor(ThreadPool & pool, uint32_t count, int helpers, Fn && fn) noexcept {
+    struct State : ForkJob<State, ThreadPool::MAX_WORKERS> {
+      std::atomic<uint32_t> next{0};
+      std::atomic<uint32_t> done{0};
+      std::atomic<int> refs{2};
+      uint32_t count = 0;
+      void * ctx = nullptr;
+      void (*call)(void *, uint32_t) = nullptr;
+
+      void drain() noexcept {
+        for (;;) {
+          const uint32_t i = this->next.fetch_add(1, std::memory_order_relaxed);
+          if (i >= this->count) {
+            return;
+          }
+          this->call(this->ctx, i);
+          this->done.fetch_add(1, std::memory_order_release);
+        }
+      }
+
+      void release() noexcept {
+        if (this->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          delete this;
+        }
+      }
+
+      void forkWork() noexcept { this->drain(); }
+      void forkDone() noexcept { this->release(); }
+    };
+
+    if (helpers > static_cast<int>(count) - 1) {
+      helpers = static_cast<int>(count) - 1;
+    }
+    if (helpers > ThreadPool::MAX_WORKERS) {
+      helpers = ThreadPool::MAX_WORKERS;
+    }
+    State * st = helpers > 0 ? new (std::nothrow) State() : nullptr;
+    if (!st) {
+      for (uint32_t i = 0; i < count; ++i) {
+        fn(i);
+      }
+      return;
+    }
+
+    st->count = count;
+    st->ctx = &fn;
+    st->call = [](void * ctx, uint32_t i) { (*static_cast<std::remove_reference_t<Fn> *>(ctx))(i); };
+    pool.submit(*st, helpers);
+    st->drain();
+    while (st->done.load(std::memory_order_acquire) < count) {
+      std::this_thread::yield();
+    }
+    st->release();
+  }
+
+}  // namespace fast_fs_hash
+
+#endif
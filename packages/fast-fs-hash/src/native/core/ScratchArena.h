@@ -0,0 +1,183 @@
+#ifndef _FAST_FS_HASH_SCRATCH_ARENA_H
+#define _FAST_FS_HASH_SCRATCH_ARENA_H
+
+#include "includes.h"
+
+#ifdef __linux__
+#  include <sys/mman.h>
+#endif
+
+namespace fast_fs_hash {
+
+  /** Smallest accepted read size. */
+  static constexpr size_t MIN_READ_BUFFER_SIZE = 32 * 1024;
+
+  /** Largest accepted read size. Bounds per-thread memory at MAX × pool threads. */
+  static constexpr size_t MAX_READ_BUFFER_SIZE = 16 * 1024 * 1024;
+
+  /**
+   * Read size used by every hashing path, in bytes.
+   * Read once from FAST_FS_HASH_READ_BUFFER_SIZE (bytes, optional k/m suffix),
+   * clamped to [MIN_READ_BUFFER_SIZE, MAX_READ_BUFFER_SIZE] and rounded up to
+   * a 4 KiB multiple. Default READ_BUFFER_SIZE.
+   */
+  inline size_t read_buffer_size() noexcept {
+    static const size_t v = [] {
+      const char * env = std::getenv("FAST_FS_HASH_READ_BUFFER_SIZE");
+      if (!env || env[0] == '\0') {
+        return READ_BUFFER_SIZE;
+      }
+      char * end = nullptr;
+      unsigned long long val = std::strtoull(env, &end, 10);
+      if (end == env) {
+        return READ_BUFFER_SIZE;
+      }
+      if (*end == 'k' || *end == 'K') {
+        val = val > (1ull << 40) ? (1ull << 50) : val * 1024;
+      } else if (*end == 'm' || *end == 'M') {
+        val = val > (1ull << 30) ? (1ull << 50) : val * 1024 * 1024;
+      }
+      if (val < MIN_READ_BUFFER_SIZE) {
+        val = MIN_READ_BUFFER_SIZE;
+      } else if (val > MAX_READ_BUFFER_SIZE) {
+        val = MAX_READ_BUFFER_SIZE;
+      }
+      return static_cast<size_t>((val + 4095) & ~4095ull);
+    }();
+    return v;
+  }
+
+  /**
+   * Per-thread read buffer shared by every worker that runs on the thread.
+   *
+   * Allocated on first use (so threads that never hash pay nothing) and freed
+   * when the thread exits — pool threads exit after the idle timeout, so the
+   * memory goes back with them. The buffer lives on the heap, which keeps
+   * the read size independent of ThreadPool::THREAD_STACK_SIZE.
+   *
+   * With FAST_FS_HASH_HUGE_PAGES=1 on Linux the buffer is mmap'd in 2 MiB
+   * multiples and advised MADV_HUGEPAGE, which cuts TLB misses for multi-MiB
+   * reads. Elsewhere the flag is ignored.
+   *
+   * Use through ReadScratch, which handles re-entrancy and allocation failure.
+   */
+  class ScratchArena : NonCopyable {
+   public:
+    /** The calling thread's arena. */
+    static ScratchArena & local() noexcept {
+      thread_local ScratchArena arena;
+      return arena;
+    }
+
+    /** Borrow the buffer (read_buffer_size() bytes, 64-byte aligned), or nullptr
+     *  if it is already borrowed on this thread or cannot be allocated. */
+    unsigned char * borrow() noexcept {
+      if (this->borrowed_) [[unlikely]] {
+        return nullptr;
+      }
+      if (!this->data_) [[unlikely]] {
+        this->allocate_();
+        if (!this->data_) [[unlikely]] {
+          return nullptr;
+        }
+      }
+      this->borrowed_ = true;
+      return this->data_;
+    }
+
+    void give_back() noexcept { this->borrowed_ = false; }
+
+    ~ScratchArena() noexcept {
+#ifdef __linux__
+      if (this->mapped_) {
+        munmap(this->data_, this->mapped_);
+        return;
+      }
+#endif
+      aligned_free(this->data_);
+    }
+
+    /** Read once from FAST_FS_HASH_HUGE_PAGES. Linux only. */
+    static bool huge_pages() noexcept {
+#ifdef __linux__
+      static const bool v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_HUGE_PAGES");
+        return env && env[0] == '1' && env[1] == '\0';
+      }();
+      return v;
+#else
+      return false;
+#endif
+    }
+
+   private:
+    ScratchArena() noexcept = default;
+
+    FSH_NO_INLINE void allocate_() noexcept {
+      const size_t size = read_buffer_size();
+#ifdef __linux__
+      if (huge_pages()) {
+        constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+        const size_t len = (size + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+        void * p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+          madvise(p, len, MADV_HUGEPAGE);  // best effort: THP may be disabled
+          this->data_ = static_cast<unsigned char *>(p);
+          this->mapped_ = len;
+          return;
+        }
+      }
+#endif
+      this->data_ = static_cast<unsigned char *>(aligned_malloc(64, size));
+    }
+
+    unsigned char * data_ = nullptr;
+    size_t mapped_ = 0;
+    bool borrowed_ = false;
+  };
+
+  /**
+   * Scoped read buffer: `data` is 64-byte aligned and holds `size` bytes.
+   *
+   * Normally borrows this thread's ScratchArena (size = read_buffer_size()).
+   * A nested borrow on the same thread gets its own heap buffer. When the
+   * heap is exhausted `data` is nullptr and `size` 0: check the scratch
+   * before reading and fail the call as out of memory.
+   */
+  class ReadScratch : NonCopyable {
+   public:
+    unsigned char * data;
+    size_t size;
+
+    ReadScratch() noexcept {
+      ScratchArena & arena = ScratchArena::local();
+      this->data = arena.borrow();
+      this->size = read_buffer_size();
+      if (this->data) [[likely]] {
+        this->arena_ = &arena;
+        return;
+      }
+      this->owned_ = static_cast<unsigned char *>(aligned_malloc(64, this->size));
+      this->data = this->owned_;
+      if (!this->owned_) [[unlikely]] {
+        this->size = 0;
+      }
+    }
+
+    explicit operator bool() const noexcept { return this->data != nullptr; }
+
+    ~ReadScratch() noexcept {
+      if (this->arena_) {
+        this->arena_->give_back();
+      }
+      aligned_free(this->owned_);
+    }
+
+   private:
+    ScratchArena * arena_ = nullptr;
+    unsigned char * owned_ = nullptr;
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
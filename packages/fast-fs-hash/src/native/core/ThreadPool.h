@@ -1,8 +1,10 @@
 #ifndef _FAST_FS_HASH_THREAD_POOL_H
 #define _FAST_FS_HASH_THREAD_POOL_H
 
+#include "CpuBudget.h"
 #include "ForkJob.h"
 #include "FshSemaphore.h"
+#include "WorkDeque.h"
 
 #ifdef _WIN32
 #  include <process.h>
@@ -10,23 +12,49 @@
 #  include <pthread.h>
 #endif
 
+#ifdef __linux__
+#  include <sys/syscall.h>
+#endif
+
+#include <bit>
+#include <chrono>
 #include <mutex>
 
 namespace fast_fs_hash {
 
   /**
-   * Per-addon-instance thread pool.
+   * Compute thread pool. One per process, shared by every napi_env (the main
+   * thread and each worker_thread) through SharedThreadPool, so thread
+   * limits apply to the whole process rather than to each env.
    *
    * Threads spawn on demand and self-terminate after IDLE_TIMEOUT_MS of inactivity.
    * shutdown() sets the flag, wakes all, joins all — draining remaining tasks first.
    * trim() wakes idle threads so they can check and exit if no work is pending.
    *
-   * Task queue is FIFO: tasks are executed in the order they are submitted.
-   * Uses a TTAS spinlock-guarded intrusive linked list (head/tail pointers).
-   * The critical section is ~2 pointer operations so contention is negligible.
+   * Two-level scheduling:
+   *  - Shared FIFO lanes (TTAS spinlock-guarded intrusive lists), one per
+   *    TaskPriority, for top-level tasks from enqueue() — AddonWorkers of
+   *    the same priority run in submission order.
+   *  - Per-worker Chase-Lev deques for ForkJob tasks from submit()/expand()
+   *    called on a pool thread. The submitting thread pushes to its own deque
+   *    without taking the shared lock; idle threads steal from the top.
+   * Fork tasks inherit the priority of the task that submitted them.
+   * A worker looks at the interactive lane first, then its own deque, then
+   * steals, and only then takes from the background lane — interactive work
+   * never waits behind queued bulk work. An interactive enqueue also grows
+   * the pool past the threads pinned by background work, within
+   * max_threads_(), so it is picked up by the next free thread at worst.
+   * With FAST_FS_HASH_BACKGROUND_IDLE_IO=1 (Linux), threads running
+   * background work drop to the idle I/O scheduling class.
+   * FAST_FS_HASH_POOL_SHARED_QUEUE=1 routes everything through the shared
+   * FIFO (the pre-deque behavior) for A/B comparisons.
    *
    * Wakeup signaling uses an idle_count_ to avoid wasted semaphore posts:
    * only threads that are actually blocked in wait_for_ms() are woken.
+   *
+   * Instrumentation: each worker slot keeps single-writer relaxed counters
+   * (tasks, spin hits, sleeps, busy/idle ns) on its own cache line, so they
+   * stay on in production builds. stats() takes a racy snapshot.
    */
   class ThreadPool : NonCopyable {
    public:
@@ -49,23 +77,36 @@ namespace fast_fs_hash {
       return v;
     }
 
+    /** True when FAST_FS_HASH_BACKGROUND_IDLE_IO=1 — background work runs at idle I/O priority. Read once. */
+    static inline bool background_idle_io() noexcept {
+      static const bool v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_BACKGROUND_IDLE_IO");
+        return env && env[0] == '1' && env[1] == '\0';
+      }();
+      return v;
+    }
+
+    /** True when FAST_FS_HASH_POOL_SHARED_QUEUE=1 disables the per-worker deques. Read once. */
+    static inline bool shared_queue_only() noexcept {
+      static const bool v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_POOL_SHARED_QUEUE");
+        return env && env[0] == '1' && env[1] == '\0';
+      }();
+      return v;
+    }
+
     using Task = AddonTask;
 
     ThreadPool() = default;
     ~ThreadPool() { this->shutdown(); }
 
-    /** Return the number of online CPUs (cached, called once). */
+    /**
+     * Return the effective CPU budget (cached, computed once): online CPUs
+     * clamped by the affinity mask and cgroup CPU quota on Linux.
+     * See cpu_budget::detect().
+     */
     static FSH_FORCE_INLINE unsigned hardware_concurrency() noexcept {
-      static const unsigned hw = [] {
-#ifdef _WIN32
-        SYSTEM_INFO si;
-        GetSystemInfo(&si);
-        return static_cast<unsigned>(si.dwNumberOfProcessors);
-#else
-        long n = sysconf(_SC_NPROCESSORS_ONLN);
-        return n > 0 ? static_cast<unsigned>(n) : 1u;
-#endif
-      }();
+      static const unsigned hw = cpu_budget::detect();
       return hw;
     }
 
@@ -117,10 +158,13 @@ namespace fast_fs_hash {
 
       // Push all tasks first, then ensure threads + wake.
       // Order matters: tasks must be visible before ensure_threads_ checks,
-      // so thread_self_exit_ sees them via pop_task_().
+      // so thread_self_exit_ sees them via has_work_().
+      WorkDeque * local = this->local_deque_();
+      const TaskPriority priority = tls_priority_;
       for (int i = 0; i < count; ++i) {
         job.tasks[i].job = &job;
-        this->push_task_(&job.tasks[i]);
+        job.tasks[i].priority_ = priority;
+        this->push_fork_task_(local, &job.tasks[i]);
       }
       this->ensure_threads_(count);
       this->notify_n_(count);
@@ -131,17 +175,23 @@ namespace fast_fs_hash {
      * MUST be called from within forkWork() (i.e. by a thread that is part of
      * the job's remaining count) to guarantee the job stays alive.
      *
-     * @return Count actually added (limited by MaxTasks and hardware_concurrency).
+     * @param cap  Total task ceiling for the job (default MaxTasks).
+     * @return Count actually added (limited by cap, MaxTasks and hardware_concurrency).
      */
     template <typename T>
-    int expand(T & job, int additional) noexcept {
+    int expand(T & job, int additional, int cap = T::MAX_TASKS) noexcept {
       if (additional <= 0) {
         return 0;
       }
       constexpr int kMaxSlots = T::MAX_TASKS;
       const int hwMax = max_threads_();
-      const int maxSlots = hwMax < kMaxSlots ? hwMax : kMaxSlots;
+      int maxSlots = hwMax < kMaxSlots ? hwMax : kMaxSlots;
+      if (cap < maxSlots) {
+        maxSlots = cap;
+      }
 
+      this->expand_calls_.fetch_add(1, std::memory_order_relaxed);
+      WorkDeque * local = this->local_deque_();
       int added = 0;
       for (int i = 0; i < additional; ++i) {
         const int slot = job.nextSlot.fetch_add(1, std::memory_order_relaxed);
@@ -150,10 +200,11 @@ namespace fast_fs_hash {
           break;
         }
         job.tasks[slot].job = &job;
+        job.tasks[slot].priority_ = tls_priority_;
         // Increment remaining BEFORE pushing the task. Use release so that
         // the new task's fetch_sub(acq_rel) in ForkTask::run() sees this.
         job.remaining.fetch_add(1, std::memory_order_release);
-        this->push_task_(&job.tasks[slot]);
+        this->push_fork_task_(local, &job.tasks[slot]);
         ++added;
       }
 
@@ -164,10 +215,16 @@ namespace fast_fs_hash {
       return added;
     }
 
-    /** Enqueue a single task on a pool thread. */
+    /** Enqueue a single task on a pool thread. Always goes through the shared
+     *  FIFO so top-level AddonWorkers keep submission-order fairness. */
     void enqueue(Task & task) noexcept {
       this->push_task_(&task);
-      this->ensure_threads_(1);
+      if (task.priority_ == TaskPriority::INTERACTIVE) [[likely]] {
+        // One thread beyond those pinned by background work, within the CPU budget.
+        this->ensure_threads_(this->bg_running_.load(std::memory_order_relaxed) + 1);
+      } else {
+        this->ensure_threads_(1);
+      }
       this->notify_one_();
     }
 
@@ -177,10 +234,7 @@ namespace fast_fs_hash {
         return;
       }
       this->trim_gen_.fetch_add(1, std::memory_order_release);
-      const int idle = this->idle_count_.load(std::memory_order_relaxed);
-      for (int i = 0; i < idle; ++i) {
-        this->wake_.post();
-      }
+      this->wake_.post(this->idle_count_.load(std::memory_order_relaxed));
     }
 
     /**
@@ -203,8 +257,8 @@ namespace fast_fs_hash {
       {
         std::lock_guard<std::mutex> lock(this->mu_);
         count = this->thread_count_.load(std::memory_order_relaxed);
+        this->wake_.post(count);
         for (int i = 0; i < count; ++i) {
-          this->wake_.post();
 #ifdef _WIN32
           handles[i] = this->handles_[i];
 #else
@@ -229,23 +283,209 @@ namespace fast_fs_hash {
       return this->state_.load(std::memory_order_relaxed) == STATE_SHUTDOWN;
     }
 
+    /** Point-in-time snapshot of pool counters, filled by stats(). */
+    struct Stats {
+      /** Counters of one worker slot. Cumulative across the threads that
+       *  have occupied the slot (threads come and go with the idle timeout). */
+      struct Thread {
+        bool live;
+        uint64_t tasks;
+        uint64_t spin_hits;
+        uint64_t sleeps;
+        uint64_t busy_ns;
+        uint64_t idle_ns;
+      };
+
+      int thread_count;
+      int idle_count;
+      int max_threads;
+      uint64_t expand_calls;
+      /** Deepest any shared FIFO lane has been since the pool started. */
+      uint64_t queue_high_water;
+      /** Number of valid entries in threads[] (highest slot ever used + 1). */
+      int slot_count;
+      Thread threads[MAX_WORKERS];
+    };
+
+    /** Fill out with a relaxed snapshot of all counters. Any thread. */
+    void stats(Stats & out) const noexcept {
+      out.thread_count = this->thread_count_.load(std::memory_order_relaxed);
+      out.idle_count = this->idle_count_.load(std::memory_order_relaxed);
+      out.max_threads = max_threads_();
+      out.expand_calls = this->expand_calls_.load(std::memory_order_relaxed);
+      uint64_t hw = 0;
+      for (const Lane & lane : this->lanes_) {
+        const uint64_t v = lane.high_water.load(std::memory_order_relaxed);
+        hw = v > hw ? v : hw;
+      }
+      out.queue_high_water = hw;
+      const uint32_t mask = this->slot_mask_.load(std::memory_order_relaxed);
+      const int hi = this->slot_hi_.load(std::memory_order_acquire);
+      out.slot_count = hi;
+      for (int i = 0; i < hi; ++i) {
+        const WorkerStats & ws = this->worker_stats_[i];
+        Stats::Thread & t = out.threads[i];
+        t.live = (mask >> i) & 1u;
+        t.tasks = ws.tasks.load(std::memory_order_relaxed);
+        t.spin_hits = ws.spin_hits.load(std::memory_order_relaxed);
+        t.sleeps = ws.sleeps.load(std::memory_order_relaxed);
+        t.busy_ns = ws.busy_ns.load(std::memory_order_relaxed);
+        t.idle_ns = ws.idle_ns.load(std::memory_order_relaxed);
+      }
+    }
+
    private:
     static constexpr int SPIN_BEFORE_WAIT = 32;
 
     static constexpr uint32_t STATE_RUNNING = 0;
     static constexpr uint32_t STATE_SHUTDOWN = 1;
 
-    alignas(64) std::atomic<bool> q_lock_{false};
-    /** May-have-work hint. Producers set true under the spinlock before
-     *  releasing it; the q_lock_ release publishes both updates. Workers
-     *  may read it relaxed to short-circuit the spinlock acquire when the
-     *  queue is empty (false-positives are harmless; false-negatives are
-     *  prevented by the producer's release-store on q_lock_). Spinlock
-     *  contention on the spin-before-sleep path dominated the parallel
-     *  stat hot path; this hint sidesteps it entirely on empty checks. */
-    std::atomic<bool> q_has_work_{false};
-    Task * q_head_ = nullptr;
-    Task * q_tail_ = nullptr;
+    /** One shared FIFO lane: TTAS spinlock-guarded intrusive list. */
+    struct alignas(64) Lane {
+      std::atomic<bool> lock{false};
+      /** May-have-work hint. Producers set true under the spinlock before
+       *  releasing it; the lock release publishes both updates. Workers
+       *  may read it relaxed to short-circuit the spinlock acquire when the
+       *  lane is empty (false-positives are harmless; false-negatives are
+       *  prevented by the producer's release-store on lock). Spinlock
+       *  contention on the spin-before-sleep path dominated the parallel
+       *  stat hot path; this hint sidesteps it entirely on empty checks. */
+      std::atomic<bool> has_work{false};
+      Task * head = nullptr;
+      Task * tail = nullptr;
+      /** Queued task count, guarded by the spinlock. */
+      uint32_t depth = 0;
+      /** Max depth ever reached. Written under the spinlock, read racily by stats(). */
+      std::atomic<uint32_t> high_water{0};
+
+      /** Acquire the TTAS spinlock. */
+      FSH_FORCE_INLINE void acquire() noexcept {
+        for (;;) {
+          if (!this->lock.exchange(true, std::memory_order_acquire)) [[likely]] {
+            return;
+          }
+          // TTAS: spin on relaxed load (shared cache state) until the lock looks free,
+          // avoiding exclusive bus transactions while another thread holds the lock.
+          do {
+            cpu_pause();
+          } while (this->lock.load(std::memory_order_relaxed));
+        }
+      }
+
+      /** Release the TTAS spinlock. */
+      FSH_FORCE_INLINE void release() noexcept { this->lock.store(false, std::memory_order_release); }
+
+      /** Push a task to the tail. */
+      void push(Task * task) noexcept {
+        task->next_ = nullptr;
+        this->acquire();
+        if (this->tail) {
+          this->tail->next_ = task;
+        } else {
+          this->head = task;
+        }
+        this->tail = task;
+        if (++this->depth > this->high_water.load(std::memory_order_relaxed)) [[unlikely]] {
+          this->high_water.store(this->depth, std::memory_order_relaxed);
+        }
+        // Publish the hint under the spinlock; release()'s release-store
+        // makes both updates visible to anyone who synchronizes-with us.
+        this->has_work.store(true, std::memory_order_relaxed);
+        this->release();
+      }
+
+      /** Pop from the head. Returns nullptr if empty. Always acquires the
+       *  spinlock — use this on the critical re-check path after
+       *  fetch_add(idle_count_) where the lost-wakeup protocol requires
+       *  full sequencing with the producer. */
+      Task * pop() noexcept {
+        this->acquire();
+        Task * task = this->head;
+        if (task) {
+          --this->depth;
+          this->head = task->next_;
+          if (!this->head) {
+            this->tail = nullptr;
+            this->has_work.store(false, std::memory_order_relaxed);
+          }
+        } else {
+          // Defensive: hint may briefly read true after consumers race to drain;
+          // sync it under the lock.
+          this->has_work.store(false, std::memory_order_relaxed);
+        }
+        this->release();
+        return task;
+      }
+
+      /** Hint-checked pop — skips the spinlock acquire when the lane is
+       *  known-empty. Safe for non-critical paths (main worker loop top, spin
+       *  loop, drain). Do NOT use on the lost-wakeup re-check path. */
+      FSH_FORCE_INLINE Task * try_pop() noexcept {
+        if (!this->has_work.load(std::memory_order_relaxed)) [[likely]] {
+          return nullptr;
+        }
+        return this->pop();
+      }
+
+      /** Exact emptiness check under the spinlock. */
+      bool non_empty() noexcept {
+        this->acquire();
+        const bool r = this->head != nullptr;
+        this->release();
+        return r;
+      }
+    };
+
+    Lane lanes_[TASK_PRIORITY_COUNT];
+
+    FSH_FORCE_INLINE Lane & lane_(TaskPriority p) noexcept { return this->lanes_[static_cast<int>(p)]; }
+
+    /** Number of threads currently inside a BACKGROUND task. */
+    alignas(64) std::atomic<int> bg_running_{0};
+
+    static_assert(MAX_WORKERS <= 32, "slot_mask_ is a 32-bit bitmap");
+
+    /** Bitmap of claimed deque slots. A thread claims one on startup and
+     *  releases it in thread_self_exit_. Slots (and their deques) outlive
+     *  the thread, so a thief never touches freed memory. */
+    alignas(64) std::atomic<uint32_t> slot_mask_{0};
+    /** One past the highest slot ever claimed — bounds the steal scan. */
+    std::atomic<int> slot_hi_{0};
+
+    WorkDeque deques_[MAX_WORKERS];
+
+    /** Per-slot counters. Only the slot's owner thread writes, so updates
+     *  are plain relaxed load+store (no lock prefix); stats() reads racily. */
+    struct alignas(64) WorkerStats {
+      std::atomic<uint64_t> tasks{0};
+      /** Found work after the queues came up empty, without blocking. */
+      std::atomic<uint64_t> spin_hits{0};
+      /** Blocked in the kernel on the wake semaphore. */
+      std::atomic<uint64_t> sleeps{0};
+      std::atomic<uint64_t> busy_ns{0};
+      std::atomic<uint64_t> idle_ns{0};
+    };
+
+    WorkerStats worker_stats_[MAX_WORKERS];
+
+    alignas(64) std::atomic<uint64_t> expand_calls_{0};
+
+    static FSH_FORCE_INLINE void bump_(std::atomic<uint64_t> & counter, uint64_t v = 1) noexcept {
+      counter.store(counter.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    static FSH_FORCE_INLINE uint64_t now_ns_() noexcept {
+      return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /** Owning pool and deque slot of the current thread (nullptr / -1 off-pool). */
+    static inline thread_local ThreadPool * tls_pool_ = nullptr;
+    static inline thread_local int tls_slot_ = -1;
+    /** Counters of the current worker's slot (nullptr off-pool). */
+    static inline thread_local WorkerStats * tls_stats_ = nullptr;
+    /** Priority of the task the current thread is running (INTERACTIVE off-pool). */
+    static inline thread_local TaskPriority tls_priority_ = TaskPriority::INTERACTIVE;
 
     alignas(64) Semaphore wake_;
 
@@ -275,76 +515,191 @@ namespace fast_fs_hash {
       return v;
     }
 
-    /** Acquire the TTAS spinlock guarding the task queue. */
-    FSH_FORCE_INLINE void q_acquire_() noexcept {
+    /** Push a task to the tail of its priority lane. */
+    FSH_FORCE_INLINE void push_task_(Task * task) noexcept { this->lane_(task->priority_).push(task); }
+
+    /** Locked pop across lanes in priority order. Returns nullptr if all are empty. */
+    Task * pop_task_() noexcept {
+      Task * task = this->lane_(TaskPriority::INTERACTIVE).pop();
+      if (!task) {
+        task = this->lane_(TaskPriority::BACKGROUND).pop();
+      }
+      return task;
+    }
+
+    /** Run a task under its priority, tracking background occupancy and busy time. */
+    FSH_FORCE_INLINE void run_task_(Task * task) noexcept {
+      // Read before run(): an AddonWorker may be deleted by the JS thread
+      // as soon as it signals.
+      const TaskPriority priority = task->priority_;
+      if (priority != tls_priority_) [[unlikely]] {
+        set_thread_priority_(priority);
+      }
+      const uint64_t start = now_ns_();
+      if (priority == TaskPriority::INTERACTIVE) [[likely]] {
+        task->run();
+      } else {
+        this->bg_running_.fetch_add(1, std::memory_order_relaxed);
+        task->run();
+        this->bg_running_.fetch_sub(1, std::memory_order_relaxed);
+      }
+      WorkerStats * ws = tls_stats_;
+      if (ws) [[likely]] {
+        bump_(ws->tasks);
+        bump_(ws->busy_ns, now_ns_() - start);
+      }
+    }
+
+    /** Switch the calling worker's scheduling class. With
+     *  FAST_FS_HASH_BACKGROUND_IDLE_IO=1 on Linux this also moves the thread
+     *  to the idle I/O class (ioprio is per-thread there) or back to the
+     *  default class derived from the CPU nice value. */
+    static FSH_NO_INLINE void set_thread_priority_(TaskPriority priority) noexcept {
+      tls_priority_ = priority;
+#if defined(__linux__) && defined(SYS_ioprio_set)
+      if (background_idle_io()) {
+        constexpr int IOPRIO_WHO_PROCESS = 1;
+        constexpr int IOPRIO_CLASS_SHIFT = 13;
+        constexpr int IOPRIO_CLASS_IDLE = 3;
+        const int ioprio = priority == TaskPriority::BACKGROUND ? IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT : 0;
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio);
+      }
+#endif
+    }
+
+    /** Deque owned by the calling thread, or nullptr if it isn't one of our workers. */
+    FSH_FORCE_INLINE WorkDeque * local_deque_() noexcept {
+      if (tls_pool_ != this || tls_slot_ < 0 || shared_queue_only()) {
+        return nullptr;
+      }
+      return &this->deques_[tls_slot_];
+    }
+
+    /** Push a ForkJob task to the caller's deque, or to the shared FIFO when
+     *  called off-pool (or the deque is full). */
+    FSH_FORCE_INLINE void push_fork_task_(WorkDeque * local, Task * task) noexcept {
+      if (local && local->push(task)) [[likely]] {
+        return;
+      }
+      this->push_task_(task);
+    }
+
+    /** Claim a free worker slot (deque + stats) for the calling worker.
+     *  Returns -1 if (transiently) none is free — the worker then runs without
+     *  one. With shared_queue_only() the slot's deque stays unused. */
+    int claim_slot_() noexcept {
+      uint32_t mask = this->slot_mask_.load(std::memory_order_relaxed);
       for (;;) {
-        if (!this->q_lock_.exchange(true, std::memory_order_acquire)) [[likely]] {
-          return;
+        if (mask == ~uint32_t{0}) [[unlikely]] {
+          return -1;
+        }
+        const int slot = std::countr_zero(~mask);
+        if (slot >= MAX_WORKERS) [[unlikely]] {
+          return -1;
+        }
+        if (this->slot_mask_.compare_exchange_weak(
+              mask, mask | (uint32_t{1} << slot), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+          int hi = this->slot_hi_.load(std::memory_order_relaxed);
+          while (hi <= slot &&
+                 !this->slot_hi_.compare_exchange_weak(hi, slot + 1, std::memory_order_release, std::memory_order_relaxed)) {
+          }
+          return slot;
         }
-        // TTAS: spin on relaxed load (shared cache state) until the lock looks free,
-        // avoiding exclusive bus transactions while another thread holds the lock.
-        do {
-          cpu_pause();
-        } while (this->q_lock_.load(std::memory_order_relaxed));
       }
     }
 
-    /** Release the TTAS spinlock guarding the task queue. */
-    FSH_FORCE_INLINE void q_release_() noexcept { this->q_lock_.store(false, std::memory_order_release); }
+    /** Release the calling worker's slot. Its deque is empty at this point. */
+    void release_slot_() noexcept {
+      const int slot = tls_slot_;
+      if (slot >= 0) {
+        this->slot_mask_.fetch_and(~(uint32_t{1} << slot), std::memory_order_release);
+      }
+      tls_slot_ = -1;
+      tls_pool_ = nullptr;
+      tls_stats_ = nullptr;
+    }
 
-    /** Push a task to the tail of the FIFO queue. */
-    void push_task_(Task * task) noexcept {
-      task->next_ = nullptr;
-      this->q_acquire_();
-      if (this->q_tail_) {
-        this->q_tail_->next_ = task;
-      } else {
-        this->q_head_ = task;
+    /** Steal one task from any other worker's deque, scanning from self + 1
+     *  so concurrent thieves spread over different victims. Skips victims
+     *  that look empty; the racy check is safe on the lost-wakeup re-check
+     *  path because the caller issues a seq_cst fence first. */
+    Task * steal_any_(int self) noexcept {
+      const int hi = this->slot_hi_.load(std::memory_order_acquire);
+      int i = self;
+      for (int k = 0; k < hi; ++k) {
+        if (++i >= hi) {
+          i = 0;
+        }
+        if (i == self) {
+          continue;
+        }
+        WorkDeque & victim = this->deques_[i];
+        if (victim.looks_empty()) {
+          continue;
+        }
+        Task * task = victim.steal();
+        if (task) {
+          return task;
+        }
       }
-      this->q_tail_ = task;
-      // Publish the hint under the spinlock; q_release_'s release-store
-      // makes both updates visible to anyone who synchronizes-with us.
-      this->q_has_work_.store(true, std::memory_order_relaxed);
-      this->q_release_();
+      return nullptr;
     }
 
-    /** Pop a task from the head of the FIFO queue. Returns nullptr if empty.
-     *  Always acquires the spinlock — use this on the critical re-check path
-     *  after fetch_add(idle_count_) where the lost-wakeup protocol requires
-     *  full sequencing with the producer. */
-    Task * pop_task_() noexcept {
-      this->q_acquire_();
-      Task * task = this->q_head_;
+    /** Next task for a worker: interactive lane, own deque (LIFO), steal,
+     *  then the background lane. */
+    FSH_FORCE_INLINE Task * next_task_(WorkDeque * own, int self) noexcept {
+      Task * task = this->lane_(TaskPriority::INTERACTIVE).try_pop();
       if (task) {
-        this->q_head_ = task->next_;
-        if (!this->q_head_) {
-          this->q_tail_ = nullptr;
-          this->q_has_work_.store(false, std::memory_order_relaxed);
+        return task;
+      }
+      // Owner reads its own bottom exactly and top can only lag low, so
+      // looks_empty() never hides work here — it just skips pop()'s fence.
+      if (own && !own->looks_empty()) {
+        task = own->pop();
+        if (task) {
+          return task;
         }
-      } else {
-        // Defensive: hint may briefly read true after consumers race to drain;
-        // sync it under the lock.
-        this->q_has_work_.store(false, std::memory_order_relaxed);
       }
-      this->q_release_();
-      return task;
+      if (own && this->slot_hi_.load(std::memory_order_relaxed) > 0) {
+        task = this->steal_any_(self);
+        if (task) {
+          return task;
+        }
+      }
+      return this->lane_(TaskPriority::BACKGROUND).try_pop();
     }
 
-    /** Hint-checked pop — skips the spinlock acquire when the queue is
-     *  known-empty. Safe for non-critical paths (main worker loop top, spin
-     *  loop, drain). Do NOT use on the lost-wakeup re-check path. */
-    FSH_FORCE_INLINE Task * try_pop_task_() noexcept {
-      if (!this->q_has_work_.load(std::memory_order_relaxed)) [[likely]] {
-        return nullptr;
+    /** True if any lane or any deque holds a task. */
+    bool has_work_() noexcept {
+      for (Lane & lane : this->lanes_) {
+        if (lane.non_empty()) {
+          return true;
+        }
       }
-      return this->pop_task_();
+      const int hi = this->slot_hi_.load(std::memory_order_acquire);
+      for (int i = 0; i < hi; ++i) {
+        if (!this->deques_[i].looks_empty()) {
+          return true;
+        }
+      }
+      return false;
     }
 
-    /** Drain and execute all remaining tasks in the queue. */
-    void drain_tasks_() noexcept {
-      Task * task;
-      while ((task = this->pop_task_())) {
-        task->run();
+    /** Drain and execute all remaining tasks — own deque, shared FIFO and
+     *  every other deque — until none is left. */
+    void drain_tasks_(WorkDeque * own, int self) noexcept {
+      for (;;) {
+        Task * task = own ? own->pop() : nullptr;
+        if (!task) {
+          task = this->pop_task_();
+        }
+        if (!task) {
+          task = this->steal_any_(self);
+        }
+        if (!task) {
+          return;
+        }
+        this->run_task_(task);
       }
     }
 
@@ -357,38 +712,42 @@ namespace fast_fs_hash {
      *  that its earlier push_task is already visible to a worker that's
      *  about to re-check the queue post-increment. */
     void notify_one_() noexcept {
+      // Orders a deque push (plain relaxed store of bottom_) before the
+      // idle_count_ load; the shared FIFO's spinlock release alone would not.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
       if (this->idle_count_.load(std::memory_order_seq_cst) > 0) {
         this->wake_.post();
       }
     }
 
-    /** Post up to n semaphore wakes, capped by the current idle count.
+    /** Post up to n semaphore wakes, capped by the current idle count, in
+     *  one batched post (a single FUTEX_WAKE on Linux).
      *  Same lost-wakeup guarantee as notify_one_. */
     void notify_n_(int n) noexcept {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
       const int idle = this->idle_count_.load(std::memory_order_seq_cst);
-      const int to_wake = n < idle ? n : idle;
-      for (int i = 0; i < to_wake; ++i) {
-        this->wake_.post();
-      }
+      this->wake_.post(n < idle ? n : idle);
     }
 
-    /** Ensure at least `needed` threads exist, spawning if necessary. */
-    FSH_FORCE_INLINE void ensure_threads_(int needed) noexcept {
+    /** Ensure at least `needed` threads exist (capped by `cap`), spawning if necessary. */
+    FSH_FORCE_INLINE void ensure_threads_(int needed, int cap = max_threads_()) noexcept {
       if (this->thread_count_.load(std::memory_order_acquire) >= needed) [[likely]] {
         return;
       }
-      this->grow_(needed);
+      this->grow_(needed, cap);
     }
 
-    /** Spawn threads up to `needed` (capped by max_threads_). Holds mu_. */
-    FSH_NO_INLINE void grow_(int needed) noexcept {
+    /** Spawn threads up to `needed` (capped by `cap`). Holds mu_. */
+    FSH_NO_INLINE void grow_(int needed, int cap) noexcept {
       if (this->state_.load(std::memory_order_acquire) == STATE_SHUTDOWN) {
         return;
       }
 
       std::lock_guard<std::mutex> lock(this->mu_);
       const int current = this->thread_count_.load(std::memory_order_relaxed);
-      const int cap = max_threads_();
+      if (cap > MAX_WORKERS) [[unlikely]] {
+        cap = MAX_WORKERS;
+      }
       const int target = needed < cap ? needed : cap;
       if (current >= target) {
         return;
@@ -445,10 +804,7 @@ namespace fast_fs_hash {
       // Check for stranded tasks before unregistering. Must be done inside mu_ —
       // after detaching, this thread must not touch pool state (shutdown could
       // destroy the pool once thread_count_ reaches 0).
-      this->q_acquire_();
-      const bool has_work = this->q_head_ != nullptr;
-      this->q_release_();
-      if (has_work) {
+      if (this->has_work_()) {
         return false;
       }
 
@@ -465,16 +821,14 @@ namespace fast_fs_hash {
           }
           this->thread_count_.store(last, std::memory_order_release);
 
-          this->q_acquire_();
-          const bool still_has_work = this->q_head_ != nullptr;
-          this->q_release_();
-          if (still_has_work) {
+          if (this->has_work_()) {
             this->handles_[last] = h;
             this->thread_ids_[last] = my_id;
             this->thread_count_.store(count, std::memory_order_release);
             return false;
           }
 
+          this->release_slot_();
           CloseHandle(h);
           return true;
         }
@@ -489,15 +843,13 @@ namespace fast_fs_hash {
           }
           this->thread_count_.store(last, std::memory_order_release);
 
-          this->q_acquire_();
-          const bool still_has_work = this->q_head_ != nullptr;
-          this->q_release_();
-          if (still_has_work) {
+          if (this->has_work_()) {
             this->threads_[last] = my_tid;
             this->thread_count_.store(count, std::memory_order_release);
             return false;
           }
 
+          this->release_slot_();
           pthread_detach(my_tid);
           return true;
         }
@@ -516,27 +868,37 @@ namespace fast_fs_hash {
     static FSH_NO_INLINE void worker_loop_(ThreadPool * pool) noexcept {
       uint32_t seen_trim_gen = pool->trim_gen_.load(std::memory_order_relaxed);
 
+      const int self = pool->claim_slot_();
+      WorkDeque * own = self >= 0 && !shared_queue_only() ? &pool->deques_[self] : nullptr;
+      WorkerStats * ws = self >= 0 ? &pool->worker_stats_[self] : nullptr;
+      tls_pool_ = pool;
+      tls_slot_ = self;
+      tls_stats_ = ws;
+
       for (;;) {
-        Task * task = pool->try_pop_task_();
+        Task * task = pool->next_task_(own, self);
         if (task) [[likely]] {
-          task->run();
+          pool->run_task_(task);
           continue;
         }
 
         if (pool->state_.load(std::memory_order_acquire) == STATE_SHUTDOWN) [[unlikely]] {
-          pool->drain_tasks_();
+          pool->drain_tasks_(own, self);
           return;
         }
 
         for (int spin = 0; spin < SPIN_BEFORE_WAIT; ++spin) {
           cpu_pause();
-          task = pool->try_pop_task_();
+          task = pool->next_task_(own, self);
           if (task) {
             break;
           }
         }
         if (task) {
-          task->run();
+          if (ws) [[likely]] {
+            bump_(ws->spin_hits);
+          }
+          pool->run_task_(task);
           continue;
         }
 
@@ -546,15 +908,31 @@ namespace fast_fs_hash {
         // then read idle_count_==0, our fetch_add hasn't run yet — but
         // then our pop below will run AFTER the producer's push_task is
         // visible, so we pick the task up rather than sleeping on it.
+        // The fence pairs with the one in notify_* for deque pushes, whose
+        // bottom_ store is relaxed. Our own deque is empty here — only this
+        // thread pushes to it and next_task_ just came back empty.
         pool->idle_count_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
         Task * lateTask = pool->pop_task_();
+        if (!lateTask && own) {
+          lateTask = pool->steal_any_(self);
+        }
         if (lateTask) [[unlikely]] {
           pool->idle_count_.fetch_sub(1, std::memory_order_relaxed);
-          lateTask->run();
+          if (ws) [[likely]] {
+            bump_(ws->spin_hits);
+          }
+          pool->run_task_(lateTask);
           continue;
         }
-        const bool woken = pool->wake_.wait_for_ms(idle_timeout_ms());
+        const uint64_t idle_start = now_ns_();
+        bool slept = false;
+        const bool woken = pool->wake_.wait_for_ms(idle_timeout_ms(), &slept);
         pool->idle_count_.fetch_sub(1, std::memory_order_release);
+        if (ws) [[likely]] {
+          bump_(ws->idle_ns, now_ns_() - idle_start);
+          bump_(slept ? ws->sleeps : ws->spin_hits);
+        }
 
         if (!woken) [[unlikely]] {
           // Timed out — try to self-terminate.
@@ -570,7 +948,7 @@ namespace fast_fs_hash {
           // Drain any remaining tasks before exiting — tasks may have been
           // pushed by expand() just before shutdown, and their forkDone()
           // callbacks must fire to avoid stranded promises.
-          pool->drain_tasks_();
+          pool->drain_tasks_(own, self);
           return;
         }
 
@@ -598,6 +976,60 @@ namespace fast_fs_hash {
 #endif
   };
 
+  /**
+   * Refcounted process-wide ThreadPool.
+   *
+   * Each AddonData acquires it on env init and releases it from its cleanup
+   * hook, after that env's in-flight tasks have completed. The last release
+   * shuts the pool down and joins its threads; a later acquire (e.g. a new
+   * worker_thread after all others exited) creates a fresh one.
+   */
+  class SharedThreadPool {
+   public:
+    /** Take a reference, creating the pool if needed. nullptr on OOM. */
+    static ThreadPool * acquire() noexcept {
+      std::lock_guard<std::mutex> lock(mutex_());
+      State & s = state_();
+      if (!s.pool) {
+        s.pool = new (std::nothrow) ThreadPool();
+        if (!s.pool) [[unlikely]] {
+          return nullptr;
+        }
+      }
+      ++s.refs;
+      return s.pool;
+    }
+
+    /** Drop a reference. The last one shuts down (drain + join) and frees the pool. */
+    static void release() noexcept {
+      ThreadPool * dead = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(mutex_());
+        State & s = state_();
+        if (--s.refs == 0) {
+          dead = s.pool;
+          s.pool = nullptr;
+        }
+      }
+      delete dead;  // ~ThreadPool() shuts down outside the lock
+    }
+
+   private:
+    struct State {
+      ThreadPool * pool = nullptr;
+      int refs = 0;
+    };
+
+    static std::mutex & mutex_() noexcept {
+      static std::mutex m;
+      return m;
+    }
+    static State & state_() noexcept {
+      static State s;
+      return s;
+    }
+  };
+
 }  // namespace fast_fs_hash
 
 #endif
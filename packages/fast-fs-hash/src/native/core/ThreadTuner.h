@@ -0,0 +1,493 @@
+#ifndef _FAST_FS_HASH_THREAD_TUNER_H
+#define _FAST_FS_HASH_THREAD_TUNER_H
+
+#include "ThreadPool.h"
+
+#include <cstdio>
+
+#ifndef _WIN32
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace fast_fs_hash {
+
+  /** Operation classes tuned independently — each stresses the filesystem differently. */
+  enum class TuneOp : uint8_t {
+    /** CacheOpen stat-match: metadata only. */
+    CACHE_STAT = 0,
+    /** Cache writers and CacheOpen re-hash: stat + read + hash. */
+    CACHE_HASH = 1,
+    /** digestFilesParallel & co: open + read + hash. */
+    HASH_FILES = 2,
+  };
+
+  static constexpr int TUNE_OP_COUNT = 3;
+
+  /**
+   * Adaptive per-(operation, device) thread caps for parallel jobs.
+   *
+   * The static caps (MAX_OPEN_THREADS, MAX_CACHE_IO_THREADS, MAX_HASH_THREADS)
+   * were measured on one machine; the best value on ext4/NVMe, overlayfs or
+   * NFS can be very different. When enabled, every large enough call whose
+   * thread count was not limited by its size reports files/s and bytes/s for
+   * the thread count it ran with, and the tuner hill-climbs: after
+   * SAMPLES_PER_STEP samples it moves one thread toward a better (or not yet
+   * measured) neighbor, and stops at a local optimum. A settled profile
+   * re-probes its neighbors every REPROBE_SAMPLES samples to follow drift.
+   *
+   * Throughput is scored as files/s + (bytes/s ÷ 64 KiB): one 64 KiB read
+   * weighs about as much as one open + stat. Samples are folded into a
+   * per-thread-count EWMA.
+   *
+   * Devices are st_dev of the job's root (POSIX); on Windows all paths share
+   * device 0.
+   *
+   * Process-wide, like the pool. Off by default:
+   *   FAST_FS_HASH_AUTOTUNE=1              enable
+   *   FAST_FS_HASH_AUTOTUNE_PROFILE=<path> enable, load the learned profile
+   *                                        at startup and save it at env
+   *                                        teardown
+   *
+   * Samples only mark the profile dirty; record() writes it right away only
+   * when a cap has moved SAVE_MIN_MOVE or more threads from the saved value,
+   * so a crash does not lose a large change. Concurrent processes sharing
+   * the profile each write through their own temp file and rename it over
+   * the target: the last writer wins, no file is ever half-written.
+   */
+  class ThreadTuner : NonCopyable {
+   public:
+    /** Upper bound for any tuned cap. ForkJobs that use the tuner size their task arrays to this. */
+    static constexpr int MAX_THREADS = 16;
+    static constexpr int MAX_PROFILES = 32;
+    static constexpr int SAMPLES_PER_STEP = 3;
+    static constexpr int REPROBE_SAMPLES = 64;
+    /** Calls with fewer work items are too noisy to learn from. */
+    static constexpr size_t MIN_SAMPLE_FILES = 256;
+    static constexpr double HYSTERESIS = 0.05;
+    static constexpr double EWMA_ALPHA = 0.3;
+    /** A cap this far from its saved value is written from record() instead of waiting for flush(). */
+    static constexpr int SAVE_MIN_MOVE = 2;
+
+    struct Cell {
+      double files_per_sec = 0;
+      double bytes_per_sec = 0;
+      uint32_t samples = 0;
+    };
+
+    struct Profile {
+      uint64_t device = 0;
+      TuneOp op = TuneOp::CACHE_STAT;
+      bool used = false;
+      int current = 0;
+      int dir = 1;
+      /** Samples taken at `current` since the last move. */
+      int fresh = 0;
+      /** Samples taken while sitting at a local optimum. */
+      int settled = 0;
+      /** `current` when the profile was last saved, loaded or created. */
+      int saved = 0;
+      Cell cells[MAX_THREADS + 1];  // indexed by thread count, [0] unused
+    };
+
+    static bool enabled() noexcept {
+      static const bool v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_AUTOTUNE");
+        return (env && env[0] == '1' && env[1] == '\0') || profile_path() != nullptr;
+      }();
+      return v;
+    }
+
+    /** FAST_FS_HASH_AUTOTUNE_PROFILE, or nullptr when unset/empty. */
+    static const char * profile_path() noexcept {
+      static const char * v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_AUTOTUNE_PROFILE");
+        return env && env[0] != '\0' ? env : nullptr;
+      }();
+      return v;
+    }
+
+    static ThreadTuner & instance() noexcept {
+      static ThreadTuner tuner;
+      return tuner;
+    }
+
+    /** Device id of a path for profile keying. 0 if unknown. */
+    static uint64_t device_of(const char * path) noexcept {
+#ifdef _WIN32
+      (void)path;
+      return 0;
+#else
+      struct stat st;
+      return ::stat(path, &st) == 0 ? static_cast<uint64_t>(st.st_dev) : 0;
+#endif
+    }
+
+    /** Thread counts the tuner may pick from: [1, min(MAX_THREADS, CPU budget)]. */
+    static int limit() noexcept {
+      int hw = static_cast<int>(ThreadPool::hardware_concurrency());
+      if (hw < 2) [[unlikely]] {
+        hw = 2;
+      }
+      return hw < MAX_THREADS ? hw : MAX_THREADS;
+    }
+
+    /** Current cap for op on device. A new profile starts at `initial`. */
+    int cap(TuneOp op, uint64_t device, int initial) noexcept {
+      std::lock_guard<std::mutex> lock(this->mu_);
+      Profile * p = this->find_or_add_(op, device, initial);
+      return p ? p->current : clamp_(initial);
+    }
+
+    /** Report one finished call that ran with `threads` (its cap). */
+    void record(TuneOp op, uint64_t device, int threads, size_t files, uint64_t bytes, uint64_t ns) noexcept {
+      if (files < MIN_SAMPLE_FILES || ns == 0 || threads < 1 || threads > MAX_THREADS) [[unlikely]] {
+        return;
+      }
+      bool save = false;
+      {
+        std::lock_guard<std::mutex> lock(this->mu_);
+        Profile * p = this->find_or_add_(op, device, threads);
+        if (!p || p->current != threads) {
+          return;  // the cap moved while this call ran — sample is for a stale cap
+        }
+        const double secs = static_cast<double>(ns) * 1e-9;
+        Cell & c = p->cells[threads];
+        const double fps = static_cast<double>(files) / secs;
+        const double bps = static_cast<double>(bytes) / secs;
+        if (c.samples == 0) {
+          c.files_per_sec = fps;
+          c.bytes_per_sec = bps;
+        } else {
+          c.files_per_sec += EWMA_ALPHA * (fps - c.files_per_sec);
+          c.bytes_per_sec += EWMA_ALPHA * (bps - c.bytes_per_sec);
+        }
+        if (c.samples < UINT32_MAX) {
+          ++c.samples;
+        }
+        ++p->fresh;
+        if (this->step_(*p)) {
+          this->dirty_ = true;
+          const int moved = p->current - p->saved;
+          save = moved >= SAVE_MIN_MOVE || moved <= -SAVE_MIN_MOVE;
+        }
+      }
+      if (save) {
+        this->save();
+      }
+    }
+
+    /** Copy up to `cap` live profiles into out. Returns the count. */
+    int snapshot(Profile * out, int cap) const noexcept {
+      std::lock_guard<std::mutex> lock(this->mu_);
+      int n = 0;
+      for (int i = 0; i < MAX_PROFILES && n < cap; ++i) {
+        if (this->profiles_[i].used) {
+          out[n++] = this->profiles_[i];
+        }
+      }
+      return n;
+    }
+
+    /** Save if anything changed since the last save. Called at env teardown. */
+    void flush() noexcept {
+      bool dirty;
+      {
+        std::lock_guard<std::mutex> lock(this->mu_);
+        dirty = this->dirty_;
+      }
+      if (dirty) {
+        this->save();
+      }
+    }
+
+    /** Write all profiles to profile_path() (temp file + rename). No-op without a path. */
+    void save() noexcept {
+      const char * path = profile_path();
+      if (!path) {
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(this->save_mu_);
+      Profile copy[MAX_PROFILES];
+      int n = 0;
+      {
+        std::lock_guard<std::mutex> state(this->mu_);
+        for (Profile & p : this->profiles_) {
+          if (p.used) {
+            p.saved = p.current;
+            copy[n++] = p;
+          }
+        }
+        this->dirty_ = false;
+      }
+      if (!this->write_(path, copy, n)) {
+        std::lock_guard<std::mutex> state(this->mu_);
+        this->dirty_ = true;  // retry at the next save or flush
+      }
+    }
+
+   private:
+    ThreadTuner() noexcept { this->load_(); }
+
+    /** Write n profiles to a temp file unique to this process and call, then rename it over path. */
+    static bool write_(const char * path, const Profile * copy, int n) noexcept {
+#ifdef _WIN32
+      const long pid = static_cast<long>(_getpid());
+#else
+      const long pid = static_cast<long>(::getpid());
+#endif
+      uint64_t nonce = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+      nonce ^= reinterpret_cast<uintptr_t>(&nonce);
+      nonce *= 0x9E3779B97F4A7C15ULL;
+      char tmp[FSH_MAX_PATH + 40];
+      if (std::snprintf(tmp, sizeof(tmp), "%s.%ld-%08x.tmp", path, pid, static_cast<unsigned>(nonce >> 32)) >=
+        static_cast<int>(sizeof(tmp))) {
+        return false;
+      }
+      std::FILE * f = std::fopen(tmp, "w");
+      if (!f) {
+        return false;
+      }
+      bool ok = std::fprintf(f, "fast-fs-hash-autotune 1\n") > 0;
+      for (int i = 0; i < n && ok; ++i) {
+        const Profile & p = copy[i];
+        ok = std::fprintf(f, "%d %llu %d %d", static_cast<int>(p.op),
+          static_cast<unsigned long long>(p.device), p.current, p.dir) > 0;
+        for (int t = 1; t <= MAX_THREADS && ok; ++t) {
+          const Cell & c = p.cells[t];
+          if (c.samples) {
+            ok = std::fprintf(f, " %d:%.17g:%.17g:%u", t, c.files_per_sec, c.bytes_per_sec, c.samples) > 0;
+          }
+        }
+        ok = ok && std::fputc('\n', f) != EOF;
+      }
+      if (std::fclose(f) != 0 || !ok) {
+        std::remove(tmp);
+        return false;
+      }
+      if (std::rename(tmp, path) != 0) {
+        std::remove(path);  // Windows rename does not replace
+        if (std::rename(tmp, path) != 0) {
+          std::remove(tmp);
+          return false;
+        }
+      }
+      return true;
+    }
+
+    static int clamp_(int t) noexcept {
+      const int lim = limit();
+      return t < 1 ? 1 : (t > lim ? lim : t);
+    }
+
+    static double score_(const Cell & c) noexcept { return c.files_per_sec + c.bytes_per_sec * (1.0 / 65536.0); }
+
+    /** Find the (op, device) profile or claim a free / least-sampled slot. Caller holds mu_. */
+    Profile * find_or_add_(TuneOp op, uint64_t device, int initial) noexcept {
+      Profile * victim = nullptr;
+      uint64_t victim_samples = UINT64_MAX;
+      for (Profile & p : this->profiles_) {
+        if (!p.used) {
+          if (victim_samples != 0) {
+            victim = &p;
+            victim_samples = 0;
+          }
+          continue;
+        }
+        if (p.op == op && p.device == device) {
+          p.current = clamp_(p.current);  // the CPU budget may differ from the saving process
+          return &p;
+        }
+        uint64_t total = 0;
+        for (const Cell & c : p.cells) {
+          total += c.samples;
+        }
+        if (total < victim_samples) {
+          victim = &p;
+          victim_samples = total;
+        }
+      }
+      if (victim) {
+        *victim = Profile{};
+        victim->used = true;
+        victim->op = op;
+        victim->device = device;
+        victim->current = clamp_(initial);
+        victim->saved = victim->current;
+      }
+      return victim;
+    }
+
+    /** One hill-climbing step after a sample at p.current. Returns true when the profile changed. */
+    static bool step_(Profile & p) noexcept {
+      if (p.fresh < SAMPLES_PER_STEP) {
+        return false;
+      }
+      const int lim = limit();
+      const int cur = p.current;
+      const double here = score_(p.cells[cur]);
+      const int fwd = cur + p.dir;
+      const int back = cur - p.dir;
+      auto valid = [lim](int t) { return t >= 1 && t <= lim; };
+      auto known = [&](int t) { return valid(t) && p.cells[t].samples > 0; };
+      auto better = [&](int t) { return score_(p.cells[t]) > here * (1.0 + HYSTERESIS); };
+
+      // Keep exploring forward only while the last move paid off.
+      const bool improving = !known(back) || here >= score_(p.cells[back]);
+      int next = 0;
+      if (valid(fwd) && (known(fwd) ? better(fwd) : improving)) {
+        next = fwd;
+      } else if (valid(back) && (known(back) ? better(back) : true)) {
+        p.dir = -p.dir;
+        next = back;
+      }
+
+      if (next) {
+        p.current = next;
+        p.fresh = 0;
+        p.settled = 0;
+        return true;
+      }
+
+      // Local optimum. Periodically forget the neighbors so they get re-measured.
+      if (++p.settled >= REPROBE_SAMPLES) {
+        p.settled = 0;
+        if (valid(cur - 1)) {
+          p.cells[cur - 1].samples = 0;
+        }
+        if (valid(cur + 1)) {
+          p.cells[cur + 1].samples = 0;
+        }
+        return false;
+      }
+      return p.settled == 1;  // just settled
+    }
+
+    /** Parse profile_path(). Malformed lines and out-of-range values are skipped. */
+    void load_() noexcept {
+      const char * path = profile_path();
+      if (!path) {
+        return;
+      }
+      std::FILE * f = std::fopen(path, "r");
+      if (!f) {
+        return;
+      }
+      char line[4096];
+      if (!std::fgets(line, sizeof(line), f) || std::strncmp(line, "fast-fs-hash-autotune 1", 23) != 0) {
+        std::fclose(f);
+        return;
+      }
+      int n = 0;
+      while (n < MAX_PROFILES && std::fgets(line, sizeof(line), f)) {
+        int op = -1;
+        unsigned long long device = 0;
+        int current = 0;
+        int dir = 0;
+        int consumed = 0;
+        if (std::sscanf(line, "%d %llu %d %d%n", &op, &device, &current, &dir, &consumed) != 4) {
+          continue;
+        }
+        if (op < 0 || op >= TUNE_OP_COUNT || current < 1 || current > MAX_THREADS) {
+          continue;
+        }
+        Profile & p = this->profiles_[n];
+        p = Profile{};
+        p.used = true;
+        p.op = static_cast<TuneOp>(op);
+        p.device = static_cast<uint64_t>(device);
+        p.current = current;
+        p.saved = current;
+        p.dir = dir < 0 ? -1 : 1;
+        p.fresh = 0;
+        const char * s = line + consumed;
+        int t = 0;
+        double fps = 0;
+        double bps = 0;
+        unsigned samples = 0;
+        int used = 0;
+        while (std::sscanf(s, " %d:%lf:%lf:%u%n", &t, &fps, &bps, &samples, &used) == 4) {
+          s += used;
+          if (t >= 1 && t <= MAX_THREADS && fps >= 0 && bps >= 0) {
+            p.cells[t] = Cell{fps, bps, samples};
+          }
+        }
+        ++n;
+      }
+      std::fclose(f);
+    }
+
+    mutable std::mutex mu_;
+    std::mutex save_mu_;
+    Profile profiles_[MAX_PROFILES];
+    /** A profile changed since the last save. Guarded by mu_. */
+    bool dirty_ = false;
+  };
+
+  /**
+   * ThreadTuner bookkeeping for one fork-join run, embedded in the worker.
+   *
+   *   int cap = tuned.begin(op, root, work, STATIC_MAX);  // before compute_threads
+   *   tuned.submitted(threadCount);                       // right before submit
+   *   tuned.bytes.fetch_add(...)                          // workers, optional
+   *   tuned.finish();                                     // in forkDone, if not cancelled
+   *
+   * Only runs that got the full cap are sampled: a run shrunk by its work
+   * size says nothing about the cap.
+   */
+  struct TunedRun {
+    std::atomic<uint64_t> bytes{0};
+
+    /** Thread cap for this run: `fallback` unless autotuning applies. */
+    int begin(TuneOp op, const char * root, size_t work, int fallback) noexcept {
+      this->op_ = op;
+      this->work_ = work;
+      this->cap_ = 0;
+      this->threads_ = 0;
+      this->bytes.store(0, std::memory_order_relaxed);
+      if (work < ThreadTuner::MIN_SAMPLE_FILES || !ThreadTuner::enabled()) {
+        return fallback;
+      }
+      this->device_ = ThreadTuner::device_of(root);
+      this->cap_ = ThreadTuner::instance().cap(op, this->device_, fallback);
+      return this->cap_;
+    }
+
+    /** Start the clock if threadCount is the full tuned cap. */
+    void submitted(int threadCount) noexcept {
+      if (this->cap_ != 0 && threadCount == this->cap_) {
+        this->threads_ = threadCount;
+        this->start_ = now_ns_();
+      }
+    }
+
+    /** Report the run. No-op when it was not sampled. */
+    void finish() noexcept {
+      if (this->threads_) {
+        ThreadTuner::instance().record(this->op_, this->device_, this->threads_, this->work_,
+          this->bytes.load(std::memory_order_relaxed), now_ns_() - this->start_);
+      }
+    }
+
+    /** True when begin() consulted the tuner (autotuning on, work large enough). */
+    bool active() const noexcept { return this->cap_ != 0; }
+    uint64_t device() const noexcept { return this->device_; }
+
+   private:
+    static uint64_t now_ns_() noexcept {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    TuneOp op_ = TuneOp::CACHE_STAT;
+    size_t work_ = 0;
+    int cap_ = 0;
+    int threads_ = 0;
+    uint64_t device_ = 0;
+    uint64_t start_ = 0;
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef _FAST_FS_HASH_WORK_DEQUE_H
+#define _FAST_FS_HASH_WORK_DEQUE_H
+
+#include "AddonTask.h"
+
+namespace fast_fs_hash {
+
+  /**
+   * Bounded Chase-Lev work-stealing deque of AddonTask pointers.
+   *
+   * One owner thread pushes and pops at the bottom (LIFO, no atomic RMW on
+   * the fast path); any other thread may steal from the top (FIFO, one CAS).
+   * Memory ordering follows Lê et al., "Correct and Efficient Work-Stealing
+   * for Weak Memory Models" (PPoPP 2013).
+   *
+   * The ring is fixed-size: push() returns false when full and the caller
+   * falls back to the pool's shared FIFO. A ForkJob never has more than
+   * MAX_WORKERS slots, so overflow only happens under pathological nesting.
+   */
+  class WorkDeque : NonCopyable {
+   public:
+    static constexpr int64_t CAPACITY = 64;
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    /** Owner only. Returns false if the ring is full. */
+    FSH_FORCE_INLINE bool push(AddonTask * task) noexcept {
+      const int64_t b = this->bottom_.load(std::memory_order_relaxed);
+      const int64_t t = this->top_.load(std::memory_order_acquire);
+      if (b - t >= CAPACITY) [[unlikely]] {
+        return false;
+      }
+      this->buf_[b & MASK].store(task, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      this->bottom_.store(b + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+    /** Owner only. Pops the most recently pushed task, or nullptr if empty. */
+    FSH_FORCE_INLINE AddonTask * pop() noexcept {
+      const int64_t b = this->bottom_.load(std::memory_order_relaxed) - 1;
+      this->bottom_.store(b, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t t = this->top_.load(std::memory_order_relaxed);
+      if (t > b) [[likely]] {
+        // Empty — restore.
+        this->bottom_.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      AddonTask * task = this->buf_[b & MASK].load(std::memory_order_relaxed);
+      if (t == b) {
+        // Last element — race against concurrent thieves for it.
+        if (!this->top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+          task = nullptr;
+        }
+        this->bottom_.store(b + 1, std::memory_order_relaxed);
+      }
+      return task;
+    }
+
+    /** Any thread. Takes the oldest task, or nullptr if empty or the CAS lost a race. */
+    FSH_FORCE_INLINE AddonTask * steal() noexcept {
+      int64_t t = this->top_.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const int64_t b = this->bottom_.load(std::memory_order_acquire);
+      if (t >= b) {
+        return nullptr;
+      }
+      AddonTask * task = this->buf_[t & MASK].load(std::memory_order_relaxed);
+      if (!this->top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+      }
+      return task;
+    }
+
+    /** Racy emptiness hint — two relaxed loads, no fences. Use to skip
+     *  obviously-empty victims before paying for steal(). */
+    FSH_FORCE_INLINE bool looks_empty() const noexcept {
+      return this->bottom_.load(std::memory_order_relaxed) <= this->top_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    static constexpr int64_t MASK = CAPACITY - 1;
+
+    /** Thieves CAS top_; the owner writes bottom_. Separate lines avoid
+     *  ping-ponging the owner's fast path on every steal attempt. */
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<AddonTask *> buf_[CAPACITY]{};
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
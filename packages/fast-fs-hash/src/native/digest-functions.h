@@ -115,7 +115,10 @@ namespace digest_functions {
     return info[1];
   }
 
-  /** digestFileTo(path, out, outOffset?, throwOnError?) → Promise<out> */
+  /** digestFileTo(path, out, outOffset?, throwOnError?) → Promise<out>
+   *  While HashFileWorker::inlineGate() predicts a small, cached file, the file
+   *  is opened and fstat'ed here and hashed inline if it is at most
+   *  inlineMaxFileBytes(); a larger one goes to the pool with the handle open. */
   static Napi::Value digestFileTo(const Napi::CallbackInfo & info) {
     auto env = info.Env();
 
@@ -138,11 +141,22 @@ namespace digest_functions {
     auto deferred = Napi::Promise::Deferred::New(env);
     auto * worker = new HashFileWorker(env, deferred, info[0].As<Napi::String>().Utf8Value(), throw_on_error);
     worker->setExternalOutput(out.Data() + outOffset, Napi::ObjectReference::New(out, 1));
-    worker->Queue();
+    if (!HashFileWorker::inlineGate().shouldInline()) {
+      worker->Queue();
+      return deferred.Promise();
+    }
+    fast_fs_hash::FfshFile fh(worker->path().c_str());
+    const int64_t size = fh ? fh.fsize() : 0;
+    worker->setFile(std::move(fh));
+    if (size >= 0 && static_cast<uint64_t>(size) <= fast_fs_hash::inlineMaxFileBytes()) {
+      worker->RunInline();
+    } else {
+      worker->Queue();
+    }
     return deferred.Promise();
   }
 
-  /** encodedPathsDigestFilesParallelTo(pathsBuf, concurrency, output, outputOffset?, throwOnError?) → Promise */
+  /** encodedPathsDigestFilesParallelTo(pathsBuf, concurrency, output, outputOffset?, throwOnError?, priority?) → Promise */
   static Napi::Value encodedPathsDigestFilesParallelTo(const Napi::CallbackInfo & info) {
     auto env = info.Env();
     auto paths = info[0].As<Napi::Uint8Array>();
@@ -170,11 +184,11 @@ namespace digest_functions {
     auto * worker = new StaticHashFilesWorker(env, deferred, concurrency, throw_on_error);
     worker->setPaths(Napi::ObjectReference::New(paths, 1), paths.Data(), paths.ElementLength());
     worker->setExternalOutput(output.Data() + outputOffset, available, Napi::ObjectReference::New(output, 1));
-    worker->Queue();
+    worker->Queue(fast_fs_hash::readTaskPriority(info, 5));
     return deferred.Promise();
   }
 
-  /** encodedPathsDigestFilesSequentialTo(pathsBuf, output, outputOffset?, throwOnError?) → Promise<output> */
+  /** encodedPathsDigestFilesSequentialTo(pathsBuf, output, outputOffset?, throwOnError?, priority?) → Promise<output> */
   static Napi::Value encodedPathsDigestFilesSequentialTo(const Napi::CallbackInfo & info) {
     auto env = info.Env();
     auto paths = info[0].As<Napi::Uint8Array>();
@@ -201,7 +215,7 @@ namespace digest_functions {
     auto * worker = new HashSequentialWorker(env, deferred, throw_on_error);
     worker->setPaths(Napi::ObjectReference::New(paths, 1), paths.Data(), paths.ElementLength());
     worker->setExternalOutput(output.Data() + outputOffset, available, Napi::ObjectReference::New(output, 1));
-    worker->Queue();
+    worker->Queue(fast_fs_hash::readTaskPriority(info, 4));
     return deferred.Promise();
   }
 
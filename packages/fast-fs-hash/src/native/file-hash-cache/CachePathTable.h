@@ -0,0 +1,129 @@
+#ifndef _FAST_FS_HASH_CACHE_PATH_TABLE_H
+#define _FAST_FS_HASH_CACHE_PATH_TABLE_H
+
+#include "file-hash-cache-format.h"
+#include "OwnedBuf.h"
+
+namespace fast_fs_hash {
+
+  /**
+   * Relative path → entry index lookup over one encoded file list
+   * (NUL-separated, sorted, as built by encodeNormalizedPaths).
+   *
+   * Holds only the start offset of every path. The encoded paths stay in
+   * their JS Buffer and are passed to each find(), which reads nothing
+   * unless their length is the one the table was built from.
+   *
+   * JS sorts paths by UTF-16 code unit and find() compares bytes. The two
+   * orders agree for any key without a character at or above U+E000 (UTF-8
+   * lead byte 0xEE or higher), whatever the list holds; such a key is
+   * looked up by a linear scan instead of the binary search.
+   */
+  class CachePathTable : NonCopyable {
+   public:
+    /** Tag checked on every External unwrap; cleared on destruction. */
+    static constexpr uint64_t MAGIC = 0x4646'5348'5061'7468ULL;  // "FFSHPath"
+    uint64_t magic = MAGIC;
+
+    /** Index the `fileCount` paths of `paths`. nullptr when they are not
+     *  exactly fileCount NUL-terminated segments, or on OOM. */
+    static CachePathTable * create(const uint8_t * paths, size_t len, uint32_t fileCount) noexcept {
+      if (fileCount == 0 || fileCount > CACHE_MAX_FILE_COUNT || len > UINT32_MAX) {
+        return nullptr;
+      }
+      auto * t = new (std::nothrow) CachePathTable();
+      if (!t) [[unlikely]] {
+        return nullptr;
+      }
+      t->starts_ = OwnedBuf<uint32_t>::alloc(static_cast<size_t>(fileCount) + 1);
+      if (!t->starts_) [[unlikely]] {
+        delete t;
+        return nullptr;
+      }
+      uint32_t * const starts = t->starts_.ptr;
+      const uint8_t * const end = paths + len;
+      const uint8_t * p = paths;
+      uint32_t n = 0;
+      while (p < end && n < fileCount) {
+        const auto * nul = static_cast<const uint8_t *>(memchr(p, 0, static_cast<size_t>(end - p)));
+        if (!nul) {
+          break;
+        }
+        starts[n++] = static_cast<uint32_t>(p - paths);
+        p = nul + 1;
+      }
+      if (n != fileCount || p != end) {
+        delete t;
+        return nullptr;
+      }
+      starts[n] = static_cast<uint32_t>(len);
+      t->len_ = len;
+      t->fileCount_ = fileCount;
+      return t;
+    }
+
+    ~CachePathTable() noexcept { this->magic = 0; }
+
+    uint32_t fileCount() const noexcept { return this->fileCount_; }
+
+    /** Index of `key` in `paths` (the buffer the table was built from), or -1. */
+    int64_t find(const uint8_t * paths, size_t len, const uint8_t * key, size_t keyLen) const noexcept {
+      if (len != this->len_ || keyLen == 0) {
+        return -1;
+      }
+      const uint32_t * const starts = this->starts_.ptr;
+      const auto cmp = [&](uint32_t i) noexcept -> int {
+        const uint32_t s = starts[i];
+        const size_t segLen = starts[i + 1] - 1 - s;
+        const int c = memcmp(paths + s, key, segLen < keyLen ? segLen : keyLen);
+        if (c != 0 || segLen == keyLen) {
+          return c;
+        }
+        return segLen < keyLen ? -1 : 1;
+      };
+
+      bool byteOrdered = true;
+      for (size_t i = 0; i < keyLen; ++i) {
+        if (key[i] >= 0xEE) {
+          byteOrdered = false;
+          break;
+        }
+      }
+      if (!byteOrdered) [[unlikely]] {
+        for (uint32_t i = 0; i < this->fileCount_; ++i) {
+          if (starts[i + 1] - 1 - starts[i] == keyLen && cmp(i) == 0) {
+            return i;
+          }
+        }
+        return -1;
+      }
+
+      uint32_t lo = 0;
+      uint32_t hi = this->fileCount_;
+      while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const int c = cmp(mid);
+        if (c == 0) {
+          return mid;
+        }
+        if (c < 0) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return -1;
+    }
+
+   private:
+    /** fileCount + 1 offsets: path i is [starts_[i], starts_[i + 1] - 1), then its NUL. */
+    OwnedBuf<uint32_t> starts_;
+    size_t len_ = 0;
+    uint32_t fileCount_ = 0;
+
+    CachePathTable() noexcept = default;
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
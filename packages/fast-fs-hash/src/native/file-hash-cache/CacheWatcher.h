@@ -0,0 +1,433 @@
+#ifndef _FAST_FS_HASH_CACHE_WATCHER_H
+#define _FAST_FS_HASH_CACHE_WATCHER_H
+
+#include "file-hash-cache-format.h"
+#include "OwnedBuf.h"
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<sys/inotify.h>)
+#  include <sys/inotify.h>
+#  define FSH_INOTIFY_WATCH 1
+#endif
+
+#ifndef FSH_INOTIFY_WATCH
+#  define FSH_INOTIFY_WATCH 0
+#endif
+
+namespace fast_fs_hash {
+
+  /**
+   * Native file watcher for one FileHashCache file list (Linux inotify).
+   *
+   * Watches the directory of every tracked entry, plus each of their
+   * ancestors up to the root, and records the indices of entries the
+   * kernel reports as written, created, deleted, renamed or chmod'ed in a
+   * bitset. CacheOpen takes that set as its dirty hint, so watch mode needs
+   * neither JS invalidate() calls nor any path parsing on open.
+   *
+   * There is no watcher thread: the inotify queue is drained without
+   * blocking whenever the set is read (take / pending). Events are kept by
+   * the kernel in between, up to fs.inotify.max_queued_events. create()
+   * adds no watches; the first take() does, on the open's worker, and
+   * reports ALL.
+   *
+   * Conservative fallbacks, all of which only cost stats:
+   *  - A queue overflow (IN_Q_OVERFLOW) marks every entry dirty.
+   *  - A tracked directory (or an ancestor) created, deleted, renamed or
+   *    unmounted marks every entry dirty, and the watches are re-armed on
+   *    the next take.
+   *  - Entries whose directory (or an ancestor) could not be watched —
+   *    missing, or the per-user watch limit (ENOSPC) reached — are dirty
+   *    on every take.
+   *  - Entries that are symlinks are dirty on every take: their target may
+   *    live in a directory that is not watched. An entry is re-checked
+   *    whenever its name is created or renamed over.
+   *
+   * Blind spots of inotify itself, which the watcher inherits:
+   *  - The root directory itself must stay in place: renaming one of its
+   *    own ancestors is not seen.
+   *  - Writes through a hardlink in an unwatched directory are not seen.
+   *  - Writes through a shared writable mmap raise no event until the
+   *    writer's munmap/close (IN_CLOSE_WRITE), and none at all for a
+   *    mapping that outlives the file descriptor.
+   *  - Network and FUSE filesystems (NFS, SMB, sshfs, ...) report only the
+   *    changes made through this host; edits made by other clients are
+   *    not seen.
+   * Callers that rely on any of these must invalidate() the entries
+   * themselves or open without watch mode.
+   *
+   * take() runs on pool threads, pending() and close() on the JS thread;
+   * one mutex guards all state.
+   */
+  class CacheWatcher : NonCopyable {
+   public:
+    /** take() result when every entry must be stat-matched. */
+    static constexpr uint32_t ALL = UINT32_MAX;
+
+    /** Tag checked on every External unwrap; cleared on destruction. */
+    static constexpr uint64_t MAGIC = 0x4646'5348'5761'7463ULL;  // "FFSHWatc"
+    uint64_t magic = MAGIC;
+
+    static constexpr bool supported() noexcept { return FSH_INOTIFY_WATCH != 0; }
+
+    /**
+     * Watch the `fileCount` NUL-separated relative `paths` under `rootPath`.
+     * Returns nullptr when watching is unsupported, the paths are malformed,
+     * or inotify_init1 fails (e.g. fs.inotify.max_user_instances reached).
+     */
+    static CacheWatcher * create(
+      const std::string & rootPath, const uint8_t * paths, size_t pathsLen, uint32_t fileCount) noexcept {
+#if FSH_INOTIFY_WATCH
+      if (fileCount == 0) {
+        return nullptr;
+      }
+      auto * w = new (std::nothrow) CacheWatcher();
+      if (!w) [[unlikely]] {
+        return nullptr;
+      }
+      if (!w->build_(rootPath, paths, pathsLen, fileCount)) [[unlikely]] {
+        delete w;
+        return nullptr;
+      }
+      w->fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if (w->fd_ < 0) {
+        delete w;
+        return nullptr;
+      }
+      // Nothing is known until the watches exist: the first take arms them
+      // and reports ALL, so the stat-match that follows runs after arming.
+      w->all_ = true;
+      w->rearm_ = true;
+      return w;
+#else
+      (void)rootPath;
+      (void)paths;
+      (void)pathsLen;
+      (void)fileCount;
+      return nullptr;
+#endif
+    }
+
+    ~CacheWatcher() noexcept {
+      this->close();
+      this->magic = 0;
+    }
+
+    uint32_t fileCount() const noexcept { return this->fileCount_; }
+
+    /** XXH3-64 of the encoded paths the watcher was built from. */
+    uint64_t pathsHash() const noexcept { return this->pathsHash_; }
+
+    /** uint64_t words of a dirty bitset for fileCount() entries. */
+    size_t words() const noexcept { return (static_cast<size_t>(this->fileCount_) + 63) / 64; }
+
+    /**
+     * Drain pending events and move the dirty set into `bits` (words()
+     * words, fully overwritten). Returns the number of dirty entries, or
+     * ALL when every entry must be stat-matched (overflow, structural
+     * change, or the watcher is closed).
+     */
+    uint32_t take(uint64_t * bits) noexcept {
+      std::lock_guard<std::mutex> lock(this->mu_);
+      if (this->fd_ < 0) {
+        return ALL;
+      }
+      this->drain_();
+      if (this->rearm_) {
+        this->rearm_ = false;
+        this->arm_();
+      }
+      uint64_t * const dirty = this->dirty_.ptr;
+      const uint64_t * const unwatched = this->unwatched_.ptr;
+      const size_t n = this->words();
+      if (this->all_) {
+        this->all_ = false;
+        this->anyDirty_ = false;
+        memset(dirty, 0, n * sizeof(uint64_t));
+        return ALL;
+      }
+      uint32_t count = 0;
+      for (size_t w = 0; w < n; ++w) {
+        const uint64_t v = dirty[w] | unwatched[w];
+        bits[w] = v;
+        dirty[w] = 0;
+        count += static_cast<uint32_t>(std::popcount(v));
+      }
+      this->anyDirty_ = false;
+      return count;
+    }
+
+    /** Drain pending events; true when the next take() would report anything dirty. */
+    bool pending() noexcept {
+      std::lock_guard<std::mutex> lock(this->mu_);
+      if (this->fd_ < 0) {
+        return true;
+      }
+      this->drain_();
+      return this->all_ || this->anyDirty_ || this->anyUnwatched_;
+    }
+
+    /** Stop watching. Later takes return ALL. */
+    void close() noexcept {
+      std::lock_guard<std::mutex> lock(this->mu_);
+      if (this->fd_ >= 0) {
+        ::close(this->fd_);
+        this->fd_ = -1;
+      }
+    }
+
+   private:
+    struct Dir {
+      std::string_view path;  // relative, no trailing slash; "" is the root
+      uint32_t parent;
+      int wd;
+      bool hasFiles;
+      bool covered;  // this directory and all its ancestors are watched
+    };
+
+    /** A tracked name inside a directory: a file entry or a subdirectory. */
+    struct Child {
+      uint32_t parent;
+      uint32_t target;  // entry index, or Dir index when isDir
+      bool isDir;
+      std::string_view name;
+
+      bool operator<(const Child & o) const noexcept {
+        return this->parent != o.parent ? this->parent < o.parent : this->name < o.name;
+      }
+    };
+
+    std::mutex mu_;
+    int fd_ = -1;
+    uint32_t fileCount_ = 0;
+    uint64_t pathsHash_ = 0;
+    bool all_ = false;
+    bool rearm_ = false;
+    bool anyDirty_ = false;
+    bool anyUnwatched_ = false;
+
+    std::string root_;  // with trailing slash
+    OwnedBuf<> paths_;  // private copy; Dir and Child views point into it
+    std::vector<Dir> dirs_;
+    std::vector<Child> children_;
+    std::unordered_map<std::string_view, uint32_t> dirIds_;
+    std::unordered_map<int, uint32_t> wdDirs_;
+    OwnedBuf<uint32_t> entryDir_;
+    OwnedBuf<uint64_t> dirty_;
+    OwnedBuf<uint64_t> unwatched_;
+
+    CacheWatcher() noexcept = default;
+
+    uint32_t dirId_(std::string_view dir) {
+      const auto it = this->dirIds_.find(dir);
+      if (it != this->dirIds_.end()) {
+        return it->second;
+      }
+      const size_t slash = dir.rfind('/');
+      const uint32_t parent = slash == std::string_view::npos ? 0 : this->dirId_(dir.substr(0, slash));
+      const std::string_view name = slash == std::string_view::npos ? dir : dir.substr(slash + 1);
+      const auto id = static_cast<uint32_t>(this->dirs_.size());
+      this->dirs_.push_back({dir, parent, -1, false, false});
+      this->dirIds_.emplace(dir, id);
+      this->children_.push_back({parent, id, true, name});
+      return id;
+    }
+
+    bool build_(const std::string & rootPath, const uint8_t * paths, size_t pathsLen, uint32_t fileCount) noexcept {
+      this->fileCount_ = fileCount;
+      this->pathsHash_ = XXH3_64bits(paths, pathsLen);
+      this->root_ = rootPath;
+      if (this->root_.empty() || this->root_.back() != '/') {
+        this->root_.push_back('/');
+      }
+      this->paths_ = OwnedBuf<>::alloc(pathsLen + 1);
+      this->entryDir_ = OwnedBuf<uint32_t>::alloc(fileCount);
+      this->dirty_ = OwnedBuf<uint64_t>::calloc(this->words());
+      this->unwatched_ = OwnedBuf<uint64_t>::calloc(this->words());
+      if (!this->paths_ || !this->entryDir_ || !this->dirty_ || !this->unwatched_) [[unlikely]] {
+        return false;
+      }
+      memcpy(this->paths_.ptr, paths, pathsLen);
+      this->paths_.ptr[pathsLen] = 0;
+
+      this->dirs_.push_back({std::string_view(), 0, -1, false, false});
+      this->dirIds_.emplace(std::string_view(), 0);
+      this->children_.reserve(fileCount);
+
+      const auto * const base = reinterpret_cast<const char *>(this->paths_.ptr);
+      size_t start = 0;
+      uint32_t i = 0;
+      for (size_t p = 0; p <= pathsLen; ++p) {
+        if (p < pathsLen && base[p] != 0) {
+          continue;
+        }
+        if (p > start) {
+          if (i == fileCount) [[unlikely]] {
+            return false;
+          }
+          const std::string_view path(base + start, p - start);
+          const size_t slash = path.rfind('/');
+          const uint32_t dir = slash == std::string_view::npos ? 0 : this->dirId_(path.substr(0, slash));
+          this->dirs_[dir].hasFiles = true;
+          this->entryDir_.ptr[i] = dir;
+          this->children_.push_back({dir, i, false, slash == std::string_view::npos ? path : path.substr(slash + 1)});
+          ++i;
+        }
+        start = p + 1;
+      }
+      if (i != fileCount) [[unlikely]] {
+        return false;
+      }
+      std::sort(this->children_.begin(), this->children_.end());
+      return true;
+    }
+
+#if FSH_INOTIFY_WATCH
+    static constexpr uint32_t STRUCTURE_EVENTS =
+      IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    static constexpr uint32_t FILE_EVENTS = STRUCTURE_EVENTS | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE;
+
+    /** (Re-)add a watch for every directory, and lstat every entry for
+     *  symlinks. Adding a watch for an inode that already has one returns
+     *  the same descriptor; descriptors no directory maps to any more are
+     *  removed. */
+    void arm_() noexcept {
+      std::unordered_map<int, uint32_t> old = std::move(this->wdDirs_);
+      this->wdDirs_.clear();
+      this->wdDirs_.reserve(this->dirs_.size());
+      std::string path;
+      bool full = false;
+      for (size_t d = 0; d < this->dirs_.size(); ++d) {
+        Dir & dir = this->dirs_[d];
+        dir.wd = -1;
+        if (!full) {
+          path.assign(this->root_);
+          path.append(dir.path);
+          dir.wd = ::inotify_add_watch(this->fd_, path.c_str(), dir.hasFiles ? FILE_EVENTS : STRUCTURE_EVENTS);
+          if (dir.wd < 0 && (errno == ENOSPC || errno == ENOMEM)) {
+            full = true;  // watch limit: leave the rest to per-open stats
+          }
+        }
+        if (dir.wd >= 0) {
+          this->wdDirs_[dir.wd] = static_cast<uint32_t>(d);
+          old.erase(dir.wd);
+        }
+        // Parents always precede their children in dirs_.
+        dir.covered = dir.wd >= 0 && (d == 0 || this->dirs_[dir.parent].covered);
+      }
+      for (const auto & [wd, unused] : old) {
+        ::inotify_rm_watch(this->fd_, wd);
+      }
+
+      memset(this->unwatched_.ptr, 0, this->words() * sizeof(uint64_t));
+      for (const Child & c : this->children_) {
+        if (!c.isDir) {
+          this->classify_(c, path);
+        }
+      }
+      this->anyUnwatched_ = this->hasUnwatched_();
+    }
+
+    /** Set or clear the unwatched bit of entry `c`: its directory chain is
+     *  not covered, or it is a symlink. `path` is scratch. */
+    void classify_(const Child & c, std::string & path) noexcept {
+      bool unwatched = !this->dirs_[c.parent].covered;
+      if (!unwatched) {
+        path.assign(this->root_);
+        const std::string_view dir = this->dirs_[c.parent].path;
+        if (!dir.empty()) {
+          path.append(dir);
+          path.push_back('/');
+        }
+        path.append(c.name);
+        struct stat st;
+        unwatched = ::lstat(path.c_str(), &st) == 0 && S_ISLNK(st.st_mode);
+      }
+      const uint64_t bit = uint64_t{1} << (c.target & 63);
+      if (unwatched) {
+        this->unwatched_.ptr[c.target >> 6] |= bit;
+      } else {
+        this->unwatched_.ptr[c.target >> 6] &= ~bit;
+      }
+    }
+
+    bool hasUnwatched_() const noexcept {
+      const uint64_t * const unwatched = this->unwatched_.ptr;
+      for (size_t w = 0, n = this->words(); w < n; ++w) {
+        if (unwatched[w] != 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void drain_() noexcept {
+      alignas(struct inotify_event) char buf[16384];
+      for (;;) {
+        const ssize_t n = ::read(this->fd_, buf, sizeof(buf));
+        if (n <= 0) {
+          if (n < 0 && errno == EINTR) {
+            continue;
+          }
+          return;  // EAGAIN: queue empty
+        }
+        for (ssize_t off = 0; off < n;) {
+          const auto * ev = reinterpret_cast<const struct inotify_event *>(buf + off);
+          this->onEvent_(*ev);
+          off += static_cast<ssize_t>(sizeof(struct inotify_event) + ev->len);
+        }
+      }
+    }
+
+    void onEvent_(const struct inotify_event & ev) noexcept {
+      if (ev.mask & IN_Q_OVERFLOW) [[unlikely]] {
+        this->all_ = true;
+        return;
+      }
+      const auto it = this->wdDirs_.find(ev.wd);
+      if (it == this->wdDirs_.end()) {
+        return;  // a watch arm_ just removed
+      }
+      if (ev.mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_IGNORED)) {
+        this->all_ = true;
+        this->rearm_ = true;
+        return;
+      }
+      if (ev.len == 0) {
+        return;
+      }
+      const Child key{it->second, 0, false, std::string_view(ev.name)};
+      const auto c = std::lower_bound(this->children_.begin(), this->children_.end(), key);
+      if (c == this->children_.end() || c->parent != key.parent || c->name != key.name) {
+        return;
+      }
+      if (!c->isDir) {
+        this->dirty_.ptr[c->target >> 6] |= uint64_t{1} << (c->target & 63);
+        this->anyDirty_ = true;
+        if (ev.mask & (IN_CREATE | IN_MOVED_TO)) {
+          // A new inode under this name: it may be (or no longer be) a symlink.
+          std::string path;
+          this->classify_(*c, path);
+          this->anyUnwatched_ = this->hasUnwatched_();
+        }
+      } else if (ev.mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) {
+        this->all_ = true;
+        this->rearm_ = true;
+      }
+    }
+#else
+    void arm_() noexcept {}
+    void drain_() noexcept {}
+#endif
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef _FAST_FS_HASH_DECODED_CACHE_REGISTRY_H
+#define _FAST_FS_HASH_DECODED_CACHE_REGISTRY_H
+
+#include "../includes.h"
+#include "OwnedBuf.h"
+#include "HashMemo.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fast_fs_hash {
+
+  /** Default FAST_FS_HASH_DECODED_CACHE_MAX. */
+  static constexpr size_t DECODED_CACHE_DEFAULT_MAX = 64u << 20;  // 64 MiB
+
+  /**
+   * Process-wide LRU of decoded cache-file images, keyed by (cache path,
+   * FileIdentity of the cache file).
+   *
+   * CacheOpen re-opens the same cache over and over in watch mode and across
+   * worker_threads. When the file's identity is unchanged the bytes on disk
+   * are too, so the open can clone the resident image (one memcpy) instead
+   * of pread + LZ4 decompress + packed-path validation.
+   *
+   * The identity only proves that once it is settled (HashMemo::settled):
+   * writers patch caches in place at the same size, so two writes within
+   * one timestamp tick can leave it unchanged. An image whose identity was
+   * not settled when its read started is never kept, and every cache write
+   * invalidates the path's image before it touches the file.
+   *
+   * Images are stored exactly as readOldCache_ produced them — before any
+   * ino state bits are set — and every hit gets a private copy, since the
+   * stat-match and JS mutate dataBuf. A path's first decode only records
+   * the path; the image is kept from the second decode on, so a process
+   * that opens each cache once never pays for the extra copy.
+   *
+   * Bounded by FAST_FS_HASH_DECODED_CACHE_MAX bytes (optional k/m suffix,
+   * default DECODED_CACHE_DEFAULT_MAX, 0 disables) and MAX_SLOTS paths;
+   * least recently used images are evicted first. Images are refcounted so
+   * the copy for a hit runs outside the lock.
+   */
+  class DecodedCacheRegistry : NonCopyable {
+   public:
+    static constexpr size_t MAX_SLOTS = 64;
+
+    /** Byte budget for resident images; 0 = registry off. */
+    static size_t capacity() noexcept {
+      static const size_t v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_DECODED_CACHE_MAX");
+        if (!env || env[0] == '\0') {
+          return DECODED_CACHE_DEFAULT_MAX;
+        }
+        char * end = nullptr;
+        unsigned long long val = std::strtoull(env, &end, 10);
+        if (end == env) {
+          return DECODED_CACHE_DEFAULT_MAX;
+        }
+        if (*end == 'k' || *end == 'K') {
+          val = val > (1ull << 40) ? (1ull << 50) : val * 1024;
+        } else if (*end == 'm' || *end == 'M') {
+          val = val > (1ull << 30) ? (1ull << 50) : val * 1024 * 1024;
+        }
+        return static_cast<size_t>(val);
+      }();
+      return v;
+    }
+
+    static DecodedCacheRegistry & instance() noexcept {
+      // Leaked on purpose: pool threads may still open caches during static destruction.
+      static DecodedCacheRegistry * registry = new DecodedCacheRegistry();
+      return *registry;
+    }
+
+    /** A private copy of the image for (path, id), or an empty buffer on a miss. */
+    OwnedBuf<> clone(const char * path, const FileIdentity & id) noexcept {
+      OwnedBuf<> out;
+      if (capacity() == 0) {
+        return out;
+      }
+      Image * img = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(this->mu_);
+        Slot * s = this->find_(path);
+        if (!s || !s->image || s->id != id) {
+          return out;
+        }
+        s->tick = ++this->tick_;
+        img = s->image;
+        img->refs.fetch_add(1, std::memory_order_relaxed);
+      }
+      out = OwnedBuf<>::alloc(img->len);
+      if (out) [[likely]] {
+        memcpy(out.ptr, img->data, img->len);
+      }
+      img->release();
+      return out;
+    }
+
+    /** Offer a freshly decoded and validated image of `path` at `id`, read
+     *  by an open that stat'ed the file at `startNs` (HashMemo::now_ns). */
+    void offer(const char * path, const FileIdentity & id, uint64_t startNs, const uint8_t * data, size_t len) noexcept {
+      const size_t cap = capacity();
+      if (cap == 0 || len > cap || !HashMemo::settled(id, startNs)) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(this->mu_);
+        Slot * s = this->find_(path);
+        if (!s) {
+          // First sighting: remember the path only.
+          this->slot_for_(path);
+          return;
+        }
+        if (s->image && s->id == id) {
+          s->tick = ++this->tick_;
+          return;
+        }
+      }
+
+      Image * img = Image::create(data, len);
+      if (!img) [[unlikely]] {
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(this->mu_);
+      Slot * s = this->slot_for_(path);
+      this->drop_image_(*s);
+      this->evict_until_(cap - len);
+      s->image = img;
+      s->id = id;
+      this->bytes_ += len;
+    }
+
+    /** Drop the image of `path`, if any. Called by writers, under the
+     *  cache file's lock, before they modify it. */
+    void invalidate(const char * path) noexcept {
+      if (capacity() == 0 || !path) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(this->mu_);
+      Slot * s = this->find_(path);
+      if (s) {
+        this->drop_image_(*s);
+      }
+    }
+
+   private:
+    struct Image {
+      std::atomic<uint32_t> refs{1};
+      size_t len = 0;
+      uint8_t * data = nullptr;
+
+      static Image * create(const uint8_t * src, size_t len) noexcept {
+        auto * img = new (std::nothrow) Image();
+        if (!img) [[unlikely]] {
+          return nullptr;
+        }
+        img->data = static_cast<uint8_t *>(::malloc(len));
+        if (!img->data) [[unlikely]] {
+          delete img;
+          return nullptr;
+        }
+        memcpy(img->data, src, len);
+        img->len = len;
+        return img;
+      }
+
+      void release() noexcept {
+        if (this->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          ::free(this->data);
+          delete this;
+        }
+      }
+    };
+
+    struct Slot {
+      std::string path;
+      FileIdentity id{};
+      Image * image = nullptr;
+      uint64_t tick = 0;
+    };
+
+    std::mutex mu_;
+    std::vector<Slot> slots_;
+    size_t bytes_ = 0;
+    uint64_t tick_ = 0;
+
+    DecodedCacheRegistry() noexcept = default;
+
+    Slot * find_(const char * path) noexcept {
+      for (Slot & s : this->slots_) {
+        if (s.path == path) {
+          return &s;
+        }
+      }
+      return nullptr;
+    }
+
+    /** Existing slot for `path`, or a new one (reusing the LRU slot when full). */
+    Slot * slot_for_(const char * path) noexcept {
+      Slot * s = this->find_(path);
+      if (!s) {
+        if (this->slots_.size() < MAX_SLOTS) {
+          s = &this->slots_.emplace_back();
+        } else {
+          s = &this->slots_[0];
+          for (Slot & c : this->slots_) {
+            if (c.tick < s->tick) {
+              s = &c;
+            }
+          }
+          this->drop_image_(*s);
+        }
+        s->path.assign(path);
+      }
+      s->tick = ++this->tick_;
+      return s;
+    }
+
+    void drop_image_(Slot & s) noexcept {
+      if (s.image) {
+        this->bytes_ -= s.image->len;
+        s.image->release();
+        s.image = nullptr;
+      }
+    }
+
+    /** Evict least recently used images until at most `budget` bytes remain. */
+    void evict_until_(size_t budget) noexcept {
+      while (this->bytes_ > budget) {
+        Slot * lru = nullptr;
+        for (Slot & c : this->slots_) {
+          if (c.image && (!lru || c.tick < lru->tick)) {
+            lru = &c;
+          }
+        }
+        if (!lru) [[unlikely]] {
+          return;
+        }
+        this->drop_image_(*lru);
+      }
+    }
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
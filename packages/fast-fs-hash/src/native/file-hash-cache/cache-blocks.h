@@ -0,0 +1,155 @@
+#ifndef _FAST_FS_HASH_CACHE_BLOCKS_H
+#define _FAST_FS_HASH_CACHE_BLOCKS_H
+
+#include "cache-helpers.h"
+#include "ParallelFor.h"
+
+namespace fast_fs_hash {
+
+  /**
+   * Encode `body` as an LZ4_BLOCKS body into `scratch` (see CacheBlockTable).
+   *
+   * Each CACHE_LZ4_BLOCK_SIZE block is compressed into its own
+   * LZ4_compressBound slot in parallel on the pool, then the slots are
+   * compacted behind the block table. A block LZ4 can't shrink is stored
+   * raw. `tableFlags` (CacheBodyCoding flags) goes into the table, with
+   * bodyLen as the image length. Returns the encoded length, or 0 if the
+   * allocation failed.
+   */
+  inline size_t encodeCacheBlocks(
+    ThreadPool & pool, const uint8_t * body, size_t bodyLen, OwnedBuf<> & scratch, uint32_t tableFlags) noexcept {
+    const size_t bs = CACHE_LZ4_BLOCK_SIZE;
+    const auto n = static_cast<uint32_t>((bodyLen + bs - 1) / bs);
+    const size_t slot = static_cast<size_t>(LZ4_compressBound(static_cast<int>(bs)));
+    const size_t prefix = CacheBlockTable::SIZE + static_cast<size_t>(n) * 4;
+    scratch = OwnedBuf<>::alloc(prefix + static_cast<size_t>(n) * slot);
+    if (!scratch) [[unlikely]] {
+      return 0;
+    }
+    auto * table = reinterpret_cast<CacheBlockTable *>(scratch.ptr);
+    table->blockCount = n;
+    table->blockSize = static_cast<uint32_t>(bs);
+    table->flags = tableFlags;
+    table->imageLen = static_cast<uint32_t>(bodyLen);
+    auto * ends = reinterpret_cast<uint32_t *>(scratch.ptr + CacheBlockTable::SIZE);
+    uint8_t * const data = scratch.ptr + prefix;
+
+    poolParallelFor(pool, n, MAX_CACHE_IO_THREADS - 1, [&](uint32_t k) {
+      const size_t start = static_cast<size_t>(k) * bs;
+      const int raw = static_cast<int>(bodyLen - start < bs ? bodyLen - start : bs);
+      uint8_t * dst = data + static_cast<size_t>(k) * slot;
+      int stored = LZ4_compress_fast(
+        reinterpret_cast<const char *>(body + start), reinterpret_cast<char *>(dst), raw, static_cast<int>(slot), 2);
+      if (stored <= 0 || stored >= raw) {
+        memcpy(dst, body + start, static_cast<size_t>(raw));
+        stored = raw;
+      }
+      ends[k] = static_cast<uint32_t>(stored);
+    });
+
+    size_t off = 0;
+    for (uint32_t k = 0; k < n; ++k) {
+      const size_t stored = ends[k];
+      memmove(data + off, data + static_cast<size_t>(k) * slot, stored);
+      off += stored;
+      ends[k] = static_cast<uint32_t>(off);
+    }
+    return prefix + off;
+  }
+
+  /**
+   * Decode the LZ4_BLOCKS body `src` into `dst` (exactly dstLen bytes, the
+   * table's image length), blocks in parallel on the pool.
+   *
+   * `onWatched()` runs once, on whichever thread finishes the last block
+   * overlapping [watchLo, watchHi) of the image, while the other
+   * blocks are still being decoded; those blocks are claimed first. Used to
+   * decode and validate the paths without waiting for the whole body. An empty
+   * range skips it. Returns false if the table is malformed, any block
+   * fails to decode, or onWatched() returned false. `dst` receives the
+   * image; undoing its coding flags is up to the caller.
+   */
+  template <typename Fn>
+  inline bool decodeCacheBlocks(
+    ThreadPool & pool,
+    const uint8_t * src,
+    size_t srcLen,
+    uint8_t * dst,
+    size_t dstLen,
+    size_t watchLo,
+    size_t watchHi,
+    Fn && onWatched) noexcept {
+    if (srcLen < CacheBlockTable::SIZE || dstLen == 0) [[unlikely]] {
+      return false;
+    }
+    CacheBlockTable table;
+    memcpy(&table, src, CacheBlockTable::SIZE);
+    const size_t bs = table.blockSize;
+    const uint32_t n = table.blockCount;
+    if (bs < 4096 || bs > (64u << 20) || n != (dstLen + bs - 1) / bs ||
+        (table.imageLen != dstLen && table.imageLen != 0)) [[unlikely]] {
+      return false;
+    }
+    const size_t prefix = CacheBlockTable::SIZE + static_cast<size_t>(n) * 4;
+    if (srcLen < prefix) [[unlikely]] {
+      return false;
+    }
+    const auto * ends = reinterpret_cast<const uint32_t *>(src + CacheBlockTable::SIZE);
+    const uint8_t * const data = src + prefix;
+    uint32_t prevEnd = 0;
+    for (uint32_t k = 0; k < n; ++k) {
+      if (ends[k] <= prevEnd) [[unlikely]] {
+        return false;
+      }
+      prevEnd = ends[k];
+    }
+    if (prevEnd != srcLen - prefix) [[unlikely]] {
+      return false;
+    }
+
+    const bool watch = watchHi > watchLo && watchHi <= dstLen;
+    const uint32_t firstWatched = watch ? static_cast<uint32_t>(watchLo / bs) : 0;
+    const uint32_t watchedCount = watch ? static_cast<uint32_t>((watchHi - 1) / bs) + 1 - firstWatched : 0;
+    std::atomic<uint32_t> watchedLeft{watchedCount};
+    std::atomic<bool> failed{false};
+    std::atomic<bool> watchedOk{!watch};
+
+    poolParallelFor(pool, n, MAX_CACHE_IO_THREADS - 1, [&](uint32_t j) {
+      // Watched blocks first, then the rest in order.
+      uint32_t k;
+      if (j < watchedCount) {
+        k = firstWatched + j;
+      } else {
+        k = j - watchedCount;
+        k = k < firstWatched ? k : k + watchedCount;
+      }
+      const uint32_t from = k > 0 ? ends[k - 1] : 0;
+      const uint32_t stored = ends[k] - from;
+      const size_t start = static_cast<size_t>(k) * bs;
+      const size_t raw = dstLen - start < bs ? dstLen - start : bs;
+      bool ok;
+      if (stored == raw) {
+        memcpy(dst + start, data + from, raw);
+        ok = true;
+      } else {
+        ok = LZ4_decompress_safe(
+               reinterpret_cast<const char *>(data + from),
+               reinterpret_cast<char *>(dst + start),
+               static_cast<int>(stored),
+               static_cast<int>(raw)) == static_cast<int>(raw);
+      }
+      if (!ok) [[unlikely]] {
+        failed.store(true, std::memory_order_relaxed);
+      }
+      if (j < watchedCount && watchedLeft.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+          !failed.load(std::memory_order_relaxed)) {
+        watchedOk.store(onWatched(), std::memory_order_relaxed);
+      }
+    });
+
+    return !failed.load(std::memory_order_relaxed) && watchedOk.load(std::memory_order_relaxed);
+  }
+
+}  // namespace fast_fs_hash
+
+#endif
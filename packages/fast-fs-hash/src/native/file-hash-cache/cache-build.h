@@ -1,5 +1,5 @@
 /**
- * cache-build.h — Build a new dataBuf from encoded paths.
+ * cache-build.h — Build a new dataBuf from encoded paths, optionally remapping an old one.
  * Pure buffer construction, no disk I/O, no stat-match, no threading.
  */
 
@@ -9,6 +9,8 @@
 #include "file-hash-cache-format.h"
 #include "OwnedBuf.h"
 
+#include <algorithm>
+
 namespace fast_fs_hash {
 
   /**
@@ -162,6 +164,312 @@ namespace fast_fs_hash {
     return OwnedBuf<>::take(raw, total);
   }
 
+  /**
+   * Old entries that no path of a new file list matched, sorted by
+   * (ino, size, mtimeNs). A new path whose fresh stat has the same key may
+   * be the same inode with the same size and mtime — a renamed or moved
+   * file — and can take the old hash instead of being read. ctime is not
+   * part of the key because a rename updates it.
+   *
+   * The key alone also matches a deleted file's inode number reused by a
+   * new file whose mtime was preserved (tar or npm extraction, cp -p,
+   * rsync -a). The caller must confirm the match with sameInode().
+   */
+  struct CacheRenameIndex {
+    struct Item {
+      uint64_t ino;
+      uint64_t size;
+      uint64_t mtimeNs;
+      uint64_t ctimeNs;
+      Hash128 contentHash;
+
+      FSH_FORCE_INLINE bool operator<(const Item & o) const noexcept {
+        if (this->ino != o.ino) {
+          return this->ino < o.ino;
+        }
+        if (this->size != o.size) {
+          return this->size < o.size;
+        }
+        return this->mtimeNs < o.mtimeNs;
+      }
+    };
+
+    OwnedBuf<> items;
+    uint32_t count = 0;
+
+    FSH_FORCE_INLINE bool empty() const noexcept { return this->count == 0; }
+
+    /** Old entry with the key of a file whose stat is `e`, or nullptr. */
+    const Item * find(const CacheEntry & e) const noexcept {
+      const auto * first = reinterpret_cast<const Item *>(this->items.ptr);
+      const auto * last = first + this->count;
+      const Item key{e.ino & INO_VALUE_MASK, e.size, e.mtimeNs, 0, {}};
+      const Item * it = std::lower_bound(first, last, key);
+      if (it == last || key < *it) {
+        return nullptr;
+      }
+      return it;
+    }
+
+    /**
+     * Whether a file born at `birthNs` is the inode `old` was stat'ed as.
+     * An inode's ctime never precedes its birth, and a reused inode number
+     * is born after the old file was deleted, so after every ctime it had.
+     */
+    static FSH_FORCE_INLINE bool sameInode(const Item & old, uint64_t birthNs) noexcept {
+      return birthNs != 0 && birthNs <= old.ctimeNs;
+    }
+  };
+
+  /**
+   * Copy the cached entry of every path present in both dataBufs from
+   * `oldData` into `newData`, marked CACHE_S_HAS_OLD so the next stat pass
+   * re-validates it. Paths only in `newData` stay CACHE_S_NOT_CHECKED.
+   * Both path lists are sorted, so this is a single merge walk.
+   *
+   * When `renames` is set and some new paths are unmatched, it receives
+   * the unmatched old entries whose stat and hash are known to belong
+   * together: not STAT_DONE (fresh stat, old hash) and not zeroed by a
+   * failed stat or read.
+   */
+  inline void remapCacheEntries(
+    const uint8_t * FSH_RESTRICT oldData,
+    uint32_t oldFc,
+    uint8_t * FSH_RESTRICT newData,
+    uint32_t newFc,
+    CacheRenameIndex * renames = nullptr) noexcept {
+    const CacheHeader * oldHdr = headerOf(oldData);
+    const uint32_t oldCompCount = oldHdr->compressedPayloadItemCount;
+    const uint32_t oldUncCount = oldHdr->uncompressedPayloadItemCount;
+    const uint32_t oldUncLen = oldHdr->uncompressedPayloadsLen;
+    const CacheEntry * FSH_RESTRICT oldEntries = entriesOf(oldData, oldUncCount, oldUncLen);
+    const uint32_t * FSH_RESTRICT oldPe = pathEndsOf(oldData, oldFc, oldCompCount, oldUncCount, oldUncLen);
+    const uint8_t * FSH_RESTRICT oldPaths = pathsOf(oldData, oldFc, oldCompCount, oldUncCount, oldUncLen);
+    const size_t oldPathsLen = oldHdr->pathsLen;
+
+    const CacheHeader * newHdr = headerOf(newData);
+    const uint32_t newCompCount = newHdr->compressedPayloadItemCount;
+    const uint32_t newUncCount = newHdr->uncompressedPayloadItemCount;
+    const uint32_t newUncLen = newHdr->uncompressedPayloadsLen;
+    CacheEntry * FSH_RESTRICT newEntries = entriesOf(newData, newUncCount, newUncLen);
+    const uint32_t * FSH_RESTRICT newPe = pathEndsOf(newData, newFc, newCompCount, newUncCount, newUncLen);
+    const uint8_t * FSH_RESTRICT newPaths = pathsOf(newData, newFc, newCompCount, newUncCount, newUncLen);
+    const size_t newPathsLen = newHdr->pathsLen;
+
+    CacheRenameIndex::Item * unmatched = nullptr;
+    if (renames) {
+      renames->items = OwnedBuf<>::alloc(static_cast<size_t>(oldFc) * sizeof(CacheRenameIndex::Item));
+      renames->count = 0;
+      unmatched = reinterpret_cast<CacheRenameIndex::Item *>(renames->items.ptr);
+    }
+    uint32_t unmatchedCount = 0;
+    size_t newOnly = 0;
+    const auto addUnmatched = [&](size_t i) noexcept {
+      const CacheEntry & e = oldEntries[i];
+      if (unmatched && (e.ino & INO_STATE_MASK) != CACHE_S_STAT_DONE && (e.ino & INO_VALUE_MASK) != 0 &&
+          !e.contentHash.is_zero()) {
+        unmatched[unmatchedCount++] = {e.ino & INO_VALUE_MASK, e.size, e.mtimeNs, e.ctimeNs, e.contentHash};
+      }
+    };
+
+    uint32_t oldOff = 0, newOff = 0;
+    size_t oi = 0, ni = 0;
+
+    while (oi < oldFc && ni < newFc) {
+      const uint32_t oldEnd = oldPe[oi];
+      const uint32_t newEnd = newPe[ni];
+      if (oldEnd < oldOff || oldEnd > oldPathsLen || newEnd < newOff || newEnd > newPathsLen) [[unlikely]] {
+        return;
+      }
+
+      const uint32_t oldSegLen = oldEnd - oldOff;
+      const uint32_t newSegLen = newEnd - newOff;
+      const uint32_t minLen = oldSegLen < newSegLen ? oldSegLen : newSegLen;
+
+      int cmp = minLen > 0 ? memcmp(oldPaths + oldOff, newPaths + newOff, minLen) : 0;
+      if (cmp == 0 && oldSegLen != newSegLen) {
+        cmp = oldSegLen < newSegLen ? -1 : 1;
+      }
+
+      if (cmp == 0) {
+        newEntries[ni] = oldEntries[oi];
+        newEntries[ni].ino = (newEntries[ni].ino & INO_VALUE_MASK) | CACHE_S_HAS_OLD;
+        oldOff = oldEnd;
+        newOff = newEnd;
+        ++oi;
+        ++ni;
+      } else if (cmp < 0) {
+        addUnmatched(oi);
+        oldOff = oldEnd;
+        ++oi;
+      } else {
+        ++newOnly;
+        newOff = newEnd;
+        ++ni;
+      }
+    }
+    for (; oi < oldFc; ++oi) {
+      addUnmatched(oi);
+    }
+    newOnly += newFc - ni;
+
+    if (unmatched && newOnly > 0 && unmatchedCount > 0) {
+      std::sort(unmatched, unmatched + unmatchedCount);
+      renames->count = unmatchedCount;
+    } else if (renames) {
+      renames->items.reset();
+    }
+  }
+
+  /**
+   * Paths of `oldData` that `newData` does not list, each NUL-terminated, in
+   * list order (both lists are sorted). A null `newData` lists nothing.
+   * Empty when nothing was dropped or on OOM; `ok` is false only on OOM.
+   */
+  inline OwnedBuf<> removedCachePaths(const uint8_t * oldData, const uint8_t * newData, bool & ok) noexcept {
+    ok = true;
+    const CacheHeader * oldHdr = headerOf(oldData);
+    const uint32_t oldFc = oldHdr->fileCount;
+    if (oldFc == 0) {
+      return {};
+    }
+    const uint32_t * oldPe = pathEndsOf(
+      oldData, oldFc, oldHdr->compressedPayloadItemCount, oldHdr->uncompressedPayloadItemCount,
+      oldHdr->uncompressedPayloadsLen);
+    const uint8_t * oldPaths = pathsOf(
+      oldData, oldFc, oldHdr->compressedPayloadItemCount, oldHdr->uncompressedPayloadItemCount,
+      oldHdr->uncompressedPayloadsLen);
+    const uint32_t newFc = newData ? headerOf(newData)->fileCount : 0;
+    const uint32_t * newPe = nullptr;
+    const uint8_t * newPaths = nullptr;
+    if (newFc > 0) {
+      const CacheHeader * newHdr = headerOf(newData);
+      newPe = pathEndsOf(
+        newData, newFc, newHdr->compressedPayloadItemCount, newHdr->uncompressedPayloadItemCount,
+        newHdr->uncompressedPayloadsLen);
+      newPaths = pathsOf(
+        newData, newFc, newHdr->compressedPayloadItemCount, newHdr->uncompressedPayloadItemCount,
+        newHdr->uncompressedPayloadsLen);
+    }
+
+    for (uint32_t i = 0, prev = 0; i < oldFc; prev = oldPe[i++]) {
+      if (oldPe[i] < prev || oldPe[i] > oldHdr->pathsLen) [[unlikely]] {
+        return {};
+      }
+    }
+
+    OwnedBuf<> out = OwnedBuf<>::alloc(static_cast<size_t>(oldHdr->pathsLen) + oldFc);
+    if (!out) [[unlikely]] {
+      ok = false;
+      return out;
+    }
+    size_t len = 0;
+    const auto drop = [&](uint32_t from, uint32_t to) noexcept {
+      memcpy(out.ptr + len, oldPaths + from, to - from);
+      len += to - from;
+      out.ptr[len++] = 0;
+    };
+
+    uint32_t oldOff = 0, newOff = 0;
+    uint32_t oi = 0, ni = 0;
+    while (oi < oldFc && ni < newFc) {
+      const uint32_t oldEnd = oldPe[oi];
+      const uint32_t newEnd = newPe[ni];
+      const uint32_t oldSegLen = oldEnd - oldOff;
+      const uint32_t newSegLen = newEnd - newOff;
+      const uint32_t minLen = oldSegLen < newSegLen ? oldSegLen : newSegLen;
+      int cmp = minLen > 0 ? memcmp(oldPaths + oldOff, newPaths + newOff, minLen) : 0;
+      if (cmp == 0 && oldSegLen != newSegLen) {
+        cmp = oldSegLen < newSegLen ? -1 : 1;
+      }
+      if (cmp <= 0) {
+        if (cmp < 0) {
+          drop(oldOff, oldEnd);
+        } else {
+          newOff = newEnd;
+          ++ni;
+        }
+        oldOff = oldEnd;
+        ++oi;
+      } else {
+        newOff = newEnd;
+        ++ni;
+      }
+    }
+    for (; oi < oldFc; ++oi) {
+      drop(oldOff, oldPe[oi]);
+      oldOff = oldPe[oi];
+    }
+    if (len == 0) {
+      out.reset();
+    } else {
+      out.truncate(len);
+    }
+    return out;
+  }
+
+  /**
+   * Build a dataBuf for a new file list, carrying over everything `oldData`
+   * knows: header version / fingerprint / user values, both payload sections,
+   * and the entries of paths present in both lists (see remapCacheEntries,
+   * which also fills `renames`). On failure, returns an empty OwnedBuf.
+   */
+  inline OwnedBuf<> buildRemappedCacheDataBuf(
+      const uint8_t * oldData,
+      const uint8_t * encoded_paths,
+      size_t encoded_len,
+      uint32_t newFc,
+      CacheRenameIndex * renames = nullptr) noexcept {
+    const CacheHeader * prevHdr = headerOf(oldData);
+    const uint32_t oldFc = prevHdr->fileCount;
+    const uint32_t compCount = prevHdr->compressedPayloadItemCount;
+    const uint32_t compLen = prevHdr->compressedPayloadsLen;
+    const uint32_t uncCount = prevHdr->uncompressedPayloadItemCount;
+    const uint32_t uncLen = prevHdr->uncompressedPayloadsLen;
+
+    OwnedBuf<> newBuf = buildCacheDataBuf(encoded_paths, encoded_len, newFc, compCount, compLen, uncCount, uncLen);
+    if (!newBuf) [[unlikely]] {
+      return newBuf;
+    }
+
+    uint8_t * newPtr = newBuf.ptr;
+    CacheHeader * newHdr = headerOf(newPtr);
+    newHdr->magic = prevHdr->magic;  // keeps the session's chunk-tree bit
+    newHdr->version = prevHdr->version;
+    newHdr->fingerprint = prevHdr->fingerprint;
+    newHdr->userValue0 = prevHdr->userValue0;
+    newHdr->userValue1 = prevHdr->userValue1;
+    newHdr->userValue2 = prevHdr->userValue2;
+    newHdr->userValue3 = prevHdr->userValue3;
+
+    if (oldFc > 0 && newFc > 0) {
+      remapCacheEntries(oldData, oldFc, newPtr, newFc, renames);
+    }
+
+    // Copy uncompressed section (identical offset in both old and new bufs:
+    // it's right after the header, same size since we rebuilt with same counts).
+    const size_t uncSectionSize = static_cast<size_t>(uncCount) * 4 + uncLen;
+    if (uncSectionSize > 0) {
+      memcpy(newPtr + CacheHeader::SIZE, oldData + CacheHeader::SIZE, uncSectionSize);
+    }
+
+    // Copy compressed payloads (dir + bytes) from old body into new body.
+    if (compCount > 0) {
+      memcpy(
+        compressedPayloadDirOf(newPtr, newFc, uncCount, uncLen),
+        compressedPayloadDirOf(oldData, oldFc, uncCount, uncLen),
+        static_cast<size_t>(compCount) * 4);
+      if (compLen > 0) {
+        memcpy(
+          compressedPayloadBytesOf(newPtr, newFc, compCount, newHdr->pathsLen, uncCount, uncLen),
+          compressedPayloadBytesOf(oldData, oldFc, compCount, prevHdr->pathsLen, uncCount, uncLen),
+          compLen);
+      }
+    }
+
+    return newBuf;
+  }
+
 }  // namespace fast_fs_hash
 
 #endif
@@ -0,0 +1,123 @@
+#ifndef _FAST_FS_HASH_CACHE_CODING_H
+#define _FAST_FS_HASH_CACHE_CODING_H
+
+#include "cache-columns.h"
+#include "cache-dir-paths.h"
+
+namespace fast_fs_hash {
+
+  /** Byte lengths of the body regions for the counts in a header. */
+  struct CacheBodyRegions {
+    size_t entries;  // n × 48
+    size_t compDir;  // compressedPayloadItemCount × 4
+    size_t paths;  // pathEnds + paths, as stored in the dataBuf
+    size_t payloads;  // compressedPayloadsLen
+
+    static CacheBodyRegions of(const CacheHeader & h) noexcept {
+      return {
+        static_cast<size_t>(h.fileCount) * CacheEntry::STRIDE,
+        static_cast<size_t>(h.compressedPayloadItemCount) * 4,
+        static_cast<size_t>(h.fileCount) * CacheEntry::PATH_END_SIZE + h.pathsLen,
+        h.compressedPayloadsLen,
+      };
+    }
+
+    /** Image offset of the paths region; it ends `payloads` bytes before the image does. */
+    FSH_FORCE_INLINE size_t pathsOffset() const noexcept { return this->entries + this->compDir; }
+  };
+
+  /** Whether `flags` / `imageLen` describe a coded image that can decode to
+   *  the body of `h`. A DIR_PATHS region is at most dirPathsBound bytes. */
+  FSH_FORCE_INLINE bool cacheImageValid(const CacheHeader & h, uint32_t flags, size_t imageLen) noexcept {
+    if ((flags & ~CacheBodyCoding::KNOWN_FLAGS) != 0) [[unlikely]] {
+      return false;
+    }
+    const CacheBodyRegions r = CacheBodyRegions::of(h);
+    if (!(flags & CacheBodyCoding::DIR_PATHS)) {
+      return imageLen == h.bodySize();
+    }
+    const size_t fixed = r.entries + r.compDir + r.payloads;
+    return imageLen >= fixed && imageLen - fixed <= dirPathsBound(h.fileCount, h.pathsLen);
+  }
+
+  /**
+   * Build the coded image of `body` (regions per `layout`) into `image`:
+   * columnar entries, and a directory table for the paths unless they
+   * can't be coded. Sets `flags` and returns the image length, or 0 if
+   * the allocation failed.
+   */
+  inline size_t encodeCacheImage(
+    const uint8_t * body, const CacheHeader & layout, OwnedBuf<> & image, uint32_t & flags) noexcept {
+    const CacheBodyRegions r = CacheBodyRegions::of(layout);
+    const uint32_t n = layout.fileCount;
+    image = OwnedBuf<>::alloc(r.entries + r.compDir + dirPathsBound(n, layout.pathsLen) + r.payloads);
+    if (!image) [[unlikely]] {
+      return 0;
+    }
+    uint8_t * dst = image.ptr;
+    encodeCacheColumns(reinterpret_cast<const CacheEntry *>(body), n, dst);
+    dst += r.entries;
+    memcpy(dst, body + r.entries, r.compDir);
+    dst += r.compDir;
+
+    const uint8_t * const srcPaths = body + r.pathsOffset();
+    const size_t coded = encodeDirPaths(
+      reinterpret_cast<const uint32_t *>(srcPaths), srcPaths + static_cast<size_t>(n) * 4, n, layout.pathsLen, dst);
+    flags = CacheBodyCoding::COLUMNAR_ENTRIES;
+    if (coded > 0) {
+      flags |= CacheBodyCoding::DIR_PATHS;
+      dst += coded;
+    } else {
+      memcpy(dst, srcPaths, r.paths);
+      dst += r.paths;
+    }
+    memcpy(dst, srcPaths + r.paths, r.payloads);
+    dst += r.payloads;
+    return static_cast<size_t>(dst - image.ptr);
+  }
+
+  /**
+   * Decode the paths region of a coded image into `body` (the dataBuf body
+   * for `layout`). Run on its own, as soon as the image bytes of that
+   * region are in, so path validation can start before the rest decodes.
+   * `entryDirOut` / `dirCountOut` as in decodeDirPaths.
+   */
+  inline bool decodeCacheImagePaths(
+    const uint8_t * image,
+    size_t imageLen,
+    uint32_t flags,
+    const CacheHeader & layout,
+    uint8_t * body,
+    uint32_t * entryDirOut,
+    uint32_t & dirCountOut) noexcept {
+    const CacheBodyRegions r = CacheBodyRegions::of(layout);
+    const size_t lo = r.pathsOffset();
+    const size_t codedLen = imageLen - lo - r.payloads;
+    uint8_t * const dst = body + lo;
+    if (!(flags & CacheBodyCoding::DIR_PATHS)) {
+      memcpy(dst, image + lo, codedLen);
+      return true;
+    }
+    const uint32_t n = layout.fileCount;
+    return decodeDirPaths(
+      image + lo, codedLen, n, layout.pathsLen, reinterpret_cast<uint32_t *>(dst), dst + static_cast<size_t>(n) * 4,
+      entryDirOut, dirCountOut);
+  }
+
+  /** Decode the remaining regions of a coded image into `body`: entries,
+   *  compressed payload dir and compressed payloads. */
+  inline void decodeCacheImageRest(
+    const uint8_t * image, size_t imageLen, uint32_t flags, const CacheHeader & layout, uint8_t * body) noexcept {
+    const CacheBodyRegions r = CacheBodyRegions::of(layout);
+    if (flags & CacheBodyCoding::COLUMNAR_ENTRIES) {
+      decodeCacheColumns(image, layout.fileCount, reinterpret_cast<CacheEntry *>(body));
+    } else {
+      memcpy(body, image, r.entries);
+    }
+    memcpy(body + r.entries, image + r.entries, r.compDir);
+    memcpy(body + r.pathsOffset() + r.paths, image + imageLen - r.payloads, r.payloads);
+  }
+
+}  // namespace fast_fs_hash
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef _FAST_FS_HASH_CACHE_COLUMNS_H
+#define _FAST_FS_HASH_CACHE_COLUMNS_H
+
+#include "file-hash-cache-format.h"
+
+namespace fast_fs_hash {
+
+  /** Map a signed delta (held in a u64) to small unsigned values: 0, -1, 1, -2, … → 0, 1, 2, 3, … */
+  FSH_FORCE_INLINE uint64_t zigzagEncode(uint64_t d) noexcept {
+    return (d << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(d) >> 63);
+  }
+
+  FSH_FORCE_INLINE uint64_t zigzagDecode(uint64_t z) noexcept { return (z >> 1) ^ (0 - (z & 1)); }
+
+  /** Entries per pass of the column transforms: the chunk's planes and
+   *  records both stay in L1/L2 while its 32 byte planes are walked. */
+  static constexpr size_t CACHE_COLUMNS_CHUNK = 512;
+
+  /** The four u64 stat columns, in on-disk order. */
+  inline constexpr uint64_t CacheEntry::* CACHE_STAT_COLUMNS[4] = {
+    &CacheEntry::ino, &CacheEntry::mtimeNs, &CacheEntry::ctimeNs, &CacheEntry::size};
+
+  /**
+   * Write `n` entries into `dst` (n × CacheEntry::STRIDE bytes) in the
+   * columnar form described under CacheBodyCoding::COLUMNAR_ENTRIES. Ino state bits
+   * are masked off. `src` and `dst` must not overlap.
+   */
+  inline void encodeCacheColumns(const CacheEntry * FSH_RESTRICT src, uint32_t n, uint8_t * FSH_RESTRICT dst) noexcept {
+    const size_t cn = n;
+    uint8_t * const hashes = dst + cn * 32;
+    const uint64_t mtimeBase = cn > 0 ? src[0].mtimeNs : 0;
+    uint64_t prevIno = 0;
+    uint64_t cols[4][CACHE_COLUMNS_CHUNK];
+    for (size_t base = 0; base < cn; base += CACHE_COLUMNS_CHUNK) {
+      const size_t len = cn - base < CACHE_COLUMNS_CHUNK ? cn - base : CACHE_COLUMNS_CHUNK;
+      for (size_t j = 0; j < len; ++j) {
+        const CacheEntry & e = src[base + j];
+        const uint64_t ino = e.ino & INO_VALUE_MASK;
+        cols[0][j] = zigzagEncode(ino - prevIno);
+        cols[1][j] = zigzagEncode(e.mtimeNs - mtimeBase);
+        cols[2][j] = zigzagEncode(e.ctimeNs - e.mtimeNs);
+        cols[3][j] = e.size;
+        prevIno = ino;
+        memcpy(hashes + (base + j) * sizeof(Hash128), &e.contentHash, sizeof(Hash128));
+      }
+      if (base == 0) {
+        cols[1][0] = mtimeBase;
+      }
+      for (size_t c = 0; c < 4; ++c) {
+        for (size_t b = 0; b < 8; ++b) {
+          uint8_t * FSH_RESTRICT const plane = dst + (c * 8 + b) * cn + base;
+          for (size_t j = 0; j < len; ++j) {
+            plane[j] = static_cast<uint8_t>(cols[c][j] >> (b * 8));
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Turn the columnar entries region `src` (n entries) back into CacheEntry
+   * records in `out`. The two must not overlap.
+   */
+  inline void decodeCacheColumns(const uint8_t * FSH_RESTRICT src, uint32_t n, CacheEntry * FSH_RESTRICT out) noexcept {
+    const size_t cn = n;
+    const uint8_t * FSH_RESTRICT const planes = src;
+    const uint8_t * FSH_RESTRICT const hashes = src + cn * 32;
+
+    uint64_t mtimeBase = 0;
+    uint64_t prevIno = 0;
+    for (size_t base = 0; base < cn; base += CACHE_COLUMNS_CHUNK) {
+      const size_t len = cn - base < CACHE_COLUMNS_CHUNK ? cn - base : CACHE_COLUMNS_CHUNK;
+      CacheEntry * FSH_RESTRICT const chunk = out + base;
+      for (size_t c = 0; c < 4; ++c) {
+        const auto field = CACHE_STAT_COLUMNS[c];
+        for (size_t j = 0; j < len; ++j) {
+          chunk[j].*field = planes[c * 8 * cn + base + j];
+        }
+        for (size_t b = 1; b < 8; ++b) {
+          const uint8_t * FSH_RESTRICT const plane = planes + (c * 8 + b) * cn + base;
+          for (size_t j = 0; j < len; ++j) {
+            chunk[j].*field |= static_cast<uint64_t>(plane[j]) << (b * 8);
+          }
+        }
+      }
+      if (base == 0) {
+        mtimeBase = chunk[0].mtimeNs;  // entry 0 holds the base raw
+        chunk[0].mtimeNs = 0;
+      }
+      for (size_t j = 0; j < len; ++j) {
+        CacheEntry & e = chunk[j];
+        prevIno += zigzagDecode(e.ino);
+        e.ino = prevIno;
+        e.mtimeNs = mtimeBase + zigzagDecode(e.mtimeNs);
+        e.ctimeNs = e.mtimeNs + zigzagDecode(e.ctimeNs);
+        memcpy(&e.contentHash, hashes + (base + j) * sizeof(Hash128), sizeof(Hash128));
+      }
+    }
+  }
+
+}  // namespace fast_fs_hash
+
+#endif
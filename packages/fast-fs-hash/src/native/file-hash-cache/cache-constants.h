@@ -12,6 +12,18 @@ namespace fast_fs_hash {
     CHANGED = 2,  // content changed (size or hash mismatch)
   };
 
+  /**
+   * Per-entry outcome of a full-scan CacheOpen, one byte per tracked file.
+   * Keep in sync with `FileChangeKind` in `packages/fast-fs-hash/src/FileHashCache.ts`.
+   */
+  enum class FileChangeKind : uint8_t {
+    UNCHANGED = 0,  // stat matched (or trusted via the dirty hint)
+    STATS_DIRTY = 1,  // stat metadata changed but content hash still matches
+    CHANGED = 2,  // content changed (size or hash mismatch)
+    MISSING = 3,  // stat failed: file deleted or unreadable
+    ADDED = 4,  // not in the cached file list
+  };
+
   /**
    * Per-file state encoded in high 2 bits of CacheEntry::ino.
    * Real inode occupies the lower 62 bits (no filesystem uses >62-bit inodes).
@@ -34,6 +46,14 @@ namespace fast_fs_hash {
   static constexpr uint32_t CACHE_MAX_UNCOMPRESSED_PAYLOADS = 128u << 20;  // 128 MiB
   static constexpr size_t CACHE_MAX_BODY_SIZE = 512u << 20;  // 512 MiB (total body)
   static constexpr size_t CACHE_MAX_FILE_SIZE = 512u << 20;  // 512 MiB (on-disk file)
+  static constexpr uint32_t CACHE_MAX_SHARDS = 64;  // entry shards per sharded cache
+
+  /** Decoded bytes per block of an LZ4_BLOCKS body. */
+  static constexpr uint32_t CACHE_LZ4_BLOCK_SIZE = 1u << 20;  // 1 MiB
+  /** Smallest body the writer splits into LZ4 blocks; smaller bodies stay one LZ4 block. */
+  static constexpr size_t CACHE_LZ4_BLOCKS_MIN_BODY = 4u << 20;  // 4 MiB
+  /** Fewest entries for which the writer stores a coded body image (BodyFormat::CODED). */
+  static constexpr uint32_t CACHE_COLUMNAR_MIN_ENTRIES = 256;
 
   static constexpr size_t MIN_DIR_FD_FILES = 4;
 
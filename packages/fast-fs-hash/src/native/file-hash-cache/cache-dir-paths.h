@@ -0,0 +1,172 @@
+#ifndef _FAST_FS_HASH_CACHE_DIR_PATHS_H
+#define _FAST_FS_HASH_CACHE_DIR_PATHS_H
+
+#include "file-hash-cache-format.h"
+#include "OwnedBuf.h"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fast_fs_hash {
+
+  /** Upper bound of encodeDirPaths' output for `n` paths totalling `pathsLen` bytes. */
+  FSH_FORCE_INLINE size_t dirPathsBound(uint32_t n, uint32_t pathsLen) noexcept {
+    return static_cast<size_t>(n) * 8 + 4 + static_cast<size_t>(pathsLen);
+  }
+
+  /**
+   * Write the DIR_PATHS form of [pathEnds][paths] (see CacheBodyCoding) to
+   * `dst`, which has room for dirPathsBound(n, pathsLen) bytes. Returns the
+   * encoded length, or 0 when the paths can't be coded (malformed ends, or
+   * a directory or basename longer than 65535 bytes); the caller then
+   * stores them as they are.
+   */
+  inline size_t encodeDirPaths(const uint32_t * pathEnds, const uint8_t * paths, uint32_t n, uint32_t pathsLen, uint8_t * dst) noexcept {
+    const size_t cn = n;
+    auto * const entryDir = reinterpret_cast<uint32_t *>(dst);
+    uint8_t * const baseLen = dst + cn * 4;
+    uint8_t * out = dst + cn * 6;
+
+    std::unordered_map<std::string_view, uint32_t> ids;
+    ids.reserve(cn / 8 + 1);
+    std::vector<std::string_view> dirs;
+
+    uint32_t prevEnd = 0;
+    for (size_t i = 0; i < cn; ++i) {
+      const uint32_t end = pathEnds[i];
+      if (end < prevEnd || end > pathsLen) [[unlikely]] {
+        return 0;
+      }
+      const uint8_t * p = paths + prevEnd;
+      const size_t len = end - prevEnd;
+      prevEnd = end;
+
+      size_t dirLen = len;
+      while (dirLen > 0 && p[dirLen - 1] != '/') {
+        --dirLen;
+      }
+      const size_t bl = len - dirLen;
+      if (dirLen > 0xFFFF || bl > 0xFFFF) [[unlikely]] {
+        return 0;
+      }
+      const std::string_view dir(reinterpret_cast<const char *>(p), dirLen);
+      const auto [it, added] = ids.try_emplace(dir, static_cast<uint32_t>(dirs.size()));
+      if (added) {
+        dirs.push_back(dir);
+      }
+      entryDir[i] = it->second;
+      const auto bl16 = static_cast<uint16_t>(bl);
+      memcpy(baseLen + i * 2, &bl16, 2);
+      memcpy(out, p + dirLen, bl);
+      out += bl;
+    }
+
+    const auto dirCount = static_cast<uint32_t>(dirs.size());
+    memcpy(out, &dirCount, 4);
+    out += 4;
+    for (const std::string_view & d : dirs) {
+      const auto dl16 = static_cast<uint16_t>(d.size());
+      memcpy(out, &dl16, 2);
+      out += 2;
+    }
+    for (const std::string_view & d : dirs) {
+      memcpy(out, d.data(), d.size());
+      out += d.size();
+    }
+    return static_cast<size_t>(out - dst);
+  }
+
+  /**
+   * Decode a DIR_PATHS region `src` (exactly srcLen bytes) into `n`
+   * pathEnds and `pathsLen` path bytes. Every index, length and the total
+   * are checked; returns false on any mismatch or allocation failure.
+   * When `entryDirOut` is non-null it receives each entry's directory
+   * index and `dirCountOut` the number of directories.
+   */
+  inline bool decodeDirPaths(
+    const uint8_t * src,
+    size_t srcLen,
+    uint32_t n,
+    uint32_t pathsLen,
+    uint32_t * pathEnds,
+    uint8_t * paths,
+    uint32_t * entryDirOut,
+    uint32_t & dirCountOut) noexcept {
+    const size_t cn = n;
+    if (srcLen < cn * 6 + 4) [[unlikely]] {
+      return false;
+    }
+    const uint8_t * const entryDir = src;
+    const uint8_t * const baseLen = src + cn * 4;
+    const uint8_t * const baseBytes = src + cn * 6;
+    size_t baseTotal = 0;
+    for (size_t i = 0; i < cn; ++i) {
+      uint16_t bl;
+      memcpy(&bl, baseLen + i * 2, 2);
+      baseTotal += bl;
+    }
+    size_t off = cn * 6 + baseTotal;
+    if (off + 4 > srcLen) [[unlikely]] {
+      return false;
+    }
+    uint32_t dirCount;
+    memcpy(&dirCount, src + off, 4);
+    off += 4;
+    if (dirCount > cn || srcLen - off < static_cast<size_t>(dirCount) * 2) [[unlikely]] {
+      return false;
+    }
+    const uint8_t * const dirLen = src + off;
+    off += static_cast<size_t>(dirCount) * 2;
+
+    // Start of every directory's bytes, plus the end of the last one.
+    OwnedBuf<> dirStartBuf = OwnedBuf<>::alloc((static_cast<size_t>(dirCount) + 1) * sizeof(size_t));
+    if (!dirStartBuf) [[unlikely]] {
+      return false;
+    }
+    auto * const dirStart = reinterpret_cast<size_t *>(dirStartBuf.ptr);
+    size_t dirOff = off;
+    for (uint32_t d = 0; d < dirCount; ++d) {
+      uint16_t dl;
+      memcpy(&dl, dirLen + static_cast<size_t>(d) * 2, 2);
+      dirStart[d] = dirOff;
+      dirOff += dl;
+    }
+    dirStart[dirCount] = dirOff;
+    if (dirOff != srcLen) [[unlikely]] {
+      return false;
+    }
+
+    size_t outLen = 0;
+    const uint8_t * base = baseBytes;
+    for (size_t i = 0; i < cn; ++i) {
+      uint32_t d;
+      memcpy(&d, entryDir + i * 4, 4);
+      uint16_t bl;
+      memcpy(&bl, baseLen + i * 2, 2);
+      if (d >= dirCount) [[unlikely]] {
+        return false;
+      }
+      const size_t dl = dirStart[d + 1] - dirStart[d];
+      if (outLen + dl + bl > pathsLen) [[unlikely]] {
+        return false;
+      }
+      memcpy(paths + outLen, src + dirStart[d], dl);
+      memcpy(paths + outLen + dl, base, bl);
+      base += bl;
+      outLen += dl + bl;
+      pathEnds[i] = static_cast<uint32_t>(outLen);
+      if (entryDirOut) {
+        entryDirOut[i] = d;
+      }
+    }
+    if (outLen != pathsLen) [[unlikely]] {
+      return false;
+    }
+    dirCountOut = dirCount;
+    return true;
+  }
+
+}  // namespace fast_fs_hash
+
+#endif
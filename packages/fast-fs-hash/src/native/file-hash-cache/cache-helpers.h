@@ -5,12 +5,20 @@
 #include "OwnedBuf.h"
 #include "ParsedPayloads.h"
 #include "cache-constants.h"
+#include "cache-coding.h"
+#include "DecodedCacheRegistry.h"
 
 #include <algorithm>
 #include <lz4.h>
 
 namespace fast_fs_hash {
 
+  class ThreadPool;
+
+  // Defined in cache-blocks.h.
+  inline size_t encodeCacheBlocks(
+    ThreadPool & pool, const uint8_t * body, size_t bodyLen, OwnedBuf<> & scratch, uint32_t tableFlags) noexcept;
+
   /** XXH3-128 of a cache file's stat fields, packed into two f64 slots.
    *  Identity: matching pair ⇒ file bytes are bit-identical to last write
    *  (under the flock held by every writer). */
@@ -33,11 +41,39 @@ namespace fast_fs_hash {
     }
   }
 
-  /** Initial threads for CacheOpen stat-match (stat-only is kernel-bound, 4 is optimal). */
+  /** Stat fields of one entry — the cached values, or a fresh stat. */
+  struct CacheStatSnapshot {
+    uint64_t ino;
+    uint64_t mtimeNs;
+    uint64_t ctimeNs;
+    uint64_t size;
+  };
+
+  /** Most entries one statMatchMask call compares (one mask bit each). */
+  static constexpr size_t STAT_MATCH_BATCH = 64;
+
+  /** Bit k set ⇔ fresh[k] and old[k] agree on all four stat fields, for
+   *  k < count ≤ STAT_MATCH_BATCH. Branchless XOR/OR reduction over two
+   *  contiguous arrays, so the compiler vectorizes it for the ISA level the
+   *  binary is built for (see includes.h). */
+  FSH_FORCE_INLINE uint64_t statMatchMask(
+    const CacheStatSnapshot * FSH_RESTRICT fresh, const CacheStatSnapshot * FSH_RESTRICT old, size_t count) noexcept {
+    uint64_t mask = 0;
+    for (size_t k = 0; k < count; ++k) {
+      const uint64_t diff = (fresh[k].ino ^ old[k].ino) | (fresh[k].mtimeNs ^ old[k].mtimeNs) |
+        (fresh[k].ctimeNs ^ old[k].ctimeNs) | (fresh[k].size ^ old[k].size);
+      mask |= static_cast<uint64_t>(diff == 0) << k;
+    }
+    return mask;
+  }
+
+  /** Initial threads for CacheOpen stat-match (stat-only is kernel-bound, 4 is optimal).
+   *  Starting point for ThreadTuner when autotuning is on. */
   static constexpr int MAX_OPEN_THREADS = 4;
 
   /** Max threads for cache I/O (stat + read + hash). Used by CacheWriter/CacheWriteNew,
-   *  and as the expand ceiling for CacheOpen when it detects files needing hash. */
+   *  and as the expand ceiling for CacheOpen when it detects files needing hash.
+   *  Starting point for ThreadTuner when autotuning is on. */
   static constexpr int MAX_CACHE_IO_THREADS = 8;
 
   /** Minimum bytes LZ4 must shrink the body by for the writer to prefer it
@@ -47,7 +83,7 @@ namespace fast_fs_hash {
 
   /** Compute batch size for work-stealing and clamp threadCount to useful range. */
   inline size_t computeBatchSize(int & threadCount, size_t fileCount) {
-    const size_t batch = std::clamp(fileCount / static_cast<size_t>(threadCount * 8), size_t{4}, size_t{64});
+    const size_t batch = std::clamp(fileCount / static_cast<size_t>(threadCount * 8), size_t{4}, STAT_MATCH_BATCH);
 
     const int maxUseful = static_cast<int>((fileCount + batch - 1) / batch);
     if (threadCount > maxUseful) {
@@ -60,6 +96,94 @@ namespace fast_fs_hash {
     return batch;
   }
 
+  /**
+   * Choose the on-disk encoding of a body. LZ4 is only attempted when the
+   * body is large enough that it can plausibly beat plain by
+   * LZ4_WIN_MARGIN_BYTES — for smaller bodies the compressBound alloc + LZ4
+   * call is pure waste. On LZ4, `out` points into `scratch`; on PLAIN it is
+   * `body` itself. `plainOnly` skips LZ4 altogether (patchable caches).
+   * With a `pool`, bodies of CACHE_LZ4_BLOCKS_MIN_BODY and up are encoded
+   * as LZ4_BLOCKS, compressed in parallel (see encodeCacheBlocks).
+   * `layout` is the header whose counts describe `body`; with
+   * CACHE_COLUMNAR_MIN_ENTRIES files or more the body is stored as a coded
+   * image (BodyFormat::CODED, or LZ4_BLOCKS with coding flags; see
+   * encodeCacheImage). Smaller caches keep plain LZ4 so they stay readable
+   * by older builds. Returns false only if a scratch allocation fails.
+   */
+  inline bool encodeCacheBody(
+    const uint8_t * body,
+    size_t bodyLen,
+    OwnedBuf<> & scratch,
+    BodyFormat & fmt,
+    const uint8_t *& out,
+    size_t & outLen,
+    bool plainOnly = false,
+    ThreadPool * pool = nullptr,
+    const CacheHeader * layout = nullptr) noexcept {
+    fmt = BodyFormat::PLAIN;
+    out = body;
+    outLen = bodyLen;
+    if (plainOnly || bodyLen <= LZ4_WIN_MARGIN_BYTES) {
+      return true;
+    }
+
+    OwnedBuf<> image;
+    const uint8_t * src = body;
+    size_t srcLen = bodyLen;
+    uint32_t coding = 0;
+    if (layout && layout->fileCount >= CACHE_COLUMNAR_MIN_ENTRIES && layout->bodySize() == bodyLen) {
+      srcLen = encodeCacheImage(body, *layout, image, coding);
+      if (srcLen == 0) [[unlikely]] {
+        return false;
+      }
+      src = image.ptr;
+    }
+
+    if (pool && bodyLen >= CACHE_LZ4_BLOCKS_MIN_BODY) {
+      const size_t encoded = encodeCacheBlocks(*pool, src, srcLen, scratch, coding);
+      if (encoded == 0) [[unlikely]] {
+        return false;
+      }
+      if (encoded + LZ4_WIN_MARGIN_BYTES < bodyLen) {
+        fmt = BodyFormat::LZ4_BLOCKS;
+        out = scratch.ptr;
+        outLen = encoded;
+      } else {
+        scratch.reset();
+      }
+      return true;
+    }
+
+    // A coded image goes behind its CacheBodyCoding header.
+    const size_t prefix = coding != 0 ? CacheBodyCoding::SIZE : 0;
+    const int srcSize = static_cast<int>(srcLen);
+    const int maxCompressed = LZ4_compressBound(srcSize);
+    scratch = OwnedBuf<>::alloc(prefix + static_cast<size_t>(maxCompressed));
+    if (!scratch) [[unlikely]] {
+      return false;
+    }
+    const int compressedSize = LZ4_compress_fast(
+      reinterpret_cast<const char *>(src),
+      reinterpret_cast<char *>(scratch.ptr + prefix),
+      srcSize,
+      maxCompressed,
+      2);
+
+    if (compressedSize > 0 && prefix + static_cast<size_t>(compressedSize) + LZ4_WIN_MARGIN_BYTES < bodyLen) {
+      fmt = BodyFormat::LZ4;
+      if (prefix > 0) {
+        const CacheBodyCoding head{coding, static_cast<uint32_t>(srcLen), 0};
+        memcpy(scratch.ptr, &head, CacheBodyCoding::SIZE);
+        fmt = BodyFormat::CODED;
+      }
+      out = scratch.ptr;
+      outLen = prefix + static_cast<size_t>(compressedSize);
+    } else {
+      scratch.reset();  // LZ4 lost — release before writev
+    }
+    return true;
+  }
+
   /**
    * Write [header][uncompressed section][body] to a locked fd.
    *
@@ -78,6 +202,8 @@ namespace fast_fs_hash {
    * @param bodyLen      Byte length of the body.
    * @param file         Locked fd — closed by this function.
    * @param statOut      Output: cache file stat hash [stat0, stat1].
+   * @param plainOnly    Always write the body PLAIN.
+   * @param pool         Pool for parallel LZ4_BLOCKS encoding of large bodies, or nullptr.
    */
   inline bool compressAndWriteCache(
     CacheHeader * hdr,
@@ -86,45 +212,24 @@ namespace fast_fs_hash {
     const uint8_t * body,
     size_t bodyLen,
     FfshFile & file,
-    double * statOut) noexcept {
+    double * statOut,
+    bool plainOnly = false,
+    ThreadPool * pool = nullptr) noexcept {
     if (bodyLen > CACHE_MAX_BODY_SIZE) [[unlikely]] {
       file.close();
       return false;
     }
 
-    const int srcSize = static_cast<int>(bodyLen);
-
-    // Choose body encoding. LZ4 is only attempted when the body is large
-    // enough that it can plausibly beat plain by LZ4_WIN_MARGIN_BYTES — for
-    // smaller bodies the compressBound alloc + LZ4 call is pure waste.
     OwnedBuf<> lz4Scratch;
-    BodyFormat fmt = BodyFormat::PLAIN;
-    size_t bodyOutLen = bodyLen;
-    const uint8_t * bodyOutPtr = body;
-    if (bodyLen > LZ4_WIN_MARGIN_BYTES) {
-      const int maxCompressed = LZ4_compressBound(srcSize);
-      lz4Scratch = OwnedBuf<>::alloc(static_cast<size_t>(maxCompressed));
-      if (!lz4Scratch) [[unlikely]] {
-        file.close();
-        return false;
-      }
-      const int compressedSize = LZ4_compress_fast(
-        reinterpret_cast<const char *>(body),
-        reinterpret_cast<char *>(lz4Scratch.ptr),
-        srcSize,
-        maxCompressed,
-        2);
-
-      if (compressedSize > 0 && static_cast<size_t>(compressedSize) + LZ4_WIN_MARGIN_BYTES < bodyLen) {
-        fmt = BodyFormat::LZ4;
-        bodyOutLen = static_cast<size_t>(compressedSize);
-        bodyOutPtr = lz4Scratch.ptr;
-      } else {
-        lz4Scratch.reset();  // LZ4 lost — release before writev
-      }
+    BodyFormat fmt;
+    const uint8_t * bodyOutPtr;
+    size_t bodyOutLen;
+    if (!encodeCacheBody(body, bodyLen, lz4Scratch, fmt, bodyOutPtr, bodyOutLen, plainOnly, pool, hdr)) [[unlikely]] {
+      file.close();
+      return false;
     }
 
-    hdr->magic = CacheHeader::makeMagic(fmt);
+    hdr->setBodyFormat(fmt);
     const size_t actualFileSize = CacheHeader::SIZE + uncSize + bodyOutLen;
 
     if (!file) [[unlikely]] {
@@ -156,6 +261,175 @@ namespace fast_fs_hash {
     return ok;
   }
 
+  /** One contiguous piece of a cache file image, in file order. */
+  struct CachePatchSeg {
+    const uint8_t * data;
+    size_t len;
+    /** Segment holds CacheEntry records whose ino state bits must be masked off. */
+    bool entries;
+  };
+
+  /**
+   * Patch a PLAIN single-file cache in place: compare the new file image
+   * (`segs`, header first) against the bytes on disk and pwrite only the
+   * ranges that differ — in practice the header and the few CacheEntry
+   * records whose stat or hash moved. No body copy, no LZ4, no truncate.
+   *
+   * Only applies when the file on disk is PLAIN and has exactly the new
+   * layout (same counts and section lengths, same size); the body offsets
+   * then line up byte for byte. Reads the old image back in ENTRY-aligned
+   * chunks, so the cost is one sequential pread pass from the page cache
+   * plus O(changed) writes.
+   *
+   * Returns true when the file now holds the new image; the fd is then
+   * closed and statOut stamped once. Returns false (fd left open) when the
+   * file is not patchable or an I/O call failed — the caller falls back to
+   * a full rewrite, which overwrites any partial patch.
+   */
+  inline bool tryPatchPlainCache(
+    CacheHeader * hdr, const CachePatchSeg * segs, int nsegs, FfshFile & file, double * statOut) noexcept {
+    static constexpr size_t CHUNK = CacheEntry::STRIDE * 1024;  // 48 KiB
+
+    size_t total = 0;
+    for (int i = 0; i < nsegs; ++i) {
+      total += segs[i].len;
+    }
+    CacheHeader disk;
+    if (!file || file.fsize() != static_cast<int64_t>(total) ||
+        file.pread_at_most(&disk, CacheHeader::SIZE, 0) != static_cast<int64_t>(CacheHeader::SIZE)) {
+      return false;
+    }
+    const uint32_t plainMagic =
+      CacheHeader::makeMagic(BodyFormat::PLAIN) | (hdr->magic & CacheHeader::MAGIC_CHUNK_TREE);
+    if (disk.magic != plainMagic || disk.fileCount != hdr->fileCount || disk.pathsLen != hdr->pathsLen ||
+        disk.compressedPayloadItemCount != hdr->compressedPayloadItemCount ||
+        disk.compressedPayloadsLen != hdr->compressedPayloadsLen ||
+        disk.uncompressedPayloadItemCount != hdr->uncompressedPayloadItemCount ||
+        disk.uncompressedPayloadsLen != hdr->uncompressedPayloadsLen) {
+      return false;
+    }
+
+    OwnedBuf<> scratch = OwnedBuf<>::alloc(CHUNK * 2);
+    if (!scratch) [[unlikely]] {
+      return false;
+    }
+    uint8_t * const old = scratch.ptr;
+    uint8_t * const masked = scratch.ptr + CHUNK;
+    // Only now is the patch going ahead: segs[0] is the header image, so it must carry the on-disk format.
+    hdr->setBodyFormat(BodyFormat::PLAIN);
+
+    size_t off = 0;
+    for (int i = 0; i < nsegs; ++i) {
+      const CachePatchSeg & seg = segs[i];
+      for (size_t pos = 0; pos < seg.len; pos += CHUNK) {
+        const size_t n = seg.len - pos < CHUNK ? seg.len - pos : CHUNK;
+        const size_t at = off + pos;
+        if (file.pread_at_most(old, n, at) != static_cast<int64_t>(n)) [[unlikely]] {
+          return false;
+        }
+        const uint8_t * cur = seg.data + pos;
+        if (seg.entries) {
+          memcpy(masked, cur, n);
+          auto * ents = reinterpret_cast<CacheEntry *>(masked);
+          for (size_t k = 0; k < n / CacheEntry::STRIDE; ++k) {
+            ents[k].ino &= INO_VALUE_MASK;
+          }
+          cur = masked;
+        }
+        if (memcmp(old, cur, n) == 0) [[likely]] {
+          continue;
+        }
+        if (seg.entries) {
+          // One pwrite per run of adjacent changed records.
+          const size_t count = n / CacheEntry::STRIDE;
+          for (size_t k = 0; k < count;) {
+            if (memcmp(old + k * CacheEntry::STRIDE, cur + k * CacheEntry::STRIDE, CacheEntry::STRIDE) == 0) {
+              ++k;
+              continue;
+            }
+            size_t end = k + 1;
+            while (end < count &&
+                   memcmp(old + end * CacheEntry::STRIDE, cur + end * CacheEntry::STRIDE, CacheEntry::STRIDE) != 0) {
+              ++end;
+            }
+            const size_t from = k * CacheEntry::STRIDE;
+            if (!file.pwrite_all(cur + from, (end - k) * CacheEntry::STRIDE, at + from)) [[unlikely]] {
+              return false;
+            }
+            k = end;
+          }
+        } else {
+          size_t lo = 0;
+          size_t hi = n;
+          while (old[lo] == cur[lo]) {
+            ++lo;
+          }
+          while (old[hi - 1] == cur[hi - 1]) {
+            --hi;
+          }
+          if (!file.pwrite_all(cur + lo, hi - lo, at + lo)) [[unlikely]] {
+            return false;
+          }
+        }
+      }
+      off += seg.len;
+    }
+
+    if (statOut) {
+      stampCacheFileStat(statOut, file.fd);
+    }
+    file.close();
+    return true;
+  }
+
+  /** On-disk layout choices for a cache write (from CacheStateBuf::flags). */
+  struct CacheWriteMode {
+    /** Entry shards to write; 0 or 1 = single file. */
+    uint32_t shardCount = 0;
+    /** Keep single-file bodies PLAIN so later writes can patch them in place. */
+    bool patchable = false;
+    /** Pool for parallel LZ4_BLOCKS encoding of large single-file bodies, or nullptr. */
+    ThreadPool * pool = nullptr;
+
+    static CacheWriteMode of(const CacheStateBuf * state, ThreadPool * pool) noexcept {
+      return {state->shardCount(), state->patchable(), pool};
+    }
+  };
+
+  // Defined in cache-shards.h.
+  inline bool writeShardedCache(
+    CacheHeader * hdr,
+    const uint8_t * uncompressed,
+    size_t uncSize,
+    const uint8_t * body,
+    size_t bodyLen,
+    FfshFile & file,
+    double * statOut,
+    const char * cachePath,
+    uint32_t shardCount) noexcept;
+  inline void removeCacheShards(FfshFile & file, const char * cachePath) noexcept;
+
+  /** Write [header][uncompressed section][body] to the locked fd — as one
+   *  file, or as a manifest plus shard files when shardCount > 1. */
+  inline bool writeCacheFile(
+    CacheHeader * hdr,
+    const uint8_t * uncompressed,
+    size_t uncSize,
+    const uint8_t * body,
+    size_t bodyLen,
+    FfshFile & file,
+    double * statOut,
+    const char * cachePath,
+    const CacheWriteMode & mode) noexcept {
+    if (mode.shardCount > 1) {
+      return writeShardedCache(hdr, uncompressed, uncSize, body, bodyLen, file, statOut, cachePath, mode.shardCount);
+    }
+    if (file) {
+      removeCacheShards(file, cachePath);
+    }
+    return compressAndWriteCache(hdr, uncompressed, uncSize, body, bodyLen, file, statOut, mode.patchable, mode.pool);
+  }
+
   /**
    * Assemble the uncompressed section and compressed body from the in-memory
    * dataBuf, then write them to the locked fd.
@@ -177,6 +451,13 @@ namespace fast_fs_hash {
    * @param uncompressed New uncompressed payloads to embed (may differ from previous).
    * @param file         Locked fd — closed by this function.
    * @param statOut      Output: cache file stat hash [stat0, stat1]. Written on success.
+   * @param cachePath    Cache file path (names the shard files).
+   * @param mode         Sharding / patchable layout. A single-file write
+   *                     patches a PLAIN file with the same layout in place
+   *                     (tryPatchPlainCache) instead of rewriting it.
+   *
+   * Drops the DecodedCacheRegistry image of cachePath first: a patch can
+   * leave the file's identity unchanged within one timestamp tick.
    */
   inline bool assembleAndWriteCache(
     uint8_t * buf,
@@ -188,7 +469,11 @@ namespace fast_fs_hash {
     const ParsedPayloads & compressed,
     const ParsedPayloads & uncompressed,
     FfshFile & file,
-    double * statOut) noexcept {
+    double * statOut,
+    const char * cachePath,
+    const CacheWriteMode & mode) noexcept {
+    DecodedCacheRegistry::instance().invalidate(cachePath);
+
     // - Compute new compressed section sizes
     const size_t newCompCount = compressed.count();
     const auto * compItems = compressed.data();
@@ -271,9 +556,44 @@ namespace fast_fs_hash {
       }
     }
 
+    // - Same layout as a PLAIN file on disk: patch it instead of rewriting
+    if (mode.shardCount <= 1 && fc > 0 && bodyTotal <= CACHE_MAX_BODY_SIZE) {
+      OwnedBuf<> compBuf;
+      if (hasComp) {
+        compBuf = OwnedBuf<>::alloc(compDirSize + compBytesLen);
+        if (!compBuf) [[unlikely]] {
+          file.close();
+          return false;
+        }
+        auto * dir = reinterpret_cast<uint32_t *>(compBuf.ptr);
+        uint8_t * bytesDst = compBuf.ptr + compDirSize;
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < newCompCount; ++i) {
+          const size_t itemLen = compItems[i].len;
+          if (itemLen > 0) {
+            memcpy(bytesDst + cumulative, compItems[i].ptr, itemLen);
+          }
+          cumulative += static_cast<uint32_t>(itemLen);
+          dir[i] = cumulative;
+        }
+      }
+      const CachePatchSeg segs[] = {
+        {reinterpret_cast<const uint8_t *>(hdr), CacheHeader::SIZE, false},
+        {uncPtr, uncSectionSize, false},
+        {reinterpret_cast<const uint8_t *>(inMemEntries), entriesLen, true},
+        {compBuf.ptr, compDirSize, false},
+        {reinterpret_cast<const uint8_t *>(inMemPe), peSize, false},
+        {inMemPaths, inMemPathsLen, false},
+        {compBuf.ptr + compDirSize, compBytesLen, false},
+      };
+      if (tryPatchPlainCache(hdr, segs, 7, file, statOut)) {
+        return true;
+      }
+    }
+
     // - Assemble the new body
     if (bodyTotal == 0) {
-      return compressAndWriteCache(hdr, uncPtr, uncSectionSize, nullptr, 0, file, statOut);
+      return writeCacheFile(hdr, uncPtr, uncSectionSize, nullptr, 0, file, statOut, cachePath, mode);
     }
     OwnedBuf<> body = OwnedBuf<>::alloc(bodyTotal);
     if (!body) [[unlikely]] {
@@ -312,7 +632,7 @@ namespace fast_fs_hash {
       }
     }
 
-    return compressAndWriteCache(hdr, uncPtr, uncSectionSize, body.ptr, bodyTotal, file, statOut);
+    return writeCacheFile(hdr, uncPtr, uncSectionSize, body.ptr, bodyTotal, file, statOut, cachePath, mode);
   }
 
 }  // namespace fast_fs_hash
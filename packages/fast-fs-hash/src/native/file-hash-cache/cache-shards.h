@@ -0,0 +1,517 @@
+#ifndef _FAST_FS_HASH_CACHE_SHARDS_H
+#define _FAST_FS_HASH_CACHE_SHARDS_H
+
+#include "cache-helpers.h"
+
+#include <string>
+#include <vector>
+
+namespace fast_fs_hash {
+
+  // Sharded cache layout (BodyFormat::SHARDED). The on-disk format is described
+  // in file-hash-cache-format.h; this file holds the writer and the loader.
+
+  /** `<cachePath>.shard-<index>`, or `<cachePath>.shard-p` for the payload shard (index == shardCount). */
+  inline std::string cacheShardPath(const char * cachePath, uint32_t index, uint32_t shardCount) {
+    std::string p(cachePath);
+    p += ".shard-";
+    if (index == shardCount) {
+      p += 'p';
+    } else {
+      p += std::to_string(index);
+    }
+    return p;
+  }
+
+  /** Entry shard of a relative path: a hash of its parent directory, so the
+   *  files of one directory always land in the same shard. */
+  FSH_FORCE_INLINE uint32_t cacheShardOf(const uint8_t * path, size_t len, uint32_t shardCount) noexcept {
+    size_t dirLen = len;
+    while (dirLen > 0 && path[dirLen - 1] != '/') {
+      --dirLen;
+    }
+    return static_cast<uint32_t>(XXH3_64bits(path, dirLen) % shardCount);
+  }
+
+  /** Byte length of the manifest tail: table + refs + shardOf. */
+  FSH_FORCE_INLINE size_t cacheShardTableSize(uint32_t shardCount, uint32_t fileCount) noexcept {
+    return CacheShardTable::SIZE + static_cast<size_t>(shardCount + 1) * CacheShardRef::SIZE + fileCount;
+  }
+
+  /**
+   * Read the shard refs of the manifest currently in `file` (locked).
+   * Returns the entry shard count, or 0 if the file is not a sharded manifest.
+   */
+  inline uint32_t readCacheShardRefs(FfshFile & file, std::vector<CacheShardRef> & refs) noexcept {
+    CacheHeader hdr;
+    const int64_t hn = file.pread_at_most(&hdr, CacheHeader::SIZE, 0);
+    if (hn < static_cast<int64_t>(CacheHeader::SIZE) || !hdr.validateLimits() ||
+        hdr.bodyFormatByte() != static_cast<uint8_t>(BodyFormat::SHARDED)) {
+      return 0;
+    }
+    const size_t tableOff = CacheHeader::SIZE + hdr.uncompressedSectionSize();
+    CacheShardTable table;
+    const int64_t tn = file.pread_at_most(&table, CacheShardTable::SIZE, tableOff);
+    if (tn < static_cast<int64_t>(CacheShardTable::SIZE) || table.shardCount < 2 ||
+        table.shardCount > CACHE_MAX_SHARDS) {
+      return 0;
+    }
+    refs.resize(table.shardCount + 1);
+    const size_t refsLen = refs.size() * CacheShardRef::SIZE;
+    const int64_t rn = file.pread_at_most(refs.data(), refsLen, tableOff + CacheShardTable::SIZE);
+    if (rn < static_cast<int64_t>(refsLen)) {
+      refs.clear();
+      return 0;
+    }
+    return table.shardCount;
+  }
+
+  /** Whether the shard file at `path` is the one `ref` pins (header check only). */
+  inline bool cacheShardFileMatches(const std::string & path, uint32_t index, const CacheShardRef & ref) noexcept {
+    FfshFile f(path.c_str());
+    if (!f) {
+      return false;
+    }
+    CacheShardHeader sh;
+    const int64_t n = f.pread_at_most(&sh, CacheShardHeader::SIZE, 0);
+    return n == static_cast<int64_t>(CacheShardHeader::SIZE) &&
+      (sh.magic & CacheHeader::MAGIC_ID_MASK) == CacheShardHeader::MAGIC_ID && sh.index == index &&
+      sh.bodyHash == ref.bodyHash && sh.bodySize == ref.bodySize;
+  }
+
+  /**
+   * Write one shard through `<path>.tmp` + rename, so the shard file is always
+   * either the old or the new one. Runs under the manifest lock, so the fixed
+   * temp name cannot collide with another writer.
+   */
+  inline bool writeCacheShardFile(
+    const std::string & path, uint32_t index, const CacheShardRef & ref, const uint8_t * body) noexcept {
+    OwnedBuf<> lz4Scratch;
+    BodyFormat fmt;
+    const uint8_t * out;
+    size_t outLen;
+    if (!encodeCacheBody(body, ref.bodySize, lz4Scratch, fmt, out, outLen)) [[unlikely]] {
+      return false;
+    }
+
+    CacheShardHeader sh{};
+    sh.magic = CacheShardHeader::MAGIC_ID | (static_cast<uint32_t>(fmt) << 24);
+    sh.index = index;
+    sh.fileCount = ref.fileCount;
+    sh.pathsLen = ref.pathsLen;
+    sh.bodyHash = ref.bodyHash;
+    sh.bodySize = ref.bodySize;
+
+    const std::string tmp = path + ".tmp";
+    FfshFile f = FfshFile::open_rw(tmp.c_str());
+    if (!f) [[unlikely]] {
+      return false;
+    }
+    f.preallocate(CacheShardHeader::SIZE + outLen);
+    FfshIoVec iov[2] = {{&sh, CacheShardHeader::SIZE}, {const_cast<uint8_t *>(out), outLen}};
+    bool ok = f.write_all_vec(iov, 2) && f.truncate(CacheShardHeader::SIZE + outLen);
+    f.close();
+    ok = ok && FfshFile::replace_file(tmp.c_str(), path.c_str());
+    if (!ok) [[unlikely]] {
+      FfshFile::remove_file(tmp.c_str());
+    }
+    return ok;
+  }
+
+  /** If `file` holds a sharded manifest, delete its shard files. Call before
+   *  overwriting it with a single-file cache, while the lock is still held. */
+  inline void removeCacheShards(FfshFile & file, const char * cachePath) noexcept {
+    std::vector<CacheShardRef> refs;
+    const uint32_t n = readCacheShardRefs(file, refs);
+    for (uint32_t k = 0; n > 0 && k <= n; ++k) {
+      FfshFile::remove_file(cacheShardPath(cachePath, k, n).c_str());
+    }
+  }
+
+  /**
+   * Sharded counterpart of compressAndWriteCache: split `body` into entry
+   * shards plus a payload shard, write the shards whose contents changed
+   * since the manifest in `file`, then rewrite the manifest in place.
+   *
+   * Every shard is hashed on every write (XXH3, a fraction of a millisecond
+   * for 200k entries); only changed shards pay for LZ4 and a write. A shard
+   * that is pinned but missing or stale on disk is rewritten.
+   *
+   * Closes the fd when done (or on error). On success, writes the manifest's
+   * stat hash to statOut[0..1].
+   */
+  inline bool writeShardedCache(
+    CacheHeader * hdr,
+    const uint8_t * uncompressed,
+    size_t uncSize,
+    const uint8_t * body,
+    size_t bodyLen,
+    FfshFile & file,
+    double * statOut,
+    const char * cachePath,
+    uint32_t shardCount) noexcept {
+    if (!file) [[unlikely]] {
+      return false;
+    }
+    const uint32_t n = shardCount < CACHE_MAX_SHARDS ? shardCount : CACHE_MAX_SHARDS;
+    const uint32_t fc = hdr->fileCount;
+    const uint32_t compCount = hdr->compressedPayloadItemCount;
+    const size_t pathsLen = hdr->pathsLen;
+    if (bodyLen != hdr->bodySize()) [[unlikely]] {
+      file.close();
+      return false;
+    }
+
+    const uint8_t * const entries = body;
+    const uint8_t * const compDir = entries + static_cast<size_t>(fc) * CacheEntry::STRIDE;
+    const auto * const pe = reinterpret_cast<const uint32_t *>(compDir + static_cast<size_t>(compCount) * 4);
+    const uint8_t * const paths = reinterpret_cast<const uint8_t *>(pe + fc);
+    const uint8_t * const compBytes = paths + pathsLen;
+
+    OwnedBuf<> tail = OwnedBuf<>::calloc(cacheShardTableSize(n, fc));
+    OwnedBuf<uint32_t> order = OwnedBuf<uint32_t>::alloc(fc > 0 ? fc : 1);
+    if (!tail || !order) [[unlikely]] {
+      file.close();
+      return false;
+    }
+    reinterpret_cast<CacheShardTable *>(tail.ptr)->shardCount = n;
+    auto * const refs = reinterpret_cast<CacheShardRef *>(tail.ptr + CacheShardTable::SIZE);
+    uint8_t * const shardOf = tail.ptr + CacheShardTable::SIZE + static_cast<size_t>(n + 1) * CacheShardRef::SIZE;
+
+    // - Partition
+    uint32_t prevEnd = 0;
+    for (uint32_t i = 0; i < fc; ++i) {
+      const uint32_t end = pe[i];
+      if (end < prevEnd || end > pathsLen) [[unlikely]] {
+        file.close();
+        return false;
+      }
+      const uint32_t k = cacheShardOf(paths + prevEnd, end - prevEnd, n);
+      shardOf[i] = static_cast<uint8_t>(k);
+      refs[k].fileCount += 1;
+      refs[k].pathsLen += end - prevEnd;
+      prevEnd = end;
+    }
+
+    // Counting sort: order[first[k] .. first[k + 1]) = the entries of shard k, in global order.
+    uint32_t first[CACHE_MAX_SHARDS + 1];
+    uint64_t maxShardBody = 0;
+    first[0] = 0;
+    for (uint32_t k = 0; k < n; ++k) {
+      CacheShardRef & r = refs[k];
+      r.bodySize = static_cast<uint64_t>(r.fileCount) * (CacheEntry::STRIDE + CacheEntry::PATH_END_SIZE) + r.pathsLen;
+      maxShardBody = r.bodySize > maxShardBody ? r.bodySize : maxShardBody;
+      first[k + 1] = first[k] + r.fileCount;
+    }
+    {
+      uint32_t fill[CACHE_MAX_SHARDS];
+      memcpy(fill, first, sizeof(uint32_t) * n);
+      for (uint32_t i = 0; i < fc; ++i) {
+        order.ptr[fill[shardOf[i]]++] = i;
+      }
+    }
+
+    std::vector<CacheShardRef> oldRefs;
+    const uint32_t oldN = readCacheShardRefs(file, oldRefs);
+    const auto unchanged = [&](uint32_t k, const std::string & path) noexcept {
+      return oldN == n && oldRefs[k].bodyHash == refs[k].bodyHash && oldRefs[k].bodySize == refs[k].bodySize &&
+        cacheShardFileMatches(path, k, refs[k]);
+    };
+
+    // - Entry shards: build each one in the same scratch buffer (it stays hot in
+    //   cache), hash it, and write it only if the hash moved.
+    OwnedBuf<> scratch = OwnedBuf<>::alloc(maxShardBody > 0 ? static_cast<size_t>(maxShardBody) : 1);
+    if (!scratch) [[unlikely]] {
+      file.close();
+      return false;
+    }
+    for (uint32_t k = 0; k < n; ++k) {
+      CacheShardRef & r = refs[k];
+      const std::string path = cacheShardPath(cachePath, k, n);
+      if (r.bodySize == 0) {
+        FfshFile::remove_file(path.c_str());
+        continue;
+      }
+      uint8_t * ent = scratch.ptr;
+      auto * localEnds = reinterpret_cast<uint32_t *>(ent + static_cast<size_t>(r.fileCount) * CacheEntry::STRIDE);
+      uint8_t * localPaths = reinterpret_cast<uint8_t *>(localEnds + r.fileCount);
+      uint32_t localLen = 0;
+      for (uint32_t j = first[k]; j < first[k + 1]; ++j) {
+        const uint32_t i = order.ptr[j];
+        const uint32_t start = i > 0 ? pe[i - 1] : 0;
+        const uint32_t len = pe[i] - start;
+        memcpy(ent, entries + static_cast<size_t>(i) * CacheEntry::STRIDE, CacheEntry::STRIDE);
+        ent += CacheEntry::STRIDE;
+        memcpy(localPaths + localLen, paths + start, len);
+        localLen += len;
+        *localEnds++ = localLen;
+      }
+      r.bodyHash.from_xxh128(XXH3_128bits(scratch.ptr, r.bodySize));
+      if (unchanged(k, path)) {
+        continue;
+      }
+      if (!writeCacheShardFile(path, k, r, scratch.ptr)) [[unlikely]] {
+        file.close();
+        return false;
+      }
+    }
+
+    // - Payload shard: [compressedPayloadDir][compressedPayloads], not contiguous
+    //   in `body`, so hash it in two steps and only gather it when it changed.
+    {
+      CacheShardRef & r = refs[n];
+      r.bodySize = static_cast<uint64_t>(compCount) * 4 + hdr->compressedPayloadsLen;
+      const std::string path = cacheShardPath(cachePath, n, n);
+      if (r.bodySize == 0) {
+        FfshFile::remove_file(path.c_str());
+      } else {
+        const size_t dirLen = static_cast<size_t>(compCount) * 4;
+        XXH3_state_t st;
+        XXH3_128bits_reset(&st);
+        XXH3_128bits_update(&st, compDir, dirLen);
+        XXH3_128bits_update(&st, compBytes, hdr->compressedPayloadsLen);
+        r.bodyHash.from_xxh128(XXH3_128bits_digest(&st));
+        if (!unchanged(n, path)) {
+          OwnedBuf<> gathered = OwnedBuf<>::alloc(static_cast<size_t>(r.bodySize));
+          if (!gathered) [[unlikely]] {
+            file.close();
+            return false;
+          }
+          memcpy(gathered.ptr, compDir, dirLen);
+          memcpy(gathered.ptr + dirLen, compBytes, hdr->compressedPayloadsLen);
+          if (!writeCacheShardFile(path, n, r, gathered.ptr)) [[unlikely]] {
+            file.close();
+            return false;
+          }
+        }
+      }
+    }
+
+    // - Rewrite the manifest, then drop shards the new table no longer has
+    hdr->setBodyFormat(BodyFormat::SHARDED);
+    const size_t manifestSize = CacheHeader::SIZE + uncSize + tail.len;
+    file.preallocate(manifestSize);
+    FfshIoVec iov[3];
+    int iovCount = 0;
+    iov[iovCount++] = {hdr, CacheHeader::SIZE};
+    if (uncSize > 0 && uncompressed) {
+      iov[iovCount++] = {const_cast<uint8_t *>(uncompressed), uncSize};
+    }
+    iov[iovCount++] = {tail.ptr, tail.len};
+    bool ok = file.seek(0) && file.write_all_vec(iov, iovCount);
+    ok = ok && file.truncate(manifestSize);
+
+    if (ok) {
+      for (uint32_t k = n; k < oldN; ++k) {
+        FfshFile::remove_file(cacheShardPath(cachePath, k, oldN).c_str());
+      }
+      if (statOut) {
+        stampCacheFileStat(statOut, file.fd);
+      }
+    }
+
+    file.close();
+    return ok;
+  }
+
+  /**
+   * Reads the shards of a sharded manifest back into one dataBuf image.
+   *
+   *   prepare()  — parse the manifest tail (opening thread, lock held)
+   *   load(k)    — read, decode and hash-check shard k (any thread, one k each)
+   *   assemble() — scatter the shards into the body of the image
+   *
+   * The shard table is validated against the header in prepare(), so a shard
+   * that passes load() is known to fit its slot in the image.
+   */
+  class CacheShardLoader : NonCopyable {
+   public:
+    /** Shard files to load (entry shards + the payload shard); 0 = not loading a sharded cache. */
+    FSH_FORCE_INLINE uint32_t count() const noexcept { return this->n_ > 0 ? this->n_ + 1 : 0; }
+
+    /**
+     * Read and validate the manifest tail: `tailLen` bytes at `tailOff` of the
+     * locked manifest `file`, whose header is `hdr`.
+     */
+    bool prepare(
+      FfshFile & file, const CacheHeader & hdr, size_t tailOff, size_t tailLen, const char * cachePath) noexcept {
+      this->reset();
+      this->tail_ = OwnedBuf<>::alloc(tailLen);
+      if (!this->tail_ || tailLen < CacheShardTable::SIZE) [[unlikely]] {
+        return false;
+      }
+      const int64_t rn = file.pread_at_most(this->tail_.ptr, tailLen, tailOff);
+      if (rn < 0 || static_cast<size_t>(rn) != tailLen) [[unlikely]] {
+        return false;
+      }
+      const uint32_t n = reinterpret_cast<const CacheShardTable *>(this->tail_.ptr)->shardCount;
+      const uint32_t fc = hdr.fileCount;
+      if (n < 2 || n > CACHE_MAX_SHARDS || tailLen != cacheShardTableSize(n, fc)) [[unlikely]] {
+        return false;
+      }
+      this->refs_ = reinterpret_cast<const CacheShardRef *>(this->tail_.ptr + CacheShardTable::SIZE);
+      this->shardOf_ = this->tail_.ptr + CacheShardTable::SIZE + static_cast<size_t>(n + 1) * CacheShardRef::SIZE;
+
+      uint64_t files = 0;
+      uint64_t pathsLen = 0;
+      for (uint32_t k = 0; k < n; ++k) {
+        const CacheShardRef & r = this->refs_[k];
+        if (r.bodySize != static_cast<uint64_t>(r.fileCount) * (CacheEntry::STRIDE + CacheEntry::PATH_END_SIZE) + r.pathsLen)
+          [[unlikely]] {
+          return false;
+        }
+        files += r.fileCount;
+        pathsLen += r.pathsLen;
+      }
+      if (files != fc || pathsLen != hdr.pathsLen ||
+          this->refs_[n].bodySize != static_cast<uint64_t>(hdr.compressedPayloadItemCount) * 4 + hdr.compressedPayloadsLen)
+        [[unlikely]] {
+        return false;
+      }
+
+      this->bodies_.resize(n + 1);
+      this->cachePath_.assign(cachePath);
+      this->fc_ = fc;
+      this->n_ = n;
+      return true;
+    }
+
+    /** Load shard `k`. Safe to call concurrently for distinct `k`. */
+    bool load(uint32_t k) noexcept {
+      const CacheShardRef & r = this->refs_[k];
+      if (r.bodySize == 0) {
+        return true;
+      }
+      FfshFile f(cacheShardPath(this->cachePath_.c_str(), k, this->n_).c_str());
+      if (!f) {
+        return false;
+      }
+      const int64_t fileSize = f.fsize();
+      CacheShardHeader sh;
+      if (fileSize < static_cast<int64_t>(CacheShardHeader::SIZE) ||
+          f.pread_at_most(&sh, CacheShardHeader::SIZE, 0) != static_cast<int64_t>(CacheShardHeader::SIZE)) {
+        return false;
+      }
+      const uint8_t fmt = static_cast<uint8_t>(sh.magic >> 24);
+      if ((sh.magic & CacheHeader::MAGIC_ID_MASK) != CacheShardHeader::MAGIC_ID || sh.index != k ||
+          sh.fileCount != r.fileCount || sh.pathsLen != r.pathsLen || sh.bodySize != r.bodySize ||
+          sh.bodyHash != r.bodyHash || fmt > static_cast<uint8_t>(BodyFormat::PLAIN)) {
+        return false;
+      }
+
+      const size_t bodySize = static_cast<size_t>(r.bodySize);
+      const size_t diskLen = static_cast<size_t>(fileSize) - CacheShardHeader::SIZE;
+      OwnedBuf<> body = OwnedBuf<>::alloc(bodySize);
+      if (!body) [[unlikely]] {
+        return false;
+      }
+      if (fmt == static_cast<uint8_t>(BodyFormat::PLAIN)) {
+        if (diskLen != bodySize ||
+            f.pread_at_most(body.ptr, bodySize, CacheShardHeader::SIZE) != static_cast<int64_t>(bodySize)) {
+          return false;
+        }
+      } else {
+        OwnedBuf<> packed = OwnedBuf<>::alloc(diskLen > 0 ? diskLen : 1);
+        if (!packed || f.pread_at_most(packed.ptr, diskLen, CacheShardHeader::SIZE) != static_cast<int64_t>(diskLen)) {
+          return false;
+        }
+        const int got = LZ4_decompress_safe(
+          reinterpret_cast<const char *>(packed.ptr),
+          reinterpret_cast<char *>(body.ptr),
+          static_cast<int>(diskLen),
+          static_cast<int>(bodySize));
+        if (got < 0 || static_cast<size_t>(got) != bodySize) {
+          return false;
+        }
+      }
+
+      Hash128 h;
+      h.from_xxh128(XXH3_128bits(body.ptr, bodySize));
+      if (h != r.bodyHash) {
+        return false;
+      }
+      this->bodies_[k] = std::move(body);
+      return true;
+    }
+
+    /** Scatter the loaded shards into the body of `buf`, whose header and
+     *  uncompressed section are already in place. */
+    bool assemble(uint8_t * buf) noexcept {
+      const CacheHeader * hdr = headerOf(buf);
+      const uint32_t n = this->n_;
+      const uint32_t fc = this->fc_;
+      const uint32_t compCount = hdr->compressedPayloadItemCount;
+      const size_t uic = hdr->uncompressedPayloadItemCount;
+      const size_t uplen = hdr->uncompressedPayloadsLen;
+      uint8_t * entries = reinterpret_cast<uint8_t *>(entriesOf(buf, uic, uplen));
+      uint32_t * pe = pathEndsOf(buf, fc, compCount, uic, uplen);
+      uint8_t * paths = pathsOf(buf, fc, compCount, uic, uplen);
+
+      const uint8_t * entCur[CACHE_MAX_SHARDS];
+      const uint32_t * peCur[CACHE_MAX_SHARDS];
+      const uint32_t * peEnd[CACHE_MAX_SHARDS];
+      const uint8_t * pathBase[CACHE_MAX_SHARDS];
+      uint32_t prevLocal[CACHE_MAX_SHARDS];
+      for (uint32_t k = 0; k < n; ++k) {
+        const uint32_t kfc = this->refs_[k].fileCount;
+        const uint8_t * b = this->bodies_[k].ptr;
+        entCur[k] = b;
+        peCur[k] = reinterpret_cast<const uint32_t *>(b + static_cast<size_t>(kfc) * CacheEntry::STRIDE);
+        peEnd[k] = peCur[k] + kfc;
+        pathBase[k] = reinterpret_cast<const uint8_t *>(peEnd[k]);
+        prevLocal[k] = 0;
+      }
+
+      uint32_t globalEnd = 0;
+      for (uint32_t i = 0; i < fc; ++i) {
+        const uint32_t k = this->shardOf_[i];
+        if (k >= n || peCur[k] == peEnd[k]) [[unlikely]] {
+          return false;
+        }
+        const uint32_t localEnd = *peCur[k]++;
+        if (localEnd < prevLocal[k] || localEnd > this->refs_[k].pathsLen) [[unlikely]] {
+          return false;
+        }
+        const uint32_t len = localEnd - prevLocal[k];
+        memcpy(entries + static_cast<size_t>(i) * CacheEntry::STRIDE, entCur[k], CacheEntry::STRIDE);
+        entCur[k] += CacheEntry::STRIDE;
+        memcpy(paths + globalEnd, pathBase[k] + prevLocal[k], len);
+        globalEnd += len;
+        pe[i] = globalEnd;
+        prevLocal[k] = localEnd;
+      }
+
+      if (compCount > 0 || hdr->compressedPayloadsLen > 0) {
+        const uint8_t * p = this->bodies_[n].ptr;
+        memcpy(compressedPayloadDirOf(buf, fc, uic, uplen), p, static_cast<size_t>(compCount) * 4);
+        memcpy(
+          compressedPayloadBytesOf(buf, fc, compCount, hdr->pathsLen, uic, uplen),
+          p + static_cast<size_t>(compCount) * 4,
+          hdr->compressedPayloadsLen);
+      }
+      return true;
+    }
+
+    /** Free the manifest tail and shard bodies. */
+    void reset() noexcept {
+      this->tail_.reset();
+      this->bodies_.clear();
+      this->refs_ = nullptr;
+      this->shardOf_ = nullptr;
+      this->n_ = 0;
+      this->fc_ = 0;
+    }
+
+   private:
+    OwnedBuf<> tail_;
+    std::vector<OwnedBuf<>> bodies_;
+    std::string cachePath_;
+    const CacheShardRef * refs_ = nullptr;
+    const uint8_t * shardOf_ = nullptr;
+    uint32_t n_ = 0;
+    uint32_t fc_ = 0;
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
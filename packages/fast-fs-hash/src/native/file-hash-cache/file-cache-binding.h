@@ -5,10 +5,23 @@
 #include "CacheWriter.h"
 #include "CacheWriteNew.h"
 #include "CacheWaitUnlocked.h"
+#include "CachePathTable.h"
 #include "../napi-helpers.h"
 
 namespace fast_fs_hash {
 
+  // - Helper: unwrap a CacheWatcher External
+
+  /** The CacheWatcher behind `val`, or nullptr when `val` is not a live watcher External. */
+  inline CacheWatcher * watcherOf(napi_env env, napi_value val) noexcept {
+    void * ptr = nullptr;
+    if (napi_get_value_external(env, val, &ptr) != napi_ok || !ptr) [[unlikely]] {
+      return nullptr;
+    }
+    auto * w = static_cast<CacheWatcher *>(ptr);
+    return w->magic == CacheWatcher::MAGIC ? w : nullptr;
+  }
+
   // - Helper: parse stateBuf from arg[0]
 
   inline CacheStateBuf * parseStateBuf(const Napi::CallbackInfo & info, Napi::ObjectReference & outRef) {
@@ -24,8 +37,13 @@ namespace fast_fs_hash {
   }
 
   /**
-   * cacheOpen(stateBuf, encodedPaths, rootPath, dirtyBuf?, dirtyCount?)
-   *   → Promise<Buffer<dataBuf>>
+   * cacheOpen(stateBuf, encodedPaths, rootPath, dirtyIndices?, dirtyCount?, fullScan?, watcher?)
+   *   → Promise<Buffer<dataBuf>>, or Promise<[dataBuf, changes | null, removed | null]> when fullScan
+   *
+   * `dirtyIndices` (Uint32Array) is the dirty hint: the first `dirtyCount`
+   * values are the entry indices to stat, every other entry is trusted.
+   * null stats every entry. `watcher` (from cacheWatch) adds its dirty
+   * entries to the hint.
    *
    * Reads version, fingerprint, lockTimeoutMs, fileCount, cachePath from stateBuf.
    * Writes status, fileHandle, cacheFileStat0/1 to stateBuf on completion.
@@ -37,6 +55,8 @@ namespace fast_fs_hash {
     Napi::ObjectReference stateRef;
     CacheStateBuf * state = parseStateBuf(info, stateRef);
 
+    const bool fullScan = info.Length() > 5 && info[5].IsBoolean() && info[5].As<Napi::Boolean>().Value();
+
     if (!state || info.Length() < 3 || !info[1].IsTypedArray() || !info[2].IsString()) [[unlikely]] {
       auto buf = Napi::Buffer<uint8_t>::New(env, CacheHeader::SIZE);
       memset(buf.Data(), 0, CacheHeader::SIZE);
@@ -44,7 +64,15 @@ namespace fast_fs_hash {
         state->status = static_cast<uint32_t>(CacheStatus::MISSING);
         state->fileHandle = FFSH_FILE_HANDLE_INVALID;
       }
-      deferred.Resolve(buf);
+      if (fullScan) {
+        auto result = Napi::Array::New(env, 3);
+        result.Set(0u, buf);
+        result.Set(1u, env.Null());
+        result.Set(2u, env.Null());
+        deferred.Resolve(result);
+      } else {
+        deferred.Resolve(buf);
+      }
       return deferred.Promise();
     }
 
@@ -58,21 +86,33 @@ namespace fast_fs_hash {
     const uint32_t fileCount = state->fileCount;
     const char * cachePath = state->cachePath();
 
-    // Optional dirty paths buffer (arg 3) and dirty count (arg 4)
-    const uint8_t * dirtyPaths = nullptr;
-    size_t dirtyLen = 0;
+    // Optional dirty indices (arg 3) and dirty count (arg 4)
+    const uint32_t * dirtyIndices = nullptr;
     uint32_t dirtyCount = 0;
     bool hasDirtyHint = false;
     Napi::ObjectReference dirtyRef;
-    if (info.Length() > 3 && !info[3].IsNull() && !info[3].IsUndefined() && info[3].IsTypedArray()) {
-      auto dirtyBuf = info[3].As<Napi::Uint8Array>();
-      dirtyPaths = dirtyBuf.Data();
-      dirtyLen = dirtyBuf.ByteLength();
+    if (info.Length() > 3 && info[3].IsTypedArray() &&
+        info[3].As<Napi::TypedArray>().TypedArrayType() == napi_uint32_array) {
+      auto dirtyArr = info[3].As<Napi::Uint32Array>();
+      dirtyIndices = dirtyArr.Data();
       hasDirtyHint = true;
-      dirtyRef = Napi::ObjectReference::New(dirtyBuf, 1);
+      dirtyRef = Napi::ObjectReference::New(dirtyArr, 1);
       if (info.Length() > 4) {
         napi_get_value_uint32(env, info[4], &dirtyCount);
       }
+      if (dirtyCount > dirtyArr.ElementLength()) {
+        dirtyCount = static_cast<uint32_t>(dirtyArr.ElementLength());
+      }
+    }
+
+    // Optional watcher External (arg 6)
+    CacheWatcher * watcher = nullptr;
+    Napi::ObjectReference watcherRef;
+    if (info.Length() > 6 && info[6].IsExternal()) {
+      watcher = watcherOf(env, info[6]);
+      if (watcher) {
+        watcherRef = Napi::ObjectReference::New(info[6].As<Napi::Object>(), 1);
+      }
     }
 
     auto paths_ref = Napi::ObjectReference::New(pathsBuf, 1);
@@ -82,7 +122,8 @@ namespace fast_fs_hash {
       pathsBuf.Data(), pathsBuf.ByteLength(), std::move(paths_ref),
       fileCount, cachePath, std::move(rootPath),
       version, fingerprint, timeoutMs,
-      dirtyPaths, dirtyLen, dirtyCount, hasDirtyHint, std::move(dirtyRef));
+      dirtyIndices, dirtyCount, hasDirtyHint, std::move(dirtyRef), fullScan,
+      watcher, std::move(watcherRef));
     worker->Start();
     return deferred.Promise();
   }
@@ -136,13 +177,14 @@ namespace fast_fs_hash {
     const bool resolveOnly = (state->flags & 1) != 0;
 
     FfshFile lockedFile;
+    PrivateFileMap * lockedMap = nullptr;
     if (!resolveOnly) {
       // Normal write: take ownership of the locked fd from AddonData
       const int32_t fileHandle = state->fileHandle;
       state->fileHandle = FFSH_FILE_HANDLE_INVALID;
       auto * addon = AddonData::get(env);
       if (addon) [[likely]] {
-        lockedFile = addon->takeHeldFile(fileHandle);
+        lockedFile = addon->takeHeldFile(fileHandle, &lockedMap);
       }
     }
 
@@ -152,7 +194,7 @@ namespace fast_fs_hash {
       encoded_paths, encoded_len, std::move(paths_ref),
       fileCount, std::move(rootPath),
       std::move(compressedPayloads), std::move(uncompressedPayloads),
-      std::move(lockedFile), resolveOnly);
+      std::move(lockedFile), lockedMap, resolveOnly);
     worker->Queue();
     return deferred.Promise();
   }
@@ -365,6 +407,165 @@ namespace fast_fs_hash {
     return env.Undefined();
   }
 
+  static void freeWatcher(Napi::Env, CacheWatcher * w) { delete w; }
+
+  /**
+   * cacheWatch(encodedPaths, rootPath, fileCount) → External | null
+   *
+   * Starts a native watcher (CacheWatcher) for the file list. null where
+   * watching is unsupported or inotify can't be initialized. Only the
+   * inotify descriptor is created on this thread; the watches are added by
+   * the next cacheOpen's worker. Freed with the External; cacheWatchClose
+   * releases the inotify descriptor early.
+   */
+  inline Napi::Value bindCacheWatch(const Napi::CallbackInfo & info) {
+    const auto env = info.Env();
+    if (info.Length() < 3 || !info[0].IsTypedArray() || !info[1].IsString()) [[unlikely]] {
+      return env.Null();
+    }
+    auto pathsBuf = info[0].As<Napi::Uint8Array>();
+    uint32_t fileCount = 0;
+    napi_get_value_uint32(env, info[2], &fileCount);
+    CacheWatcher * w = CacheWatcher::create(
+      info[1].As<Napi::String>().Utf8Value(), pathsBuf.Data(), pathsBuf.ByteLength(), fileCount);
+    if (!w) {
+      return env.Null();
+    }
+    return Napi::External<CacheWatcher>::New(env, w, freeWatcher);
+  }
+
+  /** cacheWatchPending(watcher) → boolean — whether the next open would find dirty entries. */
+  inline Napi::Value bindCacheWatchPending(const Napi::CallbackInfo & info) {
+    const auto env = info.Env();
+    CacheWatcher * w = info.Length() > 0 ? watcherOf(env, info[0]) : nullptr;
+    return Napi::Boolean::New(env, !w || w->pending());
+  }
+
+  /** cacheWatchClose(watcher) → void — stop watching and release the inotify descriptor. */
+  inline Napi::Value bindCacheWatchClose(const Napi::CallbackInfo & info) {
+    const auto env = info.Env();
+    CacheWatcher * w = info.Length() > 0 ? watcherOf(env, info[0]) : nullptr;
+    if (w) {
+      w->close();
+    }
+    return env.Undefined();
+  }
+
+  static void freePathTable(Napi::Env, CachePathTable * t) { delete t; }
+
+  /**
+   * cachePathTable(encodedPaths, fileCount) → External | null
+   *
+   * Indexes an encoded file list for cachePathIndex. null when the buffer
+   * does not hold exactly fileCount paths.
+   */
+  inline Napi::Value bindCachePathTable(const Napi::CallbackInfo & info) {
+    const auto env = info.Env();
+    if (info.Length() < 2 || !info[0].IsTypedArray()) [[unlikely]] {
+      return env.Null();
+    }
+    auto pathsBuf = info[0].As<Napi::Uint8Array>();
+    uint32_t fileCount = 0;
+    napi_get_value_uint32(env, info[1], &fileCount);
+    CachePathTable * t = CachePathTable::create(pathsBuf.Data(), pathsBuf.ByteLength(), fileCount);
+    if (!t) {
+      return env.Null();
+    }
+    return Napi::External<CachePathTable>::New(env, t, freePathTable);
+  }
+
+  /**
+   * cachePathIndex(table, encodedPaths, relPath) → number
+   *
+   * Entry index of the normalized relative path `relPath` in the list
+   * `table` was built from, or -1. O(log n) byte compares.
+   */
+  inline Napi::Value bindCachePathIndex(const Napi::CallbackInfo & info) {
+    napi_env env = info.Env();
+    void * ptr = nullptr;
+    if (info.Length() < 3 || !info[1].IsTypedArray() || !info[2].IsString() ||
+        napi_get_value_external(env, info[0], &ptr) != napi_ok || !ptr) [[unlikely]] {
+      return Napi::Number::New(env, -1);
+    }
+    const auto * t = static_cast<const CachePathTable *>(ptr);
+    if (t->magic != CachePathTable::MAGIC) [[unlikely]] {
+      return Napi::Number::New(env, -1);
+    }
+    auto pathsBuf = info[1].As<Napi::Uint8Array>();
+
+    char small_buf[STRING_SMALL_BUF];
+    size_t written = 0;
+    napi_get_value_string_utf8(env, info[2], small_buf, STRING_SMALL_BUF, &written);
+    int64_t index;
+    if (written < STRING_SMALL_BUF - 5) [[likely]] {
+      index = t->find(pathsBuf.Data(), pathsBuf.ByteLength(), reinterpret_cast<const uint8_t *>(small_buf), written);
+    } else {
+      char large_buf[STRING_LARGE_BUF];
+      const char * data;
+      const size_t len = fast_encode_string(env, info[2], small_buf, large_buf, data);
+      index = t->find(pathsBuf.Data(), pathsBuf.ByteLength(), reinterpret_cast<const uint8_t *>(data), len);
+      cleanup_string_buf(data, small_buf, large_buf);
+    }
+    return Napi::Number::New(env, static_cast<double>(index));
+  }
+
+  /**
+   * cachePathsUnsafe(paths, ends, vector) → boolean — test-only hook.
+   *
+   * Whether a path region fails validation. `ends` (Uint32Array) gives the
+   * packed form of a cache body, as checked by CacheHeader::packedPathsValid;
+   * null means NUL-separated paths, as checked by PathIndex<true>. `vector`
+   * picks the production scan (scan_path_bytes); otherwise the scalar
+   * is_unsafe_relative_path reference runs on each path. Exposed so the
+   * tests can hold the two to the same verdict.
+   */
+  inline Napi::Value bindCachePathsUnsafe(const Napi::CallbackInfo & info) {
+    const auto env = info.Env();
+    if (info.Length() < 3 || !info[0].IsTypedArray()) [[unlikely]] {
+      return Napi::Boolean::New(env, true);
+    }
+    auto pathsBuf = info[0].As<Napi::Uint8Array>();
+    const uint8_t * const paths = pathsBuf.Data();
+    const size_t len = pathsBuf.ByteLength();
+    bool vector = true;
+    napi_get_value_bool(env, info[2], &vector);
+
+    if (!info[1].IsTypedArray()) {
+      if (vector) {
+        PathIndex<true> idx(paths, len);
+        return Napi::Boolean::New(env, idx.has_unsafe());
+      }
+      size_t start = 0;
+      for (size_t i = 0; i < len; ++i) {
+        if (paths[i] == 0) {
+          if (is_unsafe_relative_path(paths + start, i - start)) {
+            return Napi::Boolean::New(env, true);
+          }
+          start = i + 1;
+        }
+      }
+      return Napi::Boolean::New(env, false);
+    }
+
+    auto endsArr = info[1].As<Napi::Uint32Array>();
+    const uint32_t * const ends = endsArr.Data();
+    const uint32_t n = static_cast<uint32_t>(endsArr.ElementLength());
+    if (len > UINT32_MAX) [[unlikely]] {
+      return Napi::Boolean::New(env, true);
+    }
+    if (vector) {
+      return Napi::Boolean::New(env, !packed_paths_safe(paths, static_cast<uint32_t>(len), ends, n));
+    }
+    bool unsafe = memchr(paths, 0, len) != nullptr;
+    uint32_t prevEnd = 0;
+    for (uint32_t i = 0; i < n && !unsafe; ++i) {
+      const uint32_t end = ends[i];
+      unsafe = end <= prevEnd || end > len || is_unsafe_relative_path(paths + prevEnd, end - prevEnd);
+      prevEnd = end;
+    }
+    return Napi::Boolean::New(env, unsafe);
+  }
+
 }  // namespace fast_fs_hash
 
 #endif
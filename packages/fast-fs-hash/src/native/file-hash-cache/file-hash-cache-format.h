@@ -25,6 +25,80 @@
  *
  * In-memory dataBuf layout is identical to disk:
  * [header:80][uncompressed section][body].
+ *
+ * ### Sharded layout (BodyFormat::SHARDED)
+ *
+ * The cache file is a manifest; entries, paths and compressed payloads live
+ * in sibling shard files so a write only rewrites the shards that changed:
+ * ```
+ * <cachePath>          [header:80][uncompressed section][CacheShardTable:16]
+ *                      [CacheShardRef × (shardCount + 1)][shardOf:n × u8]
+ * <cachePath>.shard-K  [CacheShardHeader:48][body, LZ4 or PLAIN]
+ *                      body = [entries:k×48][pathEnds:k×4, shard-local][paths]
+ * <cachePath>.shard-p  [CacheShardHeader:48][body, LZ4 or PLAIN]
+ *                      body = [compressedPayloadDir:m×4][compressedPayloads]
+ * ```
+ * A file goes to shard XXH3-64(parent directory) % shardCount; `shardOf`
+ * records the shard of every entry in the global (sorted) order, so the
+ * reader rebuilds the single in-memory dataBuf without comparing paths.
+ * Ref K (and ref shardCount, for the payload shard) pins the XXH3-128 of
+ * the decoded shard body; a shard whose header disagrees is treated like a
+ * corrupt cache. The header, version, fingerprint, user values and the lock
+ * all stay on the manifest.
+ *
+ * ### Block layout (BodyFormat::LZ4_BLOCKS)
+ *
+ * Large bodies are cut into independent blocks so the pool can compress
+ * and decompress them in parallel:
+ * ```
+ * body = [CacheBlockTable:16][blockEnd:blockCount × u32][block data]
+ * ```
+ * Block K holds decoded image bytes [K × blockSize, min((K+1) × blockSize,
+ * imageLen)) and occupies [blockEnd[K-1], blockEnd[K]) of the block data
+ * (blockEnd[-1] = 0). A block whose stored length equals its decoded
+ * length is stored raw; otherwise it is one LZ4 block (LZ4_compress_fast).
+ * The decoded image is the body itself unless the table's coding flags
+ * are set (see below).
+ *
+ * ### Coded bodies (BodyFormat::CODED, LZ4_BLOCKS with coding flags)
+ *
+ * Caches with CACHE_COLUMNAR_MIN_ENTRIES files or more store a coded
+ * image of the body, in which the entries and the paths are rewritten
+ * into forms LZ4 compresses well. CODED is one LZ4 block behind a
+ * CacheBodyCoding header; LZ4_BLOCKS carries the same flags and length in
+ * its table:
+ * ```
+ * CODED body = [CacheBodyCoding:16][LZ4 block of the image]
+ * image      = [entries][compressedPayloadDir][paths][compressedPayloads]
+ * ```
+ * CacheBodyCoding::COLUMNAR_ENTRIES — the n × 48 entries region holds the
+ * entries column by column, same size as the records it replaces:
+ * ```
+ * [ino:8 planes × n][mtime:8 planes × n][ctime:8 planes × n][size:8 planes × n][contentHash:n × 16]
+ * ```
+ * Each u64 column is split into byte planes (plane B = byte B of every
+ * value, least significant first), after delta coding:
+ *   ino    zigzag(ino[i] − ino[i−1]), ino[−1] = 0 (path order)
+ *   mtime  mtime[0] raw, then zigzag(mtime[i] − mtime[0])
+ *   ctime  zigzag(ctime[i] − mtime[i])
+ *   size   raw
+ *
+ * CacheBodyCoding::DIR_PATHS — [pathEnds][paths] is replaced by a
+ * directory table, so each directory prefix is stored once:
+ * ```
+ * [entryDir:n × u32][baseLen:n × u16][base bytes]
+ * [dirCount:u32][dirLen:dirCount × u16][dir bytes]
+ * ```
+ * A directory is the path up to and including its last '/' ("" for files
+ * at the root); path i = dir[entryDir[i]] + base i. Its length is
+ * whatever the image has left once the other regions are accounted for.
+ *
+ * The reader decodes the image back into the regular in-memory dataBuf.
+ *
+ * Two earlier layouts are still read. BodyFormat::COLUMNAR is one LZ4
+ * block with no CacheBodyCoding header; its image has COLUMNAR_ENTRIES
+ * only and is bodySize() long. An LZ4_BLOCKS table whose imageLen is 0
+ * predates the field: its image is bodySize() long too.
  * No trailing data — rootPath/cachePath are passed separately.
  * Per-file state is encoded in the high 2 bits of CacheEntry::ino.
  *
@@ -32,7 +106,7 @@
  *
  *   Offset  Size  Field
  *   ------  ----  ------------------------------------------------
- *     0      4    Magic: 0x00485346 — bytes 'F','S','H', 0x00
+ *     0      4    Magic: 0x00485346 — bytes 'F','S','H', then BodyFormat | 0x80 for chunk-tree hashes
  *     4      4    User version (u32)
  *     8      4    File count (u32)
  *    12      4    compressedPayloadItemCount (u32)
@@ -68,7 +142,7 @@
  *    80      4    cancelFlag (u32, JS↔C++, volatile)
  *    84      4    fileCount (u32, JS→C++)
  *    88      4    cachePathLen (u32, JS→C++)
- *    92      4    flags (u32, JS→C++, bit 0 = resolveOnly)
+ *    92      4    flags (u32, JS→C++, bit 0 = resolveOnly, bit 1 = patchable, bit 2 = chunk-tree hashing, bits 8-15 = shard count for writes)
  *    96      N+1  cachePath (UTF-8, null-terminated, JS→C++)
  */
 
@@ -135,6 +209,10 @@ namespace fast_fs_hash {
   enum class BodyFormat : uint8_t {
     LZ4 = 0,    // body is LZ4-frame compressed (default; matches pre-v0.0.3 layout)
     PLAIN = 1,  // body is stored uncompressed (writer chose this when LZ4 didn't help)
+    SHARDED = 2,  // manifest only: body lives in shard files (see CacheShardTable)
+    LZ4_BLOCKS = 3,  // body cut into independently LZ4-compressed blocks (see CacheBlockTable)
+    COLUMNAR = 4,  // read only: one LZ4 block of a body with columnar entries (superseded by CODED)
+    CODED = 5,  // CacheBodyCoding header, then one LZ4 block of the coded body image
   };
 
   struct CacheHeader {
@@ -158,10 +236,13 @@ namespace fast_fs_hash {
     static constexpr uint32_t MAGIC_ID_MASK = 0x00FFFFFFu;
     static constexpr uint32_t MAGIC_ID = 0x00485346u;  // 'F','S','H' (low 3 bytes; high byte = BodyFormat)
 
+    /** Magic bit 31 (byte 3 bit 7): content hashes of large files are chunk-tree roots. */
+    static constexpr uint32_t MAGIC_CHUNK_TREE = 0x80000000u;
+
     /** Highest BodyFormat value the current build recognizes. Tied to the
      *  enum below — adding a new BodyFormat that isn't reflected here will
      *  fail the static_assert at the end of this file. */
-    static constexpr uint8_t MAX_BODY_FORMAT = static_cast<uint8_t>(BodyFormat::PLAIN);
+    static constexpr uint8_t MAX_BODY_FORMAT = static_cast<uint8_t>(BodyFormat::CODED);
 
     /** Build a magic word combining the format ID and a body encoding. */
     static constexpr uint32_t makeMagic(BodyFormat fmt) noexcept {
@@ -171,7 +252,15 @@ namespace fast_fs_hash {
     /** Extract the body encoding from the magic. Returns the raw byte;
      *  caller compares against BodyFormat values. */
     FSH_FORCE_INLINE uint8_t bodyFormatByte() const noexcept {
-      return static_cast<uint8_t>(this->magic >> 24);
+      return static_cast<uint8_t>((this->magic >> 24) & 0x7Fu);
+    }
+
+    /** Whether the entries' content hashes were computed in chunk-tree mode. */
+    FSH_FORCE_INLINE bool chunkTreeHash() const noexcept { return (this->magic & MAGIC_CHUNK_TREE) != 0; }
+
+    /** Set the body encoding, keeping the format ID and the chunk-tree bit. */
+    FSH_FORCE_INLINE void setBodyFormat(BodyFormat fmt) noexcept {
+      this->magic = makeMagic(fmt) | (this->magic & MAGIC_CHUNK_TREE);
     }
 
     /** Byte length of the uncompressed payloads section (dir + bytes).
@@ -226,6 +315,70 @@ namespace fast_fs_hash {
   static_assert(offsetof(CacheHeader, uncompressedPayloadItemCount) == 72);
   static_assert(offsetof(CacheHeader, uncompressedPayloadsLen) == 76);
 
+  /** LZ4_BLOCKS body: table header, followed by blockCount u32 block ends. */
+  struct CacheBlockTable {
+    uint32_t blockCount;  //  0: number of blocks (≥ 1)
+    uint32_t blockSize;  //  4: decoded bytes per block (the last one may be shorter)
+    uint32_t flags;  //  8: CacheBodyCoding flags (0 = the image is the body)
+    uint32_t imageLen;  // 12: decoded image length
+
+    static constexpr size_t SIZE = 16;
+  };
+
+  /** CODED body: coding header in front of the LZ4 block of the image. */
+  struct CacheBodyCoding {
+    uint32_t flags;  //  0: COLUMNAR_ENTRIES | DIR_PATHS
+    uint32_t imageLen;  //  4: decoded image length
+    uint64_t reserved;  //  8: zero
+
+    static constexpr size_t SIZE = 16;
+    /** Entries stored column by column. */
+    static constexpr uint32_t COLUMNAR_ENTRIES = 1;
+    /** pathEnds + paths stored as a directory table. */
+    static constexpr uint32_t DIR_PATHS = 2;
+    static constexpr uint32_t KNOWN_FLAGS = COLUMNAR_ENTRIES | DIR_PATHS;
+  };
+
+  static_assert(sizeof(CacheBlockTable) == CacheBlockTable::SIZE);
+  static_assert(sizeof(CacheBodyCoding) == CacheBodyCoding::SIZE);
+
+  /** Sharded manifest: table header, right after the uncompressed section. */
+  struct CacheShardTable {
+    uint32_t shardCount;  //  0: number of entry shards (2..CACHE_MAX_SHARDS)
+    uint32_t reserved[3];  //  4: zero
+
+    static constexpr size_t SIZE = 16;
+  };
+
+  /** Sharded manifest: one per entry shard, then one for the payload shard. */
+  struct CacheShardRef {
+    Hash128 bodyHash;  //  0: XXH3-128 of the decoded shard body (all-zero = shard absent)
+    uint32_t fileCount;  // 16: entries in the shard
+    uint32_t pathsLen;  // 20: byte length of the shard's paths
+    uint64_t bodySize;  // 24: decoded body length
+
+    static constexpr size_t SIZE = 32;
+  };
+
+  /** Header of a shard file. Body encoding lives in the high byte of magic. */
+  struct CacheShardHeader {
+    uint32_t magic;  //  0: 'F','S','S',<BodyFormat LZ4|PLAIN>
+    uint32_t index;  //  4: shard index (shardCount = payload shard)
+    uint32_t fileCount;  //  8: entries in the shard
+    uint32_t pathsLen;  // 12: byte length of the shard's paths
+    Hash128 bodyHash;  // 16: XXH3-128 of the decoded body
+    uint64_t bodySize;  // 32: decoded body length
+    uint64_t reserved;  // 40: zero
+
+    static constexpr size_t SIZE = 48;
+    static constexpr uint32_t MAGIC_ID = 0x00535346u;  // 'F','S','S'
+  };
+
+  static_assert(sizeof(CacheShardTable) == CacheShardTable::SIZE);
+  static_assert(sizeof(CacheShardRef) == CacheShardRef::SIZE);
+  static_assert(sizeof(CacheShardHeader) == CacheShardHeader::SIZE);
+  static_assert(offsetof(CacheShardHeader, bodyHash) == 16);
+
   /** Shared JS ↔ C++ per-instance communication buffer. */
   struct CacheStateBuf {
     Hash128 fingerprint;  //  0: 16-byte fingerprint (JS→C++, zeroed = none)
@@ -242,7 +395,7 @@ namespace fast_fs_hash {
     uint32_t cancelFlag;  // 80: 0=running, 1=cancelled (JS↔C++, volatile read)
     uint32_t fileCount;  // 84: number of file entries (JS→C++)
     uint32_t cachePathLen;  // 88: byte length of cachePath (excluding null)
-    uint32_t flags;  // 92: bit 0 = resolveOnly (1 = resolve entries without writing to disk)
+    uint32_t flags;  // 92: bit 0 = resolveOnly (1 = resolve entries without writing to disk), bit 1 = patchable, bit 2 = chunk-tree hashing, bits 8-15 = shard count
     // Byte 96+: null-terminated UTF-8 cachePath (immutable after construction)
 
     static constexpr size_t HEADER_SIZE = 96;
@@ -257,6 +410,15 @@ namespace fast_fs_hash {
 
     /** Whether fingerprint is set (non-zero). */
     FSH_FORCE_INLINE bool hasFingerprint() const noexcept { return !this->fingerprint.is_zero(); }
+
+    /** Shard count for writes (flags byte 1). 0 or 1 = single-file layout. */
+    FSH_FORCE_INLINE uint32_t shardCount() const noexcept { return (this->flags >> 8) & 0xFFu; }
+
+    /** Write single-file bodies PLAIN so later writes can patch them in place (flags bit 1). */
+    FSH_FORCE_INLINE bool patchable() const noexcept { return (this->flags & 2u) != 0; }
+
+    /** Hash large files as chunk trees (flags bit 2). Recorded in the cache header. */
+    FSH_FORCE_INLINE bool chunkTreeHash() const noexcept { return (this->flags & 4u) != 0; }
   };
 
   static_assert(offsetof(CacheStateBuf, fingerprint) == 0);
@@ -405,30 +567,13 @@ namespace fast_fs_hash {
     const size_t uplen = this->uncompressedPayloadsLen;
     const uint32_t * pe = pathEndsOf(buf, fc, this->compressedPayloadItemCount, uic, uplen);
     const uint8_t * paths = pathsOf(buf, fc, this->compressedPayloadItemCount, uic, uplen);
-    // Bulk NUL check over the whole paths region (libc memchr is SIMD-accelerated);
-    // per-segment validation below relies on this and skips the byte-level NUL scan.
-    if (pLen > 0 && memchr(paths, '\0', pLen) != nullptr) {
-      return false;
-    }
-    uint32_t prevEnd = 0;
-    for (uint32_t i = 0; i < fc; ++i) {
-      const uint32_t endOff = pe[i];
-      if (endOff < prevEnd || endOff > pLen) {
-        return false;
-      }
-      const uint32_t segLen = endOff - prevEnd;
-      if (segLen == 0 || is_unsafe_relative_path(paths + prevEnd, segLen)) {
-        return false;
-      }
-      prevEnd = endOff;
-    }
-    return true;
+    return packed_paths_safe(paths, pLen, pe, fc);
   }
 
   // Drift guard: bump MAX_BODY_FORMAT whenever you add a new BodyFormat value.
   // (Update the TS enum + MAX_BODY_FORMAT_BYTE alongside.)
   static_assert(
-    CacheHeader::MAX_BODY_FORMAT == static_cast<uint8_t>(BodyFormat::PLAIN),
+    CacheHeader::MAX_BODY_FORMAT == static_cast<uint8_t>(BodyFormat::CODED),
     "MAX_BODY_FORMAT must equal the highest declared BodyFormat value");
 
 }  // namespace fast_fs_hash
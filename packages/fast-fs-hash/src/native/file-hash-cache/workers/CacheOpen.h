@@ -2,13 +2,21 @@
 #define _FAST_FS_HASH_CACHE_OPEN_H
 
 #include "../cache-build.h"
-#include "../cache-helpers.h"
+#include "../cache-blocks.h"
+#include "../cache-coding.h"
+#include "../cache-shards.h"
+#include "../CacheWatcher.h"
 #include "../file-hash-cache-format.h"
+#include "../DecodedCacheRegistry.h"
 #include "AddonWorker.h"
+#include "IoUringStat.h"
+#include "ScratchArena.h"
+#include "ThreadTuner.h"
 
 #define LZ4_STATIC_LINKING_ONLY  // expose LZ4_DECOMPRESS_INPLACE_MARGIN
 #include <lz4.h>
 #include <algorithm>
+#include <bit>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
@@ -24,6 +32,25 @@ namespace fast_fs_hash {
    *
    * Always locks. Resolves with Buffer<dataBuf>.
    * The lock handle is written to CacheStateBuf in OnOK.
+   *
+   * Full-scan mode (`fullScan`) never stops at the first change: every
+   * worker runs to the end of the queue and records a FileChangeKind per
+   * entry. A file list that differs from the cached one is remapped first,
+   * so entries new to the list are reported as ADDED and the rest are still
+   * stat-matched. Resolves with [dataBuf, changes, removed] — `changes` is
+   * an external Buffer of fileCount bytes, or null when nothing was compared
+   * (missing / stale / lock failure / cancelled); `removed` holds the
+   * NUL-terminated cached paths the new list dropped (empty when none),
+   * and is null whenever `changes` is.
+   *
+   * A PLAIN body of at least PrivateFileMap::min_size() bytes is mapped
+   * instead of read: the stat-match only faults in the pages it touches and
+   * dataBuf is handed to JS zero-copy. The mapping is registered with the
+   * held file so it is detached before the lock is released.
+   *
+   * A sharded manifest (BodyFormat::SHARDED) has its shard files read,
+   * decoded and hash-checked in parallel on the pool; the stat-match then
+   * continues from the last shard worker on the assembled dataBuf.
    */
   class CacheOpen final : public AddonWorker {
    public:
@@ -41,11 +68,13 @@ namespace fast_fs_hash {
       uint32_t version,
       const uint8_t * fingerprint,
       int timeoutMs,
-      const uint8_t * dirtyPaths = nullptr,
-      size_t dirtyLen = 0,
+      const uint32_t * dirtyIndices = nullptr,
       uint32_t dirtyCount = 0,
       bool hasDirtyHint = false,
-      Napi::ObjectReference && dirtyRef = {}) :
+      Napi::ObjectReference && dirtyRef = {},
+      bool fullScan = false,
+      CacheWatcher * watcher = nullptr,
+      Napi::ObjectReference && watcherRef = {}) :
       AddonWorker(env, deferred),
       state_(state),
       encodedPaths_(encodedPaths),
@@ -53,16 +82,20 @@ namespace fast_fs_hash {
       fileCount_(fileCount),
       version_(version),
       hasFingerprint_(fingerprint != nullptr),
+      chunkTreeHash_(state->chunkTreeHash()),
       timeoutMs_(timeoutMs),
-      dirtyPaths_(dirtyPaths),
-      dirtyLen_(dirtyLen),
+      dirtyIndices_(dirtyIndices),
       dirtyCount_(dirtyCount),
       hasDirtyHint_(hasDirtyHint),
+      watcher_(watcher),
+      fullScan_(fullScan),
+      reportChanges_(fullScan),
       cachePath_(cachePath),
       rootPath_(std::move(rootPath)),
       pathsRef_(std::move(pathsRef)),
       stateRef_(std::move(stateRef)),
-      dirtyRef_(std::move(dirtyRef)) {
+      dirtyRef_(std::move(dirtyRef)),
+      watcherRef_(std::move(watcherRef)) {
       if (fingerprint) {
         memcpy(&this->fingerprint_, fingerprint, 16);
       }
@@ -71,6 +104,7 @@ namespace fast_fs_hash {
       AddonData * d = this->addon;
       if (d) {
         d->active_cancels.add(&this->cancel_);
+        this->chunkTree_ = {&d->pool, MAX_CACHE_IO_THREADS - 1};
       }
     }
 
@@ -80,13 +114,16 @@ namespace fast_fs_hash {
         d->active_cancels.remove(&this->cancel_);
       }
       this->cancel_.fire();
+      if (this->map_) {
+        this->map_->release();
+      }
     }
 
     void Start() { this->Queue(); }
 
     void Execute() override {
       AddonData * d = this->addon;
-      if (this->cancel_.is_fired() || d->pool.is_shutdown()) [[unlikely]] {
+      if (this->cancel_.is_fired() || d->stopping()) [[unlikely]] {
         this->lockFailed_ = true;
         this->signal();
         return;
@@ -113,7 +150,7 @@ namespace fast_fs_hash {
         state->cacheFileStat1 = 0;
         auto buf = Napi::Buffer<uint8_t>::New(napiEnv, CacheHeader::SIZE);
         memset(buf.Data(), 0, CacheHeader::SIZE);
-        this->deferred.Resolve(buf);
+        this->resolve_(napiEnv, buf);
         return;
       }
 
@@ -125,12 +162,12 @@ namespace fast_fs_hash {
       // version. JS reads it as `session.diskVersion`, then restores the slot.
       state->version = this->diskVersion_;
 
-      // Transfer lock ownership to AddonData
-      const int32_t fh = this->addon->registerHeldFile(std::move(this->lockedFile_));
+      // Transfer lock ownership (and the mapping to detach on unlock) to AddonData
+      const int32_t fh = this->addon->registerHeldFile(std::move(this->lockedFile_), this->map_);
       state->fileHandle = fh;
 
       auto buf = this->makeDataBuf_(napiEnv);
-      this->deferred.Resolve(buf);
+      this->resolve_(napiEnv, buf);
     }
 
    private:
@@ -143,13 +180,26 @@ namespace fast_fs_hash {
     uint32_t fileCount_;
     uint32_t version_;
     bool hasFingerprint_;
+    /** Session hashes large files as chunk trees (state flags bit 2). */
+    bool chunkTreeHash_;
     int timeoutMs_;
     Hash128 fingerprint_{};
 
-    const uint8_t * dirtyPaths_;
-    size_t dirtyLen_;
+    /** Dirty hint: indices of the entries to stat (any order, duplicates
+     *  and out-of-range values allowed). Applied only with hasDirtyHint_. */
+    const uint32_t * dirtyIndices_;
     uint32_t dirtyCount_;
     bool hasDirtyHint_;
+    /** Native watcher of this file list, or null. Its dirty set is taken
+     *  on every open that gets as far as the stat-match. */
+    CacheWatcher * watcher_;
+
+    /** Keep stat-matching past the first change; cleared if changes_ can't be allocated. */
+    bool fullScan_;
+    /** Whether JS asked for a change report (resolve with [dataBuf, changes]). */
+    bool reportChanges_;
+    /** Full scan over a remapped dataBuf: the file list itself changed. */
+    bool listChanged_ = false;
 
     const char * cachePath_;  // Points into stateBuf (pinned by stateRef_)
     std::string rootPath_;
@@ -162,8 +212,19 @@ namespace fast_fs_hash {
     uint32_t resultStatus_ = static_cast<uint32_t>(CacheStatus::MISSING);
     uint32_t diskVersion_ = 0;  // header version from disk; defaults to version_ when no disk read happened
     double resultStat_[2] = {0, 0};
+    /** Registry key of the cache file, stat'ed at cacheIdNs_; cacheIdNs_ is 0
+     *  when the registry is off or the stat failed. */
+    FileIdentity cacheId_{};
+    uint64_t cacheIdNs_ = 0;
 
     OwnedBuf<> dataBuf_;
+    /** Set instead of dataBuf_ when the body was mapped (see readOldCache_). */
+    PrivateFileMap * map_ = nullptr;
+    /** One FileChangeKind per entry in full-scan mode. Each index is written by
+     *  the single worker that claimed it; the fork-join publishes it to OnOK. */
+    OwnedBuf<> changes_;
+    /** Full scan over a changed list: the cached paths it no longer has. */
+    OwnedBuf<> removed_;
 
     CacheEntry * runEntries_ = nullptr;
     const uint32_t * runPathEnds_ = nullptr;
@@ -203,6 +264,11 @@ namespace fast_fs_hash {
       uint64_t size;
     };
     std::vector<BulkDirJob> dirJobs_;
+    /** Directory index of each old entry (u32 × fileCount), from a DIR_PATHS
+     *  body's table; lets buildWorkUnits_ bucket without hashing prefixes.
+     *  Only filled on macOS, and only meaningful while the list is unchanged. */
+    OwnedBuf<> entryDirs_;
+    uint32_t dirCount_ = 0;
     /** Entry indices NOT covered by dirJobs_ — walked by the per-entry path.
      *  When dirJobs_ is empty this is just [0..fileCount_) for compat. */
     std::vector<uint32_t> entryQueueIdx_;
@@ -210,25 +276,54 @@ namespace fast_fs_hash {
     alignas(64) mutable std::atomic<size_t> nextDirJob_{0};
     mutable std::atomic<size_t> nextIndex_{0};
     mutable std::atomic<MatchResult> matchResult_{MatchResult::OK};
+    /** Set by every stat thread that got a read buffer; false when done means out of memory. */
+    mutable std::atomic<bool> hadScratch_{false};
 
-    struct Job : ForkJob<Job, MAX_CACHE_IO_THREADS> {
+    struct Job : ForkJob<Job, ThreadTuner::MAX_THREADS> {
       CacheOpen * owner;
       void forkWork() noexcept { this->owner->processStat_(); }
       void forkDone() noexcept { onStatDone_(this->owner); }
     };
     mutable Job job_;
+    TunedRun tuned_;
+
+    /** Sharded manifest being loaded (count() == 0 otherwise). */
+    CacheShardLoader shards_;
+    /** Parked between doOpen_ and onShardsLoaded_. */
+    OwnedBuf<> shardedBuf_;
+    CacheStatus shardedStatus_ = CacheStatus::MISSING;
+    std::atomic<uint32_t> nextShard_{0};
+    std::atomic<bool> shardFailed_{false};
+
+    struct ShardJob : ForkJob<ShardJob, MAX_CACHE_IO_THREADS> {
+      CacheOpen * owner;
+      void forkWork() noexcept { this->owner->loadShards_(); }
+      void forkDone() noexcept { onShardsLoaded_(this->owner); }
+    };
+    ShardJob shardJob_;
+    /** Thread cap for expand() once a stat mismatch turns the run into re-hashing. */
+    int expandCap_ = MAX_CACHE_IO_THREADS;
+    ChunkTreeHashing chunkTree_{};
 
     // - JS-thread-only fields
 
     Napi::ObjectReference pathsRef_;
     Napi::ObjectReference stateRef_;
     Napi::ObjectReference dirtyRef_;
+    Napi::ObjectReference watcherRef_;
 
     static_assert(
-      READ_BUFFER_SIZE + sizeof(PathResolver) <= ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
+      sizeof(ReadScratch) + sizeof(PathResolver) <= ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
       "buffers exceed pool thread usable stack");
 
     Napi::Buffer<uint8_t> makeDataBuf_(Napi::Env napiEnv) {
+      if (this->map_) {
+        // Our reference moves to the Buffer finalizer.
+        PrivateFileMap * map = this->map_;
+        this->map_ = nullptr;
+        return Napi::Buffer<uint8_t>::New(
+          napiEnv, map->data(), map->size(), [](Napi::Env, uint8_t *, PrivateFileMap * m) { m->release(); }, map);
+      }
       const size_t len = this->dataBuf_.len;
       uint8_t * ptr = this->dataBuf_.release();
       if (ptr) [[likely]] {
@@ -241,12 +336,49 @@ namespace fast_fs_hash {
       return buf;
     }
 
+    void resolve_(Napi::Env napiEnv, Napi::Buffer<uint8_t> & dataBuf) {
+      if (!this->reportChanges_) [[likely]] {
+        this->deferred.Resolve(dataBuf);
+        return;
+      }
+      Napi::Value changes = napiEnv.Null();
+      Napi::Value removed = napiEnv.Null();
+      const size_t len = this->changes_.len;
+      uint8_t * ptr = this->changes_.release();
+      if (ptr) {
+        changes = Napi::Buffer<uint8_t>::New(napiEnv, ptr, len, [](Napi::Env, uint8_t * p) {
+          free(p);
+        });
+      } else if (!this->lockFailed_ && this->fileCount_ == 0 &&
+                 this->resultStatus_ != static_cast<uint32_t>(CacheStatus::MISSING) &&
+                 this->resultStatus_ != static_cast<uint32_t>(CacheStatus::STALE) &&
+                 this->resultStatus_ != static_cast<uint32_t>(CacheStatus::STALE_VERSION)) {
+        changes = Napi::Buffer<uint8_t>::New(napiEnv, 0);
+      }
+      if (!changes.IsNull()) {
+        const size_t removedLen = this->removed_.len;
+        uint8_t * removedPtr = this->removed_.release();
+        if (removedPtr) {
+          removed = Napi::Buffer<uint8_t>::New(napiEnv, removedPtr, removedLen, [](Napi::Env, uint8_t * p) {
+            free(p);
+          });
+        } else {
+          removed = Napi::Buffer<uint8_t>::New(napiEnv, 0);
+        }
+      }
+      auto result = Napi::Array::New(napiEnv, 3);
+      result.Set(0u, dataBuf);
+      result.Set(1u, changes);
+      result.Set(2u, removed);
+      this->deferred.Resolve(result);
+    }
+
     /** Stamp final header fields + store results for OnOK. */
     void finalize_(CacheStatus st) noexcept {
-      CacheHeader * hdr = headerOf(this->dataBuf_.ptr);
+      CacheHeader * hdr = headerOf(this->data_());
       // In-memory placeholder; the writer chooses the actual on-disk
       // BodyFormat when it serializes.
-      hdr->magic = CacheHeader::makeMagic(BodyFormat::LZ4);
+      hdr->magic = CacheHeader::makeMagic(BodyFormat::LZ4) | (this->chunkTreeHash_ ? CacheHeader::MAGIC_CHUNK_TREE : 0);
       hdr->version = this->version_;
       if (this->hasFingerprint_) {
         hdr->fingerprint = this->fingerprint_;
@@ -262,12 +394,24 @@ namespace fast_fs_hash {
     void adoptOldBufOrSynthesize_(OwnedBuf<> & oldBuf, uint32_t oldFc, CacheStatus st) noexcept {
       if (oldFc == this->fileCount_) {
         this->dataBuf_ = std::move(oldBuf);
+      } else {
+        this->releaseMap_();
       }
       this->finish_(st);
     }
 
+    /** The working dataBuf: the mapped body, or dataBuf_. */
+    FSH_FORCE_INLINE uint8_t * data_() const noexcept { return this->map_ ? this->map_->data() : this->dataBuf_.ptr; }
+
+    void releaseMap_() noexcept {
+      if (this->map_) {
+        this->map_->release();
+        this->map_ = nullptr;
+      }
+    }
+
     FSH_NO_INLINE void finish_(CacheStatus st) noexcept {
-      if (!this->dataBuf_) [[unlikely]] {
+      if (!this->dataBuf_ && !this->map_) [[unlikely]] {
         if (this->encodedLen_ > 0 && this->fileCount_ > 0) {
           this->dataBuf_ = buildCacheDataBuf(this->encodedPaths_, this->encodedLen_, this->fileCount_);
         }
@@ -286,6 +430,53 @@ namespace fast_fs_hash {
       size_t oldBodyLen = 0;
       OwnedBuf<> oldBuf;
       const CacheStatus loadStatus = this->readOldCache_(oldBuf, oldHdr, oldFc, oldBodyLen);
+      const uint32_t shardCount = this->shards_.count();
+      if (shardCount > 0) {
+        this->shardedBuf_ = std::move(oldBuf);
+        this->shardedStatus_ = loadStatus;
+        const int threadCount = static_cast<int>(std::min<uint32_t>(shardCount, MAX_CACHE_IO_THREADS));
+        this->shardJob_.owner = this;
+        this->addon->pool.submit(this->shardJob_, threadCount);
+        return;
+      }
+      this->openLoaded_(loadStatus, oldBuf, oldFc);
+    }
+
+    void loadShards_() noexcept {
+      const uint32_t count = this->shards_.count();
+      for (;;) {
+        if (this->cancel_.is_fired() || this->addon->stopping()) [[unlikely]] {
+          this->shardFailed_.store(true, std::memory_order_relaxed);
+          return;
+        }
+        const uint32_t k = this->nextShard_.fetch_add(1, std::memory_order_relaxed);
+        if (k >= count) {
+          return;
+        }
+        if (!this->shards_.load(k)) {
+          this->shardFailed_.store(true, std::memory_order_relaxed);
+        }
+      }
+    }
+
+    static void onShardsLoaded_(CacheOpen * self) {
+      OwnedBuf<> oldBuf = std::move(self->shardedBuf_);
+      CacheStatus st = self->shardedStatus_;
+      if (self->shardFailed_.load(std::memory_order_relaxed) || !self->shards_.assemble(oldBuf.ptr) ||
+          !headerOf(oldBuf.ptr)->packedPathsValid(oldBuf.ptr)) [[unlikely]] {
+        oldBuf.reset();
+        st = CacheStatus::MISSING;
+      } else {
+        self->offerImage_(oldBuf.ptr, oldBuf.len);
+      }
+      self->shards_.reset();
+      const uint32_t oldFc = oldBuf ? headerOf(oldBuf.ptr)->fileCount : 0;
+      self->openLoaded_(st, oldBuf, oldFc);
+    }
+
+    /** Continue doOpen_ once the old cache is in memory. */
+    void openLoaded_(CacheStatus loadStatus, OwnedBuf<> & oldBuf, uint32_t oldFc) noexcept {
+      const uint8_t * const oldData = this->map_ ? this->map_->data() : oldBuf.ptr;
 
       if (loadStatus == CacheStatus::MISSING) [[unlikely]] {
         this->finish_(CacheStatus::MISSING);
@@ -304,6 +495,10 @@ namespace fast_fs_hash {
 
       const uint32_t fc = this->fileCount_;
       if (fc == 0) {
+        if (this->fullScan_ && !reuse) {
+          bool removedOk;
+          this->removed_ = removedCachePaths(oldData, nullptr, removedOk);
+        }
         this->dataBuf_ = std::move(oldBuf);
         this->finish_(CacheStatus::UP_TO_DATE);
         return;
@@ -311,22 +506,42 @@ namespace fast_fs_hash {
 
       bool sameFiles = reuse;
       if (!sameFiles) {
-        sameFiles = pathsMatch(this->encodedPaths_, this->encodedLen_, fc, oldBuf.ptr);
+        sameFiles = pathsMatch(this->encodedPaths_, this->encodedLen_, fc, oldData);
       }
 
       if (!sameFiles) {
-        this->adoptOldBufOrSynthesize_(oldBuf, oldFc, CacheStatus::CHANGED);
-        return;
+        // Full scan: carry the surviving entries over to the new list so they
+        // can still be stat-matched. Without it the list change alone decides.
+        OwnedBuf<> remapped;
+        if (this->fullScan_) {
+          remapped = buildRemappedCacheDataBuf(oldData, this->encodedPaths_, this->encodedLen_, fc);
+        }
+        bool removedOk = true;
+        if (remapped) {
+          this->removed_ = removedCachePaths(oldData, remapped.ptr, removedOk);
+        }
+        if (!remapped || !removedOk) [[unlikely]] {
+          this->adoptOldBufOrSynthesize_(oldBuf, oldFc, CacheStatus::CHANGED);
+          return;
+        }
+        this->releaseMap_();
+        oldBuf = std::move(remapped);
+        this->listChanged_ = true;
       }
 
       this->dataBuf_ = std::move(oldBuf);
 
-      if (this->cancel_.is_fired() || this->addon->pool.is_shutdown()) [[unlikely]] {
+      if (this->fullScan_) {
+        this->changes_ = OwnedBuf<>::calloc(fc);
+        this->fullScan_ = this->changes_.ptr != nullptr;
+      }
+
+      if (this->cancel_.is_fired() || this->addon->stopping()) [[unlikely]] {
         this->finish_(CacheStatus::MISSING);
         return;
       }
 
-      uint8_t * buf = this->dataBuf_.ptr;
+      uint8_t * buf = this->data_();
       CacheHeader * hdr = headerOf(buf);
       const uint32_t compCount = hdr->compressedPayloadItemCount;
       const uint32_t uncCount = hdr->uncompressedPayloadItemCount;
@@ -334,48 +549,57 @@ namespace fast_fs_hash {
 
       CacheEntry * entries = entriesOf(buf, uncCount, uncLen);
 
+      // Entries the native watcher saw change. Taken even when the hint is
+      // not applied, so the next open starts from a drained set.
+      OwnedBuf<uint64_t> watchedBits;
+      const uint32_t watched = this->watcher_ ? this->takeWatched_(watchedBits, fc) : 0;
+
       // Disk entries have the high 3 bits cleared (CacheWriter strips
       // INO_STATE_MASK | INO_CHANGED_BIT before writing). We can OR-in the
       // initial state without masking — the load-OR-store fuses to a single
       // RMW on the entry's ino byte.
-      if (this->hasDirtyHint_ && this->dirtyCount_ == 0 && this->dirtyLen_ == 0) {
-        // Empty dirty hint: all entries trusted, no stat needed.
-        // Skips pool submission, fork-join overhead, and the entire stat loop.
+      if (this->listChanged_) {
+        // buildRemappedCacheDataBuf marked the surviving entries HAS_OLD; the
+        // rest are new to the list. The dirty hint describes the old list, so
+        // it is not applied here.
+        if (this->fullScan_) {
+          for (uint32_t i = 0; i < fc; ++i) {
+            if ((entries[i].ino & INO_STATE_MASK) != CACHE_S_HAS_OLD) {
+              this->changes_.ptr[i] = static_cast<uint8_t>(FileChangeKind::ADDED);
+            }
+          }
+        }
+      } else if (this->hasDirtyHint_ && watched != CacheWatcher::ALL) {
         for (uint32_t i = 0; i < fc; ++i) {
           entries[i].ino |= CACHE_S_DONE;
         }
-        this->finish_(CacheStatus::UP_TO_DATE);
-        return;
-      } else if (this->hasDirtyHint_ && this->dirtyPaths_ && this->dirtyCount_ > 0) {
-        // Sorted-vector membership test: one contiguous allocation instead
-        // of std::unordered_set's per-node mallocs. lower_bound binary search
-        // is comparable to (or faster than) the hashmap probe at the n we
-        // see in practice (tens to low thousands of dirty paths).
-        std::vector<std::string_view> dirtyList;
-        dirtyList.reserve(this->dirtyCount_);
-        const uint8_t * dp = this->dirtyPaths_;
-        const uint8_t * dpEnd = dp + this->dirtyLen_;
-        const uint8_t * segStart = dp;
-        for (const uint8_t * p = dp; p <= dpEnd; ++p) {
-          if (p == dpEnd || *p == 0) {
-            if (p > segStart) {
-              dirtyList.emplace_back(reinterpret_cast<const char *>(segStart), p - segStart);
-            }
-            segStart = p + 1;
+        if (watched == 0 && this->dirtyCount_ == 0) {
+          // Empty dirty hint: all entries trusted, no stat needed.
+          // Skips pool submission, fork-join overhead, and the entire stat loop.
+          this->finish_(CacheStatus::UP_TO_DATE);
+          return;
+        }
+        // Move just the dirty entries back to HAS_OLD: O(d) after the fill,
+        // with no path comparisons.
+        const auto markDirty = [entries](size_t i) noexcept {
+          entries[i].ino = (entries[i].ino & ~INO_STATE_MASK) | CACHE_S_HAS_OLD;
+        };
+        const uint32_t * const dirty = this->dirtyIndices_;
+        for (uint32_t k = 0; k < this->dirtyCount_; ++k) {
+          if (dirty[k] < fc) {
+            markDirty(dirty[k]);
           }
         }
-        std::sort(dirtyList.begin(), dirtyList.end());
-
-        const uint32_t * pathEnds = pathEndsOf(buf, fc, compCount, uncCount, uncLen);
-        const uint8_t * packedPaths = pathsOf(buf, fc, compCount, uncCount, uncLen);
-        uint32_t prevEnd = 0;
-        for (uint32_t i = 0; i < fc; ++i) {
-          const uint32_t pEnd = pathEnds[i];
-          const uint32_t pLen = pEnd - prevEnd;
-          std::string_view path(reinterpret_cast<const char *>(packedPaths + prevEnd), pLen);
-          prevEnd = pEnd;
-          const bool isDirty = std::binary_search(dirtyList.begin(), dirtyList.end(), path);
-          entries[i].ino |= isDirty ? CACHE_S_HAS_OLD : CACHE_S_DONE;
+        if (watched != 0) {
+          const uint64_t * const bits = watchedBits.ptr;
+          for (size_t w = 0, words = (static_cast<size_t>(fc) + 63) / 64; w < words; ++w) {
+            for (uint64_t m = bits[w]; m != 0; m &= m - 1) {
+              const size_t i = w * 64 + static_cast<size_t>(std::countr_zero(m));
+              if (i < fc) {
+                markDirty(i);
+              }
+            }
+          }
         }
       } else {
         for (uint32_t i = 0; i < fc; ++i) {
@@ -394,11 +618,16 @@ namespace fast_fs_hash {
       // getattrlistbulk syscall.
       this->buildWorkUnits_();
 
-      int threadCount = ThreadPool::compute_threads(0, fc, MAX_OPEN_THREADS, 64);
+      const int cap = this->tuned_.begin(TuneOp::CACHE_STAT, this->rootPath_.c_str(), fc, MAX_OPEN_THREADS);
+      this->expandCap_ = this->tuned_.active()
+        ? ThreadTuner::instance().cap(TuneOp::CACHE_HASH, this->tuned_.device(), MAX_CACHE_IO_THREADS)
+        : MAX_CACHE_IO_THREADS;
+      int threadCount = ThreadPool::compute_threads(0, fc, cap, 64);
       this->workBatch_ = computeBatchSize(threadCount, fc);
       this->nextDirJob_.store(0, std::memory_order_relaxed);
       this->nextIndex_.store(0, std::memory_order_relaxed);
       this->matchResult_.store(MatchResult::OK, std::memory_order_relaxed);
+      this->hadScratch_.store(false, std::memory_order_relaxed);
 
       // Open the root directory fd ONCE on this thread, instead of once per
       // worker thread. processStat_ workers read from runDirFd_ instead of
@@ -406,14 +635,29 @@ namespace fast_fs_hash {
       this->runDirFd_ = DirFd(this->rootPath_.c_str(), fc);
 
       this->job_.owner = this;
+      this->tuned_.submitted(threadCount);
       this->addon->pool.submit(this->job_, threadCount);
     }
 
     static void onStatDone_(CacheOpen * self) {
       const MatchResult mr = self->matchResult_.load(std::memory_order_relaxed);
 
+      // Only pure stat runs are CACHE_STAT samples; a dirty run also re-hashed.
+      if (mr == MatchResult::OK && !self->cancel_.is_fired() && !self->addon->stopping()) {
+        self->tuned_.finish();
+      }
+
+      // Out of memory on every thread: nothing was checked.
+      const bool oom = !self->hadScratch_.load(std::memory_order_relaxed);
+
+      // A partial full scan would report unvisited entries as unchanged.
+      if (self->cancel_.is_fired() || self->addon->stopping() || oom) [[unlikely]] {
+        self->changes_.reset();
+        self->removed_.reset();
+      }
+
       CacheStatus st;
-      if (mr >= MatchResult::CHANGED) {
+      if (mr >= MatchResult::CHANGED || self->listChanged_ || oom) {
         st = CacheStatus::CHANGED;
       } else if (mr >= MatchResult::STAT_DIRTY) {
         st = CacheStatus::STATS_DIRTY;
@@ -438,6 +682,15 @@ namespace fast_fs_hash {
      *   - {@link CacheStatus::UP_TO_DATE} — passed every load-time
      *     check; may still be downgraded to CHANGED by the caller's
      *     subsequent path-match step.
+     *
+     * A PLAIN body of at least PrivateFileMap::min_size() bytes is mapped
+     * into `map_` instead; `oldBuf` then stays empty. When the cache file's
+     * identity matches an image in DecodedCacheRegistry, `oldBuf` is a copy
+     * of it and the file is not read at all. For a sharded manifest, `oldBuf`
+     * holds only the header and uncompressed section, and shards_ is primed
+     * for doOpen_ to load the body. An LZ4_BLOCKS body is decoded in
+     * parallel and a CODED (or legacy COLUMNAR) body is decompressed, then
+     * either is decoded from its coded image (readCodedBody_).
      */
     CacheStatus readOldCache_(
       OwnedBuf<> & oldBuf,
@@ -476,6 +729,23 @@ namespace fast_fs_hash {
         }
       }
 
+      // Same bytes decoded earlier in this process (any env or worker
+      // thread): clone them, skipping the read, decompress and validation.
+      if (DecodedCacheRegistry::capacity() != 0) {
+        const uint64_t startNs = HashMemo::now_ns();
+        if (this->lockedFile_.identity(this->cacheId_)) {
+          this->cacheIdNs_ = startNs;
+          oldBuf = DecodedCacheRegistry::instance().clone(this->cachePath_, this->cacheId_);
+        }
+      }
+      if (oldBuf) {
+        hdr = headerOf(oldBuf.ptr);
+        fc = hdr->fileCount;
+        bodyLen = oldBuf.len;
+        this->diskVersion_ = hdr->version;
+        return this->staleStatusOf_(*hdr);
+      }
+
       // Peek the header so we can size the final buffer correctly. Positional
       // read — leaves the fd's seek position untouched so the disk-side reads
       // below can be issued in any order via pread_at_most.
@@ -515,15 +785,40 @@ namespace fast_fs_hash {
       }
 
       this->diskVersion_ = peekHdr.version;
-      CacheStatus staleStatus = CacheStatus::UP_TO_DATE;
-      if (peekHdr.version != this->version_) {
-        staleStatus = CacheStatus::STALE_VERSION;
-      } else if (!this->hasFingerprint_) {
-        if (!peekHdr.fingerprint.is_zero()) {
-          staleStatus = CacheStatus::STALE;
+      const CacheStatus staleStatus = this->staleStatusOf_(peekHdr);
+
+      if (bodyFormat == BodyFormat::SHARDED) {
+        oldBuf = OwnedBuf<>::alloc(bodyLen);
+        if (!oldBuf) [[unlikely]] {
+          return CacheStatus::MISSING;
         }
-      } else if (peekHdr.fingerprint != this->fingerprint_) {
-        staleStatus = CacheStatus::STALE;
+        memcpy(oldBuf.ptr, &peekHdr, CacheHeader::SIZE);
+        if (uncSectionSize > 0) {
+          const int64_t un = this->lockedFile_.pread_at_most(
+            oldBuf.ptr + CacheHeader::SIZE, uncSectionSize, CacheHeader::SIZE);
+          if (un < 0 || static_cast<size_t>(un) < uncSectionSize) [[unlikely]] {
+            oldBuf.reset();
+            return CacheStatus::MISSING;
+          }
+        }
+        if (!this->shards_.prepare(this->lockedFile_, peekHdr, diskPrefix, onDiskBodyLen, this->cachePath_))
+          [[unlikely]] {
+          this->shards_.reset();
+          oldBuf.reset();
+          return CacheStatus::MISSING;
+        }
+        hdr = headerOf(oldBuf.ptr);
+        return staleStatus;
+      }
+
+      if (bodyFormat == BodyFormat::LZ4_BLOCKS || bodyFormat == BodyFormat::CODED ||
+          bodyFormat == BodyFormat::COLUMNAR) {
+        if (!this->readCodedBody_(oldBuf, peekHdr, bodyFormat, uncSectionSize, onDiskBodyLen, !cacheFileUnchanged))
+          [[unlikely]] {
+          return CacheStatus::MISSING;
+        }
+        hdr = headerOf(oldBuf.ptr);
+        return staleStatus;
       }
 
       // Allocation size depends on body encoding:
@@ -544,6 +839,19 @@ namespace fast_fs_hash {
           allocLen = needed;
         }
       }
+      // PLAIN: the file already is the dataBuf image, so map it when large enough.
+      if (uncompBodySize > 0 && bodyFormat == BodyFormat::PLAIN) {
+        this->map_ = PrivateFileMap::map(lockFd, bodyLen);
+        if (this->map_) {
+          hdr = headerOf(this->map_->data());
+          if (!cacheFileUnchanged && !hdr->packedPathsValid(this->map_->data())) [[unlikely]] {
+            this->releaseMap_();
+            return CacheStatus::MISSING;
+          }
+          return staleStatus;
+        }
+      }
+
       oldBuf = OwnedBuf<>::alloc(allocLen);
       if (!oldBuf) [[unlikely]] {
         return CacheStatus::MISSING;
@@ -599,13 +907,179 @@ namespace fast_fs_hash {
         return CacheStatus::MISSING;
       }
 
+      this->offerImage_(oldBuf.ptr, bodyLen);
       return staleStatus;
     }
 
-    FSH_FORCE_INLINE static bool statMatchHashFile_(
+    /**
+     * LZ4_BLOCKS / CODED / COLUMNAR branch of readOldCache_: read the body, then
+     * decompress it — blocks in parallel on the pool — into the dataBuf, or
+     * into an image scratch when the body is coded (see CacheBodyCoding).
+     * The paths region is decoded, and with `validatePaths` checked by
+     * packedPathsValid, as soon as its blocks are in, overlapping the rest
+     * of the decode; the other regions are decoded last. On macOS the
+     * directory table's per-entry index is kept for buildWorkUnits_.
+     */
+    bool readCodedBody_(
+      OwnedBuf<> & oldBuf,
+      const CacheHeader & peekHdr,
+      BodyFormat bodyFormat,
+      size_t uncSectionSize,
+      size_t onDiskBodyLen,
+      bool validatePaths) noexcept {
+      const size_t diskPrefix = CacheHeader::SIZE + uncSectionSize;
+      const size_t bodySize = peekHdr.bodySize();
+      oldBuf = OwnedBuf<>::alloc(diskPrefix + bodySize);
+      OwnedBuf<> src = OwnedBuf<>::alloc(onDiskBodyLen);
+      if (!oldBuf || !src) [[unlikely]] {
+        oldBuf.reset();
+        return false;
+      }
+      memcpy(oldBuf.ptr, &peekHdr, CacheHeader::SIZE);
+      if (uncSectionSize > 0) {
+        const int64_t un =
+          this->lockedFile_.pread_at_most(oldBuf.ptr + CacheHeader::SIZE, uncSectionSize, CacheHeader::SIZE);
+        if (un < 0 || static_cast<size_t>(un) < uncSectionSize) [[unlikely]] {
+          oldBuf.reset();
+          return false;
+        }
+      }
+      const int64_t bn = this->lockedFile_.pread_at_most(src.ptr, onDiskBodyLen, diskPrefix);
+      if (bn < 0 || static_cast<size_t>(bn) < onDiskBodyLen) [[unlikely]] {
+        oldBuf.reset();
+        return false;
+      }
+
+      uint32_t flags;
+      size_t imageLen;
+      size_t lz4At = 0;
+      if (bodyFormat == BodyFormat::COLUMNAR) {
+        flags = CacheBodyCoding::COLUMNAR_ENTRIES;
+        imageLen = bodySize;
+      } else if (bodyFormat == BodyFormat::CODED) {
+        CacheBodyCoding coding;
+        if (onDiskBodyLen < CacheBodyCoding::SIZE) [[unlikely]] {
+          oldBuf.reset();
+          return false;
+        }
+        memcpy(&coding, src.ptr, CacheBodyCoding::SIZE);
+        flags = coding.flags;
+        imageLen = coding.imageLen;
+        lz4At = CacheBodyCoding::SIZE;
+      } else {
+        CacheBlockTable table;
+        if (onDiskBodyLen < CacheBlockTable::SIZE) [[unlikely]] {
+          oldBuf.reset();
+          return false;
+        }
+        memcpy(&table, src.ptr, CacheBlockTable::SIZE);
+        flags = table.flags;
+        imageLen = table.imageLen != 0 ? table.imageLen : bodySize;
+      }
+      if (!cacheImageValid(peekHdr, flags, imageLen)) [[unlikely]] {
+        oldBuf.reset();
+        return false;
+      }
+
+      uint8_t * const body = oldBuf.ptr + diskPrefix;
+      OwnedBuf<> imageBuf;
+      if (flags != 0) {
+        imageBuf = OwnedBuf<>::alloc(imageLen);
+#  ifdef __APPLE__
+        if (flags & CacheBodyCoding::DIR_PATHS) {
+          this->entryDirs_ = OwnedBuf<>::alloc(static_cast<size_t>(peekHdr.fileCount) * 4);
+        }
+#  endif
+        if (!imageBuf) [[unlikely]] {
+          oldBuf.reset();
+          return false;
+        }
+      }
+      uint8_t * const image = flags != 0 ? imageBuf.ptr : body;
+
+      // Decode (coded image only) and validate the paths region.
+      const uint8_t * const dataBuf = oldBuf.ptr;
+      auto * const entryDirs = reinterpret_cast<uint32_t *>(this->entryDirs_.ptr);
+      bool pathsDone = false;
+      auto finishPaths = [&]() noexcept {
+        pathsDone = true;
+        if (flags != 0 &&
+            !decodeCacheImagePaths(image, imageLen, flags, peekHdr, body, entryDirs, this->dirCount_)) [[unlikely]] {
+          return false;
+        }
+        return !validatePaths || headerOf(dataBuf)->packedPathsValid(dataBuf);
+      };
+
+      bool ok;
+      if (bodyFormat != BodyFormat::LZ4_BLOCKS) {
+        ok = LZ4_decompress_safe(
+               reinterpret_cast<const char *>(src.ptr + lz4At),
+               reinterpret_cast<char *>(image),
+               static_cast<int>(onDiskBodyLen - lz4At),
+               static_cast<int>(imageLen)) == static_cast<int>(imageLen);
+      } else {
+        const CacheBodyRegions regions = CacheBodyRegions::of(peekHdr);
+        const bool watch = flags != 0 || validatePaths;
+        ok = decodeCacheBlocks(
+          this->addon->pool, src.ptr, onDiskBodyLen, image, imageLen, watch ? regions.pathsOffset() : 0,
+          watch ? imageLen - regions.payloads : 0, finishPaths);
+      }
+      if (ok && !pathsDone) {
+        ok = finishPaths();
+      }
+      if (!ok) [[unlikely]] {
+        this->entryDirs_.reset();
+        oldBuf.reset();
+        return false;
+      }
+      if (flags != 0) {
+        decodeCacheImageRest(image, imageLen, flags, peekHdr, body);
+      }
+      this->offerImage_(oldBuf.ptr, oldBuf.len);
+      return true;
+    }
+
+    /** Offer a decoded and validated image to DecodedCacheRegistry. */
+    void offerImage_(const uint8_t * data, size_t len) noexcept {
+      if (this->cacheIdNs_ != 0) {
+        DecodedCacheRegistry::instance().offer(this->cachePath_, this->cacheId_, this->cacheIdNs_, data, len);
+      }
+    }
+
+    /** STALE_VERSION / STALE / UP_TO_DATE for a well-formed header. */
+    CacheStatus staleStatusOf_(const CacheHeader & h) const noexcept {
+      if (h.version != this->version_) {
+        return CacheStatus::STALE_VERSION;
+      }
+      // Hashes from the other hashing mode can never match.
+      if (h.chunkTreeHash() != this->chunkTreeHash_) {
+        return CacheStatus::STALE;
+      }
+      if (!this->hasFingerprint_) {
+        return h.fingerprint.is_zero() ? CacheStatus::UP_TO_DATE : CacheStatus::STALE;
+      }
+      return h.fingerprint != this->fingerprint_ ? CacheStatus::STALE : CacheStatus::UP_TO_DATE;
+    }
+
+    /** Take the watcher's dirty set into `bits`. ALL when the watcher was
+     *  built from another file list or the bitset can't be allocated. */
+    uint32_t takeWatched_(OwnedBuf<uint64_t> & bits, uint32_t fc) noexcept {
+      CacheWatcher * const w = this->watcher_;
+      if (w->fileCount() != fc || w->pathsHash() != XXH3_64bits(this->encodedPaths_, this->encodedLen_)) {
+        return CacheWatcher::ALL;
+      }
+      bits = OwnedBuf<uint64_t>::alloc(w->words());
+      if (!bits) [[unlikely]] {
+        return CacheWatcher::ALL;
+      }
+      return w->take(bits.ptr);
+    }
+
+    FSH_FORCE_INLINE bool statMatchHashFile_(
       PathResolver & resolver, CacheEntry & entry, const Hash128 & oldContentHash,
-      unsigned char * readBuf) {
-      resolver.hash_file(entry.contentHash, readBuf, READ_BUFFER_SIZE);
+      const ReadScratch & readBuf) const {
+      resolver.hash_file(
+        entry.contentHash, readBuf.data, readBuf.size, this->chunkTreeHash_ ? &this->chunkTree_ : nullptr);
       return entry.contentHash == oldContentHash;
     }
 
@@ -666,17 +1140,26 @@ namespace fast_fs_hash {
       }
       const size_t threshold = statBulkThreshold_();
 
-      // Per-prefix bucket. unordered_map wins over sort-then-scan here in
-      // the typical case: many files share few parent dirs, so hashmap is
-      // O(fc) with cheap string_view hashes vs sort's O(fc log fc) with a
-      // memcmp comparator that doesn't get amortized away.
+      // Per-prefix bucket. When the old body carried a directory table and
+      // the list is unchanged, its per-entry index picks the bucket directly.
+      // Otherwise unordered_map wins over sort-then-scan here in the typical
+      // case: many files share few parent dirs, so hashmap is O(fc) with
+      // cheap string_view hashes vs sort's O(fc log fc) with a memcmp
+      // comparator that doesn't get amortized away.
       struct Bucket {
         const uint8_t * prefixPtr = nullptr;
         size_t prefixLen = 0;
         std::vector<BulkDirJob::Entry> entries;
       };
-      std::unordered_map<std::string_view, Bucket> buckets;
-      buckets.reserve(fc / 4);
+      const auto * const entryDirs =
+        this->listChanged_ ? nullptr : reinterpret_cast<const uint32_t *>(this->entryDirs_.ptr);
+      std::vector<Bucket> buckets;
+      std::unordered_map<std::string_view, uint32_t> bucketIds;
+      if (entryDirs) {
+        buckets.resize(this->dirCount_);
+      } else {
+        bucketIds.reserve(fc / 4);
+      }
 
       uint32_t prevEnd = 0;
       for (uint32_t i = 0; i < fc; ++i) {
@@ -690,8 +1173,17 @@ namespace fast_fs_hash {
         const size_t baseStart = (slashPos == pathLen) ? 0 : slashPos + 1;
         const size_t baseLen = pathLen - baseStart;
 
-        std::string_view prefixView(reinterpret_cast<const char *>(pathStart), prefixLen);
-        Bucket & b = buckets[prefixView];
+        uint32_t id;
+        if (entryDirs) {
+          id = entryDirs[i];
+        } else {
+          std::string_view prefixView(reinterpret_cast<const char *>(pathStart), prefixLen);
+          id = bucketIds.try_emplace(prefixView, static_cast<uint32_t>(buckets.size())).first->second;
+          if (id == buckets.size()) {
+            buckets.emplace_back();
+          }
+        }
+        Bucket & b = buckets[id];
         if (b.entries.empty()) {
           b.prefixPtr = pathStart;
           b.prefixLen = prefixLen;
@@ -705,8 +1197,7 @@ namespace fast_fs_hash {
       const size_t rootLen = this->rootPath_.size();
       const bool rootHasTrailingSlash = rootLen > 0 && this->rootPath_[rootLen - 1] == '/';
 
-      for (auto & kv : buckets) {
-        Bucket & b = kv.second;
+      for (Bucket & b : buckets) {
         const size_t bucketSize = b.entries.size();
         if (bucketSize < threshold) {
           for (const auto & e : b.entries) {
@@ -780,12 +1271,11 @@ namespace fast_fs_hash {
       uint64_t oldSize,
       bool statOk,
       PathResolver & resolver,
-      unsigned char * readBuf) const noexcept {
+      const ReadScratch & readBuf) const noexcept {
       if (!statOk) [[unlikely]] {
         entry.contentHash.set_zero();
         entry.ino |= CACHE_S_STAT_DONE;
-        this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
-        return ReconcileAction::ABORT_BATCH;
+        return this->changed_(entry, FileChangeKind::MISSING);
       }
 
       if (entry.ino == oldIno && entry.mtimeNs == oldMtime && entry.ctimeNs == oldCtime && entry.size == oldSize)
@@ -796,13 +1286,12 @@ namespace fast_fs_hash {
 
       if (this->matchResult_.load(std::memory_order_relaxed) < MatchResult::STAT_DIRTY) {
         this->matchResult_.store(MatchResult::STAT_DIRTY, std::memory_order_relaxed);
-        this->addon->pool.expand(this->job_, 1);
+        this->addon->pool.expand(this->job_, 1, this->expandCap_);
       }
 
       if (entry.size != oldSize) {
         entry.ino |= CACHE_S_STAT_DONE;
-        this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
-        return ReconcileAction::ABORT_BATCH;
+        return this->changed_(entry, FileChangeKind::CHANGED);
       }
 
       const Hash128 oldContentHash = entry.contentHash;
@@ -810,38 +1299,62 @@ namespace fast_fs_hash {
         entry.contentHash.from_xxh128(XXH3_128bits(nullptr, 0));
         entry.ino |= CACHE_S_DONE;
         if (entry.contentHash == oldContentHash) {
+          this->noteChange_(entry, FileChangeKind::STATS_DIRTY);
           return ReconcileAction::CONTINUE;
         }
-        this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
-        return ReconcileAction::ABORT_BATCH;
+        return this->changed_(entry, FileChangeKind::CHANGED);
       }
-      if (statMatchHashFile_(resolver, entry, oldContentHash, readBuf)) {
+      if (this->statMatchHashFile_(resolver, entry, oldContentHash, readBuf)) {
         entry.ino |= CACHE_S_DONE;
+        this->noteChange_(entry, FileChangeKind::STATS_DIRTY);
         return ReconcileAction::CONTINUE;
       }
       entry.ino |= CACHE_S_DONE;
+      return this->changed_(entry, FileChangeKind::CHANGED);
+    }
+
+    /** Record `kind` for `entry` when running a full scan. */
+    FSH_FORCE_INLINE void noteChange_(const CacheEntry & entry, FileChangeKind kind) const noexcept {
+      if (this->fullScan_) {
+        this->changes_.ptr[&entry - this->runEntries_] = static_cast<uint8_t>(kind);
+      }
+    }
+
+    /** Raise matchResult to CHANGED. A full scan records `kind` and keeps going;
+     *  otherwise the caller bails out of its batch. */
+    FSH_FORCE_INLINE ReconcileAction changed_(const CacheEntry & entry, FileChangeKind kind) const noexcept {
       this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
+      if (this->fullScan_) {
+        this->changes_.ptr[&entry - this->runEntries_] = static_cast<uint8_t>(kind);
+        return ReconcileAction::CONTINUE;
+      }
       return ReconcileAction::ABORT_BATCH;
     }
 
+    /** Whether workers should stop claiming work: a change was found and this
+     *  is not a full scan. */
+    FSH_FORCE_INLINE bool stopOnChange_() const noexcept {
+      return !this->fullScan_ && this->matchResult_.load(std::memory_order_relaxed) >= MatchResult::CHANGED;
+    }
+
     /** Phase-1 loop: claim and process dir-jobs (bulk-stat per directory).
      *  Returns CONTINUE on normal exhaustion of the queue, ABORT_BATCH when
      *  the worker should bail (matchResult became CHANGED, cancel fired, or
-     *  pool shutdown). Empty dirJobs_ → instant CONTINUE. */
+     *  env teardown). Empty dirJobs_ → instant CONTINUE. */
     FSH_FORCE_INLINE ReconcileAction processStatDirJobs_(
-      PathResolver & resolver, size_t maxSegCap, unsigned char * readBuf,
+      PathResolver & resolver, size_t maxSegCap, const ReadScratch & readBuf,
       std::vector<BulkStat> & bulkData) const noexcept {
       const size_t dirJobCount = this->dirJobs_.size();
       if (dirJobCount == 0) {
         return ReconcileAction::CONTINUE;
       }
       const FfshFile::LockCancel * cancel = &this->cancel_;
-      ThreadPool & pool = this->addon->pool;
+      const AddonData * d = this->addon;
       for (;;) {
-        if (this->matchResult_.load(std::memory_order_relaxed) >= MatchResult::CHANGED) [[unlikely]] {
+        if (this->stopOnChange_()) [[unlikely]] {
           return ReconcileAction::ABORT_BATCH;
         }
-        if (cancel->is_fired() || pool.is_shutdown()) [[unlikely]] {
+        if (cancel->is_fired() || d->stopping()) [[unlikely]] {
           return ReconcileAction::ABORT_BATCH;
         }
         const size_t didx = this->nextDirJob_.fetch_add(1, std::memory_order_relaxed);
@@ -861,7 +1374,7 @@ namespace fast_fs_hash {
       const uint32_t * FSH_RESTRICT const entryQueue = this->entryQueueIdx_.data();
       const size_t entryQueueSize = this->entryQueueIdx_.size();
       const FfshFile::LockCancel * cancel = &this->cancel_;
-      ThreadPool & pool = this->addon->pool;
+      const AddonData * d = this->addon;
 
       const std::string & rootRef = this->rootPath_;
       const char * rootPath = rootRef.c_str();
@@ -872,17 +1385,27 @@ namespace fast_fs_hash {
       resolver.init(this->runDirFd_, rootPath, rootPathLen);
       const size_t maxSegCap = FSH_MAX_PATH > resolver.prefix_len + 1 ? FSH_MAX_PATH - resolver.prefix_len - 1 : 0;
 
-      // Worker-owned scratch for the whole call. Hash readBuf for
+      // Thread scratch for the whole call. Hash readBuf for
       // statMatchHashFile_; the first 32 KiB is also donated to
       // processBulkDir_'s getattrlistbulk iteration. Bulk Phase A and
       // hash Phase B are serialized, so reusing the region is safe.
-      alignas(64) unsigned char readBuf[READ_BUFFER_SIZE];
+      ReadScratch readBuf;
+      if (!readBuf) [[unlikely]] {
+        return;  // threads that got a buffer claim this one's share
+      }
+      this->hadScratch_.store(true, std::memory_order_relaxed);
 
       // Per-worker bulkData vector, reused across all dir-jobs this worker
       // claims — grows monotonically to the largest dir size then stays put.
       // Eliminates the per-dir-job malloc on the validate hot path.
       std::vector<BulkStat> bulkData;
 
+#  if FSH_IO_URING_STAT
+      // Linux, FAST_FS_HASH_IO_URING=1: stat whole batches with one
+      // io_uring_enter each. nullptr when io_uring is unavailable.
+      IoUringStat * const ring = IoUringStat::local();
+#  endif
+
       // Phase 1: dir-clustered work (large directories via platform bulk-stat).
       // Returns early if matchResult / cancel / shutdown aborts the worker.
       if (this->processStatDirJobs_(resolver, maxSegCap, readBuf, bulkData) == ReconcileAction::ABORT_BATCH) [[unlikely]] {
@@ -893,10 +1416,10 @@ namespace fast_fs_hash {
       // unclustered files). Indexes into entryQueueIdx_ — a possibly-sparse
       // subset of [0..fc) when dir-jobs absorbed the large clusters.
       for (;;) {
-        if (this->matchResult_.load(std::memory_order_relaxed) >= MatchResult::CHANGED) [[unlikely]] {
+        if (this->stopOnChange_()) [[unlikely]] {
           break;
         }
-        if (cancel->is_fired() || pool.is_shutdown()) [[unlikely]] {
+        if (cancel->is_fired() || d->stopping()) [[unlikely]] {
           break;
         }
 
@@ -906,17 +1429,45 @@ namespace fast_fs_hash {
         }
         const size_t batchEnd = baseIdx + workBatch < entryQueueSize ? baseIdx + workBatch : entryQueueSize;
 
+#  if FSH_IO_URING_STAT
+        if (ring) {
+          if (this->statBatchUring_(*ring, entryQueue + baseIdx, batchEnd - baseIdx, resolver, maxSegCap, readBuf) ==
+              ReconcileAction::ABORT_BATCH) [[unlikely]] {
+            goto done;
+          }
+          continue;
+        }
+#  endif
+
+        // Stat the whole batch first, then reconcile it against the cached
+        // values in one statMatchMask pass (see reconcileStatBatch_).
+        CacheStatSnapshot oldStat[STAT_MATCH_BATCH];
+        CacheStatSnapshot freshStat[STAT_MATCH_BATCH];
+        uint32_t statIdx[STAT_MATCH_BATCH];
+        uint64_t statFailed = 0;
+        size_t statCount = 0;
+        bool stop = false;
+
         for (size_t i = baseIdx; i < batchEnd; ++i) {
+          // Another worker found a change: the rest of the batch can't alter the result.
+          if (this->stopOnChange_()) [[unlikely]] {
+            stop = true;
+            break;
+          }
+
           const uint32_t idx = entryQueue[i];
           const uint32_t pathEnd = pathEnds[idx];
           const uint32_t pathStart = idx == 0 ? 0u : pathEnds[idx - 1];
 
+          CacheEntry & entry = entries[idx];
           if (pathEnd < pathStart || pathEnd > packedPathsSize) [[unlikely]] {
-            this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
-            goto done;
+            if (this->changed_(entry, FileChangeKind::CHANGED) == ReconcileAction::ABORT_BATCH) {
+              stop = true;
+              break;
+            }
+            continue;
           }
 
-          CacheEntry & entry = entries[idx];
           const uint64_t inoWithState = entry.ino;
           const uint64_t state = inoWithState & INO_STATE_MASK;
 
@@ -934,33 +1485,178 @@ namespace fast_fs_hash {
 
           if (state == CACHE_S_HAS_OLD) [[likely]] {
             if (pathLen > maxSegCap) [[unlikely]] {
-              this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
-              goto done;
+              entry.ino |= CACHE_S_STAT_DONE;
+              if (this->changed_(entry, FileChangeKind::MISSING) == ReconcileAction::ABORT_BATCH) {
+                stop = true;
+                break;
+              }
+              continue;
             }
 
             resolver.resolve(packedPaths + pathOffset, pathLen);
 
-            const uint64_t oldIno = inoWithState & INO_VALUE_MASK;
-            const uint64_t oldMtime = entry.mtimeNs;
-            const uint64_t oldCtime = entry.ctimeNs;
-            const uint64_t oldSize = entry.size;
-
-            const bool statOk = resolver.stat_into(entry);
-            const ReconcileAction act =
-              this->reconcileStat_(entry, oldIno, oldMtime, oldCtime, oldSize, statOk, resolver, readBuf);
-            if (act == ReconcileAction::ABORT_BATCH) [[unlikely]] {
-              goto done;
+            oldStat[statCount] = {inoWithState & INO_VALUE_MASK, entry.mtimeNs, entry.ctimeNs, entry.size};
+            if (!resolver.stat_into(entry)) [[unlikely]] {
+              statFailed |= uint64_t{1} << statCount;
             }
+            freshStat[statCount] = {entry.ino, entry.mtimeNs, entry.ctimeNs, entry.size};
+            statIdx[statCount++] = idx;
             continue;
           }
 
+          if (this->fullScan_ && state == CACHE_S_NOT_CHECKED) {
+            continue;  // new to the list; doOpen_ already reported it ADDED
+          }
           this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
+          stop = true;
+          break;
+        }
+
+        if (statCount > 0 &&
+            this->reconcileStatBatch_(statIdx, oldStat, freshStat, statFailed, statCount, resolver, readBuf) ==
+              ReconcileAction::ABORT_BATCH) [[unlikely]] {
+          goto done;
+        }
+        if (stop) [[unlikely]] {
           goto done;
         }
       }
     done:;
     }
 
+    /** Reconcile a batch of fresh stats taken by processStat_. Entries whose
+     *  four stat fields all match the cached ones (one statMatchMask pass)
+     *  are marked DONE; the rest, and failed stats, go through
+     *  reconcileStat_ in batch order. Once that aborts (or another worker
+     *  has already found a change), the entries not yet reconciled get their
+     *  cached stat and HAS_OLD state back — exactly as if they had never
+     *  been stat'ed. */
+    FSH_FORCE_INLINE ReconcileAction reconcileStatBatch_(
+      const uint32_t * idx, const CacheStatSnapshot * oldStat, const CacheStatSnapshot * freshStat,
+      uint64_t statFailed, size_t count, PathResolver & resolver, const ReadScratch & readBuf) const noexcept {
+      CacheEntry * FSH_RESTRICT const entries = this->runEntries_;
+      const uint64_t match = statMatchMask(freshStat, oldStat, count) & ~statFailed;
+      const uint64_t all = count == STAT_MATCH_BATCH ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+      for (uint64_t m = match; m != 0; m &= m - 1) {
+        entries[idx[std::countr_zero(m)]].ino |= CACHE_S_DONE;
+      }
+      if (match == all) [[likely]] {
+        return ReconcileAction::CONTINUE;
+      }
+
+      bool aborted = false;
+      for (uint64_t m = all & ~match; m != 0; m &= m - 1) {
+        const auto k = static_cast<size_t>(std::countr_zero(m));
+        CacheEntry & entry = entries[idx[k]];
+        const CacheStatSnapshot & old = oldStat[k];
+        // Checked per entry: reconcileStat_ may hash the file.
+        if (aborted || this->stopOnChange_()) {
+          aborted = true;
+          entry.writeStat(old.ino | CACHE_S_HAS_OLD, old.mtimeNs, old.ctimeNs, old.size);
+          continue;
+        }
+        const bool statOk = ((statFailed >> k) & 1) == 0;
+        if (this->reconcileStat_(entry, old.ino, old.mtimeNs, old.ctimeNs, old.size, statOk, resolver, readBuf) ==
+            ReconcileAction::ABORT_BATCH) [[unlikely]] {
+          aborted = true;
+        }
+      }
+      return aborted ? ReconcileAction::ABORT_BATCH : ReconcileAction::CONTINUE;
+    }
+
+#  if FSH_IO_URING_STAT
+    /** io_uring variant of one Phase-2 batch: queue a statx per entry, then
+     *  reconcile the completions through reconcileStat_. Entries whose statx
+     *  failed (missing file, filesystem without the STATX_FIELDS bits, ring
+     *  failure) are re-stat'ed with fstatat so the outcome is identical to
+     *  the per-entry path. Same abort rules as the per-entry loop. */
+    FSH_NO_INLINE ReconcileAction statBatchUring_(
+      IoUringStat & ring, const uint32_t * batch, size_t count, PathResolver & resolver, size_t maxSegCap,
+      const ReadScratch & readBuf) const noexcept {
+      CacheEntry * FSH_RESTRICT const entries = this->runEntries_;
+      const uint32_t * FSH_RESTRICT const pathEnds = this->runPathEnds_;
+      const uint8_t * FSH_RESTRICT const packedPaths = this->runPackedPaths_;
+      const size_t packedPathsSize = this->runPackedPathsSize_;
+      const int dirFd = resolver.dir->fd;
+      bool aborted = false;
+
+      auto complete = [&](uint32_t idx, const struct statx * stx) {
+        if (aborted || this->stopOnChange_()) [[unlikely]] {
+          aborted = true;
+          return;  // drained only so the ring can be reused
+        }
+        CacheEntry & entry = entries[idx];
+        const uint64_t oldIno = entry.ino & INO_VALUE_MASK;
+        const uint64_t oldMtime = entry.mtimeNs;
+        const uint64_t oldCtime = entry.ctimeNs;
+        const uint64_t oldSize = entry.size;
+        const uint32_t pathStart = idx == 0 ? 0u : pathEnds[idx - 1];
+        resolver.resolve(packedPaths + pathStart, pathEnds[idx] - pathStart);
+        bool statOk = true;
+        if (stx) [[likely]] {
+          IoUringStat::to_entry(*stx, entry);
+        } else {
+          statOk = resolver.stat_into(entry);
+        }
+        if (this->reconcileStat_(entry, oldIno, oldMtime, oldCtime, oldSize, statOk, resolver, readBuf) ==
+            ReconcileAction::ABORT_BATCH) [[unlikely]] {
+          aborted = true;
+        }
+      };
+
+      for (size_t i = 0; i < count && !aborted; ++i) {
+        const uint32_t idx = batch[i];
+        const uint32_t pathEnd = pathEnds[idx];
+        const uint32_t pathStart = idx == 0 ? 0u : pathEnds[idx - 1];
+        if (pathEnd < pathStart || pathEnd > packedPathsSize) [[unlikely]] {
+          if (this->changed_(entries[idx], FileChangeKind::CHANGED) == ReconcileAction::ABORT_BATCH) {
+            aborted = true;
+            break;
+          }
+          continue;
+        }
+
+        const uint64_t state = entries[idx].ino & INO_STATE_MASK;
+        if (state == CACHE_S_DONE) [[likely]] {
+          continue;
+        }
+        const size_t pathLen = pathEnd - pathStart;
+        if (state != CACHE_S_HAS_OLD || pathLen > maxSegCap) [[unlikely]] {
+          if (this->fullScan_ && state == CACHE_S_NOT_CHECKED) {
+            continue;  // new to the list; doOpen_ already reported it ADDED
+          }
+          if (state == CACHE_S_HAS_OLD) {
+            entries[idx].ino |= CACHE_S_STAT_DONE;
+          }
+          if (this->changed_(entries[idx], FileChangeKind::MISSING) == ReconcileAction::ABORT_BATCH) {
+            aborted = true;
+            break;
+          }
+          continue;
+        }
+
+        // Relative to the root DirFd when there is one, else absolute.
+        const char * path = reinterpret_cast<const char *>(packedPaths + pathStart);
+        size_t len = pathLen;
+        if (dirFd < 0) {
+          resolver.resolve(packedPaths + pathStart, pathLen);
+          path = resolver.path_buf;
+          len = resolver.prefix_len + pathLen;
+        }
+        if (!ring.add(dirFd, path, len, idx)) [[unlikely]] {
+          ring.flush(complete);
+          if (aborted || !ring.add(dirFd, path, len, idx)) [[unlikely]] {
+            break;
+          }
+        }
+      }
+      if (ring.pending()) {
+        ring.flush(complete);
+      }
+      return aborted ? ReconcileAction::ABORT_BATCH : ReconcileAction::CONTINUE;
+    }
+#  endif
+
 #  ifdef __APPLE__
     /** Bulk-stat one directory in two phases. Phase A collects stat data
      *  via getattrlistbulk into per-entry slots; Phase B walks the slots
@@ -971,7 +1667,7 @@ namespace fast_fs_hash {
      *  monotonically to fit the largest dir, eliminating per-call malloc. */
     FSH_NO_INLINE void processBulkDir_(
       const BulkDirJob & job, PathResolver & resolver, size_t maxSegCap,
-      unsigned char * readBuf, std::vector<BulkStat> & bulkData) const noexcept {
+      const ReadScratch & readBuf, std::vector<BulkStat> & bulkData) const noexcept {
       CacheEntry * FSH_RESTRICT const entries = this->runEntries_;
       const uint32_t * FSH_RESTRICT const pathEnds = this->runPathEnds_;
       const uint8_t * FSH_RESTRICT const packedPaths = this->runPackedPaths_;
@@ -988,10 +1684,10 @@ namespace fast_fs_hash {
       constexpr size_t BULK_BUF_SIZE = 32 * 1024;
       static_assert(BULK_BUF_SIZE >= FfshFile::BULK_BUF_MIN_SIZE,
         "bulk iter buf below documented minimum");
-      static_assert(BULK_BUF_SIZE <= READ_BUFFER_SIZE,
+      static_assert(BULK_BUF_SIZE <= MIN_READ_BUFFER_SIZE,
         "bulk iter buf must fit inside the shared readBuf");
       const int got = FfshFile::bulk_stat_dir(
-        job.dirPath.c_str(), readBuf, BULK_BUF_SIZE, maxRecords,
+        job.dirPath.c_str(), readBuf.data, BULK_BUF_SIZE, maxRecords,
         [&](const char * name, size_t name_len, uint64_t ino, uint64_t mtime_ns,
             uint64_t ctime_ns, uint64_t size) {
           const std::string_view key(name, name_len);
@@ -1026,7 +1722,7 @@ namespace fast_fs_hash {
         const size_t pathLen = pathEnd - pathStart;
         if (pathLen > maxSegCap) [[unlikely]] {
           entry.ino |= CACHE_S_STAT_DONE;
-          this->matchResult_.store(MatchResult::CHANGED, std::memory_order_relaxed);
+          (void)this->changed_(entry, FileChangeKind::MISSING);
           continue;
         }
         resolver.resolve(packedPaths + pathStart, pathLen);
@@ -1045,7 +1741,7 @@ namespace fast_fs_hash {
 #  else
     // Stub for non-Apple — never called (dirJobs_ is always empty).
     FSH_FORCE_INLINE void processBulkDir_(
-      const BulkDirJob &, PathResolver &, size_t, unsigned char *,
+      const BulkDirJob &, PathResolver &, size_t, const ReadScratch &,
       std::vector<BulkStat> &) const noexcept {}
 #  endif
   };
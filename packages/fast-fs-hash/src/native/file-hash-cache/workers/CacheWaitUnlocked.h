@@ -41,7 +41,7 @@ namespace fast_fs_hash {
     }
 
     void Execute() override {
-      if (this->cancel_.is_fired() || this->addon->pool.is_shutdown()) [[unlikely]] {
+      if (this->cancel_.is_fired() || this->addon->stopping()) [[unlikely]] {
         this->signal();
         return;
       }
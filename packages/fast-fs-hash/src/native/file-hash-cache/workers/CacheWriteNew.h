@@ -2,9 +2,12 @@
 #define _FAST_FS_HASH_CACHE_WRITE_NEW_H
 
 #include "../cache-build.h"
-#include "../cache-helpers.h"
+#include "../cache-blocks.h"
+#include "../cache-shards.h"
 #include "../ParsedPayloads.h"
 #include "AddonWorker.h"
+#include "ScratchArena.h"
+#include "ThreadTuner.h"
 
 namespace fast_fs_hash {
 
@@ -47,6 +50,7 @@ namespace fast_fs_hash {
       fileCount_(fileCount),
       version_(version),
       hasFingerprint_(fingerprint != nullptr),
+      chunkTreeHash_(state->chunkTreeHash()),
       timeoutMs_(timeoutMs),
       userValue0_(userValue0),
       userValue1_(userValue1),
@@ -58,6 +62,7 @@ namespace fast_fs_hash {
       uncompressedPayloads_(std::move(uncompressedPayloads)),
       pathsRef_(std::move(pathsRef)),
       stateRef_(std::move(stateRef)) {
+      this->writeMode_ = CacheWriteMode::of(state, this->addon ? &this->addon->pool : nullptr);
       if (fingerprint) {
         memcpy(&this->fingerprint_, fingerprint, 16);
       }
@@ -80,7 +85,7 @@ namespace fast_fs_hash {
 
     void Execute() override {
       AddonData * d = this->addon;
-      if (this->cancel_.is_fired() || d->pool.is_shutdown()) [[unlikely]] {
+      if (this->cancel_.is_fired() || d->stopping()) [[unlikely]] {
         this->signal();
         return;
       }
@@ -109,6 +114,7 @@ namespace fast_fs_hash {
     uint32_t fileCount_;
     uint32_t version_;
     bool hasFingerprint_;
+    bool chunkTreeHash_;
     int timeoutMs_;
     Hash128 fingerprint_{};
     double userValue0_;
@@ -117,6 +123,7 @@ namespace fast_fs_hash {
     double userValue3_;
 
     const char * cachePath_;  // Points into stateBuf (pinned by stateRef_)
+    CacheWriteMode writeMode_;
     std::string rootPath_;
 
     ParsedPayloads compressedPayloads_;
@@ -130,6 +137,9 @@ namespace fast_fs_hash {
     const uint8_t * runPackedPaths_ = nullptr;
     size_t runPackedPathsSize_ = 0;
     size_t workBatch_ = 0;
+    /** &chunkTree_ when large files are hashed as chunk trees (state flags bit 2). */
+    const ChunkTreeHashing * runChunkTree_ = nullptr;
+    ChunkTreeHashing chunkTree_{};
     uint32_t writerFc_ = 0;
     bool writeSuccess_ = false;
     double resultStat_[2] = {0, 0};
@@ -141,19 +151,22 @@ namespace fast_fs_hash {
     OwnedBuf<> dataBuf_;
 
     alignas(64) mutable std::atomic<size_t> nextIndex_{0};
+    /** Set by every hash thread that got a read buffer; false when done means out of memory. */
+    std::atomic<bool> hadScratch_{false};
 
-    struct Job : ForkJob<Job, MAX_CACHE_IO_THREADS> {
+    struct Job : ForkJob<Job, ThreadTuner::MAX_THREADS> {
       CacheWriteNew * owner;
       void forkWork() noexcept { hashProc_(this->owner); }
       void forkDone() noexcept { onHashDone_(this->owner); }
     };
     Job job_;
+    mutable TunedRun tuned_;
 
     Napi::ObjectReference pathsRef_;
     Napi::ObjectReference stateRef_;
 
     static_assert(
-      READ_BUFFER_SIZE + sizeof(PathResolver) <= ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
+      sizeof(ReadScratch) + sizeof(PathResolver) <= ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
       "buffers exceed pool thread usable stack");
 
     // Close the locked fd BEFORE signaling JS so that any fresh open()+flock
@@ -187,6 +200,11 @@ namespace fast_fs_hash {
       if (this->hasFingerprint_) {
         hdr->fingerprint = this->fingerprint_;
       }
+      if (this->chunkTreeHash_) {
+        hdr->magic |= CacheHeader::MAGIC_CHUNK_TREE;
+        this->chunkTree_ = {&this->addon->pool, MAX_CACHE_IO_THREADS - 1};
+        this->runChunkTree_ = &this->chunkTree_;
+      }
 
       if (fc == 0) {
         this->writeFile_(this->dataBuf_.ptr, hdr, 0);
@@ -194,7 +212,7 @@ namespace fast_fs_hash {
         return;
       }
 
-      if (this->cancel_.is_fired() || this->addon->pool.is_shutdown()) [[unlikely]] {
+      if (this->cancel_.is_fired() || this->addon->stopping()) [[unlikely]] {
         this->signalAndClose_();
         return;
       }
@@ -208,9 +226,11 @@ namespace fast_fs_hash {
       this->runPackedPaths_ = pathsOf(buf, fc, 0, 0, 0);
       this->runPackedPathsSize_ = hdr->pathsLen;
 
-      int threadCount = ThreadPool::compute_threads(0, fc, MAX_CACHE_IO_THREADS, 4);
+      const int cap = this->tuned_.begin(TuneOp::CACHE_HASH, this->rootPath_.c_str(), fc, MAX_CACHE_IO_THREADS);
+      int threadCount = ThreadPool::compute_threads(0, fc, cap, 4);
       this->workBatch_ = computeBatchSize(threadCount, fc);
       this->nextIndex_.store(0, std::memory_order_relaxed);
+      this->hadScratch_.store(false, std::memory_order_relaxed);
 
       // Open the root directory fd ONCE on this thread, instead of once per
       // worker thread. processHash_ workers read from runDirFd_ instead of
@@ -218,11 +238,17 @@ namespace fast_fs_hash {
       this->runDirFd_ = DirFd(this->rootPath_.c_str(), fc);
 
       this->job_.owner = this;
+      this->tuned_.submitted(threadCount);
       this->addon->pool.submit(this->job_, threadCount);
     }
 
     static void onHashDone_(CacheWriteNew * self) {
-      if (!self->cancel_.is_fired() && !self->addon->pool.is_shutdown()) [[likely]] {
+      if (!self->hadScratch_.load(std::memory_order_relaxed)) [[unlikely]] {
+        self->signalAndClose_("CacheWriteNew: out of memory");
+        return;
+      }
+      if (!self->cancel_.is_fired() && !self->addon->stopping()) [[likely]] {
+        self->tuned_.finish();
         uint8_t * buf = self->dataBuf_.ptr;
         self->writeFile_(buf, headerOf(buf), self->writerFc_);
       }
@@ -235,24 +261,28 @@ namespace fast_fs_hash {
       this->writeSuccess_ = assembleAndWriteCache(
         buf, hdr, fc, 0, 0, 0,
         this->compressedPayloads_, this->uncompressedPayloads_,
-        this->lockedFile_, this->resultStat_);
+        this->lockedFile_, this->resultStat_, this->cachePath_, this->writeMode_);
     }
 
     static void hashProc_(CacheWriteNew * self) {
-      alignas(64) unsigned char rbuf[READ_BUFFER_SIZE];
-      self->processHash_(rbuf);
+      ReadScratch rbuf;
+      if (!rbuf) [[unlikely]] {
+        return;  // threads that got a buffer claim this one's share
+      }
+      self->hadScratch_.store(true, std::memory_order_relaxed);
+      self->processHash_(rbuf.data, rbuf.size);
     }
 
-    void processHash_(unsigned char * readBuf) const {
-      constexpr size_t readBufSize = READ_BUFFER_SIZE;
+    void processHash_(unsigned char * readBuf, size_t readBufSize) const {
       const uint32_t fileCount = this->writerFc_;
       const size_t workBatch = this->workBatch_;
       CacheEntry * FSH_RESTRICT const entries = this->runEntries_;
       const uint32_t * FSH_RESTRICT const pathEnds = this->runPathEnds_;
       const uint8_t * FSH_RESTRICT const packedPaths = this->runPackedPaths_;
       const size_t packedPathsSize = this->runPackedPathsSize_;
+      const ChunkTreeHashing * const tree = this->runChunkTree_;
       const FfshFile::LockCancel * cancel = &this->cancel_;
-      ThreadPool & pool = this->addon->pool;
+      const AddonData * d = this->addon;
 
       const std::string & rootRef = this->rootPath_;
       const char * rootPath = rootRef.c_str();
@@ -263,9 +293,10 @@ namespace fast_fs_hash {
       PathResolver resolver;
       resolver.init(this->runDirFd_, rootPath, rootPathLen);
       const size_t maxSegCap = FSH_MAX_PATH > resolver.prefix_len + 1 ? FSH_MAX_PATH - resolver.prefix_len - 1 : 0;
+      uint64_t hashedBytes = 0;
 
       for (;;) {
-        if (cancel->is_fired() || pool.is_shutdown()) [[unlikely]] {
+        if (cancel->is_fired() || d->stopping()) [[unlikely]] {
           break;
         }
         const size_t baseIdx = this->nextIndex_.fetch_add(workBatch, std::memory_order_relaxed);
@@ -305,11 +336,13 @@ namespace fast_fs_hash {
 
           resolver.resolve(packedPaths + pathOffset, pathLen);
 
-          if (!resolver.stat_and_hash_file(entry, entry.contentHash, readBuf, readBufSize)) [[unlikely]] {
+          if (!resolver.stat_and_hash_file(entry, entry.contentHash, readBuf, readBufSize, tree)) [[unlikely]] {
             continue;
           }
+          hashedBytes += entry.contentHash.is_zero() ? 0 : entry.size;
         }
       }
+      this->tuned_.bytes.fetch_add(hashedBytes, std::memory_order_relaxed);
     }
   };
 
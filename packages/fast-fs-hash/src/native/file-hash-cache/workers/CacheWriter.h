@@ -2,9 +2,12 @@
 #define _FAST_FS_HASH_CACHE_WRITER_H
 
 #include "../cache-build.h"
-#include "../cache-helpers.h"
+#include "../cache-blocks.h"
+#include "../cache-shards.h"
 #include "../ParsedPayloads.h"
 #include "AddonWorker.h"
+#include "ScratchArena.h"
+#include "ThreadTuner.h"
 
 namespace fast_fs_hash {
 
@@ -16,8 +19,11 @@ namespace fast_fs_hash {
    *   2. Count unresolved entries (ino state bits != DONE)
    *   3. If work needed → fork hash threads on pool
    *   4. Assemble uncompressed section + body, LZ4 compress body, write directly to the locked cache fd
+   *      (or, when the file on disk is PLAIN with the same layout, pwrite just the changed bytes)
    *
-   * On-disk format: [header:80 uncompressed][uncompressed section][LZ4(body)]
+   * On-disk format: [header:80 uncompressed][uncompressed section][LZ4(body)],
+   * or a manifest plus shard files when CacheStateBuf::shardCount() > 1
+   * (see cache-shards.h).
    */
   class CacheWriter final : public AddonWorker {
    public:
@@ -37,6 +43,7 @@ namespace fast_fs_hash {
       ParsedPayloads && compressedPayloads,
       ParsedPayloads && uncompressedPayloads,
       FfshFile && lockedFile,
+      PrivateFileMap * lockedMap = nullptr,
       bool resolveOnly = false) :
       AddonWorker(env, deferred),
       resolveOnly_(resolveOnly),
@@ -47,12 +54,14 @@ namespace fast_fs_hash {
       encodedLen_(encodedLen),
       fileCount_(fileCount),
       lockedFile_(std::move(lockedFile)),
+      lockedMap_(lockedMap),
       rootPath_(std::move(rootPath)),
       compressedPayloads_(std::move(compressedPayloads)),
       uncompressedPayloads_(std::move(uncompressedPayloads)),
       dataRef_(std::move(dataRef)),
       pathsRef_(std::move(pathsRef)),
       stateRef_(std::move(stateRef)) {
+      this->writeMode_ = CacheWriteMode::of(state, this->addon ? &this->addon->pool : nullptr);
       this->cancel_.cancelByte_ = state->cancelByte();
       AddonData * d = this->addon;
       if (d) {
@@ -66,11 +75,15 @@ namespace fast_fs_hash {
         d->active_cancels.remove(&this->cancel_);
       }
       this->cancel_.fire();
+      this->releaseMap_();
     }
 
     void Execute() override {
+      // dataBuf may be a mapping of the very file we are about to rewrite.
+      this->releaseMap_();
+
       AddonData * d = this->addon;
-      if (this->cancel_.is_fired() || d->pool.is_shutdown()) [[unlikely]] {
+      if (this->cancel_.is_fired() || d->stopping()) [[unlikely]] {
         this->signalAndClose_();
         return;
       }
@@ -80,13 +93,10 @@ namespace fast_fs_hash {
 
       if (this->encodedPaths_ && this->encodedLen_ > 0) {
         const uint32_t newFc = this->fileCount_;
-        const CacheHeader * prevHdr = headerOf(this->dataBuf_);
-        const uint32_t oldFc = prevHdr->fileCount;
-
         const bool sameFiles = pathsMatch(this->encodedPaths_, this->encodedLen_, newFc, this->dataBuf_);
 
         if (!sameFiles) {
-          if (!this->buildRemappedBuf_(prevHdr, oldFc, newFc)) {
+          if (!this->buildRemappedBuf_(newFc)) {
             return;
           }
           buf = this->newBuf_.ptr;
@@ -120,8 +130,11 @@ namespace fast_fs_hash {
     const uint8_t * encodedPaths_;
     size_t encodedLen_;
     uint32_t fileCount_;
+    CacheWriteMode writeMode_;
 
     FfshFile lockedFile_;
+    /** Mapping behind dataBuf_ (CacheOpen's mmap path), or nullptr. */
+    PrivateFileMap * lockedMap_;
 
     std::string rootPath_;
 
@@ -135,6 +148,9 @@ namespace fast_fs_hash {
     const uint8_t * runPackedPaths_ = nullptr;
     size_t runPackedPathsSize_ = 0;
     size_t workBatch_ = 0;
+    /** &chunkTree_ when the session hashes large files as chunk trees (header magic bit). */
+    const ChunkTreeHashing * runChunkTree_ = nullptr;
+    ChunkTreeHashing chunkTree_{};
     uint32_t writerFc_ = 0;
     bool writeSuccess_ = false;
     double resultStat_[2] = {0, 0};
@@ -145,22 +161,27 @@ namespace fast_fs_hash {
     DirFd runDirFd_{};
 
     OwnedBuf<> newBuf_;
+    /** Old entries the new file list dropped, for matching renamed files (see buildRemappedBuf_). */
+    CacheRenameIndex renames_;
 
     alignas(64) mutable std::atomic<size_t> nextIndex_{0};
+    /** Set by every hash thread that got a read buffer; false when done means out of memory. */
+    std::atomic<bool> hadScratch_{false};
 
-    struct Job : ForkJob<Job, MAX_CACHE_IO_THREADS> {
+    struct Job : ForkJob<Job, ThreadTuner::MAX_THREADS> {
       CacheWriter * owner;
       void forkWork() noexcept { hashProc_(this->owner); }
       void forkDone() noexcept { onHashDone_(this->owner); }
     };
     Job job_;
+    mutable TunedRun tuned_;
 
     Napi::ObjectReference dataRef_;
     Napi::ObjectReference pathsRef_;
     Napi::ObjectReference stateRef_;
 
     static_assert(
-      READ_BUFFER_SIZE + sizeof(PathResolver) <= ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
+      sizeof(ReadScratch) + sizeof(PathResolver) <= ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
       "buffers exceed pool thread usable stack");
 
     // Close the locked fd BEFORE signaling JS so that any fresh open()+flock
@@ -176,56 +197,21 @@ namespace fast_fs_hash {
       this->signal(error);
     }
 
-    FSH_NO_INLINE bool buildRemappedBuf_(const CacheHeader * prevHdr, uint32_t oldFc, uint32_t newFc) noexcept {
-      const uint32_t compCount = prevHdr->compressedPayloadItemCount;
-      const uint32_t compLen = prevHdr->compressedPayloadsLen;
-      const uint32_t uncCount = prevHdr->uncompressedPayloadItemCount;
-      const uint32_t uncLen = prevHdr->uncompressedPayloadsLen;
-
-      this->newBuf_ = buildCacheDataBuf(
-        this->encodedPaths_, this->encodedLen_, newFc, compCount, compLen, uncCount, uncLen);
+    /** Detach dataBuf_ from the cache file while the lock is still held. */
+    void releaseMap_() noexcept {
+      if (this->lockedMap_) {
+        this->lockedMap_->release_lock();
+        this->lockedMap_ = nullptr;
+      }
+    }
 
+    FSH_NO_INLINE bool buildRemappedBuf_(uint32_t newFc) noexcept {
+      this->newBuf_ = buildRemappedCacheDataBuf(
+        this->dataBuf_, this->encodedPaths_, this->encodedLen_, newFc, &this->renames_);
       if (!this->newBuf_) {
         this->signalAndClose_("cacheWrite: failed to build dataBuf");
         return false;
       }
-
-      uint8_t * newPtr = this->newBuf_.ptr;
-      CacheHeader * newHdr = headerOf(newPtr);
-      newHdr->version = prevHdr->version;
-      newHdr->fingerprint = prevHdr->fingerprint;
-      newHdr->userValue0 = prevHdr->userValue0;
-      newHdr->userValue1 = prevHdr->userValue1;
-      newHdr->userValue2 = prevHdr->userValue2;
-      newHdr->userValue3 = prevHdr->userValue3;
-
-      if (oldFc > 0 && newFc > 0) {
-        remapEntries_(this->dataBuf_, oldFc, newPtr, newFc);
-      }
-
-      // Copy uncompressed section (identical offset in both old and new bufs:
-      // it's right after the header, same size since we rebuilt with same counts).
-      if (uncCount > 0 || uncLen > 0) {
-        const size_t uncSectionSize = static_cast<size_t>(uncCount) * 4 + uncLen;
-        if (uncSectionSize > 0) {
-          memcpy(newPtr + CacheHeader::SIZE, this->dataBuf_ + CacheHeader::SIZE, uncSectionSize);
-        }
-      }
-
-      // Copy compressed payloads (dir + bytes) from old body into new body.
-      if (compCount > 0) {
-        memcpy(
-          compressedPayloadDirOf(newPtr, newFc, uncCount, uncLen),
-          compressedPayloadDirOf(this->dataBuf_, oldFc, uncCount, uncLen),
-          static_cast<size_t>(compCount) * 4);
-        if (compLen > 0) {
-          memcpy(
-            compressedPayloadBytesOf(newPtr, newFc, compCount, newHdr->pathsLen, uncCount, uncLen),
-            compressedPayloadBytesOf(this->dataBuf_, oldFc, compCount, prevHdr->pathsLen, uncCount, uncLen),
-            compLen);
-        }
-      }
-
       return true;
     }
 
@@ -267,7 +253,7 @@ namespace fast_fs_hash {
         return;
       }
 
-      if (this->cancel_.is_fired() || this->addon->pool.is_shutdown()) [[unlikely]] {
+      if (this->cancel_.is_fired() || this->addon->stopping()) [[unlikely]] {
         this->signalAndClose_();
         return;
       }
@@ -277,10 +263,16 @@ namespace fast_fs_hash {
       this->runPackedPaths_ = pathsOf(dbuf, fc, compCount, uncCount, uncLen);
       this->runPackedPathsSize_ = hdr->pathsLen;
       this->dataBuf_ = dbuf;
+      if (hdr->chunkTreeHash()) {
+        this->chunkTree_ = {&this->addon->pool, MAX_CACHE_IO_THREADS - 1};
+        this->runChunkTree_ = &this->chunkTree_;
+      }
 
-      int threadCount = ThreadPool::compute_threads(0, workNeeded, MAX_CACHE_IO_THREADS, 4);
+      const int cap = this->tuned_.begin(TuneOp::CACHE_HASH, this->rootPath_.c_str(), workNeeded, MAX_CACHE_IO_THREADS);
+      int threadCount = ThreadPool::compute_threads(0, workNeeded, cap, 4);
       this->workBatch_ = computeBatchSize(threadCount, fc);
       this->nextIndex_.store(0, std::memory_order_relaxed);
+      this->hadScratch_.store(false, std::memory_order_relaxed);
 
       // Open the root directory fd ONCE on this thread, instead of once per
       // worker thread. processHash_ workers read from runDirFd_ instead of
@@ -288,15 +280,27 @@ namespace fast_fs_hash {
       this->runDirFd_ = DirFd(this->rootPath_.c_str(), fc);
 
       this->job_.owner = this;
+      this->tuned_.submitted(threadCount);
       this->addon->pool.submit(this->job_, threadCount);
     }
 
     static void onHashDone_(CacheWriter * self) {
+      if (!self->hadScratch_.load(std::memory_order_relaxed)) [[unlikely]] {
+        if (self->resolveOnly_) {
+          self->signal("cacheWrite: out of memory");
+        } else {
+          self->signalAndClose_("cacheWrite: out of memory");
+        }
+        return;
+      }
+      if (!self->cancel_.is_fired() && !self->addon->stopping()) [[likely]] {
+        self->tuned_.finish();
+      }
       if (self->resolveOnly_) {
         self->signal();  // Resolve only — entries resolved in dataBuf, no disk write, keep fd open
         return;
       }
-      if (!self->cancel_.is_fired() && !self->addon->pool.is_shutdown()) [[likely]] {
+      if (!self->cancel_.is_fired() && !self->addon->stopping()) [[likely]] {
         uint8_t * buf = self->dataBuf_;
         self->writeFile_(buf, headerOf(buf), self->writerFc_);
       }
@@ -310,80 +314,29 @@ namespace fast_fs_hash {
       this->writeSuccess_ = assembleAndWriteCache(
         buf, hdr, fc, prevCompCount, prevUncCount, prevUncLen,
         this->compressedPayloads_, this->uncompressedPayloads_,
-        this->lockedFile_, this->resultStat_);
-    }
-
-    static void remapEntries_(
-      const uint8_t * FSH_RESTRICT oldData, uint32_t oldFc, uint8_t * FSH_RESTRICT newData, uint32_t newFc) noexcept {
-      const CacheHeader * oldHdr = headerOf(oldData);
-      const uint32_t oldCompCount = oldHdr->compressedPayloadItemCount;
-      const uint32_t oldUncCount = oldHdr->uncompressedPayloadItemCount;
-      const uint32_t oldUncLen = oldHdr->uncompressedPayloadsLen;
-      const CacheEntry * FSH_RESTRICT oldEntries = entriesOf(oldData, oldUncCount, oldUncLen);
-      const uint32_t * FSH_RESTRICT oldPe = pathEndsOf(oldData, oldFc, oldCompCount, oldUncCount, oldUncLen);
-      const uint8_t * FSH_RESTRICT oldPaths = pathsOf(oldData, oldFc, oldCompCount, oldUncCount, oldUncLen);
-      const size_t oldPathsLen = oldHdr->pathsLen;
-
-      const CacheHeader * newHdr = headerOf(newData);
-      const uint32_t newCompCount = newHdr->compressedPayloadItemCount;
-      const uint32_t newUncCount = newHdr->uncompressedPayloadItemCount;
-      const uint32_t newUncLen = newHdr->uncompressedPayloadsLen;
-      CacheEntry * FSH_RESTRICT newEntries = entriesOf(newData, newUncCount, newUncLen);
-      const uint32_t * FSH_RESTRICT newPe = pathEndsOf(newData, newFc, newCompCount, newUncCount, newUncLen);
-      const uint8_t * FSH_RESTRICT newPaths = pathsOf(newData, newFc, newCompCount, newUncCount, newUncLen);
-      const size_t newPathsLen = newHdr->pathsLen;
-
-      uint32_t oldOff = 0, newOff = 0;
-      size_t oi = 0, ni = 0;
-
-      while (oi < oldFc && ni < newFc) {
-        const uint32_t oldEnd = oldPe[oi];
-        const uint32_t newEnd = newPe[ni];
-        if (oldEnd < oldOff || oldEnd > oldPathsLen || newEnd < newOff || newEnd > newPathsLen) [[unlikely]] {
-          return;
-        }
-
-        const uint32_t oldSegLen = oldEnd - oldOff;
-        const uint32_t newSegLen = newEnd - newOff;
-        const uint32_t minLen = oldSegLen < newSegLen ? oldSegLen : newSegLen;
-
-        int cmp = minLen > 0 ? memcmp(oldPaths + oldOff, newPaths + newOff, minLen) : 0;
-        if (cmp == 0 && oldSegLen != newSegLen) {
-          cmp = oldSegLen < newSegLen ? -1 : 1;
-        }
-
-        if (cmp == 0) {
-          newEntries[ni] = oldEntries[oi];
-          newEntries[ni].ino = (newEntries[ni].ino & INO_VALUE_MASK) | CACHE_S_HAS_OLD;
-          oldOff = oldEnd;
-          newOff = newEnd;
-          ++oi;
-          ++ni;
-        } else if (cmp < 0) {
-          oldOff = oldEnd;
-          ++oi;
-        } else {
-          newOff = newEnd;
-          ++ni;
-        }
-      }
+        this->lockedFile_, this->resultStat_, this->state_->cachePath(), this->writeMode_);
     }
 
     static void hashProc_(CacheWriter * wr) {
-      alignas(64) unsigned char rbuf[READ_BUFFER_SIZE];
-      wr->processHash_(rbuf);
+      ReadScratch rbuf;
+      if (!rbuf) [[unlikely]] {
+        return;  // threads that got a buffer claim this one's share
+      }
+      wr->hadScratch_.store(true, std::memory_order_relaxed);
+      wr->processHash_(rbuf.data, rbuf.size);
     }
 
-    void processHash_(unsigned char * readBuf) const {
-      constexpr size_t readBufSize = READ_BUFFER_SIZE;
+    void processHash_(unsigned char * readBuf, size_t readBufSize) const {
       const uint32_t fileCount = this->writerFc_;
       const size_t workBatch = this->workBatch_;
       CacheEntry * FSH_RESTRICT const entries = this->runEntries_;
       const uint32_t * FSH_RESTRICT const pathEnds = this->runPathEnds_;
       const uint8_t * FSH_RESTRICT const packedPaths = this->runPackedPaths_;
       const size_t packedPathsSize = this->runPackedPathsSize_;
+      const ChunkTreeHashing * const tree = this->runChunkTree_;
+      const CacheRenameIndex * const renames = this->renames_.empty() ? nullptr : &this->renames_;
       const FfshFile::LockCancel * cancel = &this->cancel_;
-      ThreadPool & pool = this->addon->pool;
+      const AddonData * d = this->addon;
 
       const std::string & rootRef = this->rootPath_;
       const char * rootPath = rootRef.c_str();
@@ -394,9 +347,10 @@ namespace fast_fs_hash {
       PathResolver resolver;
       resolver.init(this->runDirFd_, rootPath, rootPathLen);
       const size_t maxSegCap = FSH_MAX_PATH > resolver.prefix_len + 1 ? FSH_MAX_PATH - resolver.prefix_len - 1 : 0;
+      uint64_t hashedBytes = 0;
 
       for (;;) {
-        if (cancel->is_fired() || pool.is_shutdown()) [[unlikely]] {
+        if (cancel->is_fired() || d->stopping()) [[unlikely]] {
           break;
         }
         const size_t baseIdx = this->nextIndex_.fetch_add(workBatch, std::memory_order_relaxed);
@@ -460,7 +414,8 @@ namespace fast_fs_hash {
               continue;
             }
             const Hash128 oldHash = entry.contentHash;
-            resolver.hash_file(entry.contentHash, readBuf, readBufSize);
+            resolver.hash_file(entry.contentHash, readBuf, readBufSize, tree);
+            hashedBytes += entry.contentHash.is_zero() ? 0 : entry.size;
             if (entry.contentHash != oldHash) {
               entry.ino |= INO_CHANGED_BIT;
             }
@@ -472,7 +427,8 @@ namespace fast_fs_hash {
             if (entry.size == 0) {
               entry.contentHash.from_xxh128(XXH3_128bits(nullptr, 0));
             } else {
-              resolver.hash_file(entry.contentHash, readBuf, readBufSize);
+              resolver.hash_file(entry.contentHash, readBuf, readBufSize, tree);
+              hashedBytes += entry.contentHash.is_zero() ? 0 : entry.size;
             }
             if (entry.contentHash != oldHash) {
               entry.ino |= INO_CHANGED_BIT;
@@ -481,10 +437,33 @@ namespace fast_fs_hash {
           }
 
           // New entry (NOT_CHECKED) — always changed regardless of stat/hash success
-          resolver.stat_and_hash_file(entry, entry.contentHash, readBuf, readBufSize);
+          if (renames) {
+            // A file the list lost under another path: same inode, size and
+            // mtime, and born before the old entry's ctime. Without a birth
+            // time (or on Windows) the file is hashed.
+            if (!resolver.stat_into(entry)) [[unlikely]] {
+              entry.contentHash.set_zero();
+              entry.ino |= INO_CHANGED_BIT;
+              continue;
+            }
+            const CacheRenameIndex::Item * moved = renames->find(entry);
+            uint64_t birthNs = 0;
+            if (moved && resolver.birth_ns(birthNs) && CacheRenameIndex::sameInode(*moved, birthNs)) {
+              entry.contentHash = moved->contentHash;
+              entry.ino |= CACHE_S_DONE | INO_CHANGED_BIT;
+              continue;
+            }
+            resolver.hash_file(entry.contentHash, readBuf, readBufSize, tree);
+            hashedBytes += entry.contentHash.is_zero() ? 0 : entry.size;
+            entry.ino |= INO_CHANGED_BIT;
+            continue;
+          }
+          resolver.stat_and_hash_file(entry, entry.contentHash, readBuf, readBufSize, tree);
+          hashedBytes += entry.contentHash.is_zero() ? 0 : entry.size;
           entry.ino |= INO_CHANGED_BIT;
         }
       }
+      this->tuned_.bytes.fetch_add(hashedBytes, std::memory_order_relaxed);
     }
   };
 
@@ -5,13 +5,35 @@
 
 namespace fast_fs_hash {
 
-  /** filesEqual(pathA, pathB) → Promise<boolean> */
+  /**
+   * filesEqual(pathA, pathB) → Promise<boolean>
+   *
+   * While FilesEqualWorker::inlineGate() predicts small, cached files, both
+   * are opened and fstat'ed here. A missing file, a size mismatch or a pair
+   * at most inlineMaxFileBytes() long settles inline; larger pairs go to the
+   * pool with the handles open. Otherwise everything runs on the pool.
+   */
   static Napi::Value bindFilesEqual(const Napi::CallbackInfo & info) {
     auto env = info.Env();
     auto deferred = Napi::Promise::Deferred::New(env);
     auto * worker = new FilesEqualWorker(
       env, deferred, info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value());
-    worker->Queue();
+    if (!FilesEqualWorker::inlineGate().shouldInline()) {
+      worker->Queue();
+      return deferred.Promise();
+    }
+    FfshFile fa(worker->pathA().c_str());
+    FfshFile fb(fa ? FfshFile(worker->pathB().c_str()) : FfshFile());
+    const int64_t sizeA = fa ? fa.fsize() : -1;
+    const int64_t sizeB = fb ? fb.fsize() : -1;
+    // Unequal or unknown sizes resolve false without reading.
+    const bool small = sizeA < 0 || sizeA != sizeB || static_cast<uint64_t>(sizeA) <= inlineMaxFileBytes();
+    worker->setFiles(std::move(fa), std::move(fb));
+    if (small) {
+      worker->RunInline();
+    } else {
+      worker->Queue();
+    }
     return deferred.Promise();
   }
 
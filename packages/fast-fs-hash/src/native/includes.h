@@ -127,8 +127,9 @@ FSH_FORCE_INLINE void aligned_free(void * ptr) noexcept {
 
 namespace fast_fs_hash {
   /**
-   * Per-thread read buffer size.
+   * Default per-thread read buffer size.
    * Covers the vast majority of source files in a single read.
+   * Overridable at runtime, see read_buffer_size() in ScratchArena.h.
    */
   static constexpr size_t READ_BUFFER_SIZE = 128 * 1024;
 
@@ -5,8 +5,13 @@
 
 #  include "../includes.h"
 #  include "../file-hash-cache/file-hash-cache-format.h"
+#  include "../core/OwnedBuf.h"
+#  include "../core/ParallelFor.h"
+#  include "../core/ScratchArena.h"
+#  include "../core/HashMemo.h"
 
 #  include <sys/file.h>
+#  include <sys/resource.h>
 #  include <sys/uio.h>
 #  include <time.h>
 
@@ -141,7 +146,7 @@ namespace fast_fs_hash {
 
     /** JS-thread-only doubly-linked list of active LockCancel tokens.
      *  Workers register on construction, unregister on destruction.
-     *  fire_all() before pool.shutdown() ensures poll_lock_ threads see
+     *  fire_all() before the env drains its tasks ensures poll_lock_ threads see
      *  is_fired()==true and exit within one sleep interval. */
     struct LockCancelList {
       LockCancel * head_ = nullptr;
@@ -392,6 +397,27 @@ namespace fast_fs_hash {
       return static_cast<int64_t>(st.st_size);
     }
 
+    /** Fill `id` from fstat. Returns false on error. */
+    inline bool identity(FileIdentity & id) const noexcept {
+      struct stat st{};
+      if (fstat_eintr_(this->fd, st) != 0) [[unlikely]] {
+        return false;
+      }
+#  if defined(__APPLE__)
+      id.mtimeNs =
+        static_cast<uint64_t>(st.st_mtimespec.tv_sec) * 1000000000ULL + static_cast<uint64_t>(st.st_mtimespec.tv_nsec);
+      id.ctimeNs =
+        static_cast<uint64_t>(st.st_ctimespec.tv_sec) * 1000000000ULL + static_cast<uint64_t>(st.st_ctimespec.tv_nsec);
+#  else
+      id.mtimeNs = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+      id.ctimeNs = static_cast<uint64_t>(st.st_ctim.tv_sec) * 1000000000ULL + static_cast<uint64_t>(st.st_ctim.tv_nsec);
+#  endif
+      id.dev = static_cast<uint64_t>(st.st_dev);
+      id.ino = static_cast<uint64_t>(st.st_ino);
+      id.size = static_cast<uint64_t>(st.st_size);
+      return true;
+    }
+
     /** Write all bytes. Returns true on success.
      *  Retries on EINTR. Treats n <= 0 (other than EINTR) as fatal. */
     inline bool write_all(const uint8_t * data, size_t len) noexcept {
@@ -409,6 +435,23 @@ namespace fast_fs_hash {
       return true;
     }
 
+    /** Positional write of all bytes at `offset` (does not touch the seek
+     *  position). Retries on EINTR and short writes. */
+    inline bool pwrite_all(const uint8_t * data, size_t len, size_t offset) noexcept {
+      size_t total = 0;
+      while (total < len) {
+        const ssize_t n = ::pwrite(this->fd, data + total, len - total, static_cast<off_t>(offset + total));
+        if (n > 0) [[likely]] {
+          total += static_cast<size_t>(n);
+          continue;
+        }
+        if (n == 0 || errno != EINTR) [[likely]] {
+          return false;
+        }
+      }
+      return true;
+    }
+
     /** Vectored write — gather-write multiple buffers in one syscall.
      *  Avoids an intermediate memcpy when the caller already has the bytes
      *  laid out across separate buffers (e.g. [header][body]).
@@ -656,6 +699,12 @@ namespace fast_fs_hash {
 #  endif
     }
 
+    /** Atomically replace `to` with `from`. */
+    static inline bool replace_file(const char * from, const char * to) noexcept { return ::rename(from, to) == 0; }
+
+    /** Delete a file. A file that is already gone counts as success. */
+    static inline bool remove_file(const char * path) noexcept { return ::unlink(path) == 0 || errno == ENOENT; }
+
    private:
     /** Apply a flock(2) operation, retrying on EINTR.
      *  `op` is one of LOCK_SH/LOCK_EX/LOCK_UN, optionally OR'd with LOCK_NB.
@@ -956,6 +1005,155 @@ namespace fast_fs_hash {
     }
   };
 
+  /**
+   * Per-worker LRU of open parent-directory fds for PathResolver.
+   *
+   * fstatat(root, "packages/a/src/x/y.tsx") walks every component of the path
+   * again for each file, which on overlayfs is most of the cost of a stat. With
+   * the parent open, stat and open take just the basename. Workers claim
+   * consecutive entries of a sorted path list, so siblings hit the same slot.
+   *
+   * Slots are bounded by RLIMIT_NOFILE (see slots()). If fewer than half the
+   * lookups hit after WARMUP_LOOKUPS, the tree is too scattered to gain from
+   * caching and the cache turns itself off for the rest of the run. The fds live
+   * only as long as the PathResolver (one worker run), so renamed directories
+   * are never observed through a stale fd across calls.
+   *
+   * FAST_FS_HASH_DIR_FD_CACHE=0 disables it.
+   */
+  class DirFdCache : NonCopyable {
+   public:
+    static constexpr int MAX_SLOTS = 64;
+    /** Longest parent prefix cached. Longer ones use the root-relative path. */
+    static constexpr size_t MAX_PREFIX = 255;
+    static constexpr uint32_t WARMUP_LOOKUPS = 64;
+
+    /** Slots per worker: RLIMIT_NOFILE / 128 (room for 32 workers at a quarter of
+     *  the limit), capped at MAX_SLOTS. 0 — disabled — below 4. Read once. */
+    static int slots() noexcept {
+      static const int v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_DIR_FD_CACHE");
+        if (env && env[0] == '0' && env[1] == '\0') {
+          return 0;
+        }
+        struct rlimit rl;
+        if (::getrlimit(RLIMIT_NOFILE, &rl) != 0) {
+          return 0;
+        }
+        const rlim_t n = rl.rlim_cur == RLIM_INFINITY ? MAX_SLOTS : rl.rlim_cur / 128;
+        return n < 4 ? 0 : (n > MAX_SLOTS ? MAX_SLOTS : static_cast<int>(n));
+      }();
+      return v;
+    }
+
+    DirFdCache() noexcept = default;
+
+    ~DirFdCache() noexcept {
+      if (this->slots_) {
+        for (int i = 0; i < this->used_; ++i) {
+          ::close(this->slots_[i].fd);
+        }
+        std::free(this->slots_);
+      }
+    }
+
+    /** Open fd of `root_fd`/`prefix` (prefix_len bytes, no trailing slash), or -1
+     *  when uncached — the caller then uses the root-relative path. */
+    FSH_FORCE_INLINE int get(int root_fd, const char * prefix, size_t prefix_len) noexcept {
+      if (this->off_ || prefix_len == 0 || prefix_len > MAX_PREFIX) [[unlikely]] {
+        return -1;
+      }
+      const Slot * last = this->used_ ? &this->slots_[this->last_] : nullptr;
+      if (last && last->len == prefix_len && memcmp(last->prefix, prefix, prefix_len) == 0) [[likely]] {
+        ++this->hits_;
+        return last->fd;
+      }
+      return this->lookup_(root_fd, prefix, prefix_len);
+    }
+
+   private:
+    struct Slot {
+      int fd;
+      uint32_t used_at;
+      size_t len;
+      char prefix[MAX_PREFIX + 1];
+    };
+
+    FSH_NO_INLINE int lookup_(int root_fd, const char * prefix, size_t prefix_len) noexcept {
+      const uint32_t lookups = ++this->lookups_;
+      if (lookups == WARMUP_LOOKUPS && this->hits_ * 2 < WARMUP_LOOKUPS) [[unlikely]] {
+        this->off_ = true;
+        return -1;
+      }
+      for (int i = 0; i < this->used_; ++i) {
+        Slot & s = this->slots_[i];
+        if (s.len == prefix_len && memcmp(s.prefix, prefix, prefix_len) == 0) {
+          ++this->hits_;
+          s.used_at = lookups;
+          this->last_ = i;
+          return s.fd;
+        }
+      }
+
+      const int cap = slots();
+      if (cap == 0) [[unlikely]] {
+        this->off_ = true;
+        return -1;
+      }
+      if (!this->slots_) {
+        this->slots_ = static_cast<Slot *>(std::malloc(sizeof(Slot) * static_cast<size_t>(cap)));
+        if (!this->slots_) [[unlikely]] {
+          this->off_ = true;
+          return -1;
+        }
+      }
+
+      int victim = this->used_;
+      if (victim == cap) {
+        victim = 0;
+        for (int i = 1; i < cap; ++i) {
+          if (this->slots_[i].used_at < this->slots_[victim].used_at) {
+            victim = i;
+          }
+        }
+      }
+      Slot & s = this->slots_[victim];
+      memcpy(s.prefix, prefix, prefix_len);
+      s.prefix[prefix_len] = '\0';
+      int fd;
+      for (;;) {
+#  ifdef O_PATH
+        fd = ::openat(root_fd, s.prefix, O_PATH | O_DIRECTORY | O_CLOEXEC);
+#  else
+        fd = ::openat(root_fd, s.prefix, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#  endif
+        if (fd >= 0 || errno != EINTR) {
+          break;
+        }
+      }
+      if (fd < 0) [[unlikely]] {
+        return -1;  // missing dir or EMFILE: the root-relative path reports the same error
+      }
+      if (victim == this->used_) {
+        ++this->used_;
+      } else {
+        ::close(s.fd);
+      }
+      s.fd = fd;
+      s.len = prefix_len;
+      s.used_at = lookups;
+      this->last_ = victim;
+      return fd;
+    }
+
+    Slot * slots_ = nullptr;
+    int used_ = 0;
+    int last_ = 0;
+    uint32_t lookups_ = 0;
+    uint32_t hits_ = 0;
+    bool off_ = false;
+  };
+
 #  include "hash-file-helpers.h"
 
   /**
@@ -964,7 +1162,9 @@ namespace fast_fs_hash {
    * Concatenates a root prefix with relative packed paths into a fixed
    * path_buf: [rootPath/][relativePath\0]. On POSIX, optionally uses a
    * DirFd for fstatat()/openat() — avoids repeated kernel path resolution
-   * of the root prefix when many files share the same directory.
+   * of the root prefix when many files share the same directory. With a
+   * DirFd, paths with a parent directory go through DirFdCache and are
+   * resolved by basename against the cached parent fd.
    *
    * Lifecycle: init() once with root path, then resolve()+stat/hash per file.
    */
@@ -972,6 +1172,9 @@ namespace fast_fs_hash {
     char path_buf[FSH_MAX_PATH];
     const DirFd * dir;
     size_t prefix_len;
+    /** Length of the resolved path's parent directory, 0 when it has none. */
+    size_t parent_len = 0;
+    mutable DirFdCache dirs;
 
     FSH_FORCE_INLINE void init(const DirFd & dir_fd, const char * root_path, size_t root_path_len) noexcept {
       this->dir = &dir_fd;
@@ -991,33 +1194,83 @@ namespace fast_fs_hash {
       char * dst = this->path_buf + this->prefix_len;
       memcpy(dst, packed_path, path_len);
       dst[path_len] = '\0';
+      size_t slash = path_len;
+      while (slash > 0 && dst[slash - 1] != '/') {
+        --slash;
+      }
+      this->parent_len = slash > 0 ? slash - 1 : 0;
     }
 
     FSH_FORCE_INLINE bool stat_into(CacheEntry & entry) const noexcept {
-      const char * path = this->dir->fd >= 0 ? this->path_buf + this->prefix_len : this->path_buf;
-      return FfshFile::stat_into_at(this->dir->fd, path, entry);
+      if (this->dir->fd < 0) {
+        return FfshFile::stat_into_at(-1, this->path_buf, entry);
+      }
+      const char * rel = this->path_buf + this->prefix_len;
+      const int at = this->at_(rel);
+      return FfshFile::stat_into_at(at, rel, entry);
+    }
+
+    /** Birth time of the resolved path in ns since the Unix epoch: statx
+     *  STATX_BTIME on Linux, st_birthtime on macOS. false where the
+     *  platform or filesystem does not record it. */
+    inline bool birth_ns(uint64_t & out) const noexcept {
+      const char * rel = this->path_buf + this->prefix_len;
+      const int at = this->dir->fd >= 0 ? this->at_(rel) : AT_FDCWD;
+      const char * const path = this->dir->fd >= 0 ? rel : this->path_buf;
+#  if defined(__linux__) && defined(STATX_BTIME)
+      struct statx stx;
+      int r;
+      do {
+        r = ::statx(at, path, AT_STATX_SYNC_AS_STAT, STATX_BTIME, &stx);
+      } while (r != 0 && errno == EINTR);
+      if (r != 0 || !(stx.stx_mask & STATX_BTIME)) {
+        return false;
+      }
+      out = static_cast<uint64_t>(stx.stx_btime.tv_sec) * 1000000000ULL + stx.stx_btime.tv_nsec;
+      return true;
+#  elif defined(__APPLE__)
+      struct stat st;
+      int r;
+      do {
+        r = ::fstatat(at, path, &st, 0);
+      } while (r != 0 && errno == EINTR);
+      if (r != 0) {
+        return false;
+      }
+      out = static_cast<uint64_t>(st.st_birthtimespec.tv_sec) * 1000000000ULL +
+        static_cast<uint64_t>(st.st_birthtimespec.tv_nsec);
+      return true;
+#  else
+      (void)at;
+      (void)path;
+      return false;
+#  endif
     }
 
     FSH_FORCE_INLINE FfshFile open_file() const noexcept {
       if (this->dir->fd >= 0) {
-        return FfshFile(this->dir->fd, this->path_buf + this->prefix_len);
+        const char * rel = this->path_buf + this->prefix_len;
+        const int at = this->at_(rel);
+        return FfshFile(at, rel);
       }
       return FfshFile(this->path_buf);
     }
 
-    FSH_FORCE_INLINE void hash_file(Hash128 & dest, unsigned char * rbuf, size_t rbs) const noexcept {
+    FSH_FORCE_INLINE void hash_file(
+      Hash128 & dest, unsigned char * rbuf, size_t rbs, const ChunkTreeHashing * tree = nullptr) const noexcept {
       FfshFile rf = this->open_file();
       if (!rf) [[unlikely]] {
         dest.set_zero();
         return;
       }
-      hash_open_file(rf, dest, rbuf, rbs);
+      hash_open_file(rf, dest, rbuf, rbs, tree);
     }
 
     /** Combined stat + hash: opens file once, fstats the fd, then reads and hashes.
      *  Saves one syscall vs separate stat_into() + hash_file(). */
     FSH_FORCE_INLINE bool stat_and_hash_file(
-      CacheEntry & entry, Hash128 & dest, unsigned char * rbuf, size_t rbs) const noexcept {
+      CacheEntry & entry, Hash128 & dest, unsigned char * rbuf, size_t rbs,
+      const ChunkTreeHashing * tree = nullptr) const noexcept {
       FfshFile rf = this->open_file();
       if (!rf) [[unlikely]] {
         entry.clearStat();
@@ -1037,9 +1290,24 @@ namespace fast_fs_hash {
         ::fcntl(rf.fd, F_RDADVISE, &ra);
       }
 #  endif
-      hash_open_file(rf, dest, rbuf, rbs);
+      hash_open_file(rf, dest, rbuf, rbs, tree);
       return true;
     }
+
+   private:
+    /** Directory fd to resolve `rel` against: the cached parent (and `rel`
+     *  advanced to the basename), else the root DirFd. */
+    FSH_FORCE_INLINE int at_(const char *& rel) const noexcept {
+      const size_t plen = this->parent_len;
+      if (plen != 0) {
+        const int pfd = this->dirs.get(this->dir->fd, rel, plen);
+        if (pfd >= 0) [[likely]] {
+          rel += plen + 1;
+          return pfd;
+        }
+      }
+      return this->dir->fd;
+    }
   };
 
 }  // namespace fast_fs_hash
@@ -5,6 +5,10 @@
 
 #  include "../includes.h"
 #  include "../file-hash-cache/file-hash-cache-format.h"
+#  include "../core/OwnedBuf.h"
+#  include "../core/ParallelFor.h"
+#  include "../core/ScratchArena.h"
+#  include "../core/HashMemo.h"
 
 #  include <fcntl.h>
 #  include <io.h>
@@ -496,6 +500,33 @@ namespace fast_fs_hash {
       return sz.QuadPart;
     }
 
+    /** Fill `id` from the handle's file information. Returns false on error. */
+    inline bool identity(FileIdentity & id) const noexcept {
+      HANDLE h = this->get_handle();
+      if (h == INVALID_HANDLE_VALUE) [[unlikely]] {
+        return false;
+      }
+      BY_HANDLE_FILE_INFORMATION info;
+      FILE_BASIC_INFO basicInfo;
+      if (
+        !GetFileInformationByHandle(h, &info) ||
+        !GetFileInformationByHandleEx(h, FileBasicInfo, &basicInfo, sizeof(basicInfo))) [[unlikely]] {
+        return false;
+      }
+      id.dev = info.dwVolumeSerialNumber;
+      id.ino = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+      // FILETIME 100 ns ticks since 1601 → ns since the Unix epoch.
+      static constexpr uint64_t EPOCH_DIFF = 116444736000000000ULL;
+      auto li_to_ns = [](LARGE_INTEGER li) -> uint64_t {
+        const uint64_t v = static_cast<uint64_t>(li.QuadPart);
+        return v >= EPOCH_DIFF ? (v - EPOCH_DIFF) * 100ULL : 0ULL;
+      };
+      id.mtimeNs = li_to_ns(basicInfo.LastWriteTime);
+      id.ctimeNs = li_to_ns(basicInfo.ChangeTime);
+      id.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+      return true;
+    }
+
     /** Write all bytes. Returns true on success. */
     inline bool write_all(const uint8_t * data, size_t len) noexcept {
       HANDLE h = this->get_handle();
@@ -517,6 +548,29 @@ namespace fast_fs_hash {
       return true;
     }
 
+    /** Positional write of all bytes at `offset`, via WriteFile with
+     *  OVERLAPPED.Offset. */
+    inline bool pwrite_all(const uint8_t * data, size_t len, size_t offset) noexcept {
+      HANDLE h = this->get_handle();
+      if (h == INVALID_HANDLE_VALUE) [[unlikely]] {
+        return false;
+      }
+      size_t total = 0;
+      while (total < len) {
+        const DWORD chunk = static_cast<DWORD>((len - total > 0x7FFFFFFFu) ? 0x7FFFFFFFu : len - total);
+        const uint64_t pos = static_cast<uint64_t>(offset) + total;
+        OVERLAPPED ov{};
+        ov.Offset = static_cast<DWORD>(pos & 0xFFFFFFFFu);
+        ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+        DWORD written = 0;
+        if (!WriteFile(h, data + total, chunk, &written, &ov) || written == 0) [[unlikely]] {
+          return false;
+        }
+        total += written;
+      }
+      return true;
+    }
+
     /** Vectored write — Win32 has no kernel gather for regular files
      *  (WriteFileGather is unbuffered-only). To avoid N user/kernel
      *  transitions and N NTFS lock acquisitions, stage segments into a
@@ -656,6 +710,29 @@ namespace fast_fs_hash {
       return f;
     }
 
+    /** Atomically replace `to` with `from`. */
+    static inline bool replace_file(const char * from, const char * to) noexcept {
+      wchar_t wfrom[FSH_MAX_PATH];
+      wchar_t wto[FSH_MAX_PATH];
+      if (path_to_wide_(from, wfrom) == 0 || path_to_wide_(to, wto) == 0) [[unlikely]] {
+        return false;
+      }
+      return MoveFileExW(wfrom, wto, MOVEFILE_REPLACE_EXISTING) != 0;
+    }
+
+    /** Delete a file. A file that is already gone counts as success. */
+    static inline bool remove_file(const char * path) noexcept {
+      wchar_t wpath[FSH_MAX_PATH];
+      if (path_to_wide_(path, wpath) == 0) [[unlikely]] {
+        return false;
+      }
+      if (DeleteFileW(wpath)) {
+        return true;
+      }
+      const DWORD err = GetLastError();
+      return err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND;
+    }
+
    private:
     /** Overlapped handle that holds the byte-range lock. INVALID_HANDLE_VALUE when unused. */
     HANDLE lockHandle_ = INVALID_HANDLE_VALUE;
@@ -955,24 +1032,33 @@ namespace fast_fs_hash {
       return FfshFile::stat_into(wp.data, entry);
     }
 
+    /** Birth time of the resolved path. Always false here: Windows lets any
+     *  writer set the creation time, so it cannot prove an inode's history. */
+    inline bool birth_ns(uint64_t & out) const noexcept {
+      (void)out;
+      return false;
+    }
+
     FSH_FORCE_INLINE FfshFile open_file() const noexcept {
       WPath wp(this->path_buf, const_cast<wchar_t *>(this->wpath_scratch), FSH_MAX_PATH);
       return FfshFile(wp.data);
     }
 
-    FSH_FORCE_INLINE void hash_file(Hash128 & dest, unsigned char * rbuf, size_t rbs) const noexcept {
+    FSH_FORCE_INLINE void hash_file(
+      Hash128 & dest, unsigned char * rbuf, size_t rbs, const ChunkTreeHashing * tree = nullptr) const noexcept {
       FfshFile rf = this->open_file();
       if (!rf) [[unlikely]] {
         dest.set_zero();
         return;
       }
-      hash_open_file(rf, dest, rbuf, rbs);
+      hash_open_file(rf, dest, rbuf, rbs, tree);
     }
 
     /** Combined stat + hash: opens file once, fstats the fd, then reads and hashes.
      *  Saves one syscall vs separate stat_into() + hash_file(). */
     FSH_FORCE_INLINE bool stat_and_hash_file(
-      CacheEntry & entry, Hash128 & dest, unsigned char * rbuf, size_t rbs) const noexcept {
+      CacheEntry & entry, Hash128 & dest, unsigned char * rbuf, size_t rbs,
+      const ChunkTreeHashing * tree = nullptr) const noexcept {
       FfshFile rf = this->open_file();
       if (!rf) [[unlikely]] {
         entry.clearStat();
@@ -983,7 +1069,7 @@ namespace fast_fs_hash {
         dest.set_zero();
         return false;
       }
-      hash_open_file(rf, dest, rbuf, rbs);
+      hash_open_file(rf, dest, rbuf, rbs, tree);
       return true;
     }
   };
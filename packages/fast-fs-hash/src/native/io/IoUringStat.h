@@ -0,0 +1,297 @@
+#ifndef _FAST_FS_HASH_IO_URING_STAT_H
+#define _FAST_FS_HASH_IO_URING_STAT_H
+
+#include "../includes.h"
+#include "../file-hash-cache/file-hash-cache-format.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(STATX_INO)
+#    define FSH_IO_URING_STAT 1
+#  endif
+#endif
+
+#ifndef FSH_IO_URING_STAT
+#  define FSH_IO_URING_STAT 0
+#endif
+
+#if FSH_IO_URING_STAT
+
+namespace fast_fs_hash {
+
+  /**
+   * Batched statx through io_uring (Linux 5.6+), talking to the kernel with
+   * raw syscalls — no liburing dependency.
+   *
+   * One ring per thread, created on first use and torn down when the thread
+   * exits (like ScratchArena). Callers queue up to QUEUE_DEPTH statx requests
+   * with add() and complete them all with one flush(): a single
+   * io_uring_enter replaces QUEUE_DEPTH fstatat calls.
+   *
+   * Off by default — IORING_OP_STATX always runs on io-wq kernel threads,
+   * which only beats a hot-dentry fstatat when the filesystem is slow (cold
+   * cache, network, overlay). Enabled with FAST_FS_HASH_IO_URING=1.
+   *
+   * Unavailable io_uring (old kernel, io_uring_disabled sysctl, seccomp) or
+   * a kernel without IORING_OP_STATX (-EINVAL completions) disables the ring
+   * process-wide; local() then returns nullptr and callers use fstatat.
+   */
+  class IoUringStat : NonCopyable {
+   public:
+    static constexpr unsigned QUEUE_DEPTH = 128;
+
+    /** Bytes for NUL-terminated copies of queued paths; add() fails when full. */
+    static constexpr size_t PATH_ARENA_SIZE = 64 * 1024;
+
+    /** Fields every CacheEntry stat needs. */
+    static constexpr unsigned STATX_FIELDS = STATX_INO | STATX_MTIME | STATX_CTIME | STATX_SIZE;
+
+    /** FAST_FS_HASH_IO_URING=1, and no earlier setup or probe failure. */
+    static bool enabled() noexcept {
+      static const bool requested = [] {
+        const char * env = std::getenv("FAST_FS_HASH_IO_URING");
+        return env && env[0] == '1' && env[1] == '\0';
+      }();
+      return requested && !unavailable_().load(std::memory_order_relaxed);
+    }
+
+    /** The calling thread's ring, or nullptr when io_uring is off or unavailable. */
+    static IoUringStat * local() noexcept {
+      if (!enabled()) {
+        return nullptr;
+      }
+      thread_local IoUringStat ring;
+      return ring.ready_ && !ring.broken_ ? &ring : nullptr;
+    }
+
+    /** Convert a completed statx into CacheEntry stat fields (same as stat_from_struct_). */
+    static FSH_FORCE_INLINE void to_entry(const struct statx & stx, CacheEntry & entry) noexcept {
+      const uint64_t mtimeNs = static_cast<uint64_t>(stx.stx_mtime.tv_sec) * 1000000000ULL + stx.stx_mtime.tv_nsec;
+      const uint64_t ctimeNs = static_cast<uint64_t>(stx.stx_ctime.tv_sec) * 1000000000ULL + stx.stx_ctime.tv_nsec;
+      entry.writeStat(stx.stx_ino & INO_VALUE_MASK, mtimeNs, ctimeNs, stx.stx_size);
+    }
+
+    unsigned pending() const noexcept { return this->pending_; }
+
+    /**
+     * Queue statx(dir_fd, path) tagged with `tag`. `path` need not be
+     * NUL-terminated — it is copied. Returns false when the queue or the path
+     * arena is full; flush() and retry.
+     */
+    bool add(int dir_fd, const char * path, size_t path_len, uint32_t tag) noexcept {
+      if (this->pending_ >= QUEUE_DEPTH || this->arena_used_ + path_len + 1 > PATH_ARENA_SIZE) [[unlikely]] {
+        return false;
+      }
+      char * p = this->paths_ + this->arena_used_;
+      memcpy(p, path, path_len);
+      p[path_len] = '\0';
+      this->arena_used_ += path_len + 1;
+
+      const unsigned slot = this->pending_++;
+      const unsigned tail = *this->sq_tail_;
+      const unsigned idx = tail & this->sq_mask_;
+      io_uring_sqe & sqe = this->sqes_[idx];
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_STATX;
+      sqe.fd = dir_fd >= 0 ? dir_fd : AT_FDCWD;
+      sqe.addr = reinterpret_cast<uint64_t>(p);
+      sqe.len = STATX_FIELDS;
+      sqe.off = reinterpret_cast<uint64_t>(&this->statx_[slot]);
+      sqe.statx_flags = AT_STATX_SYNC_AS_STAT;
+      sqe.user_data = slot;
+      this->sq_array_[idx] = idx;
+      this->tags_[slot] = tag;
+      this->done_[slot] = false;
+      __atomic_store_n(this->sq_tail_, tail + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+
+    /**
+     * Submit everything queued, wait for all of it, and call
+     * `cb(tag, const struct statx * stx)` once per request. `stx` is nullptr
+     * when the request failed or the filesystem did not report every
+     * STATX_FIELDS bit — the caller should fall back to fstatat for that tag.
+     * Completion order is arbitrary.
+     */
+    template <typename Cb>
+    void flush(Cb && cb) noexcept {
+      const unsigned total = this->pending_;
+      unsigned reaped = 0;
+      while (reaped < total) {
+        const unsigned to_submit = *this->sq_tail_ - __atomic_load_n(this->sq_head_, __ATOMIC_ACQUIRE);
+        const long rc = ::syscall(
+          __NR_io_uring_enter, this->ring_fd_, to_submit, total - reaped, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (rc < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) [[unlikely]] {
+          this->fail_(cb);
+          return;
+        }
+        reaped += this->reap_(cb);
+      }
+      this->pending_ = 0;
+      this->arena_used_ = 0;
+    }
+
+    ~IoUringStat() noexcept {
+      if (this->broken_) {
+        return;  // requests may still be in flight: leak rather than free buffers the kernel can write
+      }
+      if (this->sqes_) {
+        munmap(this->sqes_, this->sqes_size_);
+      }
+      if (this->cq_ring_ && this->cq_ring_ != this->sq_ring_) {
+        munmap(this->cq_ring_, this->cq_ring_size_);
+      }
+      if (this->sq_ring_) {
+        munmap(this->sq_ring_, this->sq_ring_size_);
+      }
+      if (this->ring_fd_ >= 0) {
+        ::close(this->ring_fd_);
+      }
+      aligned_free(this->statx_);
+      std::free(this->paths_);
+    }
+
+   private:
+    IoUringStat() noexcept {
+      this->ready_ = this->setup_();
+      if (!this->ready_) [[unlikely]] {
+        unavailable_().store(true, std::memory_order_relaxed);
+      }
+    }
+
+    static std::atomic<bool> & unavailable_() noexcept {
+      static std::atomic<bool> v{false};
+      return v;
+    }
+
+    FSH_NO_INLINE bool setup_() noexcept {
+      this->statx_ = static_cast<struct statx *>(aligned_malloc(64, QUEUE_DEPTH * sizeof(struct statx)));
+      this->paths_ = static_cast<char *>(std::malloc(PATH_ARENA_SIZE));
+      if (!this->statx_ || !this->paths_) [[unlikely]] {
+        return false;
+      }
+
+      io_uring_params params;
+      memset(&params, 0, sizeof(params));
+      const long fd = ::syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params);
+      if (fd < 0) {
+        return false;  // ENOSYS, EPERM (io_uring_disabled / seccomp), ENOMEM (memlock)
+      }
+      this->ring_fd_ = static_cast<int>(fd);
+
+      this->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      this->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (single && this->cq_ring_size_ > this->sq_ring_size_) {
+        this->sq_ring_size_ = this->cq_ring_size_;
+      }
+      void * sq = mmap(nullptr, this->sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        this->ring_fd_, IORING_OFF_SQ_RING);
+      if (sq == MAP_FAILED) [[unlikely]] {
+        return false;
+      }
+      this->sq_ring_ = sq;
+      void * cq = sq;
+      if (!single) {
+        cq = mmap(nullptr, this->cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+          this->ring_fd_, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) [[unlikely]] {
+          return false;
+        }
+      }
+      this->cq_ring_ = cq;
+      this->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+      void * sqes = mmap(nullptr, this->sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        this->ring_fd_, IORING_OFF_SQES);
+      if (sqes == MAP_FAILED) [[unlikely]] {
+        return false;
+      }
+      this->sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+      auto * sqb = static_cast<uint8_t *>(sq);
+      auto * cqb = static_cast<uint8_t *>(cq);
+      this->sq_head_ = reinterpret_cast<unsigned *>(sqb + params.sq_off.head);
+      this->sq_tail_ = reinterpret_cast<unsigned *>(sqb + params.sq_off.tail);
+      this->sq_mask_ = *reinterpret_cast<unsigned *>(sqb + params.sq_off.ring_mask);
+      this->sq_array_ = reinterpret_cast<unsigned *>(sqb + params.sq_off.array);
+      this->cq_head_ = reinterpret_cast<unsigned *>(cqb + params.cq_off.head);
+      this->cq_tail_ = reinterpret_cast<unsigned *>(cqb + params.cq_off.tail);
+      this->cq_mask_ = *reinterpret_cast<unsigned *>(cqb + params.cq_off.ring_mask);
+      this->cqes_ = reinterpret_cast<io_uring_cqe *>(cqb + params.cq_off.cqes);
+      return params.sq_entries >= QUEUE_DEPTH;
+    }
+
+    /** Drain the completion ring. Returns the number of completions handled. */
+    template <typename Cb>
+    unsigned reap_(Cb & cb) noexcept {
+      unsigned head = *this->cq_head_;
+      const unsigned tail = __atomic_load_n(this->cq_tail_, __ATOMIC_ACQUIRE);
+      unsigned n = 0;
+      for (; head != tail; ++head, ++n) {
+        const io_uring_cqe & cqe = this->cqes_[head & this->cq_mask_];
+        const unsigned slot = static_cast<unsigned>(cqe.user_data);
+        const struct statx * stx = nullptr;
+        if (cqe.res == 0) [[likely]] {
+          if ((this->statx_[slot].stx_mask & STATX_FIELDS) == STATX_FIELDS) [[likely]] {
+            stx = &this->statx_[slot];
+          }
+        } else if (cqe.res == -EINVAL) {
+          unavailable_().store(true, std::memory_order_relaxed);  // kernel without IORING_OP_STATX
+        }
+        this->done_[slot] = true;
+        cb(this->tags_[slot], stx);
+      }
+      __atomic_store_n(this->cq_head_, head, __ATOMIC_RELEASE);
+      return n;
+    }
+
+    /** io_uring_enter failed for good: report every outstanding tag as failed and retire the ring. */
+    template <typename Cb>
+    FSH_NO_INLINE void fail_(Cb & cb) noexcept {
+      this->broken_ = true;
+      unavailable_().store(true, std::memory_order_relaxed);
+      this->reap_(cb);
+      for (unsigned s = 0; s < this->pending_; ++s) {
+        if (!this->done_[s]) {
+          cb(this->tags_[s], nullptr);
+        }
+      }
+      this->pending_ = 0;
+      this->arena_used_ = 0;
+    }
+
+    int ring_fd_ = -1;
+    bool ready_ = false;
+    bool broken_ = false;
+    unsigned pending_ = 0;
+    size_t arena_used_ = 0;
+
+    void * sq_ring_ = nullptr;
+    void * cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe * sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned * sq_head_ = nullptr;
+    unsigned * sq_tail_ = nullptr;
+    unsigned * sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned * cq_head_ = nullptr;
+    unsigned * cq_tail_ = nullptr;
+    io_uring_cqe * cqes_ = nullptr;
+    unsigned cq_mask_ = 0;
+
+    struct statx * statx_ = nullptr;
+    char * paths_ = nullptr;
+    uint32_t tags_[QUEUE_DEPTH];
+    bool done_[QUEUE_DEPTH];
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
+
+#endif
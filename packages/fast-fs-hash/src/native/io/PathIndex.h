@@ -3,24 +3,37 @@
 
 #include "includes.h"
 
+#include <algorithm>
+#include <bit>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#  include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#  include <arm_neon.h>
+#endif
+
+FSH_FORCE_INLINE bool is_path_sep(uint8_t c) noexcept { return c == '/' || c == '\\'; }
+
+/** Absolute path ('/' or '\\' first) or Windows drive letter ("C:") — the
+ *  checks of is_unsafe_relative_path that look only at a segment's start. */
+FSH_FORCE_INLINE bool is_unsafe_path_start(const uint8_t * seg, size_t len) noexcept {
+  return len > 0 && (is_path_sep(seg[0]) || (len >= 2 && seg[1] == ':'));
+}
+
 /**
  * Check whether a relative path segment is unsafe.
  *
  * Detects directory traversal, absolute paths, and embedded NUL bytes.
- * Mirrors the JS `isUnsafeRelativePath()` in path-utils.ts.
+ * Mirrors the JS `isUnsafeRelativePath()` in path-utils.ts. This is the
+ * scalar reference; packed_paths_safe and PathIndex<true> validate whole
+ * path regions with scan_path_bytes instead, and must agree with it.
  */
 FSH_FORCE_INLINE bool is_unsafe_relative_path(const uint8_t * seg, size_t len) noexcept {
   if (len == 0) {
     return false;
   }
 
-  // Absolute paths: leading '/' or '\'
-  if (seg[0] == '/' || seg[0] == '\\') {
-    return true;
-  }
-
-  // Windows drive letter (e.g. "C:")
-  if (len >= 2 && seg[1] == ':') {
+  if (is_unsafe_path_start(seg, len)) {
     return true;
   }
 
@@ -58,6 +71,126 @@ FSH_FORCE_INLINE bool is_unsafe_relative_path(const uint8_t * seg, size_t len) n
   return false;
 }
 
+/**
+ * Vector scan of a path region: calls `onDotDot(i)` for every i where
+ * p[i] and p[i + 1] are both '.', in increasing order, and stops with
+ * false as soon as it returns false. With `RejectNul` any NUL byte fails
+ * the scan too. Real paths contain few ".." pairs, so the callback — which
+ * decides from segment boundaries whether the pair is a ".." component —
+ * runs rarely, and the scan costs about one compare per byte per lane.
+ * AVX2 / SSE2 / NEON is picked at compile time (the x64 builds are per-ISA).
+ */
+template <bool RejectNul, typename OnDotDot>
+inline bool scan_path_bytes(const uint8_t * p, size_t len, OnDotDot && onDotDot) noexcept {
+  size_t i = 0;
+#if defined(__AVX2__)
+  constexpr size_t W = 32;
+  const __m256i dot = _mm256_set1_epi8('.');
+  const __m256i zero = _mm256_setzero_si256();
+  for (; i + W < len; i += W) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i + 1));
+    const __m256i dd = _mm256_and_si256(_mm256_cmpeq_epi8(a, dot), _mm256_cmpeq_epi8(b, dot));
+    if constexpr (RejectNul) {
+      if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero)) != 0) {
+        return false;
+      }
+    }
+    for (uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(dd)); m != 0; m &= m - 1) {
+      if (!onDotDot(i + static_cast<size_t>(std::countr_zero(m)))) {
+        return false;
+      }
+    }
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  constexpr size_t W = 16;
+  const __m128i dot = _mm_set1_epi8('.');
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + W < len; i += W) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 1));
+    const __m128i dd = _mm_and_si128(_mm_cmpeq_epi8(a, dot), _mm_cmpeq_epi8(b, dot));
+    if constexpr (RejectNul) {
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) != 0) {
+        return false;
+      }
+    }
+    for (uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(dd)); m != 0; m &= m - 1) {
+      if (!onDotDot(i + static_cast<size_t>(std::countr_zero(m)))) {
+        return false;
+      }
+    }
+  }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  constexpr size_t W = 16;
+  const uint8x16_t dot = vdupq_n_u8('.');
+  for (; i + W < len; i += W) {
+    const uint8x16_t a = vld1q_u8(p + i);
+    const uint8x16_t b = vld1q_u8(p + i + 1);
+    const uint8x16_t dd = vandq_u8(vceqq_u8(a, dot), vceqq_u8(b, dot));
+    if constexpr (RejectNul) {
+      if (vmaxvq_u8(vceqzq_u8(a)) != 0) {
+        return false;
+      }
+    }
+    // Narrow to 4 bits per byte: bit 4j of the u64 is lane j.
+    uint64_t m = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(dd), 4)), 0);
+    for (m &= 0x1111111111111111ull; m != 0; m &= m - 1) {
+      if (!onDotDot(i + static_cast<size_t>(std::countr_zero(m)) / 4)) {
+        return false;
+      }
+    }
+  }
+#endif
+  for (; i < len; ++i) {
+    if constexpr (RejectNul) {
+      if (p[i] == 0) {
+        return false;
+      }
+    }
+    if (p[i] == '.' && i + 1 < len && p[i + 1] == '.' && !onDotDot(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Whether the ".." at seg[i], i + 1 < len, is a whole path component. */
+FSH_FORCE_INLINE bool is_dotdot_component(const uint8_t * seg, size_t len, size_t i) noexcept {
+  return (i == 0 || is_path_sep(seg[i - 1])) && (i + 2 == len || is_path_sep(seg[i + 2]));
+}
+
+/**
+ * Validate packed paths: `n` non-empty segments of `paths` ending at the
+ * non-decreasing offsets `ends` (≤ pathsLen), none unsafe by
+ * is_unsafe_relative_path, and no NUL anywhere in the pathsLen bytes.
+ * One pass over the ends for the per-segment checks, one vector scan of
+ * the bytes for NULs and ".." components.
+ */
+inline bool packed_paths_safe(const uint8_t * paths, uint32_t pathsLen, const uint32_t * ends, uint32_t n) noexcept {
+  uint32_t prevEnd = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const uint32_t end = ends[i];
+    if (end <= prevEnd || end > pathsLen || is_unsafe_path_start(paths + prevEnd, end - prevEnd)) {
+      return false;
+    }
+    prevEnd = end;
+  }
+  // Candidates arrive in increasing order, so each segment lookup resumes
+  // from the previous one.
+  const uint32_t * seg = ends;
+  const uint32_t * const segEnd = ends + n;
+  return scan_path_bytes<true>(paths, pathsLen, [&](size_t i) noexcept {
+    seg = std::upper_bound(seg, segEnd, static_cast<uint32_t>(i));
+    if (seg == segEnd) {
+      return true;  // past the last segment
+    }
+    const size_t start = seg == ends ? 0 : seg[-1];
+    const size_t segLen = *seg - start;
+    return i + 1 - start >= segLen || !is_dotdot_component(paths + start, segLen, i - start);
+  });
+}
+
 /**
  * Pre-computed path pointers into a null-separated buffer.
  * Skips the last segment if it lacks a trailing \0.
@@ -140,6 +273,7 @@ struct PathIndex : NonCopyable {
     const char ** dst = this->segments;
     const char ** const dstEnd = this->segments + n;
     size_t maxLen = 0;
+    [[maybe_unused]] const uint8_t * indexedEnd = buf;
     for (const uint8_t * p = buf; p < end && dst < dstEnd;) {
       const uint8_t * nul = static_cast<const uint8_t *>(memchr(p, 0, static_cast<size_t>(end - p)));
       if (!nul) {
@@ -150,17 +284,30 @@ struct PathIndex : NonCopyable {
       if (segLen > maxLen) {
         maxLen = segLen;
       }
-      // Validate path safety during the same pass (compile-time branch).
+      // Start-of-segment checks during the same pass (compile-time branch);
+      // ".." components are found by one scan of the indexed bytes below.
       if constexpr (ValidatePaths) {
-        if (!this->has_unsafe_ && is_unsafe_relative_path(p, segLen)) {
+        if (is_unsafe_path_start(p, segLen)) {
           this->has_unsafe_ = true;
         }
       }
       p = nul + 1;
+      indexedEnd = p;
     }
     this->count = static_cast<size_t>(dst - this->segments);
     this->max_seg_len = maxLen;
     this->segments[this->count] = nullptr;  // sentinel
+
+    if constexpr (ValidatePaths) {
+      if (!this->has_unsafe_) {
+        // The indexed bytes end on the last segment's NUL; NULs bound segments.
+        this->has_unsafe_ = !scan_path_bytes<false>(buf, static_cast<size_t>(indexedEnd - buf), [buf](size_t i) noexcept {
+          const bool startsComponent = i == 0 || buf[i - 1] == 0 || is_path_sep(buf[i - 1]);
+          const uint8_t next = buf[i + 2];  // in range: the scanned bytes end on a NUL
+          return !(startsComponent && (next == 0 || is_path_sep(next)));
+        });
+      }
+    }
   }
 
   inline ~PathIndex() { free(this->segments); }
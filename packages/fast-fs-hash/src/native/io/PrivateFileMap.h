@@ -0,0 +1,156 @@
+#ifndef _FAST_FS_HASH_PRIVATE_FILE_MAP_H
+#define _FAST_FS_HASH_PRIVATE_FILE_MAP_H
+
+#include "../includes.h"
+
+#ifdef __linux__
+#  include <sys/mman.h>
+#endif
+
+namespace fast_fs_hash {
+
+  /**
+   * Writable MAP_PRIVATE mapping of a whole file, shared by the locked-file
+   * holder and the JS Buffer that exposes it.
+   *
+   * Pages are read from the page cache on first touch and copied on first
+   * write, so a cache file can be validated without reading the parts the
+   * stat-match never looks at. The catch: the mapping stays tied to the
+   * file. Once the lock is released another writer may rewrite or truncate
+   * it, and truncation zaps even the copied-on-write pages (SIGBUS on the
+   * next access). The lock holder therefore calls release_lock() before it
+   * releases the lock, which moves the contents into anonymous memory at the
+   * same address (copy + mremap) so every view into the Buffer stays valid.
+   *
+   * That copy is the whole file, so mapping lowers the time until open()
+   * reports a status but not the total cost: on a warm page cache, an 80 MiB
+   * body takes ~30 ms to stat-match through the mapping plus ~48 ms to
+   * detach, against ~57 ms for read-then-match. Hence opt-in. The detach
+   * always runs on a pool thread: CacheWriter's own, or a task queued by
+   * AddonData::closeHeldFile that closes the file afterwards. Env teardown
+   * skips it, since no JS can touch the Buffer again.
+   *
+   * Refcounted: one reference for the Buffer finalizer, one for the lock
+   * holder. The last release() unmaps, so a finalizer that runs during a
+   * detach only drops its reference.
+   */
+  class PrivateFileMap : NonCopyable {
+   public:
+    /**
+     * Smallest file to map, in bytes; 0 (the default) disables mapping.
+     * Read once from FAST_FS_HASH_MMAP_MIN (bytes, optional k/m suffix).
+     * Linux only (detach needs mremap); always 0 elsewhere.
+     */
+    static size_t min_size() noexcept {
+#ifdef __linux__
+      static const size_t v = [] {
+        const char * env = std::getenv("FAST_FS_HASH_MMAP_MIN");
+        if (!env || env[0] == '\0') {
+          return size_t{0};
+        }
+        char * end = nullptr;
+        unsigned long long val = std::strtoull(env, &end, 10);
+        if (end == env) {
+          return size_t{0};
+        }
+        if (*end == 'k' || *end == 'K') {
+          val = val > (1ull << 40) ? (1ull << 50) : val * 1024;
+        } else if (*end == 'm' || *end == 'M') {
+          val = val > (1ull << 30) ? (1ull << 50) : val * 1024 * 1024;
+        }
+        return static_cast<size_t>(val);
+      }();
+      return v;
+#else
+      return 0;
+#endif
+    }
+
+    /** Map the first `len` bytes of `fd`, or nullptr (mapping off, too small, mmap failed). */
+    static PrivateFileMap * map(int fd, size_t len) noexcept {
+#ifdef __linux__
+      const size_t minLen = min_size();
+      if (minLen == 0 || len < minLen) {
+        return nullptr;
+      }
+      void * p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) [[unlikely]] {
+        return nullptr;
+      }
+      auto * m = new (std::nothrow) PrivateFileMap(static_cast<uint8_t *>(p), len);
+      if (!m) [[unlikely]] {
+        munmap(p, len);
+        return nullptr;
+      }
+      return m;
+#else
+      (void)fd;
+      (void)len;
+      return nullptr;
+#endif
+    }
+
+    FSH_FORCE_INLINE uint8_t * data() const noexcept { return this->data_; }
+    FSH_FORCE_INLINE size_t size() const noexcept { return this->len_; }
+
+    FSH_FORCE_INLINE void retain() noexcept { this->refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    /** Drop one reference; the last one unmaps and deletes. */
+    void release() noexcept {
+      if (this->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+      }
+    }
+
+    /** Whether the Buffer still uses a file-backed mapping, so release_lock() would copy. */
+    FSH_FORCE_INLINE bool needs_detach() const noexcept {
+      return !this->detached_ && this->refs_.load(std::memory_order_acquire) > 1;
+    }
+
+    /** The lock is about to be released: detach if the Buffer is still alive, then drop our reference. */
+    void release_lock() noexcept {
+      if (this->refs_.load(std::memory_order_acquire) > 1) {
+        this->detach();
+      }
+      this->release();
+    }
+
+    /** Move the contents into anonymous memory at the same address. Idempotent.
+     *  Best effort: if the anonymous copy can't be allocated the mapping stays file-backed. */
+    void detach() noexcept {
+      if (this->detached_) {
+        return;
+      }
+#ifdef __linux__
+      void * q = mmap(nullptr, this->len_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (q == MAP_FAILED) [[unlikely]] {
+        return;
+      }
+      memcpy(q, this->data_, this->len_);
+      // Atomically replaces the file pages; no window where data_ is unmapped.
+      if (mremap(q, this->len_, this->len_, MREMAP_MAYMOVE | MREMAP_FIXED, this->data_) == MAP_FAILED) [[unlikely]] {
+        munmap(q, this->len_);
+        return;
+      }
+#endif
+      this->detached_ = true;
+    }
+
+   private:
+    uint8_t * data_;
+    size_t len_;
+    std::atomic<uint32_t> refs_{1};
+    bool detached_ = false;
+
+    PrivateFileMap(uint8_t * data, size_t len) noexcept : data_(data), len_(len) {}
+
+    ~PrivateFileMap() noexcept {
+#ifdef __linux__
+      munmap(this->data_, this->len_);
+#endif
+    }
+  };
+
+}  // namespace fast_fs_hash
+
+#endif
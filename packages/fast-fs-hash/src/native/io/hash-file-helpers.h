@@ -2,20 +2,23 @@
  * hash-file-helpers.h — Shared file hashing helpers for PathResolver.
  *
  * Extracted from FfshFilePosix.h / FfshFileWin32.h to avoid duplication.
- * Depends on FfshFile (platform-specific) and Hash128 — must be included
- * inside namespace fast_fs_hash, after FfshFile is defined.
+ * Depends on FfshFile (platform-specific), Hash128, HashMemo, OwnedBuf,
+ * ReadScratch and poolParallelFor — must be included inside namespace
+ * fast_fs_hash, after FfshFile is defined.
  */
 
 #ifndef _FAST_FS_HASH_HASH_FILE_HELPERS_H
 #define _FAST_FS_HASH_HASH_FILE_HELPERS_H
 
 /** Large-file streaming hash — cold path, kept out-of-line to avoid
- *  putting the 576-byte XXH3_state_t on every caller's stack frame. */
-static FSH_NO_INLINE void hash_large_file(
+ *  putting the 576-byte XXH3_state_t on every caller's stack frame.
+ *  Returns the total bytes hashed, including initial_bytes. */
+static FSH_NO_INLINE uint64_t hash_large_file(
   FfshFile & rf, Hash128 & dest, unsigned char * rbuf, size_t initial_bytes, size_t rbs) noexcept {
   XXH3_state_t state;
   XXH3_128bits_reset(&state);
   XXH3_128bits_update(&state, rbuf, initial_bytes);
+  uint64_t total = initial_bytes;
   for (;;) {
     const int64_t nr = rf.read(rbuf, rbs);
     if (nr <= 0) [[unlikely]] {
@@ -24,15 +27,143 @@ static FSH_NO_INLINE void hash_large_file(
       } else {
         dest.set_zero();
       }
-      return;
+      return total;
     }
     XXH3_128bits_update(&state, rbuf, static_cast<size_t>(nr));
+    total += static_cast<uint64_t>(nr);
+  }
+}
+
+/** Chunk size of chunk-tree hashing. */
+static constexpr size_t CHUNK_TREE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+/** Files at least this large are hashed as chunk trees when the mode is on. */
+static constexpr int64_t CHUNK_TREE_MIN_FILE_SIZE = 16 * 1024 * 1024;
+
+// A file that qualifies always fills the first read, so the choice never
+// depends on the read buffer size.
+static_assert(CHUNK_TREE_MIN_FILE_SIZE >= static_cast<int64_t>(MAX_READ_BUFFER_SIZE));
+
+/** Pool threads that may help hash one large file's chunks. Cache workers
+ *  only: the digest functions pass no tree, so their digests stay plain XXH3. */
+struct ChunkTreeHashing {
+  ThreadPool * pool;
+  int helpers;
+};
+
+/**
+ * Chunk-tree hash of a file of `fileSize` bytes: leaf i is the XXH3-128
+ * (seed i) of the i-th CHUNK_TREE_CHUNK_SIZE bytes, and the digest is the
+ * XXH3-128 (seed fileSize) of the canonical leaves in order. Leaves are
+ * read with pread and hashed on the calling thread plus `tree.helpers`
+ * pool threads; the calling thread reads into `rbuf`. Gives a zero hash
+ * on a read error or if the file shrinks while it is read.
+ */
+static FSH_NO_INLINE void hash_chunk_tree(
+  FfshFile & rf, Hash128 & dest, unsigned char * rbuf, size_t rbs, int64_t fileSize,
+  const ChunkTreeHashing & tree) noexcept {
+  const uint64_t size = static_cast<uint64_t>(fileSize);
+  const auto chunks = static_cast<uint32_t>((size + CHUNK_TREE_CHUNK_SIZE - 1) / CHUNK_TREE_CHUNK_SIZE);
+  const std::thread::id caller = std::this_thread::get_id();
+  std::atomic<bool> failed{false};
+
+  const auto leafOf = [&](uint32_t i, unsigned char * buf, size_t bufSize) noexcept -> XXH128_hash_t {
+    const uint64_t start = static_cast<uint64_t>(i) * CHUNK_TREE_CHUNK_SIZE;
+    const uint64_t end = size - start < CHUNK_TREE_CHUNK_SIZE ? size : start + CHUNK_TREE_CHUNK_SIZE;
+    XXH3_state_t state;
+    XXH3_128bits_reset_withSeed(&state, i);
+    for (uint64_t off = start; off < end;) {
+      const size_t want = end - off < bufSize ? static_cast<size_t>(end - off) : bufSize;
+      const int64_t nr = rf.pread_at_most(buf, want, static_cast<size_t>(off));
+      if (nr != static_cast<int64_t>(want)) [[unlikely]] {
+        failed.store(true, std::memory_order_relaxed);
+        break;
+      }
+      XXH3_128bits_update(&state, buf, want);
+      off += want;
+    }
+    return XXH3_128bits_digest(&state);
+  };
+
+  OwnedBuf<> leavesBuf = OwnedBuf<>::alloc(static_cast<size_t>(chunks) * sizeof(Hash128));
+  if (leavesBuf) [[likely]] {
+    auto * const leaves = reinterpret_cast<Hash128 *>(leavesBuf.ptr);
+    poolParallelFor(*tree.pool, chunks, tree.helpers, [&](uint32_t i) {
+      if (failed.load(std::memory_order_relaxed)) {
+        return;
+      }
+      if (std::this_thread::get_id() == caller) {
+        leaves[i].from_xxh128_canonical(leafOf(i, rbuf, rbs));
+      } else {
+        ReadScratch scratch;
+        if (!scratch) [[unlikely]] {
+          failed.store(true, std::memory_order_relaxed);
+          return;
+        }
+        leaves[i].from_xxh128_canonical(leafOf(i, scratch.data, scratch.size));
+      }
+    });
+    if (!failed.load(std::memory_order_relaxed)) [[likely]] {
+      dest.from_xxh128(XXH3_128bits_withSeed(leaves, static_cast<size_t>(chunks) * sizeof(Hash128), size));
+      return;
+    }
+  } else {
+    // Same digest, one leaf at a time on this thread.
+    XXH3_state_t root;
+    XXH3_128bits_reset_withSeed(&root, size);
+    for (uint32_t i = 0; i < chunks && !failed.load(std::memory_order_relaxed); ++i) {
+      Hash128 leaf;
+      leaf.from_xxh128_canonical(leafOf(i, rbuf, rbs));
+      XXH3_128bits_update(&root, &leaf, sizeof(Hash128));
+    }
+    if (!failed.load(std::memory_order_relaxed)) [[likely]] {
+      dest.from_xxh128(XXH3_128bits_digest(&root));
+      return;
+    }
+  }
+  dest.set_zero();
+}
+
+/**
+ * Hash an already-open file whose first read filled all `rbs` bytes of
+ * rbuf. Looks the file's identity up in the process-wide HashMemo first,
+ * and memoizes the result when the identity is the same after hashing and
+ * settled before it started (HashMemo::settled). Returns the bytes read
+ * from the file.
+ */
+static FSH_NO_INLINE uint64_t hash_large_open_file(
+  FfshFile & rf, Hash128 & dest, unsigned char * rbuf, size_t rbs, const ChunkTreeHashing * tree) noexcept {
+  const bool memo = HashMemo::enabled();
+  FileIdentity id;
+  if (!(memo || tree) || !rf.identity(id)) {
+    return hash_large_file(rf, dest, rbuf, rbs, rbs);
+  }
+  const bool chunked = tree && id.size >= static_cast<uint64_t>(CHUNK_TREE_MIN_FILE_SIZE);
+  const uint8_t mode = chunked ? HashMemo::MODE_CHUNK_TREE : HashMemo::MODE_STREAM;
+  if (memo && HashMemo::instance().find(id, mode, dest)) {
+    return rbs;
+  }
+  const uint64_t startNs = memo ? HashMemo::now_ns() : 0;
+  uint64_t bytes;
+  if (chunked) {
+    hash_chunk_tree(rf, dest, rbuf, rbs, static_cast<int64_t>(id.size), *tree);
+    bytes = id.size;
+  } else {
+    bytes = hash_large_file(rf, dest, rbuf, rbs, rbs);
+  }
+  // A write while the file was read moves its ctime: keep only stable results.
+  FileIdentity after;
+  if (memo && !dest.is_zero() && HashMemo::settled(id, startNs) && rf.identity(after) && after == id) {
+    HashMemo::instance().store(id, mode, dest);
   }
+  return bytes;
 }
 
 /** Hash an already-open file. Small files (< rbs) are hashed in one shot;
- *  large files fall through to the out-of-line streaming path. */
-static FSH_FORCE_INLINE void hash_open_file(FfshFile & rf, Hash128 & dest, unsigned char * rbuf, size_t rbs) noexcept {
+ *  large files fall through to the out-of-line memoized path, which picks
+ *  the chunk tree when `tree` is set and the file is big enough. */
+static FSH_FORCE_INLINE void hash_open_file(
+  FfshFile & rf, Hash128 & dest, unsigned char * rbuf, size_t rbs, const ChunkTreeHashing * tree = nullptr) noexcept {
   const int64_t n = rf.read_at_most(rbuf, rbs);
   if (n < 0) [[unlikely]] {
     dest.set_zero();
@@ -43,7 +174,7 @@ static FSH_FORCE_INLINE void hash_open_file(FfshFile & rf, Hash128 & dest, unsig
     dest.from_xxh128(XXH3_128bits(rbuf, bytes));
     return;
   }
-  hash_large_file(rf, dest, rbuf, rbs, rbs);
+  hash_large_open_file(rf, dest, rbuf, rbs, tree);
 }
 
 #endif
@@ -368,7 +368,7 @@ namespace lz4_functions {
     uint8_t * outBuf_ = nullptr;
   };
 
-  /** lz4CompressBlockAsync(input, offset?, length?) → Promise<Buffer> */
+  /** lz4CompressBlockAsync(input, offset?, length?, priority?) → Promise<Buffer> */
   static Napi::Value lz4CompressBlockAsync(const Napi::CallbackInfo & info) {
     auto env = info.Env();
     auto input = info[0].As<Napi::Uint8Array>();
@@ -381,11 +381,12 @@ namespace lz4_functions {
 
     auto deferred = Napi::Promise::Deferred::New(env);
     auto * worker = new Lz4CompressWorker(env, deferred, Napi::ObjectReference::New(input, 1), src, srcLen);
-    worker->Queue();
+    worker->Queue(fast_fs_hash::readTaskPriority(info, 3));
     return deferred.Promise();
   }
 
-  /** lz4DecompressBlockAsync(input, uncompressedSize, offset?, length?) → Promise<Buffer> */
+  /** lz4DecompressBlockAsync(input, uncompressedSize, offset?, length?, priority?) → Promise<Buffer>
+   *  Interactive outputs up to inlineMaxBytes() decompress inline. */
   static Napi::Value lz4DecompressBlockAsync(const Napi::CallbackInfo & info) {
     auto env = info.Env();
     auto input = info[0].As<Napi::Uint8Array>();
@@ -406,21 +407,21 @@ namespace lz4_functions {
 
     auto deferred = Napi::Promise::Deferred::New(env);
     auto * worker = new Lz4DecompressWorker(env, deferred, Napi::ObjectReference::New(input, 1), src, srcLen, uncompSize);
-    worker->Queue();
+    worker->QueueAdaptive(uncompSize, fast_fs_hash::inlineMaxBytes(), fast_fs_hash::readTaskPriority(info, 4));
     return deferred.Promise();
   }
 
-  /** lz4CompressFile(path) → Promise<{ data: Buffer, uncompressedSize: number }> */
+  /** lz4CompressFile(path, priority?) → Promise<{ data: Buffer, uncompressedSize: number }> */
   static Napi::Value lz4CompressFile(const Napi::CallbackInfo & info) {
     auto env = info.Env();
     auto deferred = Napi::Promise::Deferred::New(env);
     auto * worker =
       new fast_fs_hash::Lz4CompressFileWorker(env, deferred, info[0].As<Napi::String>().Utf8Value());
-    worker->Queue();
+    worker->Queue(fast_fs_hash::readTaskPriority(info, 1));
     return deferred.Promise();
   }
 
-  /** lz4DecompressAndWrite(compressedData, uncompressedSize, path) → Promise<true> */
+  /** lz4DecompressAndWrite(compressedData, uncompressedSize, path, priority?) → Promise<true> */
   static Napi::Value lz4DecompressAndWrite(const Napi::CallbackInfo & info) {
     auto env = info.Env();
     auto input = info[0].As<Napi::Uint8Array>();
@@ -437,7 +438,7 @@ namespace lz4_functions {
       input.ElementLength(),
       uncompSize,
       Napi::ObjectReference::New(input, 1));
-    worker->Queue();
+    worker->Queue(fast_fs_hash::readTaskPriority(info, 3));
     return deferred.Promise();
   }
 
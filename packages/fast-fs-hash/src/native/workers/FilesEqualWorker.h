@@ -5,8 +5,8 @@
  * both files in lockstep chunks and memcmps. Returns false if either file
  * cannot be opened/read or if sizes differ.
  *
- * Uses two half-buffers (64 KiB each) from the stack-allocated read buffer
- * to avoid any heap allocation on the hot path.
+ * Uses two halves of the pool thread's ReadScratch buffer to avoid any
+ * per-call heap allocation on the hot path.
  */
 
 #ifndef _FAST_FS_HASH_FILES_EQUAL_WORKER_H
@@ -15,6 +15,7 @@
 #include "includes.h"
 #include "FfshFile.h"
 #include "AddonWorker.h"
+#include "ScratchArena.h"
 
 namespace fast_fs_hash {
 
@@ -23,43 +24,67 @@ namespace fast_fs_hash {
     FilesEqualWorker(Napi::Env env, Napi::Promise::Deferred deferred, std::string pathA, std::string pathB) :
       AddonWorker(env, deferred), pathA_(std::move(pathA)), pathB_(std::move(pathB)) {}
 
-    static_assert(
-      READ_BUFFER_SIZE <= ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
-      "read buffer exceeds pool thread usable stack");
+    /** Hand over the files the JS thread opened for its inline size check.
+     *  An invalid handle means that open failed. */
+    void setFiles(FfshFile && a, FfshFile && b) {
+      this->fileA_ = std::move(a);
+      this->fileB_ = std::move(b);
+      this->preopened_ = true;
+    }
+
+    const std::string & pathA() const noexcept { return this->pathA_; }
+    const std::string & pathB() const noexcept { return this->pathB_; }
+
+    /** Predicts whether the next filesEqual() is cheap enough to run inline. */
+    static InlineFileGate & inlineGate() noexcept {
+      static InlineFileGate gate;
+      return gate;
+    }
 
     void Execute() override {
+      ReadScratch scratch;
+      if (!scratch) [[unlikely]] {
+        this->signal("filesEqual: out of memory");
+        return;
+      }
+      const uint64_t start = InlineFileGate::now_ns();
+      uint64_t bytes = 0;
+      this->result_ = this->compare_(scratch, bytes);
+      inlineGate().record(bytes, InlineFileGate::now_ns() - start);
+      this->signal();
+    }
+
+    void OnOK() override { this->deferred.Resolve(Napi::Boolean::New(Napi::Env(this->env), this->result_)); }
+
+   private:
+    /** True when both files open and hold the same bytes. `bytes` counts what was read from each. */
+    bool compare_(const ReadScratch & scratch, uint64_t & bytes) noexcept {
       // Open both files
-      FfshFile fa(this->pathA_.c_str());
+      FfshFile fa = this->preopened_ ? std::move(this->fileA_) : FfshFile(this->pathA_.c_str());
       if (!fa) [[unlikely]] {
-        this->signal();
-        return;
+        return false;
       }
-      FfshFile fb(this->pathB_.c_str());
+      FfshFile fb = this->preopened_ ? std::move(this->fileB_) : FfshFile(this->pathB_.c_str());
       if (!fb) [[unlikely]] {
-        this->signal();
-        return;
+        return false;
       }
 
       // Compare sizes via fstat
       const int64_t sizeA = fa.fsize();
       const int64_t sizeB = fb.fsize();
       if (sizeA < 0 || sizeB < 0 || sizeA != sizeB) [[unlikely]] {
-        this->signal();
-        return;
+        return false;
       }
 
       // Both empty → equal
       if (sizeA == 0) [[unlikely]] {
-        this->result_ = true;
-        this->signal();
-        return;
+        return true;
       }
 
-      // Split the stack buffer into two halves for interleaved reading
-      alignas(64) uint8_t buf[READ_BUFFER_SIZE];
-      static constexpr size_t HALF = READ_BUFFER_SIZE / 2;
-      uint8_t * bufA = buf;
-      uint8_t * bufB = buf + HALF;
+      // Split the scratch buffer into two halves for interleaved reading
+      const size_t HALF = scratch.size / 2;
+      uint8_t * bufA = scratch.data;
+      uint8_t * bufB = scratch.data + HALF;
 
       int64_t remaining = sizeA;
       while (remaining > 0) {
@@ -67,33 +92,30 @@ namespace fast_fs_hash {
 
         const int64_t nA = fa.read_at_most(bufA, toRead);
         if (nA <= 0) [[unlikely]] {
-          this->signal();
-          return;
+          return false;
         }
 
         const int64_t nB = fb.read_at_most(bufB, static_cast<size_t>(nA));
+        bytes += static_cast<uint64_t>(nA);
         if (nB != nA) [[unlikely]] {
-          this->signal();
-          return;
+          return false;
         }
 
         if (memcmp(bufA, bufB, static_cast<size_t>(nA)) != 0) {
-          this->signal();
-          return;
+          return false;
         }
 
         remaining -= nA;
       }
 
-      this->result_ = true;
-      this->signal();
+      return true;
     }
 
-    void OnOK() override { this->deferred.Resolve(Napi::Boolean::New(Napi::Env(this->env), this->result_)); }
-
-   private:
     std::string pathA_;
     std::string pathB_;
+    FfshFile fileA_;
+    FfshFile fileB_;
+    bool preopened_ = false;
     bool result_ = false;
   };
 
@@ -3,7 +3,7 @@
  *
  * Supports:
  *  - Optional external output buffer (writes 16-byte digest at a given offset)
- *  - One-shot fast path for small files (< 128 KiB)
+ *  - One-shot fast path for files smaller than the read buffer
  */
 
 #ifndef _FAST_FS_HASH_HASH_FILE_WORKER_H
@@ -12,6 +12,7 @@
 #include "includes.h"
 #include "FfshFile.h"
 #include "AddonWorker.h"
+#include "ScratchArena.h"
 
 class HashFileWorker final : public fast_fs_hash::AddonWorker {
  public:
@@ -25,58 +26,92 @@ class HashFileWorker final : public fast_fs_hash::AddonWorker {
     this->has_external_ = true;
   }
 
-  static_assert(
-    fast_fs_hash::READ_BUFFER_SIZE <= fast_fs_hash::ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
-    "read buffer exceeds pool thread usable stack");
+  /** Hand over the file the JS thread opened for its inline size check. An
+   *  invalid handle means that open failed — Execute() reports it without retrying. */
+  void setFile(fast_fs_hash::FfshFile && file) {
+    this->file_ = std::move(file);
+    this->preopened_ = true;
+  }
+
+  const std::string & path() const noexcept { return this->path_; }
+
+  /** Predicts whether the next digestFileTo() is cheap enough to run inline. */
+  static fast_fs_hash::InlineFileGate & inlineGate() noexcept {
+    static fast_fs_hash::InlineFileGate gate;
+    return gate;
+  }
 
   void Execute() override {
-    fast_fs_hash::FfshFile fh(this->path_.c_str());
-    if (!fh) [[unlikely]] {
-      if (this->throw_on_error_) {
-        this->signal("hashFile: cannot open file");
-      } else {
-        this->signal();
-      }
+    fast_fs_hash::ReadScratch scratch;
+    if (!scratch) [[unlikely]] {
+      this->signal("hashFile: out of memory");
+      return;
+    }
+    const uint64_t start = fast_fs_hash::InlineFileGate::now_ns();
+    uint64_t bytes = 0;
+    const char * error = this->hash_(scratch, bytes);
+    inlineGate().record(bytes, fast_fs_hash::InlineFileGate::now_ns() - start);
+    if (error && this->throw_on_error_) [[unlikely]] {
+      this->signal(error);
       return;
     }
+    if (!error && this->has_external_) {
+      memcpy(this->output_data_, this->digest_, 16);
+    }
+    this->signal();
+  }
 
-    alignas(64) uint8_t rbuf[fast_fs_hash::READ_BUFFER_SIZE];
+  void OnOK() override {
+    auto env = Napi::Env(this->env);
+    Napi::HandleScope scope(env);
+    if (this->has_external_) {
+      // When not hashed (throwOnError=false, file error), zero the output.
+      if (!this->hashed_) {
+        memset(this->output_data_, 0, 16);
+      }
+      this->deferred.Resolve(this->output_ref_.Value());
+    } else {
+      this->deferred.Resolve(Napi::Buffer<uint8_t>::Copy(env, this->digest_, 16));
+    }
+  }
+
+ private:
+  /** Hash path_ into digest_. Returns the error message, or nullptr. `bytes` counts what was read. */
+  const char * hash_(const fast_fs_hash::ReadScratch & scratch, uint64_t & bytes) noexcept {
+    fast_fs_hash::FfshFile fh =
+      this->preopened_ ? std::move(this->file_) : fast_fs_hash::FfshFile(this->path_.c_str());
+    if (!fh) [[unlikely]] {
+      return "hashFile: cannot open file";
+    }
+
+    uint8_t * const rbuf = scratch.data;
 
     // Try one-shot for small files.
-    const int64_t n = fh.read_at_most(rbuf, fast_fs_hash::READ_BUFFER_SIZE);
+    const int64_t n = fh.read_at_most(rbuf, scratch.size);
     if (n < 0) [[unlikely]] {
-      if (this->throw_on_error_) {
-        this->signal("hashFile: read error");
-      } else {
-        this->signal();
-      }
-      return;
+      return "hashFile: read error";
     }
 
-    const size_t bytes = static_cast<size_t>(n);
-    if (bytes < fast_fs_hash::READ_BUFFER_SIZE) [[likely]] {
+    bytes = static_cast<uint64_t>(n);
+    if (static_cast<size_t>(n) < scratch.size) [[likely]] {
       // Entire file in one read — one-shot hash (fast path).
       XXH128_canonicalFromHash(
-        reinterpret_cast<XXH128_canonical_t *>(this->digest_), XXH3_128bits(rbuf, bytes));
+        reinterpret_cast<XXH128_canonical_t *>(this->digest_), XXH3_128bits(rbuf, static_cast<size_t>(n)));
     } else {
       // Large file — streaming.
       XXH3_state_t state;
       XXH3_128bits_reset(&state);
-      XXH3_128bits_update(&state, rbuf, bytes);
+      XXH3_128bits_update(&state, rbuf, static_cast<size_t>(n));
 
       for (;;) {
-        const int64_t n2 = fh.read(rbuf, fast_fs_hash::READ_BUFFER_SIZE);
+        const int64_t n2 = fh.read(rbuf, scratch.size);
         if (n2 <= 0) [[unlikely]] {
           if (n2 < 0) {
-            if (this->throw_on_error_) {
-              this->signal("hashFile: read error");
-            } else {
-              this->signal();
-            }
-            return;
+            return "hashFile: read error";
           }
           break;
         }
+        bytes += static_cast<uint64_t>(n2);
         XXH3_128bits_update(&state, rbuf, static_cast<size_t>(n2));
       }
 
@@ -84,32 +119,13 @@ class HashFileWorker final : public fast_fs_hash::AddonWorker {
     }
 
     this->hashed_ = true;
-
-    // Write to external output if provided.
-    if (this->has_external_) {
-      memcpy(this->output_data_, this->digest_, 16);
-    }
-
-    this->signal();
-  }
-
-  void OnOK() override {
-    auto env = Napi::Env(this->env);
-    Napi::HandleScope scope(env);
-    if (this->has_external_) {
-      // When not hashed (throwOnError=false, file error), zero the output.
-      if (!this->hashed_) {
-        memset(this->output_data_, 0, 16);
-      }
-      this->deferred.Resolve(this->output_ref_.Value());
-    } else {
-      this->deferred.Resolve(Napi::Buffer<uint8_t>::Copy(env, this->digest_, 16));
-    }
+    return nullptr;
   }
 
- private:
   std::string path_;
+  fast_fs_hash::FfshFile file_;
   bool throw_on_error_;
+  bool preopened_ = false;
   bool has_external_ = false;
   bool hashed_ = false;
   uint8_t * output_data_ = nullptr;
@@ -2,7 +2,8 @@
 #define _FAST_FS_HASH_HASH_FILES_WORKER_H
 
 #include "FfshFile.h"
-#include "ThreadPool.h"
+#include "ScratchArena.h"
+#include "ThreadTuner.h"
 
 #include <algorithm>
 
@@ -13,26 +14,21 @@ namespace fast_fs_hash {
   static constexpr size_t OUTPUT_ALIGNMENT = 64;
 
   /**
-   * Large-file streaming hash — cold path, kept out-of-line to minimize
-   * icache pressure in the hot single-read loop. The XXH3_state_t (576 B)
-   * lives only on this frame, not on the hot-path stack.
+   * Large-file hash — cold path, kept out-of-line to minimize icache
+   * pressure in the hot single-read loop. Goes through the process-wide
+   * HashMemo (hash_large_open_file) and writes the canonical digest.
+   * Always streams: these digests are the public XXH3-128 of the content, so
+   * chunk-tree hashing (a cache-only mode) never applies here.
+   * Returns the bytes read from the file, including the first rbuf_size.
    */
-  FSH_NO_INLINE inline void hashLargeFile(unsigned char * rbuf, size_t initial_bytes, FfshFile & file, uint8_t * dest) {
-    XXH3_state_t state;
-    XXH3_128bits_reset(&state);
-    XXH3_128bits_update(&state, rbuf, initial_bytes);
-    for (;;) {
-      const int64_t n = file.read(rbuf, READ_BUFFER_SIZE);
-      if (n <= 0) [[unlikely]] {
-        if (n == 0) [[likely]] {
-          XXH128_canonicalFromHash(reinterpret_cast<XXH128_canonical_t *>(dest), XXH3_128bits_digest(&state));
-        } else {
-          memset(dest, 0, 16);  // rare: read error mid-stream
-        }
-        return;
-      }
-      XXH3_128bits_update(&state, rbuf, static_cast<size_t>(n));
-    }
+  FSH_NO_INLINE inline uint64_t hashLargeFile(
+    unsigned char * rbuf, size_t rbuf_size, FfshFile & file, uint8_t * dest) noexcept {
+    Hash128 h;
+    const uint64_t total = hash_large_open_file(file, h, rbuf, rbuf_size, nullptr);
+    XXH128_hash_t raw;
+    memcpy(&raw, &h, sizeof(raw));
+    XXH128_canonicalFromHash(reinterpret_cast<XXH128_canonical_t *>(dest), raw);
+    return total;
   }
 
   /**
@@ -55,7 +51,8 @@ namespace fast_fs_hash {
   };
 
   /** Max threads for parallel file hashing. Measured optimal at ~10 threads
-   *  on M3/M4 (705 files, 23 MiB) — beyond that, filesystem contention dominates. */
+   *  on M3/M4 (705 files, 23 MiB) — beyond that, filesystem contention dominates.
+   *  Starting point for ThreadTuner (TuneOp::HASH_FILES) when autotuning is on. */
   static constexpr int MAX_HASH_THREADS = 10;
 
   /**
@@ -70,7 +67,7 @@ namespace fast_fs_hash {
     uint8_t * outputData = nullptr;
     size_t workBatch = 0;
     bool throwOnError = false;
-    const ThreadPool * pool_ = nullptr;
+    const std::atomic<bool> * stop_ = nullptr;
 
     void init(const char * const * segs, size_t count, uint8_t * output) noexcept {
       this->segments = segs;
@@ -78,16 +75,24 @@ namespace fast_fs_hash {
       this->outputData = output;
     }
 
-    struct Job : ForkJob<Job, MAX_HASH_THREADS> {
+    struct Job : ForkJob<Job, ThreadTuner::MAX_THREADS> {
       HashFilesWorker * owner;
       void (*onDone)(void *);
       void * onDoneArg;
 
       void forkWork() noexcept {
-        alignas(64) unsigned char rbuf[READ_BUFFER_SIZE];
-        this->owner->processFiles(rbuf);
+        ReadScratch rbuf;
+        if (!rbuf) [[unlikely]] {
+          return;  // threads that got a buffer claim this one's share
+        }
+        this->owner->hadScratch.store(true, std::memory_order_relaxed);
+        this->owner->processFiles(rbuf.data, rbuf.size);
       }
       void forkDone() noexcept {
+        HashFilesWorker * o = this->owner;
+        if (!o->stop_->load(std::memory_order_relaxed)) {
+          o->tuned_.finish();
+        }
         if (this->onDone) {
           this->onDone(this->onDoneArg);
         }
@@ -96,17 +101,26 @@ namespace fast_fs_hash {
 
     alignas(64) mutable std::atomic<size_t> nextIndex{0};
     mutable std::atomic<bool> hasError{false};
+    /** Set by every thread that got a read buffer. Still false when done: out of memory, nothing hashed. */
+    mutable std::atomic<bool> hadScratch{false};
+    mutable TunedRun tuned_;
 
     Job job_;
 
-    /** Launch parallel hashing on the given pool. Calls on_done when complete. */
-    void run(ThreadPool & pool, int concurrency, void (*on_done)(void *), void * done_arg) {
-      this->pool_ = &pool;
+    /** Launch parallel hashing on the given pool. Calls on_done when complete.
+     *  Threads stop claiming files once `stop` is set (owning env tearing down). */
+    void run(ThreadPool & pool, const std::atomic<bool> & stop, int concurrency, void (*on_done)(void *), void * done_arg) {
+      this->stop_ = &stop;
       this->job_.owner = this;
       this->job_.onDone = on_done;
       this->job_.onDoneArg = done_arg;
 
-      int tc = ThreadPool::compute_threads(concurrency, this->fileCount, MAX_HASH_THREADS, 4);
+      // An explicit concurrency is the caller's choice — only auto-sized calls are tuned.
+      const int cap = concurrency > 0
+        ? MAX_HASH_THREADS
+        : this->tuned_.begin(TuneOp::HASH_FILES, this->segments[0], this->fileCount, MAX_HASH_THREADS);
+
+      int tc = ThreadPool::compute_threads(concurrency, this->fileCount, cap, 4);
 
       const size_t batch = std::clamp(this->fileCount / static_cast<size_t>(tc * 4), size_t{1}, size_t{32});
 
@@ -122,24 +136,27 @@ namespace fast_fs_hash {
 
       this->workBatch = batch;
       this->nextIndex.store(0, std::memory_order_relaxed);
+      this->hadScratch.store(false, std::memory_order_relaxed);
 
+      this->tuned_.submitted(tc);
       pool.submit(this->job_, tc);
     }
 
-    /** Per-thread work loop. `rbuf_raw` is stack-allocated by the pool thread. */
-    FSH_FORCE_INLINE void processFiles(unsigned char * rbuf_raw) const {
+    /** Per-thread work loop. `rbuf_raw` is the pool thread's ReadScratch buffer. */
+    FSH_FORCE_INLINE void processFiles(unsigned char * rbuf_raw, size_t rbuf_size) const {
       unsigned char * FSH_RESTRICT const rbuf = assume_aligned<64>(rbuf_raw);
       const size_t fc = this->fileCount;
       const size_t wb = this->workBatch;
       uint8_t * FSH_RESTRICT const out = assume_aligned<OUTPUT_ALIGNMENT>(this->outputData);
       const char * const * FSH_RESTRICT const segs = this->segments;
       const bool toe = this->throwOnError;
-      const ThreadPool * pool = this->pool_;
+      const std::atomic<bool> * stop = this->stop_;
 
       FileOpener opener;
+      uint64_t readTotal = 0;
 
       for (;;) {
-        if (pool->is_shutdown()) [[unlikely]] {
+        if (stop->load(std::memory_order_relaxed)) [[unlikely]] {
           break;
         }
         const size_t base = this->nextIndex.fetch_add(wb, std::memory_order_relaxed);
@@ -173,7 +190,7 @@ namespace fast_fs_hash {
             continue;
           }
 
-          const int64_t n = file.read_at_most(rbuf, READ_BUFFER_SIZE);
+          const int64_t n = file.read_at_most(rbuf, rbuf_size);
           if (n < 0) [[unlikely]] {
             memset(dest, 0, 16);
             if (toe) {
@@ -183,14 +200,17 @@ namespace fast_fs_hash {
           }
 
           const size_t bytes = static_cast<size_t>(n);
-          if (bytes < READ_BUFFER_SIZE) [[likely]] {
+          if (bytes < rbuf_size) [[likely]] {
             XXH128_canonicalFromHash(reinterpret_cast<XXH128_canonical_t *>(dest), XXH3_128bits(rbuf, bytes));
+            readTotal += bytes;
             continue;
           }
 
-          hashLargeFile(rbuf, READ_BUFFER_SIZE, file, dest);
+          readTotal += hashLargeFile(rbuf, rbuf_size, file, dest);
         }
       }
+
+      this->tuned_.bytes.fetch_add(readTotal, std::memory_order_relaxed);
     }
   };
 
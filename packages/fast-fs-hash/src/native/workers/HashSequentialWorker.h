@@ -2,10 +2,10 @@
 #define _FAST_FS_HASH_HASH_SEQUENTIAL_WORKER_H
 
 #include "includes.h"
-#include "AlignedPtr.h"
 #include "PathIndex.h"
 #include "FfshFile.h"
 #include "AddonWorker.h"
+#include "ScratchArena.h"
 
 /**
  * Async worker for sequential file hashing on the pool thread.
@@ -90,7 +90,7 @@ class HashSequentialWorker final : public fast_fs_hash::AddonWorker {
       XXH3_128bits_reset(state);
     }
 
-    AlignedPtr<uint8_t> rbuf(64, fast_fs_hash::READ_BUFFER_SIZE);
+    fast_fs_hash::ReadScratch rbuf;
     if (!rbuf) [[unlikely]] {
       this->signal("hashFilesSequential: out of memory");
       return;
@@ -112,7 +112,7 @@ class HashSequentialWorker final : public fast_fs_hash::AddonWorker {
       }
 
       for (;;) {
-        const int64_t n = file.read(rbuf.ptr, fast_fs_hash::READ_BUFFER_SIZE);
+        const int64_t n = file.read(rbuf.data, rbuf.size);
         if (n < 0) [[unlikely]] {
           if (this->throw_on_error_) {
             this->signal("hashFilesSequential: read error");
@@ -121,7 +121,7 @@ class HashSequentialWorker final : public fast_fs_hash::AddonWorker {
           break;
         }
         if (n == 0) { break; }
-        XXH3_128bits_update(state, rbuf.ptr, static_cast<size_t>(n));
+        XXH3_128bits_update(state, rbuf.data, static_cast<size_t>(n));
       }
     }
 
@@ -30,11 +30,15 @@ inline void InstanceHashWorker::Execute() {
   this->worker_.throwOnError = this->throw_on_error_;
 
   auto * d = this->addon;
-  this->worker_.run(d->pool, this->concurrency_, onHashDone_, this);
+  this->worker_.run(d->pool, d->closing, this->concurrency_, onHashDone_, this);
 }
 
 inline void InstanceHashWorker::onHashDone_(void * raw) {
   auto * self = static_cast<InstanceHashWorker *>(raw);
+  if (!self->worker_.hadScratch.load(std::memory_order_relaxed)) [[unlikely]] {
+    self->signal("hash_files: out of memory");
+    return;
+  }
   if (self->throw_on_error_ && self->worker_.hasError.load(std::memory_order_relaxed)) {
     self->signal("hash_files: one or more files could not be read");
     return;
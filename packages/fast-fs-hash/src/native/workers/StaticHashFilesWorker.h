@@ -59,7 +59,7 @@ class StaticHashFilesWorker final : public fast_fs_hash::AddonWorker {
     this->worker_.throwOnError = this->throw_on_error_;
 
     auto * d = this->addon;
-    this->worker_.run(d->pool, this->concurrency_, onHashDone_, this);
+    this->worker_.run(d->pool, d->closing, this->concurrency_, onHashDone_, this);
   }
 
   void OnOK() override {
@@ -86,6 +86,10 @@ class StaticHashFilesWorker final : public fast_fs_hash::AddonWorker {
   static void onHashDone_(void * raw) {
     auto * self = static_cast<StaticHashFilesWorker *>(raw);
 
+    if (!self->worker_.hadScratch.load(std::memory_order_relaxed)) [[unlikely]] {
+      self->signal("digestFilesParallelTo: out of memory");
+      return;
+    }
     if (self->throw_on_error_ && self->worker_.hasError.load(std::memory_order_relaxed)) {
       self->signal("digestFilesParallelTo: one or more files could not be read");
       return;
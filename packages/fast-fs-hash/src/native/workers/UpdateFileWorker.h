@@ -4,6 +4,7 @@
 #include "includes.h"
 #include "FfshFile.h"
 #include "AddonWorker.h"
+#include "ScratchArena.h"
 
 /**
  * Async worker that reads a single file on the pool thread and feeds
@@ -11,8 +12,8 @@
  *
  * The state update happens on the pool thread — safe because JS does not
  * touch the state while the worker is in flight (the promise is pending).
- * No intermediate buffer needed — file data is streamed through a
- * fixed stack-allocated read buffer.
+ * No intermediate buffer needed — file data is streamed through the
+ * pool thread's ReadScratch buffer.
  *
  * When throw_on_error is false, file open/read errors are silently ignored.
  */
@@ -31,10 +32,6 @@ class UpdateFileWorker final : public fast_fs_hash::AddonWorker {
     path_(std::move(path)),
     throw_on_error_(throw_on_error) {}
 
-  static_assert(
-    fast_fs_hash::READ_BUFFER_SIZE <= fast_fs_hash::ThreadPool::THREAD_STACK_SIZE - 64 * 1024,
-    "read buffer exceeds pool thread usable stack");
-
   void Execute() override {
     fast_fs_hash::FfshFile fh(this->path_.c_str());
     if (!fh) [[unlikely]] {
@@ -46,9 +43,14 @@ class UpdateFileWorker final : public fast_fs_hash::AddonWorker {
       return;
     }
     auto * state = reinterpret_cast<XXH3_state_t *>(this->state_ptr_);
-    alignas(64) uint8_t rbuf[fast_fs_hash::READ_BUFFER_SIZE];
+    fast_fs_hash::ReadScratch scratch;
+    if (!scratch) [[unlikely]] {
+      this->signal("updateFile: out of memory");
+      return;
+    }
+    uint8_t * const rbuf = scratch.data;
 
-    const int64_t n0 = fh.read(rbuf, fast_fs_hash::READ_BUFFER_SIZE);
+    const int64_t n0 = fh.read(rbuf, scratch.size);
     if (n0 < 0) [[unlikely]] {
       if (this->throw_on_error_) {
         this->signal("updateFile: read error");
@@ -63,9 +65,9 @@ class UpdateFileWorker final : public fast_fs_hash::AddonWorker {
     }
     XXH3_128bits_update(state, rbuf, static_cast<size_t>(n0));
 
-    if (static_cast<size_t>(n0) == fast_fs_hash::READ_BUFFER_SIZE) {
+    if (static_cast<size_t>(n0) == scratch.size) {
       for (;;) {
-        const int64_t n = fh.read(rbuf, fast_fs_hash::READ_BUFFER_SIZE);
+        const int64_t n = fh.read(rbuf, scratch.size);
         if (n < 0) [[unlikely]] {
           if (this->throw_on_error_) {
             this->signal("updateFile: read error");
@@ -58,6 +58,115 @@ export interface NearestProjectFiles {
   nodeModules: string | null;
 }
 
+/**
+ * Native thread pool scheduling class for an async call.
+ *
+ * - `'interactive'` (default) — latency-sensitive work. Always dequeued before
+ *   any queued background work.
+ * - `'background'` — bulk work (large parallel hashing, file compression).
+ *   Runs only when no interactive task is waiting. On Linux, with
+ *   `FAST_FS_HASH_BACKGROUND_IDLE_IO=1`, it also runs at idle I/O priority.
+ */
+export type TaskPriority = "interactive" | "background";
+
+/**
+ * Counters of one native pool worker slot, as reported by {@link threadPoolStats}.
+ *
+ * Threads self-terminate when idle and new ones reuse free slots, so the
+ * counters are cumulative across every thread that has occupied the slot.
+ */
+export interface ThreadPoolThreadStats {
+  /** Slot index (0-based). */
+  slot: number;
+  /** True if a thread currently occupies the slot. */
+  live: boolean;
+  /** Tasks executed. */
+  tasks: number;
+  /** Times the thread found work while spinning, without blocking in the kernel. */
+  spinHits: number;
+  /** Times the thread blocked on the wake semaphore. */
+  sleeps: number;
+  /** Total nanoseconds spent running tasks. */
+  busyNs: number;
+  /** Total nanoseconds spent waiting for work. */
+  idleNs: number;
+}
+
+/**
+ * Snapshot of the native thread pool counters, as reported by {@link threadPoolStats}.
+ * Counters are relaxed atomics read without a lock — values are consistent
+ * per field but not across fields.
+ */
+export interface ThreadPoolStats {
+  /** Live pool threads. */
+  threadCount: number;
+  /** Threads currently waiting for work. */
+  idleCount: number;
+  /** Upper bound on pool threads for parallel jobs (see `threadPoolCpuBudget()`). */
+  maxThreads: number;
+  /** Tasks executed, summed over all slots. */
+  tasksExecuted: number;
+  /** Wakeups that found work without blocking, summed over all slots. */
+  spinHits: number;
+  /** Semaphore sleeps, summed over all slots. */
+  sleeps: number;
+  /** Deepest the shared task queue has been since the pool started. */
+  queueHighWater: number;
+  /** ForkJob `expand()` calls (parallel jobs widening themselves at runtime). */
+  expandCalls: number;
+  /** Per-slot counters. */
+  threads: ThreadPoolThreadStats[];
+}
+
+/** Learned throughput at one thread count, as reported by {@link threadPoolTuning}. */
+export interface ThreadPoolTuningSample {
+  /** Thread cap the calls ran with. */
+  threads: number;
+  /** Files per second (moving average). */
+  filesPerSec: number;
+  /** Bytes read per second (moving average). 0 for `cacheStat`. */
+  bytesPerSec: number;
+  /** Calls measured at this thread count. */
+  samples: number;
+}
+
+/** Tuner state for one (operation, device) pair. */
+export interface ThreadPoolTuningProfile {
+  /**
+   * - `cacheStat` — `FileHashCache.open()` stat matching.
+   * - `cacheHash` — `FileHashCache` writes and re-hashing of changed files.
+   * - `hashFiles` — `digestFilesParallel()` and friends with default concurrency.
+   */
+  op: "cacheStat" | "cacheHash" | "hashFiles";
+  /** `st_dev` of the call's root directory (always 0 on Windows). */
+  device: number;
+  /** Thread cap the next call will use. */
+  threads: number;
+  /** Measured thread counts, ascending. */
+  samples: ThreadPoolTuningSample[];
+}
+
+/** Snapshot of the thread-count autotuner, as reported by {@link threadPoolTuning}. */
+export interface ThreadPoolTuning {
+  /** True when `FAST_FS_HASH_AUTOTUNE=1` or `FAST_FS_HASH_AUTOTUNE_PROFILE` is set. */
+  enabled: boolean;
+  /** `FAST_FS_HASH_AUTOTUNE_PROFILE`, or null. */
+  profilePath: string | null;
+  profiles: ThreadPoolTuningProfile[];
+}
+
+/** Counters of the process-wide file hash memo, as reported by {@link hashMemoStats}. */
+export interface HashMemoStats {
+  /** Memo slots (`FAST_FS_HASH_HASH_MEMO_ENTRIES` rounded up to a power of two); 0 when disabled. */
+  capacity: number;
+  /** Occupied slots. */
+  entries: number;
+  /** Large files whose hash was taken from the memo instead of read. */
+  hits: number;
+  /** Large files looked up and not found. */
+  misses: number;
+}
+
 /**
  * Stateless xxHash128 digest functions — available as static methods on XxHash128Stream.
  */
@@ -81,19 +190,26 @@ export interface IXxHash128Functions {
     outOffset?: number,
     throwOnError?: boolean
   ): Promise<TOut>;
-  digestFilesSequential(paths: readonly string[], throwOnError?: boolean): Promise<Buffer>;
+  digestFilesSequential(paths: readonly string[], throwOnError?: boolean, priority?: TaskPriority): Promise<Buffer>;
   digestFilesSequentialTo<TOut extends Uint8Array>(
     paths: readonly string[],
     out: TOut,
     outOffset?: number,
-    throwOnError?: boolean
+    throwOnError?: boolean,
+    priority?: TaskPriority
   ): Promise<TOut>;
-  digestFilesParallel(paths: readonly string[], concurrency?: number, throwOnError?: boolean): Promise<Buffer>;
+  digestFilesParallel(
+    paths: readonly string[],
+    concurrency?: number,
+    throwOnError?: boolean,
+    priority?: TaskPriority
+  ): Promise<Buffer>;
   digestFilesParallelTo<TOut extends Uint8Array>(
     paths: readonly string[],
     out: TOut,
     outOffset?: number,
     concurrency?: number,
-    throwOnError?: boolean
+    throwOnError?: boolean,
+    priority?: TaskPriority
   ): Promise<TOut>;
 }
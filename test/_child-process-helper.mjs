@@ -12,9 +12,39 @@
  *   trim-race: repeatedly trims idle pool threads, waits for self-termination,
  *              then submits fresh work. Used to catch the race where new work
  *              could be stranded while the last idle thread detaches.
+ *   cpu-budget: sends { cpuBudget } as detected by the native pool. Run with
+ *               FAST_FS_HASH_CGROUP_ROOT pointing at a fake cgroup tree.
+ *   pool-tasks: runs args.calls background lz4CompressBlockAsync calls one after
+ *               another and sends { delta }, the change in threadPoolStats().tasksExecuted.
+ *   read-size: hashes args.files through every file-reading path and sends
+ *              { single, parallel, sequential, equal } as hex digests / booleans.
+ *              Run with FAST_FS_HASH_READ_BUFFER_SIZE set.
+ *   autotune: hashes args.files with digestFilesParallel args.iterations times and
+ *             sends { tuning, digest } (threadPoolTuning() snapshot, hex digest),
+ *             then disconnects and exits. Run with FAST_FS_HASH_AUTOTUNE_PROFILE set.
+ *   open-status: opens a cache for args.files / args.rootPath / args.cachePath and
+ *                sends { status }; writes it first when args.write is true.
+ *                Run with FAST_FS_HASH_IO_URING set to compare stat backends.
+ *   mmap-body: opens the cache at args.cachePath, keeps its compressedPayloads[0]
+ *              view, writes args.files[0] with new content through session.write()
+ *              or clobbers the cache file after close() (args.clobber), then sends
+ *              { status, payload } with the view re-read as hex.
+ *              Run with FAST_FS_HASH_MMAP_MIN set so the body is mapped.
  */
 
-import { digestFile, FileHashCache, threadPoolTrim } from "fast-fs-hash";
+import { writeFileSync } from "node:fs";
+import {
+  digestFile,
+  digestFilesParallel,
+  digestFilesSequential,
+  FileHashCache,
+  filesEqual,
+  lz4CompressBlockAsync,
+  threadPoolCpuBudget,
+  threadPoolStats,
+  threadPoolTrim,
+  threadPoolTuning,
+} from "fast-fs-hash";
 
 const args = JSON.parse(process.argv[2]);
 
@@ -63,3 +93,81 @@ if (args.mode === "trim-race") {
 
   process.send({ ok: true, iterations });
 }
+
+if (args.mode === "cpu-budget") {
+  process.send({ cpuBudget: threadPoolCpuBudget() });
+}
+
+if (args.mode === "pool-tasks") {
+  const before = threadPoolStats().tasksExecuted;
+  for (let i = 0; i < args.calls; i++) {
+    await lz4CompressBlockAsync(Buffer.alloc(4096, 1), undefined, undefined, "background");
+  }
+  // A task is counted after run() returns, which can be just after its
+  // promise settles: give the last one time to land, then read the total.
+  const deadline = Date.now() + 5000;
+  while (threadPoolStats().tasksExecuted < before + args.calls && Date.now() < deadline) {
+    await new Promise((r) => setTimeout(r, 1));
+  }
+  await new Promise((r) => setTimeout(r, 20));
+  process.send({ delta: threadPoolStats().tasksExecuted - before });
+}
+
+if (args.mode === "read-size") {
+  const single = [];
+  const equal = [];
+  for (const file of args.files) {
+    single.push((await digestFile(file)).toString("hex"));
+    equal.push(await filesEqual(file, `${file}.copy`));
+  }
+  const parallel = (await digestFilesParallel(args.files)).toString("hex");
+  const sequential = (await digestFilesSequential(args.files)).toString("hex");
+  process.send({ single, parallel, sequential, equal });
+}
+
+if (args.mode === "autotune") {
+  let digest = "";
+  for (let i = 0; i < args.iterations; i++) {
+    digest = (await digestFilesParallel(args.files)).toString("hex");
+  }
+  // Exit normally so env teardown saves the profile.
+  process.send({ tuning: threadPoolTuning(), digest }, () => process.disconnect());
+}
+
+if (args.mode === "open-status") {
+  const cache = new FileHashCache({
+    cachePath: args.cachePath,
+    files: args.files,
+    rootPath: args.rootPath,
+    version: 1,
+  });
+  const session = await cache.open();
+  const status = session.status;
+  if (args.write) {
+    await session.write();
+  }
+  session.close();
+  process.send({ status });
+}
+
+if (args.mode === "mmap-body") {
+  const cache = new FileHashCache({
+    cachePath: args.cachePath,
+    files: args.files,
+    rootPath: args.rootPath,
+    version: 1,
+  });
+  const session = await cache.open();
+  const status = session.status;
+  const view = session.compressedPayloads[0];
+  if (args.clobber) {
+    session.close();
+    // A writer that honors the lock: a mapped body is copied out after close() returns.
+    await FileHashCache.waitUnlocked(args.cachePath);
+    writeFileSync(args.cachePath, "x");
+  } else {
+    writeFileSync(args.files[0], "rewritten while the cache was mapped\n");
+    await session.write({ compressedPayloads: session.compressedPayloads });
+  }
+  process.send({ status, payload: Buffer.from(view).toString("hex") });
+}
@@ -0,0 +1,72 @@
+/**
+ * Benchmark: FileHashCache write after renaming a 10k-file directory.
+ *
+ * A `git mv` of a directory changes every path in it but no file contents.
+ * The writer matches the new paths against the dropped old entries by
+ * (ino, size, mtime), so each moved file costs a stat instead of a read
+ * and hash. The cold write of the same files is the cost this avoids.
+ */
+
+import { mkdirSync, renameSync, rmSync, writeFileSync } from "node:fs";
+import { tmpdir } from "node:os";
+import path from "node:path";
+import { FileHashCache } from "fast-fs-hash";
+import { bench, describe } from "vitest";
+
+const FIXTURE_DIR = path.join(tmpdir(), `fast-fs-hash-bench-rename-${process.pid}`);
+const FILE_COUNT = 10_000;
+const FILE_SIZE = 4096;
+
+const names = Array.from({ length: FILE_COUNT }, (_, i) => `m${i % 100}/f${i}.ts`);
+
+function buildFixture(): void {
+  rmSync(FIXTURE_DIR, { recursive: true, force: true });
+  const content = Buffer.alloc(FILE_SIZE);
+  for (let i = 0; i < FILE_COUNT; i++) {
+    content.writeUInt32LE(i, 0);
+    const file = path.join(FIXTURE_DIR, "pkg-a", names[i]);
+    mkdirSync(path.dirname(file), { recursive: true });
+    writeFileSync(file, content);
+  }
+}
+
+function filesIn(dir: string): string[] {
+  return names.map((n) => path.join(FIXTURE_DIR, dir, n));
+}
+
+describe(`FileHashCache — write after renaming a ${FILE_COUNT}-file directory`, async () => {
+  buildFixture();
+  let current = "pkg-a";
+  const cache = new FileHashCache({
+    cachePath: path.join(FIXTURE_DIR, "rename.cache"),
+    files: filesIn(current),
+    rootPath: FIXTURE_DIR,
+  });
+  await cache.overwrite();
+
+  bench(
+    "rename directory, open + write",
+    async () => {
+      const next = current === "pkg-a" ? "pkg-b" : "pkg-a";
+      renameSync(path.join(FIXTURE_DIR, current), path.join(FIXTURE_DIR, next));
+      current = next;
+      cache.files = filesIn(current);
+      using session = await cache.open();
+      await session.write();
+    },
+    { warmupIterations: 1, throws: true }
+  );
+
+  bench(
+    "cold write of the same files",
+    async () => {
+      const cold = new FileHashCache({
+        cachePath: path.join(FIXTURE_DIR, "cold.cache"),
+        files: filesIn(current),
+        rootPath: FIXTURE_DIR,
+      });
+      await cold.overwrite();
+    },
+    { warmupIterations: 1, throws: true }
+  );
+});
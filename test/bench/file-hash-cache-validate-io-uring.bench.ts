@@ -0,0 +1,76 @@
+/**
+ * Benchmark: no-change `FileHashCache.open()` stat-match — fstatat vs io_uring.
+ *
+ * Linux only. The default backend issues one fstatat per tracked file; with
+ * FAST_FS_HASH_IO_URING=1 each worker batch goes out as IORING_OP_STATX
+ * requests completed by a single io_uring_enter. The backend is read once
+ * per process, so run twice and compare:
+ *
+ *   npm run bench -- test/bench/file-hash-cache-validate-io-uring.bench.ts
+ *   FAST_FS_HASH_IO_URING=1 npm run bench -- test/bench/file-hash-cache-validate-io-uring.bench.ts
+ *
+ * With a warm dentry cache fstatat usually wins: IORING_OP_STATX is always
+ * punted to io-wq kernel threads. io_uring pays off on cold caches and slow
+ * filesystems (NFS, overlayfs, FUSE), where its requests overlap.
+ */
+
+import { mkdirSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { FileHashCache } from "fast-fs-hash";
+import { bench, describe } from "vitest";
+
+const { generate } = require("./generate-raw-data.cjs") as {
+  generate: () => { files: string[]; modFilePath: string; cacheDir: string };
+};
+
+const RAW_DATA_DIR = path.join(import.meta.dirname, "raw-data");
+
+const BACKEND = process.env.FAST_FS_HASH_IO_URING === "1" ? "io_uring" : "fstatat";
+
+const ON_LINUX = process.platform === "linux";
+
+describe.skipIf(!ON_LINUX)(`FileHashCache — no change, stat backend ${BACKEND}`, async () => {
+  const { files, cacheDir } = generate();
+
+  // A monorepo-sized tree of tiny files, where the stat-match is all syscalls.
+  const manyDir = path.join(cacheDir, "io-uring-many");
+  const manyFiles: string[] = [];
+  for (let d = 0; d < 100; d++) {
+    const dir = path.join(manyDir, `pkg${d}`);
+    mkdirSync(dir, { recursive: true });
+    for (let f = 0; f < 200; f++) {
+      const file = path.join(dir, `m${f}.ts`);
+      writeFileSync(file, `export const v = ${f};\n`);
+      manyFiles.push(file);
+    }
+  }
+
+  async function seeded(label: string, list: string[], rootPath: string): Promise<FileHashCache> {
+    const cachePath = path.join(cacheDir, `io-uring-${label}.cache`);
+    const cache = new FileHashCache({ cachePath, files: list, rootPath });
+    using session = await cache.open();
+    await session.write();
+    return cache;
+  }
+
+  const rawCache = await seeded("raw", files, RAW_DATA_DIR);
+  const manyCache = await seeded("many", manyFiles, manyDir);
+
+  bench(
+    `${files.length} files (raw-data)`,
+    async () => {
+      rawCache.invalidateAll();
+      using _session = await rawCache.open();
+    },
+    { warmupIterations: 2, throws: true }
+  );
+
+  bench(
+    `${manyFiles.length} files`,
+    async () => {
+      manyCache.invalidateAll();
+      using _session = await manyCache.open();
+    },
+    { warmupIterations: 2, throws: true }
+  );
+});
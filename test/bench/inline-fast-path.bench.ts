@@ -0,0 +1,70 @@
+/**
+ * Benchmark: inline fast path vs. pool round trip for small async calls.
+ *
+ * Interactive `lz4DecompressBlockAsync` calls up to
+ * FAST_FS_HASH_INLINE_MAX_BYTES (default 16 KiB) run synchronously on the JS
+ * thread and return an already-resolved promise. `"background"` priority
+ * never inlines, so each size below is measured both ways in one process.
+ * The crossover is where "pool" starts beating "inline".
+ *
+ * `digestFile` tries the inline path once a streak of calls were cheap; it then
+ * fstats the file and hashes it inline only if it is at most
+ * FAST_FS_HASH_INLINE_MAX_FILE_BYTES (default 8 KiB).
+ *
+ * For digestFile, compare two runs:
+ *
+ *   npm run bench -- test/bench/inline-fast-path.bench.ts
+ *   FAST_FS_HASH_INLINE_MAX_FILE_BYTES=0 npm run bench -- test/bench/inline-fast-path.bench.ts
+ */
+
+import { mkdirSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { digestFile, lz4CompressBlock, lz4DecompressBlockAsync } from "fast-fs-hash";
+import { bench, describe } from "vitest";
+
+const { generate } = require("./generate-raw-data.cjs") as {
+  generate: () => { files: string[]; modFilePath: string; cacheDir: string };
+};
+
+const SIZES = [256, 4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024];
+
+function label(size: number): string {
+  return size >= 1024 ? `${size / 1024} KiB` : `${size} B`;
+}
+
+function makeData(size: number): Buffer {
+  const chunk = Buffer.from('export function f(x: number) { return x * 2; }\nconst s = "fast-fs-hash";\n');
+  const buf = Buffer.alloc(size);
+  for (let i = 0; i < size; i += chunk.length) {
+    chunk.copy(buf, i, 0, Math.min(chunk.length, size - i));
+  }
+  return buf;
+}
+
+for (const size of SIZES) {
+  describe(`lz4DecompressBlockAsync ${label(size)}`, () => {
+    const compressed = lz4CompressBlock(makeData(size));
+
+    bench("inline (interactive)", async () => {
+      await lz4DecompressBlockAsync(compressed, size);
+    });
+
+    bench("pool (background)", async () => {
+      await lz4DecompressBlockAsync(compressed, size, undefined, undefined, "background");
+    });
+  });
+}
+
+describe("digestFile", () => {
+  const dir = path.join(generate().cacheDir, "inline-fast-path");
+  mkdirSync(dir, { recursive: true });
+
+  for (const size of [256, 4 * 1024, 8 * 1024, 32 * 1024, 128 * 1024]) {
+    const file = path.join(dir, `f-${size}.bin`);
+    writeFileSync(file, makeData(size));
+
+    bench(label(size), async () => {
+      await digestFile(file);
+    });
+  }
+});
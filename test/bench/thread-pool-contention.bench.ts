@@ -0,0 +1,77 @@
+/**
+ * Benchmark: native thread pool under N concurrent mixed jobs.
+ *
+ * Each iteration launches N copies of a build-orchestrator-like mix at once:
+ * a no-change `FileHashCache.open()` (ForkJob stat-match), a
+ * `digestFilesParallel` (ForkJob hashing) and an `lz4CompressBlockAsync`
+ * (single AddonWorker). Fork tasks go to per-thread work-stealing deques;
+ * top-level workers go through the shared FIFO.
+ *
+ * Compare against the legacy single-FIFO queue by running twice:
+ *
+ *   npm run bench -- test/bench/thread-pool-contention.bench.ts
+ *   FAST_FS_HASH_POOL_SHARED_QUEUE=1 npm run bench -- test/bench/thread-pool-contention.bench.ts
+ *
+ * The queue mode is read once per process, so both cannot run in one pass.
+ */
+
+import path from "node:path";
+import { digestFilesParallel, FileHashCache, lz4CompressBlockAsync } from "fast-fs-hash";
+import { bench, describe } from "vitest";
+
+const { generate } = require("./generate-raw-data.cjs") as {
+  generate: () => { files: string[]; modFilePath: string; cacheDir: string };
+};
+
+const RAW_DATA_DIR = path.join(import.meta.dirname, "raw-data");
+
+const QUEUE_MODE = process.env.FAST_FS_HASH_POOL_SHARED_QUEUE === "1" ? "shared FIFO" : "work-stealing";
+
+describe(`thread pool contention (${QUEUE_MODE})`, async () => {
+  const { files, cacheDir } = generate();
+
+  // One cache file per concurrent job — sessions hold an exclusive lock, so
+  // sharing a file would measure lock waits instead of pool scheduling.
+  const MAX_JOBS = 16;
+  const caches: FileHashCache[] = [];
+  for (let i = 0; i < MAX_JOBS; i++) {
+    const cachePath = path.join(cacheDir, `pool-contention-${i}.cache`);
+    const cache = new FileHashCache({ cachePath, files, rootPath: RAW_DATA_DIR });
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    caches.push(cache);
+  }
+
+  const hashFiles = files.slice(0, 200);
+  const lz4Input = Buffer.alloc(256 * 1024, "export const x = 1;\n");
+
+  async function mixedJob(cache: FileHashCache): Promise<void> {
+    await Promise.all([
+      (async () => {
+        cache.invalidateAll();
+        using _session = await cache.open();
+      })(),
+      digestFilesParallel(hashFiles),
+      lz4CompressBlockAsync(lz4Input),
+    ]);
+  }
+
+  // Pre-warm the pool so thread spawn cost doesn't land in the first sample.
+  await mixedJob(caches[0]);
+
+  for (const n of [1, 4, MAX_JOBS]) {
+    bench(
+      `${n} concurrent job${n === 1 ? "" : "s"}`,
+      async () => {
+        const jobs = new Array<Promise<void>>(n);
+        for (let i = 0; i < n; i++) {
+          jobs[i] = mixedJob(caches[i]);
+        }
+        await Promise.all(jobs);
+      },
+      { warmupIterations: 2, throws: true }
+    );
+  }
+});
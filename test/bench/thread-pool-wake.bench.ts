@@ -0,0 +1,47 @@
+/**
+ * Benchmark: submit-to-first-task latency of the native thread pool.
+ *
+ * Every operation here is tiny, so the round trip is dominated by waking
+ * sleeping pool threads rather than by the work itself:
+ *
+ *  - `lz4CompressBlockAsync` on 64 bytes — one enqueue, one wake (notify_one_).
+ *  - `digestFilesParallel` on 10 empty-ish files — one ForkJob submit that
+ *    wakes up to 10 threads at once (notify_n_ → one batched post).
+ *
+ * The pool is pre-warmed so threads exist but are idle (blocked in
+ * wait_for_ms) at the start of each sample. Compare against the previous
+ * commit to see the effect of the futex semaphore.
+ */
+
+import { mkdirSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { digestFilesParallel, lz4CompressBlockAsync } from "fast-fs-hash";
+import { bench, describe } from "vitest";
+
+const { generate } = require("./generate-raw-data.cjs") as {
+  generate: () => { files: string[]; modFilePath: string; cacheDir: string };
+};
+
+describe("thread pool wake latency", async () => {
+  const wakeDir = path.join(generate().cacheDir, "pool-wake");
+  mkdirSync(wakeDir, { recursive: true });
+  const files: string[] = [];
+  for (let i = 0; i < 10; i++) {
+    const file = path.join(wakeDir, `f${i}.txt`);
+    writeFileSync(file, `file ${i}\n`);
+    files.push(file);
+  }
+  const tiny = Buffer.alloc(64, "x");
+
+  // Spawn the pool threads up front so spawn cost stays out of the samples.
+  await digestFilesParallel(files, 10);
+  await lz4CompressBlockAsync(tiny);
+
+  bench("single enqueue (lz4CompressBlockAsync, 64 B)", async () => {
+    await lz4CompressBlockAsync(tiny);
+  });
+
+  bench("fork submit, 10 threads (digestFilesParallel, 10 tiny files)", async () => {
+    await digestFilesParallel(files, 10);
+  });
+});
@@ -2,8 +2,9 @@
  * Tests: FileHashCache binary format verification.
  *
  * On-disk format is LZ4-compressed: [magic:4][uncompressedSize:4][LZ4 block]
- * Tests verify the on-disk prefix, round-trip correctness, and that the
- * in-memory format exposes correct values via the context.
+ * Tests verify the on-disk prefix, round-trip correctness, that the
+ * in-memory format exposes correct values via the context, and that a
+ * corrupt LZ4_BLOCKS body is rejected as missing.
  */
 
 import { mkdirSync, readFileSync, rmSync, writeFileSync } from "node:fs";
@@ -334,6 +335,200 @@ describe("FileHashCache binary format [native]", () => {
       });
     });
 
+    it("large bodies use LZ4_BLOCKS and round-trip", async () => {
+      const cp = cachePath("fmt-blocks");
+      const files = [fixtureFile("a.txt")];
+      // 6 MiB, compressible but not constant: every block sees different bytes.
+      const payload = Buffer.alloc(6 * 1024 * 1024);
+      for (let i = 0; i < payload.length; i++) {
+        payload[i] = (i >>> 10) & 0xff;
+      }
+      await withCache(cp, files, { version: 1 }, async (session) => {
+        await session.write({ compressedPayloads: [payload, Buffer.from("tail")] });
+      });
+      expect(readBodyFormat(cp)).toBe(BodyFormat.LZ4_BLOCKS);
+      expect(readFileSync(cp).length).toBeLessThan(payload.length / 4);
+
+      await withCache(cp, files, { version: 1 }, (session) => {
+        expect(session.status).toBe("upToDate");
+        expect(Buffer.from(session.compressedPayloads[0]).equals(payload)).toBe(true);
+        expect(Buffer.from(session.compressedPayloads[1]).toString()).toBe("tail");
+      });
+    });
+
+    it("large incompressible bodies stay PLAIN", async () => {
+      const cp = cachePath("fmt-blocks-plain");
+      const files = [fixtureFile("a.txt")];
+      const payload = incompressibleBytes(5 * 1024 * 1024);
+      await withCache(cp, files, { version: 1 }, async (session) => {
+        await session.write({ compressedPayloads: [payload] });
+      });
+      expect(readBodyFormat(cp)).toBe(BodyFormat.PLAIN);
+    });
+
+    describe("corrupt LZ4_BLOCKS bodies", () => {
+      // Block 0 is incompressible, so the writer stores it raw and its
+      // bytes on disk are the decoded body: the paths can be edited in
+      // place. The other blocks are LZ4.
+      const BLOCK_SIZE = 1 << 20;
+      let pristine: Buffer;
+      let blockCount: number;
+      /** Offset of the block table; the block ends follow it, then the block data. */
+      let tableAt: number;
+
+      const blockEndAt = (k: number) => tableAt + 16 + k * 4;
+      const blockDataAt = () => tableAt + 16 + blockCount * 4;
+
+      beforeAll(async () => {
+        const cp = cachePath("blocks-pristine");
+        const payload = Buffer.concat([incompressibleBytes(BLOCK_SIZE), Buffer.alloc(5 * BLOCK_SIZE)]);
+        for (let i = BLOCK_SIZE; i < payload.length; i++) {
+          payload[i] = (i >>> 10) & 0xff;
+        }
+        await withCache(cp, [fixtureFile("a.txt")], { version: 1 }, async (session) => {
+          await session.write({ compressedPayloads: [payload] });
+        });
+        pristine = readFileSync(cp);
+        expect(readBodyFormat(cp)).toBe(BodyFormat.LZ4_BLOCKS);
+        tableAt =
+          HEADER_SIZE +
+          pristine.readUInt32LE(H_UNCOMPRESSED_PAYLOAD_ITEM_COUNT) * 4 +
+          pristine.readUInt32LE(H_UNCOMPRESSED_PAYLOADS_LEN);
+        blockCount = pristine.readUInt32LE(tableAt);
+        expect(pristine.readUInt32LE(tableAt + 4)).toBe(BLOCK_SIZE);
+        expect(pristine.readUInt32LE(tableAt + 8)).toBe(0); // no coding flags
+        expect(blockCount).toBeGreaterThan(2);
+        expect(pristine.readUInt32LE(blockEndAt(0))).toBe(BLOCK_SIZE); // block 0 stored raw
+      });
+
+      async function statusOf(data: Buffer): Promise<string> {
+        const cp = cachePath("blocks-corrupt");
+        writeFileSync(cp, data);
+        const cache = new FileHashCache({ cachePath: cp, rootPath: FIXTURE_DIR, version: 1 });
+        using session = await cache.open();
+        return session.status;
+      }
+
+      /** Drop byte `at` of the block data, which lies in block `k`: later ends shift down by one. */
+      function dropByte(k: number, at: number): Buffer {
+        const data = Buffer.concat([pristine.subarray(0, at), pristine.subarray(at + 1)]);
+        for (let j = k; j < blockCount; j++) {
+          data.writeUInt32LE(pristine.readUInt32LE(blockEndAt(j)) - 1, blockEndAt(j));
+        }
+        return data;
+      }
+
+      /** The paths region sits in raw block 0: entries, payload dir, pathEnds, then paths. */
+      function withPath(path: string): Buffer {
+        const data = Buffer.from(pristine);
+        const pathsAt = blockDataAt() + 48 + 4 + 4;
+        expect(data.subarray(pathsAt, pathsAt + 5).toString()).toBe("a.txt");
+        data.write(path, pathsAt, "latin1");
+        return data;
+      }
+
+      it("the pristine file opens", async () => {
+        expect(await statusOf(pristine)).toBe("upToDate");
+        expect(await statusOf(withPath("a.txt"))).toBe("upToDate");
+      });
+
+      it("a block table without imageLen (older writers) still opens", async () => {
+        const data = Buffer.from(pristine);
+        data.writeUInt32LE(0, tableAt + 12);
+        expect(await statusOf(data)).toBe("upToDate");
+      });
+
+      it("rejects a malformed block table", async () => {
+        const cases: [string, (d: Buffer) => void][] = [
+          ["blockCount + 1", (d) => d.writeUInt32LE(blockCount + 1, tableAt)],
+          ["blockCount - 1", (d) => d.writeUInt32LE(blockCount - 1, tableAt)],
+          ["blockCount 0", (d) => d.writeUInt32LE(0, tableAt)],
+          ["blockSize too small", (d) => d.writeUInt32LE(1024, tableAt + 4)],
+          ["blockSize doubled", (d) => d.writeUInt32LE(BLOCK_SIZE * 2, tableAt + 4)],
+          ["unknown flags", (d) => d.writeUInt32LE(0x80, tableAt + 8)],
+          ["imageLen + 1", (d) => d.writeUInt32LE(d.readUInt32LE(tableAt + 12) + 1, tableAt + 12)],
+          ["block ends not increasing", (d) => d.writeUInt32LE(d.readUInt32LE(blockEndAt(0)), blockEndAt(1))],
+          [
+            "last end past the data",
+            (d) => d.writeUInt32LE(d.readUInt32LE(blockEndAt(blockCount - 1)) + 1, blockEndAt(blockCount - 1)),
+          ],
+        ];
+        for (const [label, corrupt] of cases) {
+          const data = Buffer.from(pristine);
+          corrupt(data);
+          expect(await statusOf(data), label).toBe("missing");
+        }
+      });
+
+      it("rejects a truncated file", async () => {
+        expect(await statusOf(pristine.subarray(0, pristine.length - 1))).toBe("missing");
+        expect(await statusOf(pristine.subarray(0, blockDataAt() + 100))).toBe("missing");
+        expect(await statusOf(pristine.subarray(0, tableAt + 8))).toBe("missing");
+      });
+
+      it("rejects a truncated LZ4 block", async () => {
+        // Last byte of block 1 (a middle block) and of the final block.
+        const mid = blockDataAt() + pristine.readUInt32LE(blockEndAt(1)) - 1;
+        expect(await statusOf(dropByte(1, mid))).toBe("missing");
+        expect(await statusOf(dropByte(blockCount - 1, pristine.length - 1))).toBe("missing");
+      });
+
+      it("rejects unsafe paths found in the decoded blocks", async () => {
+        for (const path of ["../ab", "/a.tx", "C:abc", "a/../", "a\0txt"]) {
+          expect(await statusOf(withPath(path)), JSON.stringify(path)).toBe("missing");
+        }
+      });
+    });
+
+    it("caches with many files use CODED and round-trip", async () => {
+      const cp = cachePath("fmt-columnar");
+      const dir = fixtureFile("many");
+      mkdirSync(dir, { recursive: true });
+      const files = Array.from({ length: 300 }, (_, i) => path.join(dir, `f${i}.txt`));
+      for (let i = 0; i < files.length; i++) {
+        writeFileSync(files[i], `file ${i}\n`);
+      }
+      await withCache(cp, files, { version: 1 }, async (session) => {
+        await session.write({ compressedPayloads: [Buffer.from("columnar")] });
+      });
+      expect(readBodyFormat(cp)).toBe(BodyFormat.CODED);
+
+      await withCache(cp, files, { version: 1 }, (session) => {
+        expect(session.status).toBe("upToDate");
+        expect(Buffer.from(session.compressedPayloads[0]).toString()).toBe("columnar");
+      });
+
+      writeFileSync(files[123], "file 123, changed\n");
+      await withCache(cp, files, { version: 1 }, (session) => {
+        expect(session.status).toBe("changed");
+      });
+    });
+
+    it("CODED caches with nested directories round-trip their paths", async () => {
+      const cp = cachePath("fmt-dir-paths");
+      const root = fixtureFile("tree");
+      const files: string[] = [];
+      for (let i = 0; i < 300; i++) {
+        const dir = path.join(root, `pkg${i % 5}`, i % 3 === 0 ? "" : `src/d${i % 7}`);
+        mkdirSync(dir, { recursive: true });
+        const file = path.join(dir, `f${i}.txt`);
+        writeFileSync(file, `file ${i}\n`);
+        files.push(file);
+      }
+      files.push(fixtureFile("a.txt"));
+      await withCache(cp, files, { version: 1 }, async (session) => {
+        await session.write();
+      });
+      expect(readBodyFormat(cp)).toBe(BodyFormat.CODED);
+
+      // No file list: the session's paths come from the decoded cache file.
+      const cache = new FileHashCache({ cachePath: cp, rootPath: FIXTURE_DIR, version: 1 });
+      using session = await cache.open();
+      expect(session.status).toBe("upToDate");
+      const expected = files.map((f) => path.relative(FIXTURE_DIR, f).split(path.sep).join("/"));
+      expect([...session.files].sort()).toEqual(expected.sort());
+    });
+
     it("old files (BodyFormat=LZ4) still readable after upgrade", async () => {
       // We can't easily fabricate a pre-v0.0.3 file, but we can verify the
       // writer's choice of LZ4 produces a file whose magic byte 3 is exactly
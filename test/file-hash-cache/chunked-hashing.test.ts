@@ -0,0 +1,139 @@
+/**
+ * Tests: chunk-tree hashing of large files (`chunkedHashing` option).
+ *
+ * Files of 16 MiB or more are hashed as a tree of 4 MiB chunks: leaf i is
+ * the XXH3-128 (seed i) of chunk i, the digest is the XXH3-128 (seed =
+ * file size) of the canonical leaves. The mode is stored in bit 7 of the
+ * magic's BodyFormat byte, and a cache written in the other mode is stale.
+ */
+
+import { readFileSync, utimesSync, writeFileSync } from "node:fs";
+import { digestBuffer, FileHashCache, XxHash128Stream } from "fast-fs-hash";
+import { beforeEach, describe, expect, it } from "vitest";
+import { ENTRY_STRIDE, HEADER_SIZE } from "../../packages/fast-fs-hash/src/file-hash-cache-format";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-chunked-hashing");
+
+const CHUNK = 4 * 1024 * 1024;
+const BIG_SIZE = 4 * CHUNK + 12345;
+
+const bigFile = fixtureFile("big.bin");
+const smallFile = fixtureFile("small.txt");
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: Uint8Array | string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+function bigContent(): Buffer {
+  const out = Buffer.alloc(BIG_SIZE);
+  let s = 0x2545f491;
+  for (let i = 0; i + 4 <= BIG_SIZE; i += 4) {
+    s ^= s << 13;
+    s ^= s >>> 17;
+    s ^= s << 5;
+    out.writeUInt32LE(s >>> 0, i);
+  }
+  return out;
+}
+
+/** Reference chunk-tree digest, canonical byte order. */
+function chunkTreeDigest(data: Buffer): Buffer {
+  const leaves: Buffer[] = [];
+  for (let i = 0; i * CHUNK < data.length; i++) {
+    const leaf = new XxHash128Stream(i, 0);
+    leaf.addBuffer(data.subarray(i * CHUNK, Math.min((i + 1) * CHUNK, data.length)));
+    leaves.push(leaf.digest());
+  }
+  const root = new XxHash128Stream(data.length >>> 0, Math.floor(data.length / 2 ** 32));
+  root.addBuffer(Buffer.concat(leaves));
+  return root.digest();
+}
+
+/** Content hash of entry `i` of a PLAIN cache without payloads, canonical byte order. */
+function entryHash(cp: string, i: number): Buffer {
+  const data = readFileSync(cp);
+  const off = HEADER_SIZE + i * ENTRY_STRIDE + 32;
+  return Buffer.from(data.subarray(off, off + 16)).reverse();
+}
+
+function newCache(cp: string, chunkedHashing: boolean): FileHashCache {
+  return new FileHashCache({
+    cachePath: cp,
+    files: [bigFile, smallFile],
+    rootPath: FIXTURE_DIR,
+    version: 1,
+    patchable: true,
+    chunkedHashing,
+  });
+}
+
+beforeEach(() => {
+  writeWithMtime(bigFile, bigContent());
+  writeWithMtime(smallFile, "small\n");
+});
+
+describe("chunked hashing", () => {
+  it("hashes large files as a chunk tree and marks the header", async () => {
+    const big = bigContent();
+    const cp = cachePath("tree");
+    {
+      using session = await newCache(cp, true).open();
+      await session.write();
+    }
+    expect(readFileSync(cp)[3]).toBe(0x81); // PLAIN | chunk-tree bit
+    expect(entryHash(cp, 0)).toEqual(chunkTreeDigest(big));
+    expect(entryHash(cp, 1)).toEqual(digestBuffer(Buffer.from("small\n")));
+
+    const plain = cachePath("plain");
+    {
+      using session = await newCache(plain, false).open();
+      await session.write();
+    }
+    expect(readFileSync(plain)[3]).toBe(0x01);
+    expect(entryHash(plain, 0)).toEqual(digestBuffer(big));
+    expect(entryHash(plain, 1)).toEqual(entryHash(cp, 1));
+  });
+
+  it("treats a cache written in the other mode as stale", async () => {
+    const cp = cachePath("toggle");
+    {
+      using session = await newCache(cp, false).open();
+      await session.write();
+    }
+    {
+      using session = await newCache(cp, true).open();
+      expect(session.status).toBe("stale");
+      await session.write();
+    }
+    {
+      using session = await newCache(cp, true).open();
+      expect(session.status).toBe("upToDate");
+    }
+    using session = await newCache(cp, false).open();
+    expect(session.status).toBe("stale");
+  });
+
+  it("detects a change inside one chunk", async () => {
+    const cp = cachePath("change");
+    const cache = newCache(cp, true);
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    const before = entryHash(cp, 0);
+    const big = bigContent();
+    big[2 * CHUNK + 7] ^= 0xff;
+    writeWithMtime(bigFile, big);
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("changed");
+      await session.write();
+    }
+    expect(entryHash(cp, 0)).toEqual(chunkTreeDigest(big));
+    expect(entryHash(cp, 0)).not.toEqual(before);
+  });
+});
@@ -0,0 +1,117 @@
+/**
+ * Tests: process-wide decoded cache registry.
+ *
+ * From the second decode of a cache path on, open() keeps the decoded image
+ * and later opens with the same cache-file identity clone it instead of
+ * reading the file. Clones must behave exactly like a fresh read: no state
+ * from an earlier session may leak, and any rewrite of the file must miss —
+ * including an in-place patch that keeps the file's inode and size.
+ */
+
+import { statSync, utimesSync, writeFileSync } from "node:fs";
+import { FileHashCache } from "fast-fs-hash";
+import { beforeEach, describe, expect, it } from "vitest";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-decoded-registry");
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+const files = Array.from({ length: 50 }, (_, i) => fixtureFile(`r${i}.txt`));
+
+/** Images are kept only once the cache file's timestamps are this much older than the open. */
+const RACY_WINDOW_MS = 2300;
+
+function newCache(cp: string, patchable = false): FileHashCache {
+  return new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1, patchable });
+}
+
+async function openStatus(cache: FileHashCache): Promise<{ status: string; payload: number[] }> {
+  using session = await cache.open();
+  return { status: session.status, payload: [...(session.compressedPayloads[0] ?? [])] };
+}
+
+beforeEach(() => {
+  for (let i = 0; i < files.length; i++) {
+    writeWithMtime(files[i], `content ${i}\n`);
+  }
+});
+
+describe("decoded cache registry", () => {
+  it("repeated opens of an unchanged cache stay upToDate", async () => {
+    const cp = cachePath("repeat");
+    {
+      using session = await newCache(cp).open();
+      await session.write({ compressedPayloads: [new Uint8Array([7, 8, 9])] });
+    }
+    // Fresh instances: no per-instance "cache file unchanged" shortcut.
+    for (let i = 0; i < 4; i++) {
+      expect(await openStatus(newCache(cp))).toEqual({ status: "upToDate", payload: [7, 8, 9] });
+    }
+  });
+
+  it("does not leak stat-match state between opens of the same image", async () => {
+    const cp = cachePath("no-leak");
+    {
+      using session = await newCache(cp).open();
+      await session.write();
+    }
+    await openStatus(newCache(cp));
+    await openStatus(newCache(cp));
+
+    writeWithMtime(files[3], "a different size\n");
+    for (let i = 0; i < 3; i++) {
+      expect((await openStatus(newCache(cp))).status).toBe("changed");
+    }
+  });
+
+  it("misses after the cache file is rewritten", async () => {
+    const cp = cachePath("rewrite");
+    const cache = newCache(cp);
+    {
+      using session = await cache.open();
+      await session.write({ compressedPayloads: [new Uint8Array([1])] });
+    }
+    await openStatus(newCache(cp));
+    await openStatus(newCache(cp));
+
+    // Rewrite through another instance with a new payload.
+    {
+      using session = await newCache(cp).open();
+      await session.write({ compressedPayloads: [new Uint8Array([2, 2])] });
+    }
+    expect(await openStatus(newCache(cp))).toEqual({ status: "upToDate", payload: [2, 2] });
+    expect(await openStatus(cache)).toEqual({ status: "upToDate", payload: [2, 2] });
+  });
+
+  it("misses after an in-place patch of a settled cache file", async () => {
+    const cp = cachePath("patch");
+    {
+      using session = await newCache(cp, true).open();
+      await session.write({ compressedPayloads: [new Uint8Array([1, 1])] });
+    }
+    await new Promise((r) => setTimeout(r, RACY_WINDOW_MS));
+    // Second decode of a settled file keeps the image.
+    await openStatus(newCache(cp, true));
+    expect(await openStatus(newCache(cp, true))).toEqual({ status: "upToDate", payload: [1, 1] });
+
+    const before = statSync(cp);
+    {
+      using session = await newCache(cp, true).open();
+      await session.write({ compressedPayloads: [new Uint8Array([2, 2])] });
+    }
+    const after = statSync(cp);
+    expect(after.ino).toBe(before.ino);
+    expect(after.size).toBe(before.size);
+    // Same mtime as before the patch: only ctime and the write's invalidation tell them apart.
+    utimesSync(cp, before.atime, before.mtime);
+    for (let i = 0; i < 2; i++) {
+      expect(await openStatus(newCache(cp, true))).toEqual({ status: "upToDate", payload: [2, 2] });
+    }
+  }, 10_000);
+});
@@ -0,0 +1,119 @@
+/**
+ * Tests: per-worker parent-directory fd cache (FAST_FS_HASH_DIR_FD_CACHE).
+ *
+ * Deep trees are stat'ed and opened relative to cached parent-directory fds.
+ * The setting is read once per process, so each open() runs in a child with
+ * the cache on (default) and off; both must agree. The tree spans more than
+ * DirFdCache::MAX_SLOTS (64) directories so eviction is exercised.
+ */
+
+import type { ChildProcess } from "node:child_process";
+
+import { fork } from "node:child_process";
+import { mkdirSync, renameSync, rmSync, utimesSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { afterAll, afterEach, beforeAll, describe, expect, it } from "vitest";
+
+const TEST_DIR = path.resolve(import.meta.dirname, "tmp/fhc-dir-fd-cache");
+const CHILD_SCRIPT = path.resolve(import.meta.dirname, "../_child-process-helper.mjs");
+
+const SETTINGS = [{ FAST_FS_HASH_DIR_FD_CACHE: "" }, { FAST_FS_HASH_DIR_FD_CACHE: "0" }];
+
+const activeChildren: Set<ChildProcess> = new Set();
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+function openInChild(
+  env: Record<string, string>,
+  args: { cachePath: string; rootPath: string; files: string[]; write?: boolean }
+): Promise<string> {
+  return new Promise((resolve, reject) => {
+    const child = fork(CHILD_SCRIPT, [JSON.stringify({ mode: "open-status", ...args })], {
+      stdio: "pipe",
+      env: { ...process.env, ...env },
+    });
+    activeChildren.add(child);
+    child.on("message", (msg: { status: string }) => {
+      resolve(msg.status);
+      child.kill("SIGKILL");
+    });
+    child.on("error", reject);
+    child.on("exit", (code, signal) => {
+      activeChildren.delete(child);
+      if (code !== 0 && signal !== "SIGKILL") {
+        reject(new Error(`open-status child exited with code ${code}`));
+      }
+    });
+  });
+}
+
+async function statusBySetting(args: { cachePath: string; rootPath: string; files: string[] }): Promise<string[]> {
+  const out: string[] = [];
+  for (const env of SETTINGS) {
+    out.push(await openInChild(env, args));
+  }
+  return out;
+}
+
+beforeAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+  mkdirSync(TEST_DIR, { recursive: true });
+});
+
+afterEach(() => {
+  for (const child of activeChildren) {
+    child.kill("SIGKILL");
+  }
+  activeChildren.clear();
+});
+
+afterAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+});
+
+describe("dir fd cache", () => {
+  it("deep tree: cache on and off agree on every status", async () => {
+    const rootPath = path.join(TEST_DIR, "tree");
+    const files: string[] = [path.join(rootPath, "top.txt")];
+    writeWithMtime(files[0], "top\n");
+    for (let d = 0; d < 80; d++) {
+      const dir = path.join(rootPath, "packages", `p${d % 8}`, "src", `c${d}`, "ui");
+      mkdirSync(dir, { recursive: true });
+      for (let f = 0; f < 6; f++) {
+        const file = path.join(dir, `f${f}.tsx`);
+        writeWithMtime(file, `export const v${d}_${f} = ${d * f};\n`);
+        files.push(file);
+      }
+    }
+    const cachePath = path.join(TEST_DIR, "tree.cache");
+    const args = { cachePath, rootPath, files };
+
+    expect(await openInChild({}, { ...args, write: true })).toBe("missing");
+    expect(await statusBySetting(args)).toEqual(["upToDate", "upToDate"]);
+
+    const deep = files[files.length - 1];
+    writeWithMtime(deep, "export const changed = 1;\n");
+    expect(await statusBySetting(args)).toEqual(["changed", "changed"]);
+    expect(await openInChild({}, { ...args, write: true })).toBe("changed");
+
+    // Swap a directory out from under the tracked paths: every file in it is
+    // now a different inode, even though the paths resolve.
+    const swapped = path.join(rootPath, "packages", "p3", "src", "c3");
+    renameSync(swapped, `${swapped}.old`);
+    mkdirSync(path.join(swapped, "ui"), { recursive: true });
+    for (let f = 0; f < 6; f++) {
+      writeWithMtime(path.join(swapped, "ui", `f${f}.tsx`), `export const v3_${f} = ${3 * f};\n`);
+    }
+    const statuses = await statusBySetting(args);
+    expect(statuses[0]).toBe(statuses[1]);
+    expect(statuses[0]).not.toBe("upToDate");
+
+    rmSync(path.join(rootPath, "packages", "p5"), { recursive: true });
+    expect(await statusBySetting(args)).toEqual(["changed", "changed"]);
+  });
+});
@@ -35,6 +35,39 @@ beforeAll(() => {
   writeFileSync(fx("e.txt"), "eee\n");
 });
 
+/** Names whose UTF-16 and UTF-8 orders disagree: U+E000..U+FFFF sorts after
+ *  the surrogates of astral characters in UTF-16 but before them in UTF-8.
+ *  Plain names are mixed in so the lookups binary-search a real list. */
+const MIXED_NAMES = [
+  ...Array.from({ length: 40 }, (_, i) => `u/f-${i}.txt`),
+  "u/\u07ff.txt",
+  "u/\u0800.txt",
+  "u/\ud7ff.txt",
+  "u/\ue000.txt",
+  "u/\ue000\u{1f600}.txt",
+  "u/\uf8ff-x.txt",
+  "u/\ufb01.txt",
+  "u/\ufefe.txt",
+  "u/\uff21.txt",
+  "u/\ufffd.txt",
+  "u/\u{10000}.txt",
+  "u/\u{1d11e}.txt",
+  "u/\u{1f600}.txt",
+  "u/\u{1f600}\ue000.txt",
+  "u/m/a.txt",
+  "u/m\ue001/a.txt",
+  "u/m\u{1f601}/a.txt",
+  "u/z\u00e9.txt",
+];
+
+function writeMixedNames(): string[] {
+  return MIXED_NAMES.map((n) => {
+    mkdirSync(path.dirname(fx(n)), { recursive: true });
+    writeFileSync(fx(n), `${n}\n`);
+    return fx(n);
+  });
+}
+
 afterAll(() => {
   rmSync(TEST_DIR, { recursive: true, force: true });
 });
@@ -195,6 +228,47 @@ describe("watch mode simulation", () => {
     }
   });
 
+  it("invalidate ignores paths outside the file list", async () => {
+    const cache = new FileHashCache({ cachePath: cp(), files: [fx("a.txt"), fx("b.txt")], rootPath: FIXTURE_DIR });
+    {
+      using s = await cache.open();
+      await s.write();
+    }
+    expect(cache.needsOpen).toBe(false);
+
+    cache.invalidate([fx("c.txt"), fx("nested/a.txt"), "/elsewhere/a.txt"]);
+    expect(cache.needsOpen).toBe(false);
+
+    writeWithMtime(fx("b.txt"), "bbb outside\n");
+    cache.invalidate([fx("c.txt"), fx("b.txt")]);
+    expect(cache.needsOpen).toBe(true);
+    {
+      using s = await cache.open();
+      expect(s.status).toBe("changed");
+      await s.write();
+    }
+    writeWithMtime(fx("b.txt"), "bbb\n");
+  });
+
+  it("invalidate marks the right entry when paths mix U+E000..U+FFFF and astral characters", async () => {
+    const files = writeMixedNames();
+    const cache = new FileHashCache({ cachePath: cp(), files, rootPath: FIXTURE_DIR });
+    {
+      using s = await cache.open();
+      await s.write();
+    }
+    for (const file of files) {
+      // Only the invalidated entry is stat-ed: the open sees the change
+      // only if invalidate() mapped the path to its own index.
+      writeWithMtime(file, `${file} changed\n`);
+      cache.invalidate([file]);
+      expect(cache.needsOpen, file).toBe(true);
+      using s = await cache.open();
+      expect(s.status, file).toBe("changed");
+      await s.write();
+    }
+  });
+
   it("invalidate also works with relative paths", async () => {
     const files = [fx("a.txt"), fx("b.txt")];
     const cache = new FileHashCache({ cachePath: cp(), files, rootPath: FIXTURE_DIR });
@@ -0,0 +1,233 @@
+/**
+ * Tests: FileHashCache fullScan — per-file change report from open().
+ *
+ * With fullScan on, open() keeps stat-matching after the first change and
+ * reports a FileChangeKind for every tracked file in session.changes, and
+ * the cached files the list dropped in session.removedFiles.
+ */
+
+import { rmSync, utimesSync, writeFileSync } from "node:fs";
+import { FileChangeKind, FileHashCache } from "fast-fs-hash";
+import { beforeEach, describe, expect, it } from "vitest";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-full-scan");
+
+const FILE_COUNT = 200;
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+function name(i: number): string {
+  return `f${String(i).padStart(3, "0")}.txt`;
+}
+
+function fileList(count = FILE_COUNT): string[] {
+  return Array.from({ length: count }, (_, i) => fixtureFile(name(i)));
+}
+
+async function writeCache(cp: string, files: string[], compressedPayloads?: Uint8Array[]): Promise<void> {
+  const cache = new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1 });
+  using session = await cache.open();
+  await session.write({ compressedPayloads });
+}
+
+function changesByName(files: readonly string[], changes: Uint8Array): Map<string, number> {
+  const out = new Map<string, number>();
+  for (let i = 0; i < files.length; i++) {
+    if (changes[i] !== FileChangeKind.UNCHANGED) {
+      out.set(files[i].slice(FIXTURE_DIR.length + 1), changes[i]);
+    }
+  }
+  return out;
+}
+
+beforeEach(() => {
+  for (let i = 0; i <= FILE_COUNT; i++) {
+    writeWithMtime(fixtureFile(name(i)), `content ${i}\n`);
+  }
+});
+
+describe("FileHashCache fullScan [native]", () => {
+  it("is null unless fullScan is enabled", async () => {
+    const cp = cachePath("off");
+    const files = fileList();
+    await writeCache(cp, files);
+    writeWithMtime(files[3], "changed\n");
+
+    const cache = new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1 });
+    using session = await cache.open();
+    expect(session.status).toBe("changed");
+    expect(session.changes).toBeNull();
+    expect(session.removedFiles).toBeNull();
+  });
+
+  it("reports all zeros when nothing changed", async () => {
+    const cp = cachePath("clean");
+    const files = fileList();
+    await writeCache(cp, files);
+
+    const cache = new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1, fullScan: true });
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+    expect(session.changes).not.toBeNull();
+    expect(session.changes?.length).toBe(FILE_COUNT);
+    expect(session.changes?.every((k) => k === FileChangeKind.UNCHANGED)).toBe(true);
+    expect(session.removedFiles).toEqual([]);
+  });
+
+  it("classifies every file instead of stopping at the first change", async () => {
+    const cp = cachePath("kinds");
+    const files = fileList();
+    await writeCache(cp, files);
+
+    writeWithMtime(files[5], "a different size\n"); // size changed
+    writeWithMtime(files[50], "content X\n".padEnd("content 50\n".length, "x")); // same size, new bytes
+    writeWithMtime(files[100], "content 100\n"); // touched only
+    writeWithMtime(files[199], "also a different size\n");
+    rmSync(files[150]);
+
+    const cache = new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1, fullScan: true });
+    using session = await cache.open();
+    expect(session.status).toBe("changed");
+    expect(changesByName(session.files, session.changes as Uint8Array)).toEqual(
+      new Map([
+        [name(5), FileChangeKind.CHANGED],
+        [name(50), FileChangeKind.CHANGED],
+        [name(100), FileChangeKind.STATS_DIRTY],
+        [name(150), FileChangeKind.MISSING],
+        [name(199), FileChangeKind.CHANGED],
+      ])
+    );
+  });
+
+  it("reports statsDirty files when content is unchanged", async () => {
+    const cp = cachePath("stats");
+    const files = fileList();
+    await writeCache(cp, files);
+    writeWithMtime(files[7], "content 7\n");
+
+    const cache = new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1, fullScan: true });
+    using session = await cache.open();
+    expect(session.status).toBe("statsDirty");
+    expect(changesByName(session.files, session.changes as Uint8Array)).toEqual(
+      new Map([[name(7), FileChangeKind.STATS_DIRTY]])
+    );
+  });
+
+  it("reports added files and still stat-matches the rest when the list changes", async () => {
+    const cp = cachePath("list");
+    const files = fileList();
+    const payload = new Uint8Array([1, 2, 3, 4]);
+    await writeCache(cp, files, [payload]);
+
+    writeWithMtime(files[20], "a different size\n");
+    const newFiles = files.filter((_, i) => i !== 10).concat(fixtureFile(name(FILE_COUNT)));
+
+    const cache = new FileHashCache({
+      cachePath: cp,
+      files: newFiles,
+      rootPath: FIXTURE_DIR,
+      version: 1,
+      fullScan: true,
+    });
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("changed");
+      expect(session.changes?.length).toBe(newFiles.length);
+      expect(changesByName(session.files, session.changes as Uint8Array)).toEqual(
+        new Map([
+          [name(20), FileChangeKind.CHANGED],
+          [name(FILE_COUNT), FileChangeKind.ADDED],
+        ])
+      );
+      expect(session.removedFiles).toEqual([files[10]]);
+      expect(session.compressedPayloads.map((b) => [...b])).toEqual([[...payload]]);
+      expect(await session.write()).toBe(true);
+    }
+
+    // What the full-scan session wrote must match the disk exactly.
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+    expect(session.changes?.every((k) => k === FileChangeKind.UNCHANGED)).toBe(true);
+    expect(session.removedFiles).toEqual([]);
+  });
+
+  it("reports every file dropped from the list in removedFiles", async () => {
+    const cp = cachePath("removed");
+    const files = fileList();
+    await writeCache(cp, files);
+
+    const dropped = new Set([0, 1, 77, 78, 150, FILE_COUNT - 1]);
+    const newFiles = files.filter((_, i) => !dropped.has(i));
+    const cache = new FileHashCache({
+      cachePath: cp,
+      files: newFiles,
+      rootPath: FIXTURE_DIR,
+      version: 1,
+      fullScan: true,
+    });
+    using session = await cache.open();
+    expect(session.status).toBe("changed");
+    expect(session.changes?.every((k) => k === FileChangeKind.UNCHANGED)).toBe(true);
+    expect(session.removedFiles).toEqual([...dropped].map((i) => files[i]));
+  });
+
+  it("only reports invalidated files in watch mode", async () => {
+    const cp = cachePath("watch");
+    const files = fileList();
+    const cache = new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1, fullScan: true });
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+
+    writeWithMtime(files[30], "a different size\n");
+    writeWithMtime(files[31], "another different size\n");
+    cache.invalidate([files[30]]);
+
+    using session = await cache.open();
+    expect(session.status).toBe("changed");
+    expect(changesByName(session.files, session.changes as Uint8Array)).toEqual(
+      new Map([[name(30), FileChangeKind.CHANGED]])
+    );
+  });
+
+  it("is null when there is no cache file", async () => {
+    const cache = new FileHashCache({
+      cachePath: cachePath("none"),
+      files: fileList(),
+      rootPath: FIXTURE_DIR,
+      version: 1,
+      fullScan: true,
+    });
+    using session = await cache.open();
+    expect(session.status).toBe("missing");
+    expect(session.changes).toBeNull();
+    expect(session.removedFiles).toBeNull();
+  });
+
+  it("can be toggled with configure()", async () => {
+    const cp = cachePath("toggle");
+    const files = fileList();
+    await writeCache(cp, files);
+    writeWithMtime(files[1], "a different size\n");
+
+    const cache = new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1 });
+    {
+      using session = await cache.open();
+      expect(session.changes).toBeNull();
+    }
+    cache.configure({ fullScan: true });
+    expect(cache.fullScan).toBe(true);
+    cache.invalidateAll();
+    using session = await cache.open();
+    expect(changesByName(session.files, session.changes as Uint8Array)).toEqual(
+      new Map([[name(1), FileChangeKind.CHANGED]])
+    );
+  });
+});
@@ -0,0 +1,130 @@
+/**
+ * Tests: process-wide file hash memo (hashMemoStats).
+ *
+ * Files larger than one read buffer are memoized by (dev, ino, mtime,
+ * ctime, size), but only once both timestamps are 2 s older than the hash
+ * start: a same-size rewrite within one timestamp tick would keep the key.
+ * The settled fixtures are written in beforeAll, which then waits out that
+ * window. Every FileHashCache and digestFilesParallel call shares the memo,
+ * so a second reader of a settled, unchanged file — under any of its
+ * hardlinks — takes the hash instead of reading the file. Counters are
+ * process-wide and other test files run in the same process, so only lower
+ * bounds are asserted.
+ */
+import { copyFileSync, linkSync, readFileSync, statSync, utimesSync, writeFileSync } from "node:fs";
+import { digestBuffer, digestFilesParallel, FileHashCache, hashMemoStats } from "fast-fs-hash";
+import { beforeAll, describe, expect, it } from "vitest";
+import { ENTRY_STRIDE, HEADER_SIZE } from "../../packages/fast-fs-hash/src/file-hash-cache-format";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-hash-memo");
+
+/** Larger than the default 128 KiB read buffer. */
+const BIG_SIZE = 1024 * 1024 + 777;
+
+/** HashMemo::RACY_WINDOW_NS plus slack. */
+const RACY_WINDOW_MS = 2000 + 300;
+
+let fileCounter = 0;
+
+function bigContent(seed: number): Buffer {
+  const out = Buffer.alloc(BIG_SIZE);
+  let s = seed >>> 0 || 1;
+  for (let i = 0; i + 4 <= BIG_SIZE; i += 4) {
+    s ^= s << 13;
+    s ^= s >>> 17;
+    s ^= s << 5;
+    out.writeUInt32LE(s >>> 0, i);
+  }
+  return out;
+}
+
+/** Content hash of entry `i` of a PLAIN cache without payloads, canonical byte order. */
+function entryHash(cp: string, i: number): Buffer {
+  const data = readFileSync(cp);
+  const off = HEADER_SIZE + i * ENTRY_STRIDE + 32;
+  return Buffer.from(data.subarray(off, off + 16)).reverse();
+}
+
+/** digestFilesParallel of a fresh copy: a new inode the memo has never seen. */
+async function referenceDigest(file: string): Promise<Buffer> {
+  const copy = fixtureFile(`copy-${++fileCounter}.bin`);
+  copyFileSync(file, copy);
+  return digestFilesParallel([copy]);
+}
+
+function writeBig(): string {
+  const file = fixtureFile(`big-${++fileCounter}.bin`);
+  writeFileSync(file, bigContent(fileCounter));
+  return file;
+}
+
+/** Settled fixtures, one per test that needs memo hits or mutates its file. */
+const settled: string[] = [];
+/** Second hardlink of settled[1]; linking moves the inode's ctime, so it is made before the wait. */
+let settledLink = "";
+
+beforeAll(async () => {
+  for (let i = 0; i < 3; i++) {
+    settled.push(writeBig());
+  }
+  settledLink = fixtureFile("link-settled.bin");
+  linkSync(settled[1], settledLink);
+  await new Promise((resolve) => setTimeout(resolve, RACY_WINDOW_MS));
+}, 10_000);
+
+describe("hashMemoStats", () => {
+  it("returns a well-formed snapshot", () => {
+    const stats = hashMemoStats();
+    expect(stats.capacity).toBeGreaterThanOrEqual(16384);
+    expect(stats.capacity & (stats.capacity - 1)).toBe(0);
+    expect(stats.entries).toBeLessThanOrEqual(stats.capacity);
+    expect(stats.hits).toBeGreaterThanOrEqual(0);
+    expect(stats.misses).toBeGreaterThanOrEqual(0);
+  });
+
+  it("shares hashes between digestFilesParallel and caches", async () => {
+    const bigFile = settled[0];
+    const first = await digestFilesParallel([bigFile]);
+    const before = hashMemoStats();
+    expect(await digestFilesParallel([bigFile])).toEqual(first);
+
+    const cp = cachePath("shared");
+    const cache = new FileHashCache({ cachePath: cp, files: [bigFile], rootPath: FIXTURE_DIR, patchable: true });
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    expect(entryHash(cp, 0)).toEqual(digestBuffer(readFileSync(bigFile)));
+    expect(hashMemoStats().hits).toBeGreaterThanOrEqual(before.hits + 2);
+  });
+
+  it("hits for another hardlink of the same inode", async () => {
+    const bigFile = settled[1];
+    const first = await digestFilesParallel([bigFile]);
+    const before = hashMemoStats();
+    expect(await digestFilesParallel([settledLink])).toEqual(first);
+    expect(hashMemoStats().hits).toBeGreaterThanOrEqual(before.hits + 1);
+  });
+
+  it("re-reads a settled file rewritten with the same size and mtime", async () => {
+    // Memoized with a ctime over 2 s old; the rewrite's ctime is a later tick on any filesystem.
+    const bigFile = settled[2];
+    await digestFilesParallel([bigFile]);
+    await digestFilesParallel([bigFile]);
+    const st = statSync(bigFile);
+    writeFileSync(bigFile, bigContent(fileCounter + 1000));
+    utimesSync(bigFile, st.atime, st.mtime);
+    expect(await digestFilesParallel([bigFile])).toEqual(await referenceDigest(bigFile));
+  });
+
+  it("does not memoize a file written within the racy window", async () => {
+    const bigFile = writeBig();
+    await digestFilesParallel([bigFile]);
+    const st = statSync(bigFile);
+    // Same size, same mtime: only the memo could still return the old hash.
+    writeFileSync(bigFile, bigContent(fileCounter + 2000));
+    utimesSync(bigFile, st.atime, st.mtime);
+    expect(await digestFilesParallel([bigFile])).toEqual(await referenceDigest(bigFile));
+  });
+});
@@ -0,0 +1,116 @@
+/**
+ * Tests: FAST_FS_HASH_IO_URING — batched statx for the Linux stat-match.
+ *
+ * The backend is chosen once per process, so every open() runs in a child,
+ * once with the default fstatat path and once with io_uring. Both must agree
+ * on every status. Where io_uring is unavailable (non-Linux, seccomp,
+ * io_uring_disabled) the flag falls back to fstatat and the test still holds.
+ */
+
+import type { ChildProcess } from "node:child_process";
+
+import { fork } from "node:child_process";
+import { mkdirSync, rmSync, unlinkSync, utimesSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { afterAll, afterEach, beforeAll, describe, expect, it } from "vitest";
+
+const TEST_DIR = path.resolve(import.meta.dirname, "tmp/fhc-io-uring-stat");
+const CHILD_SCRIPT = path.resolve(import.meta.dirname, "../_child-process-helper.mjs");
+
+const BACKENDS = [
+  ["fstatat", { FAST_FS_HASH_IO_URING: "" }],
+  ["io_uring", { FAST_FS_HASH_IO_URING: "1" }],
+] as const;
+
+const activeChildren: Set<ChildProcess> = new Set();
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+function openInChild(
+  env: Record<string, string>,
+  args: { cachePath: string; rootPath: string; files: string[]; write?: boolean }
+): Promise<string> {
+  return new Promise((resolve, reject) => {
+    const child = fork(CHILD_SCRIPT, [JSON.stringify({ mode: "open-status", ...args })], {
+      stdio: "pipe",
+      env: { ...process.env, ...env },
+    });
+    activeChildren.add(child);
+    child.on("message", (msg: { status: string }) => {
+      resolve(msg.status);
+      child.kill("SIGKILL");
+    });
+    child.on("error", reject);
+    child.on("exit", (code, signal) => {
+      activeChildren.delete(child);
+      if (code !== 0 && signal !== "SIGKILL") {
+        reject(new Error(`open-status child exited with code ${code}`));
+      }
+    });
+  });
+}
+
+/** Status of a fresh open() under each backend, without writing. */
+async function statusByBackend(args: { cachePath: string; rootPath: string; files: string[] }): Promise<string[]> {
+  const out: string[] = [];
+  for (const [, env] of BACKENDS) {
+    out.push(await openInChild(env, args));
+  }
+  return out;
+}
+
+beforeAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+  mkdirSync(TEST_DIR, { recursive: true });
+});
+
+afterEach(() => {
+  for (const child of activeChildren) {
+    child.kill("SIGKILL");
+  }
+  activeChildren.clear();
+});
+
+afterAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+});
+
+describe("io_uring stat-match", () => {
+  // 3 files stat by absolute path (no root DirFd); 600 files span several
+  // io_uring batches relative to the root DirFd.
+  it.each([3, 600])("%i files: both backends agree on every status", async (count) => {
+    const rootPath = path.join(TEST_DIR, `set-${count}`);
+    const files: string[] = [];
+    for (let i = 0; i < count; i++) {
+      const file = path.join(rootPath, `d${i % 7}`, `f${i}.txt`);
+      mkdirSync(path.dirname(file), { recursive: true });
+      writeWithMtime(file, `file ${i}\n`);
+      files.push(file);
+    }
+    const cachePath = path.join(TEST_DIR, `set-${count}.cache`);
+    const args = { cachePath, rootPath, files };
+
+    expect(await openInChild({}, { ...args, write: true })).toBe("missing");
+    expect(await statusByBackend(args)).toEqual(["upToDate", "upToDate"]);
+
+    // Metadata-only change: same content, new mtime.
+    const last = files[count - 1];
+    writeWithMtime(last, `file ${count - 1}\n`);
+    expect(await statusByBackend(args)).toEqual(["statsDirty", "statsDirty"]);
+
+    // Same size, different content.
+    writeWithMtime(last, `fiLe ${count - 1}\n`);
+    expect(await statusByBackend(args)).toEqual(["changed", "changed"]);
+
+    expect(await openInChild({}, { ...args, write: true })).toBe("changed");
+    expect(await statusByBackend(args)).toEqual(["upToDate", "upToDate"]);
+
+    unlinkSync(files[count >> 1]);
+    expect(await statusByBackend(args)).toEqual(["changed", "changed"]);
+  });
+});
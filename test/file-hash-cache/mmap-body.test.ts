@@ -0,0 +1,126 @@
+/**
+ * Tests: mmap'd PLAIN cache bodies (FAST_FS_HASH_MMAP_MIN).
+ *
+ * A large PLAIN body is mapped MAP_PRIVATE instead of read, and the session's
+ * zero-copy views point into the mapping. The threshold is read once per
+ * process, so each open() runs in a child with FAST_FS_HASH_MMAP_MIN=1 (map
+ * every PLAIN body). The views must stay intact after the lock is released,
+ * whether the session wrote the file or someone else clobbered it.
+ */
+
+import type { ChildProcess } from "node:child_process";
+
+import { fork } from "node:child_process";
+import { mkdirSync, readFileSync, rmSync, utimesSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { FileHashCache } from "fast-fs-hash";
+import { afterAll, afterEach, beforeAll, describe, expect, it } from "vitest";
+import { BodyFormat } from "../../packages/fast-fs-hash/src/file-hash-cache-format";
+
+const TEST_DIR = path.resolve(import.meta.dirname, "tmp/fhc-mmap-body");
+const CHILD_SCRIPT = path.resolve(import.meta.dirname, "../_child-process-helper.mjs");
+
+const activeChildren: Set<ChildProcess> = new Set();
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+/** Deterministic xorshift32 bytes — LZ4 can't shrink them, so the writer picks PLAIN. */
+function incompressibleBytes(byteLength: number, seed: number): Buffer {
+  const out = Buffer.alloc(byteLength);
+  let s = seed >>> 0;
+  for (let i = 0; i < byteLength; i += 4) {
+    s ^= s << 13;
+    s ^= s >>> 17;
+    s ^= s << 5;
+    out.writeUInt32LE(s >>> 0, i);
+  }
+  return out;
+}
+
+function runInChild(args: {
+  cachePath: string;
+  rootPath: string;
+  files: string[];
+  clobber?: boolean;
+}): Promise<{ status: string; payload: string }> {
+  return new Promise((resolve, reject) => {
+    const child = fork(CHILD_SCRIPT, [JSON.stringify({ mode: "mmap-body", ...args })], {
+      stdio: "pipe",
+      env: { ...process.env, FAST_FS_HASH_MMAP_MIN: "1" },
+    });
+    activeChildren.add(child);
+    child.on("message", (msg: { status: string; payload: string }) => {
+      resolve(msg);
+      child.kill("SIGKILL");
+    });
+    child.on("error", reject);
+    child.on("exit", (code, signal) => {
+      activeChildren.delete(child);
+      if (code !== 0 && signal !== "SIGKILL") {
+        reject(new Error(`mmap-body child exited with code ${code} (signal ${signal})`));
+      }
+    });
+  });
+}
+
+beforeAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+  mkdirSync(TEST_DIR, { recursive: true });
+});
+
+afterEach(() => {
+  for (const child of activeChildren) {
+    child.kill("SIGKILL");
+  }
+  activeChildren.clear();
+});
+
+afterAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+});
+
+describe("mmap'd PLAIN cache body", () => {
+  async function setup(label: string) {
+    const rootPath = path.join(TEST_DIR, label);
+    mkdirSync(rootPath, { recursive: true });
+    const files: string[] = [];
+    for (let i = 0; i < 300; i++) {
+      const file = path.join(rootPath, `f${i}.txt`);
+      writeWithMtime(file, `file ${i}\n`);
+      files.push(file);
+    }
+    const cachePath = path.join(TEST_DIR, `${label}.cache`);
+    const payload = incompressibleBytes(256 * 1024, 0x9e3779b9);
+    const cache = new FileHashCache({ cachePath, files, rootPath, version: 1 });
+    {
+      using session = await cache.open();
+      await session.write({ compressedPayloads: [payload] });
+    }
+    expect(readFileSync(cachePath).readUInt32LE(0) >>> 24).toBe(BodyFormat.PLAIN);
+    return { cache, cachePath, rootPath, files, payload };
+  }
+
+  it("keeps payload views intact when the cache file is clobbered after close()", async () => {
+    const { cachePath, rootPath, files, payload } = await setup("clobber");
+    const result = await runInChild({ cachePath, rootPath, files, clobber: true });
+    expect(result.status).toBe("upToDate");
+    expect(result.payload).toBe(payload.toString("hex"));
+  });
+
+  it("writes from the mapped body and keeps payload views intact", async () => {
+    const { cache, cachePath, rootPath, files, payload } = await setup("write");
+    const result = await runInChild({ cachePath, rootPath, files });
+    expect(result.status).toBe("upToDate");
+    expect(result.payload).toBe(payload.toString("hex"));
+
+    // The child re-hashed files[0] and rewrote the cache from its mapping.
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+    expect(Buffer.from(session.compressedPayloads[0]).equals(payload)).toBe(true);
+  });
+});
@@ -0,0 +1,122 @@
+/**
+ * Tests: native watch mode (FileHashCache.watch).
+ *
+ * On Linux an inotify watcher on the tracked files' directories feeds the
+ * dirty set of the next open directly, so invalidate() is not needed. A
+ * structural change (a tracked directory renamed or created) makes the
+ * next open stat everything, and a tracked symlink is stat'ed on every
+ * open. Elsewhere watch() returns false and the tests are skipped.
+ */
+
+import { mkdirSync, renameSync, symlinkSync, utimesSync, writeFileSync } from "node:fs";
+import { FileHashCache } from "fast-fs-hash";
+import { describe, expect, it } from "vitest";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-native-watch");
+
+const supported = new FileHashCache({ cachePath: "unused.cache" }).watch();
+
+let epochCounter = 1700300000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+let dirCounter = 0;
+
+/** A written, watched, up-to-date cache of `<dir>/a.txt` and `<dir>/sub/b.txt`. */
+async function watchedCache(): Promise<{ cache: FileHashCache; dir: string }> {
+  const dir = `w${++dirCounter}`;
+  mkdirSync(fixtureFile(`${dir}/sub`), { recursive: true });
+  writeWithMtime(fixtureFile(`${dir}/a.txt`), "a\n");
+  writeWithMtime(fixtureFile(`${dir}/sub/b.txt`), "b\n");
+  const cache = new FileHashCache({
+    cachePath: cachePath("watch"),
+    files: [fixtureFile(`${dir}/a.txt`), fixtureFile(`${dir}/sub/b.txt`)],
+    rootPath: FIXTURE_DIR,
+  });
+  expect(cache.watch()).toBe(true);
+  {
+    using session = await cache.open();
+    expect(session.status).toBe("missing");
+    await session.write();
+  }
+  {
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+  }
+  return { cache, dir };
+}
+
+describe.skipIf(!supported)("native watch mode", () => {
+  it("reports a modified file without invalidate()", async () => {
+    const { cache, dir } = await watchedCache();
+    expect(cache.needsOpen).toBe(false);
+    writeWithMtime(fixtureFile(`${dir}/sub/b.txt`), "b changed\n");
+    expect(cache.needsOpen).toBe(true);
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("changed");
+      await session.write();
+    }
+    expect(cache.needsOpen).toBe(false);
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+  });
+
+  it("ignores untracked files in watched directories", async () => {
+    const { cache, dir } = await watchedCache();
+    writeFileSync(fixtureFile(`${dir}/untracked.txt`), "x\n");
+    expect(cache.needsOpen).toBe(false);
+  });
+
+  it("stats everything after a tracked directory is renamed", async () => {
+    const { cache, dir } = await watchedCache();
+    renameSync(fixtureFile(`${dir}/sub`), fixtureFile(`${dir}/sub2`));
+    expect(cache.needsOpen).toBe(true);
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("changed");
+    }
+    renameSync(fixtureFile(`${dir}/sub2`), fixtureFile(`${dir}/sub`));
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+  });
+
+  it("sees edits of a symlinked entry's target in an unwatched directory", async () => {
+    const dir = `w${++dirCounter}`;
+    mkdirSync(fixtureFile(`${dir}/tracked`), { recursive: true });
+    mkdirSync(fixtureFile(`${dir}/elsewhere`), { recursive: true });
+    writeWithMtime(fixtureFile(`${dir}/elsewhere/target.txt`), "t\n");
+    symlinkSync("../elsewhere/target.txt", fixtureFile(`${dir}/tracked/link.txt`));
+    const cache = new FileHashCache({
+      cachePath: cachePath("watch-symlink"),
+      files: [fixtureFile(`${dir}/tracked/link.txt`)],
+      rootPath: FIXTURE_DIR,
+    });
+    expect(cache.watch()).toBe(true);
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    // The symlink keeps the dirty set non-empty: every open stats it.
+    expect(cache.needsOpen).toBe(true);
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("upToDate");
+    }
+    writeWithMtime(fixtureFile(`${dir}/elsewhere/target.txt`), "target changed\n");
+    using session = await cache.open();
+    expect(session.status).toBe("changed");
+  });
+
+  it("unwatch() closes the watcher", async () => {
+    const { cache, dir } = await watchedCache();
+    cache.unwatch();
+    expect(cache.watching).toBe(false);
+    writeWithMtime(fixtureFile(`${dir}/a.txt`), "a changed\n");
+    expect(cache.needsOpen).toBe(false);
+  });
+});
@@ -0,0 +1,95 @@
+/**
+ * Tests: patchable cache bodies (`patchable` option).
+ *
+ * A patchable cache is always written PLAIN. When the next write keeps the
+ * same file list and payload sizes, only the changed bytes are written in
+ * place, so the file keeps its inode and size and must still read back
+ * exactly like a full rewrite.
+ */
+
+import { readFileSync, statSync, utimesSync, writeFileSync } from "node:fs";
+import { FileHashCache } from "fast-fs-hash";
+import { beforeEach, describe, expect, it } from "vitest";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-patch-write");
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+const files = Array.from({ length: 40 }, (_, i) => fixtureFile(`p${i}.txt`));
+
+function newCache(cp: string, patchable = true): FileHashCache {
+  return new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1, patchable });
+}
+
+/** Body encoding byte of the cache file's magic (0 = LZ4, 1 = PLAIN). */
+function bodyFormat(cp: string): number {
+  return readFileSync(cp)[3];
+}
+
+beforeEach(() => {
+  for (let i = 0; i < files.length; i++) {
+    writeWithMtime(files[i], `content ${i}\n`);
+  }
+});
+
+describe("patchable cache", () => {
+  it("writes PLAIN and patches a changed entry in place", async () => {
+    const cp = cachePath("patch");
+    const cache = newCache(cp);
+    {
+      using session = await cache.open();
+      await session.write({ payloadValue0: 1, compressedPayloads: [new Uint8Array([1, 2])] });
+    }
+    expect(bodyFormat(cp)).toBe(1);
+    const before = statSync(cp);
+
+    writeWithMtime(files[7], "content 7, changed\n");
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("changed");
+      await session.write({ payloadValue0: 2, compressedPayloads: [new Uint8Array([3, 4])] });
+    }
+    const after = statSync(cp);
+    expect(after.ino).toBe(before.ino);
+    expect(after.size).toBe(before.size);
+
+    using session = await newCache(cp).open();
+    expect(session.status).toBe("upToDate");
+    expect(session.payloadValue0).toBe(2);
+    expect([...session.compressedPayloads[0]]).toEqual([3, 4]);
+  });
+
+  it("falls back to a full rewrite when the layout changes", async () => {
+    const cp = cachePath("relayout");
+    const cache = newCache(cp);
+    {
+      using session = await cache.open();
+      await session.write({ compressedPayloads: [new Uint8Array([1])] });
+    }
+    {
+      using session = await cache.open();
+      await session.write({ compressedPayloads: [new Uint8Array([1, 2, 3, 4, 5])] });
+    }
+    using session = await newCache(cp).open();
+    expect(session.status).toBe("upToDate");
+    expect([...session.compressedPayloads[0]]).toEqual([1, 2, 3, 4, 5]);
+  });
+
+  it("resolve() does not clear the patchable flag", async () => {
+    const cp = cachePath("resolve");
+    const cache = newCache(cp);
+    {
+      using session = await cache.open();
+      await session.resolve();
+      await session.write();
+    }
+    expect(cache.patchable).toBe(true);
+    expect(bodyFormat(cp)).toBe(1);
+  });
+});
@@ -0,0 +1,220 @@
+/**
+ * Tests: validation of the paths loaded from a cache file.
+ *
+ * The native reader checks the whole paths region with a vectorized scan
+ * (packed_paths_safe in PathIndex.h). These tests corrupt the paths of a
+ * PLAIN cache file in place and check the reader agrees with a scalar
+ * reference of the is_unsafe_relative_path rules on every input, then
+ * drive the scan directly through the test-only cachePathsUnsafe hook: the
+ * vector path (packed and NUL-separated forms) against the native scalar
+ * one, on random regions whose lengths straddle the 16/32/64-byte blocks.
+ */
+
+import { readFileSync, writeFileSync } from "node:fs";
+import { FileHashCache } from "fast-fs-hash";
+import { beforeAll, describe, expect, it } from "vitest";
+import {
+  BodyFormat,
+  ENTRY_STRIDE,
+  H_COMPRESSED_PAYLOAD_ITEM_COUNT,
+  H_FILE_COUNT,
+  H_PATHS_LEN,
+  H_UNCOMPRESSED_PAYLOAD_ITEM_COUNT,
+  H_UNCOMPRESSED_PAYLOADS_LEN,
+  HEADER_SIZE,
+} from "../../packages/fast-fs-hash/src/file-hash-cache-format";
+import { binding } from "../../packages/fast-fs-hash/src/init-native";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-path-validation");
+
+/** Test-only native hook, deliberately left out of the binding typings. */
+const testHooks = binding as unknown as {
+  cachePathsUnsafe(paths: Uint8Array, ends: Uint32Array | null, vector: boolean): boolean;
+};
+
+const FILE_COUNT = 40;
+
+function isSep(c: number): boolean {
+  return c === 0x2f || c === 0x5c;
+}
+
+/** Scalar reference: the rules of is_unsafe_relative_path, plus the NUL
+ *  and empty-segment checks of CacheHeader::packedPathsValid. */
+function segmentUnsafe(seg: Uint8Array): boolean {
+  if (seg.length === 0 || seg.includes(0)) {
+    return true;
+  }
+  if (isSep(seg[0]) || (seg.length >= 2 && seg[1] === 0x3a)) {
+    return true;
+  }
+  for (let i = 0; i + 1 < seg.length; i++) {
+    if (
+      seg[i] === 0x2e &&
+      seg[i + 1] === 0x2e &&
+      (i === 0 || isSep(seg[i - 1])) &&
+      (i + 2 === seg.length || isSep(seg[i + 2]))
+    ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Deterministic xorshift32 stream (see binary-format.test.ts). */
+function xorshift32(seed: number): () => number {
+  let s = seed >>> 0;
+  return () => {
+    s ^= s << 13;
+    s ^= s >>> 17;
+    s ^= s << 5;
+    return s >>> 0;
+  };
+}
+
+function incompressibleBytes(byteLength: number, seed: number): Buffer {
+  const next = xorshift32(seed);
+  const out = Buffer.alloc(byteLength);
+  for (let i = 0; i < byteLength; i += 4) {
+    out.writeUInt32LE(next(), i);
+  }
+  return out;
+}
+
+/** Offset and per-file end offsets of the paths region in a PLAIN cache file. */
+function pathsRegionOf(data: Buffer): { offset: number; ends: number[]; length: number } {
+  const fc = data.readUInt32LE(H_FILE_COUNT);
+  const uncCount = data.readUInt32LE(H_UNCOMPRESSED_PAYLOAD_ITEM_COUNT);
+  const uncLen = data.readUInt32LE(H_UNCOMPRESSED_PAYLOADS_LEN);
+  const compCount = data.readUInt32LE(H_COMPRESSED_PAYLOAD_ITEM_COUNT);
+  const pathEnds = HEADER_SIZE + uncCount * 4 + uncLen + fc * ENTRY_STRIDE + compCount * 4;
+  const ends: number[] = [];
+  for (let i = 0; i < fc; i++) {
+    ends.push(data.readUInt32LE(pathEnds + i * 4));
+  }
+  return { offset: pathEnds + fc * 4, ends, length: data.readUInt32LE(H_PATHS_LEN) };
+}
+
+beforeAll(() => {
+  for (let i = 0; i < FILE_COUNT; i++) {
+    writeFileSync(fixtureFile(`path-${String(i).padStart(3, "0")}.txt`), `file ${i}\n`);
+  }
+});
+
+describe("cache path validation [native]", () => {
+  it("rejects exactly the paths the scalar rules reject", async () => {
+    const base = cachePath("base");
+    const files = Array.from({ length: FILE_COUNT }, (_, i) => fixtureFile(`path-${String(i).padStart(3, "0")}.txt`));
+    {
+      const cache = new FileHashCache({ cachePath: base, files, rootPath: FIXTURE_DIR, version: 1 });
+      using session = await cache.open();
+      // Incompressible payload: the writer keeps the body PLAIN, so the
+      // paths can be edited in place.
+      await session.write({ compressedPayloads: [incompressibleBytes(1 << 20, 0x9e3779b9)] });
+    }
+    const original = readFileSync(base);
+    expect(original.readUInt8(3)).toBe(BodyFormat.PLAIN);
+    const region = pathsRegionOf(original);
+
+    const alphabet = [0x2e, 0x2e, 0x2e, 0x2f, 0x5c, 0x3a, 0x61, 0x00];
+    const next = xorshift32(0x1234567);
+    const seen = { safe: 0, unsafe: 0 };
+    for (let trial = 0; trial < 150; trial++) {
+      const data = Buffer.from(original);
+      const paths = data.subarray(region.offset, region.offset + region.length);
+      // A few short runs of path punctuation at random offsets, some of
+      // them straddling segment boundaries.
+      const runs = 1 + (next() % 3);
+      for (let r = 0; r < runs; r++) {
+        const at = next() % paths.length;
+        const len = 1 + (next() % 4);
+        for (let k = at; k < Math.min(at + len, paths.length); k++) {
+          paths[k] = alphabet[next() % (trial % 4 === 0 ? alphabet.length : alphabet.length - 1)];
+        }
+      }
+      let expectUnsafe = false;
+      let prev = 0;
+      for (const end of region.ends) {
+        expectUnsafe ||= segmentUnsafe(paths.subarray(prev, end));
+        prev = end;
+      }
+      seen[expectUnsafe ? "unsafe" : "safe"]++;
+
+      const cp = cachePath("fuzz");
+      writeFileSync(cp, data);
+      const cache = new FileHashCache({ cachePath: cp, rootPath: FIXTURE_DIR, version: 1 });
+      using session = await cache.open();
+      expect(session.status === "missing", `trial ${trial}: ${paths.toString("latin1")}`).toBe(expectUnsafe);
+    }
+    expect(seen.safe).toBeGreaterThan(0);
+    expect(seen.unsafe).toBeGreaterThan(0);
+  });
+
+  /** Region lengths around each vector block size, plus random ones. */
+  const LENGTHS = [1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 47, 48, 49, 63, 64, 65, 95, 96, 97, 127, 128, 129, 200, 1000];
+  const FUZZ_ALPHABET = [0x2e, 0x2e, 0x2e, 0x2f, 0x5c, 0x3a, 0x61, 0x62, 0xc3, 0xa9];
+
+  /** Random path bytes from FUZZ_ALPHABET, cut into segments; `cut` marks a segment end. */
+  function randomRegion(next: () => number, length: number, cut: number): { bytes: Uint8Array; ends: number[] } {
+    const bytes = new Uint8Array(length);
+    const ends: number[] = [];
+    for (let i = 0; i < length; i++) {
+      bytes[i] = FUZZ_ALPHABET[next() % FUZZ_ALPHABET.length];
+      if (i + 1 === length || next() % cut === 0) {
+        ends.push(i + 1);
+      }
+    }
+    return { bytes, ends };
+  }
+
+  it("vector scan of packed paths matches the scalar rules", () => {
+    const next = xorshift32(0x5eed1234);
+    const seen = { safe: 0, unsafe: 0 };
+    for (let trial = 0; trial < 4000; trial++) {
+      const length = trial < LENGTHS.length * 40 ? LENGTHS[trial % LENGTHS.length] : 1 + (next() % 300);
+      const { bytes, ends } = randomRegion(next, length, 2 + (trial % 24));
+      if (trial % 16 === 0) {
+        bytes[next() % length] = 0; // stray NUL
+      }
+      const endsArr = Uint32Array.from(ends);
+      const scalar = testHooks.cachePathsUnsafe(bytes, endsArr, false);
+      let expected = false;
+      let prev = 0;
+      for (const end of ends) {
+        expected ||= segmentUnsafe(bytes.subarray(prev, end));
+        prev = end;
+      }
+      const label = `trial ${trial}: ${Buffer.from(bytes).toString("latin1")} / ${ends.join(",")}`;
+      expect(scalar, label).toBe(expected);
+      expect(testHooks.cachePathsUnsafe(bytes, endsArr, true), label).toBe(scalar);
+      seen[scalar ? "unsafe" : "safe"]++;
+    }
+    expect(seen.safe).toBeGreaterThan(100);
+    expect(seen.unsafe).toBeGreaterThan(100);
+  });
+
+  it("vector scan of NUL-separated paths matches the scalar rules", () => {
+    const next = xorshift32(0x0badf00d);
+    const seen = { safe: 0, unsafe: 0 };
+    for (let trial = 0; trial < 4000; trial++) {
+      const length = trial < LENGTHS.length * 40 ? LENGTHS[trial % LENGTHS.length] : 1 + (next() % 300);
+      const { bytes, ends } = randomRegion(next, length, 2 + (trial % 24));
+      // Same segments, each followed by its NUL terminator.
+      const joined = new Uint8Array(length + ends.length);
+      let prev = 0;
+      let o = 0;
+      for (const end of ends) {
+        joined.set(bytes.subarray(prev, end), o);
+        o += end - prev;
+        joined[o++] = 0;
+        prev = end;
+      }
+      const scalar = testHooks.cachePathsUnsafe(joined, null, false);
+      const label = `trial ${trial}: ${Buffer.from(joined).toString("latin1")}`;
+      expect(testHooks.cachePathsUnsafe(joined, null, true), label).toBe(scalar);
+      seen[scalar ? "unsafe" : "safe"]++;
+    }
+    expect(seen.safe).toBeGreaterThan(100);
+    expect(seen.unsafe).toBeGreaterThan(100);
+  });
+});
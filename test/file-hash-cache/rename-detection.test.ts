@@ -0,0 +1,153 @@
+/**
+ * Tests: renamed and moved files keep their hashes across a file-list change.
+ *
+ * When the file list changes, the writer indexes the old entries no new
+ * path matched by (ino, size, mtime). A new path whose stat hits that
+ * index, and whose birth time proves it is the same inode, takes the old
+ * hash without the file being read. Where there is no birth time (Windows,
+ * filesystems without one) every new path is read.
+ */
+
+import { mkdirSync, readFileSync, renameSync, statSync, unlinkSync, utimesSync, writeFileSync } from "node:fs";
+import { digestBuffer, FileHashCache } from "fast-fs-hash";
+import { beforeEach, describe, expect, it } from "vitest";
+import { ENTRY_STRIDE, HEADER_SIZE } from "../../packages/fast-fs-hash/src/file-hash-cache-format";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-rename-detection");
+
+const COUNT = 20;
+const names = Array.from({ length: COUNT }, (_, i) => `f${String(i).padStart(2, "0")}.txt`);
+
+let epochCounter = 1700200000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+/** Content hash of entry `i` of a PLAIN cache without payloads, canonical byte order. */
+function entryHash(cp: string, i: number): Buffer {
+  const data = readFileSync(cp);
+  const off = HEADER_SIZE + i * ENTRY_STRIDE + 32;
+  return Buffer.from(data.subarray(off, off + 16)).reverse();
+}
+
+const hasBirthTime = process.platform !== "win32" && statSync(FIXTURE_DIR).birthtimeMs > 0;
+
+let dirCounter = 0;
+let dir = "";
+
+beforeEach(() => {
+  dir = `pkg${++dirCounter}`;
+  mkdirSync(fixtureFile(dir), { recursive: true });
+  for (let i = 0; i < COUNT; i++) {
+    writeWithMtime(fixtureFile(`${dir}/${names[i]}`), `file ${i}\n`);
+  }
+});
+
+/** Write a cache of `dir`, then rename the directory and point the cache at the new paths. */
+async function writeThenRename(cp: string): Promise<{ cache: FileHashCache; moved: string }> {
+  const cache = new FileHashCache({
+    cachePath: cp,
+    files: names.map((n) => fixtureFile(`${dir}/${n}`)),
+    rootPath: FIXTURE_DIR,
+    patchable: true,
+  });
+  {
+    using session = await cache.open();
+    await session.write();
+  }
+  const moved = `${dir}-moved`;
+  renameSync(fixtureFile(dir), fixtureFile(moved));
+  cache.files = names.map((n) => fixtureFile(`${moved}/${n}`));
+  return { cache, moved };
+}
+
+describe("rename detection", () => {
+  it("keeps the hashes of a renamed directory", async () => {
+    const cp = cachePath("dir");
+    const { cache } = await writeThenRename(cp);
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("changed");
+      await session.write();
+    }
+    for (let i = 0; i < COUNT; i++) {
+      expect(entryHash(cp, i)).toEqual(digestBuffer(Buffer.from(`file ${i}\n`)));
+    }
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+  });
+
+  it("re-hashes a moved file whose mtime changed", async () => {
+    const cp = cachePath("edited");
+    const { cache, moved } = await writeThenRename(cp);
+    writeWithMtime(fixtureFile(`${moved}/${names[3]}`), "file 3 edited\n");
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    expect(entryHash(cp, 3)).toEqual(digestBuffer(Buffer.from("file 3 edited\n")));
+    expect(entryHash(cp, 4)).toEqual(digestBuffer(Buffer.from("file 4\n")));
+  });
+
+  it.skipIf(!hasBirthTime)("does not read a moved file whose stat matches", async () => {
+    const cp = cachePath("reuse");
+    const { cache, moved } = await writeThenRename(cp);
+    // Same size, mtime put back: only a reused hash can still say "file 5".
+    const p = fixtureFile(`${moved}/${names[5]}`);
+    const st = statSync(p);
+    writeFileSync(p, "FILE 5\n");
+    utimesSync(p, st.atime, st.mtime);
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    expect(entryHash(cp, 5)).toEqual(digestBuffer(Buffer.from("file 5\n")));
+  });
+
+  it("re-hashes a new file that reuses a deleted file's inode and mtime", async () => {
+    const cp = cachePath("reused-inode");
+    const cache = new FileHashCache({
+      cachePath: cp,
+      files: names.map((n) => fixtureFile(`${dir}/${n}`)),
+      rootPath: FIXTURE_DIR,
+      patchable: true,
+    });
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    // Delete f07 and create files until one gets its inode number back
+    // (extraction with preserved mtimes). Filesystems that never reuse an
+    // inode right away leave nothing to check.
+    const old = fixtureFile(`${dir}/${names[7]}`);
+    const st = statSync(old);
+    unlinkSync(old);
+    let reused = "";
+    for (let i = 0; i < 64 && !reused; i++) {
+      const p = fixtureFile(`${dir}/new${i}.txt`);
+      writeFileSync(p, "FILE 7\n");
+      if (statSync(p).ino === st.ino) {
+        utimesSync(p, st.atime, st.mtime);
+        reused = p;
+      } else {
+        unlinkSync(p);
+      }
+    }
+    if (!reused) {
+      return;
+    }
+    cache.files = [...names.filter((_, i) => i !== 7).map((n) => fixtureFile(`${dir}/${n}`)), reused];
+    {
+      using session = await cache.open();
+      await session.write();
+    }
+    using session = await cache.open();
+    expect(session.status).toBe("upToDate");
+    const i = session.files.indexOf(reused);
+    expect(i).toBeGreaterThanOrEqual(0);
+    expect(entryHash(cp, i)).toEqual(digestBuffer(Buffer.from("FILE 7\n")));
+  });
+});
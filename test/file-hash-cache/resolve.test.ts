@@ -29,6 +29,39 @@ beforeAll(() => {
   writeFileSync(fx("c.txt"), "ccc\n");
 });
 
+/** Names whose UTF-16 and UTF-8 orders disagree: U+E000..U+FFFF sorts after
+ *  the surrogates of astral characters in UTF-16 but before them in UTF-8.
+ *  Plain names are mixed in so the lookups binary-search a real list. */
+const MIXED_NAMES = [
+  ...Array.from({ length: 40 }, (_, i) => `u/f-${i}.txt`),
+  "u/\u07ff.txt",
+  "u/\u0800.txt",
+  "u/\ud7ff.txt",
+  "u/\ue000.txt",
+  "u/\ue000\u{1f600}.txt",
+  "u/\uf8ff-x.txt",
+  "u/\ufb01.txt",
+  "u/\ufefe.txt",
+  "u/\uff21.txt",
+  "u/\ufffd.txt",
+  "u/\u{10000}.txt",
+  "u/\u{1d11e}.txt",
+  "u/\u{1f600}.txt",
+  "u/\u{1f600}\ue000.txt",
+  "u/m/a.txt",
+  "u/m\ue001/a.txt",
+  "u/m\u{1f601}/a.txt",
+  "u/z\u00e9.txt",
+];
+
+function writeMixedNames(): string[] {
+  return MIXED_NAMES.map((n) => {
+    mkdirSync(path.dirname(fx(n)), { recursive: true });
+    writeFileSync(fx(n), `${n}\n`);
+    return fx(n);
+  });
+}
+
 afterAll(() => {
   rmSync(TEST_DIR, { recursive: true, force: true });
 });
@@ -132,6 +165,39 @@ describe("session.resolve()", () => {
     expect(entries.find("/nonexistent")).toBeUndefined();
   });
 
+  it("find locates every entry of a larger list", async () => {
+    const names = Array.from({ length: 300 }, (_, i) => `many/d${i % 7}/f-${i}.txt`);
+    for (const n of names) {
+      mkdirSync(path.dirname(fx(n)), { recursive: true });
+      writeFileSync(fx(n), `${n}\n`);
+    }
+    const cache = new FileHashCache({ cachePath: cp(), files: names.map(fx), rootPath: FIXTURE_DIR });
+
+    using session = await cache.open();
+    const entries = await session.resolve();
+
+    for (const e of entries) {
+      expect(entries.find(e.path)).toBe(e);
+    }
+    expect(entries.find(fx("many/d0/missing.txt"))).toBeUndefined();
+    expect(entries.find(fx("many"))).toBeUndefined();
+  });
+
+  it("find locates every entry when paths mix U+E000..U+FFFF and astral characters", async () => {
+    const cache = new FileHashCache({ cachePath: cp(), files: writeMixedNames(), rootPath: FIXTURE_DIR });
+
+    using session = await cache.open();
+    const entries = await session.resolve();
+
+    expect(entries.length).toBe(MIXED_NAMES.length);
+    for (const e of entries) {
+      expect(entries.find(e.path), e.path).toBe(e);
+    }
+    expect(entries.find(fx("u/\ue002.txt"))).toBeUndefined();
+    expect(entries.find(fx("u/\u{1f602}.txt"))).toBeUndefined();
+    expect(entries.find(fx("u/m\ue001"))).toBeUndefined();
+  });
+
   it("different files produce different hashes", async () => {
     const files = [fx("a.txt"), fx("b.txt")];
     const cache = new FileHashCache({ cachePath: cp(), files, rootPath: FIXTURE_DIR });
@@ -0,0 +1,132 @@
+/**
+ * Tests: sharded cache layout (`shards` option).
+ *
+ * With shards > 1 the cache file is a small manifest and entries live in
+ * `<cachePath>.shard-<k>` files partitioned by parent directory, plus a
+ * `<cachePath>.shard-p` file for compressed payloads. A write only replaces
+ * the shards whose contents changed; a missing or damaged shard makes the
+ * whole cache read as missing.
+ */
+
+import { existsSync, mkdirSync, readdirSync, rmSync, statSync, utimesSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { FileHashCache } from "fast-fs-hash";
+import { beforeEach, describe, expect, it } from "vitest";
+import { setupCacheTestDir } from "./_fixture-utils";
+
+const { FIXTURE_DIR, cachePath, fixtureFile } = setupCacheTestDir("fhc-sharded");
+
+let epochCounter = 1700000000;
+function writeWithMtime(filePath: string, content: string): void {
+  writeFileSync(filePath, content);
+  const t = new Date(++epochCounter * 1000);
+  utimesSync(filePath, t, t);
+}
+
+const files = Array.from({ length: 64 }, (_, i) => fixtureFile(`d${i % 16}/f${i}.txt`));
+
+function newCache(cp: string, shards = 8): FileHashCache {
+  return new FileHashCache({ cachePath: cp, files, rootPath: FIXTURE_DIR, version: 1, shards });
+}
+
+function shardFiles(cp: string): Map<string, number> {
+  const dir = path.dirname(cp);
+  const prefix = `${path.basename(cp)}.shard-`;
+  const out = new Map<string, number>();
+  for (const name of readdirSync(dir)) {
+    if (name.startsWith(prefix)) {
+      out.set(name.slice(prefix.length), statSync(path.join(dir, name)).ino);
+    }
+  }
+  return out;
+}
+
+beforeEach(() => {
+  for (let i = 0; i < files.length; i++) {
+    mkdirSync(path.dirname(files[i]), { recursive: true });
+    writeWithMtime(files[i], `content ${i}\n`);
+  }
+});
+
+describe("sharded cache", () => {
+  it("round-trips entries and payloads", async () => {
+    const cp = cachePath("round-trip");
+    {
+      using session = await newCache(cp).open();
+      expect(session.status).toBe("missing");
+      await session.write({ compressedPayloads: [new Uint8Array([1, 2, 3])] });
+    }
+    expect(shardFiles(cp).has("p")).toBe(true);
+    expect(shardFiles(cp).size).toBeGreaterThan(2);
+
+    using session = await newCache(cp).open();
+    expect(session.status).toBe("upToDate");
+    expect([...session.compressedPayloads[0]]).toEqual([1, 2, 3]);
+  });
+
+  it("rewrites only the shard holding a changed file", async () => {
+    const cp = cachePath("one-shard");
+    const cache = newCache(cp);
+    {
+      using session = await cache.open();
+      await session.write({ compressedPayloads: [new Uint8Array([4])] });
+    }
+    const before = shardFiles(cp);
+
+    writeWithMtime(files[5], "changed content\n");
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("changed");
+      await session.write();
+    }
+    const after = shardFiles(cp);
+    expect([...after.keys()].sort()).toEqual([...before.keys()].sort());
+    const replaced = [...after].filter(([k, ino]) => before.get(k) !== ino).map(([k]) => k);
+    expect(replaced).toHaveLength(1);
+    expect(replaced[0]).not.toBe("p");
+
+    using session = await newCache(cp).open();
+    expect(session.status).toBe("upToDate");
+  });
+
+  it("reports missing when a shard file is gone", async () => {
+    const cp = cachePath("lost-shard");
+    {
+      using session = await newCache(cp).open();
+      await session.write();
+    }
+    const [first] = shardFiles(cp).keys();
+    rmSync(`${cp}.shard-${first}`);
+
+    using session = await newCache(cp).open();
+    expect(session.status).toBe("missing");
+  });
+
+  it("removes shard files when switching back to a single file", async () => {
+    const cp = cachePath("unshard");
+    const cache = newCache(cp);
+    {
+      using session = await cache.open();
+      await session.write({ compressedPayloads: [new Uint8Array([9])] });
+    }
+    expect(shardFiles(cp).size).toBeGreaterThan(0);
+
+    cache.shards = 0;
+    {
+      using session = await cache.open();
+      expect(session.status).toBe("upToDate");
+      await session.write();
+    }
+    expect(shardFiles(cp).size).toBe(0);
+    expect(existsSync(cp)).toBe(true);
+
+    using session = await newCache(cp, 0).open();
+    expect(session.status).toBe("upToDate");
+    expect([...session.compressedPayloads[0]]).toEqual([9]);
+  });
+
+  it("rejects out-of-range shard counts", () => {
+    expect(() => newCache(cachePath("range"), 65)).toThrow(RangeError);
+    expect(() => newCache(cachePath("range"), 1.5)).toThrow(RangeError);
+  });
+});
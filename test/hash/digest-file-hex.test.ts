@@ -1,6 +1,6 @@
 import { mkdirSync, rmSync, writeFileSync } from "node:fs";
 import { join } from "node:path";
-import { digestFile, digestFilesToHexArray, digestFileToHex, hashToHex } from "fast-fs-hash";
+import { digestBuffer, digestFile, digestFilesToHexArray, digestFileToHex, hashToHex } from "fast-fs-hash";
 import { afterAll, beforeAll, describe, expect, it } from "vitest";
 
 const TMP_DIR = join(__dirname, "..", "tmp", "digest-file-hex");
@@ -20,6 +20,21 @@ function tmpFile(name: string, content: Buffer | string): string {
   return p;
 }
 
+describe("digestFile inline and pooled paths", () => {
+  // A streak of small files switches digestFile to inline; a large one switches it back.
+  it.each([0, 1, 4096, 8192, 8193, 65536, 300_000])("matches digestBuffer for %i bytes", async (size) => {
+    const data = Buffer.alloc(size);
+    for (let i = 0; i < size; i++) {
+      data[i] = (i * 31 + 7) & 0xff;
+    }
+    const path = tmpFile(`inline-${size}.bin`, data);
+    const expected = hashToHex(digestBuffer(data));
+    for (let i = 0; i < 12; i++) {
+      expect(hashToHex(await digestFile(path))).toBe(expected);
+    }
+  });
+});
+
 describe("digestFileToHex", () => {
   it("returns a 32-character hex string", async () => {
     const path = tmpFile("hex-basic.txt", "hello world");
@@ -0,0 +1,104 @@
+/**
+ * Tests: FAST_FS_HASH_READ_BUFFER_SIZE / FAST_FS_HASH_HUGE_PAGES.
+ *
+ * The read size only changes how files are chunked, never the digests. The
+ * size is read once per process, so each configuration runs in a child and
+ * its results are compared against this process (default 128 KiB reads).
+ */
+
+import type { ChildProcess } from "node:child_process";
+
+import { fork } from "node:child_process";
+import { copyFileSync, mkdirSync, rmSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { digestFile, digestFilesParallel, digestFilesSequential } from "fast-fs-hash";
+import { afterAll, afterEach, beforeAll, describe, expect, it } from "vitest";
+
+const TEST_DIR = path.resolve(import.meta.dirname, "../tmp/read-buffer-size");
+const CHILD_SCRIPT = path.resolve(import.meta.dirname, "../_child-process-helper.mjs");
+
+// Straddle the minimum (32 KiB), the default (128 KiB) and a multi-MiB read.
+const SIZES = [0, 1000, 32 * 1024, 32 * 1024 + 1, 128 * 1024 + 7, 3 * 1024 * 1024 + 11];
+
+interface ReadSizeResult {
+  single: string[];
+  parallel: string;
+  sequential: string;
+  equal: boolean[];
+}
+
+const activeChildren: Set<ChildProcess> = new Set();
+
+let files: string[] = [];
+let expected: ReadSizeResult;
+
+function readSizeInChild(env: Record<string, string>): Promise<ReadSizeResult> {
+  return new Promise((resolve, reject) => {
+    const child = fork(CHILD_SCRIPT, [JSON.stringify({ mode: "read-size", files })], {
+      stdio: "pipe",
+      env: { ...process.env, ...env },
+    });
+    activeChildren.add(child);
+    child.on("message", (msg: ReadSizeResult) => {
+      resolve(msg);
+      child.kill("SIGKILL");
+    });
+    child.on("error", reject);
+    child.on("exit", (code, signal) => {
+      activeChildren.delete(child);
+      if (code !== 0 && signal !== "SIGKILL") {
+        reject(new Error(`read-size child exited with code ${code}`));
+      }
+    });
+  });
+}
+
+beforeAll(async () => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+  mkdirSync(TEST_DIR, { recursive: true });
+  files = SIZES.map((size) => {
+    const data = Buffer.alloc(size);
+    for (let i = 0; i < size; i++) {
+      data[i] = (i * 131 + (i >>> 12)) & 0xff;
+    }
+    const file = path.join(TEST_DIR, `f-${size}.bin`);
+    writeFileSync(file, data);
+    copyFileSync(file, `${file}.copy`);
+    return file;
+  });
+
+  const single: string[] = [];
+  for (const file of files) {
+    single.push((await digestFile(file)).toString("hex"));
+  }
+  expected = {
+    single,
+    parallel: (await digestFilesParallel(files)).toString("hex"),
+    sequential: (await digestFilesSequential(files)).toString("hex"),
+    equal: files.map(() => true),
+  };
+});
+
+afterEach(() => {
+  for (const child of activeChildren) {
+    child.kill("SIGKILL");
+  }
+  activeChildren.clear();
+});
+
+afterAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+});
+
+describe("read buffer size", () => {
+  it.each([
+    ["minimum (32k)", { FAST_FS_HASH_READ_BUFFER_SIZE: "32k" }],
+    ["below minimum clamps", { FAST_FS_HASH_READ_BUFFER_SIZE: "100" }],
+    ["unaligned bytes", { FAST_FS_HASH_READ_BUFFER_SIZE: "70000" }],
+    ["4 MiB", { FAST_FS_HASH_READ_BUFFER_SIZE: "4m" }],
+    ["4 MiB + huge pages", { FAST_FS_HASH_READ_BUFFER_SIZE: "4m", FAST_FS_HASH_HUGE_PAGES: "1" }],
+    ["garbage falls back to default", { FAST_FS_HASH_READ_BUFFER_SIZE: "lots" }],
+  ])("%s gives the same digests", async (_name, env) => {
+    expect(await readSizeInChild(env)).toEqual(expected);
+  });
+});
@@ -210,5 +210,33 @@ describe("LZ4 block compression", () => {
       const decompressed = lz4DecompressBlock(compressed, 400);
       expectBuffersEqual(decompressed, sub);
     });
+
+    it("round-trips on both sides of the inline cutoff", async () => {
+      // Interactive decompression up to 16 KiB runs inline; background always uses the pool.
+      for (const size of [1, 1024, 16 * 1024, 16 * 1024 + 1, 256 * 1024]) {
+        const input = Buffer.alloc(size);
+        for (let i = 0; i < size; i++) {
+          input[i] = (i % 251) ^ (i >> 9);
+        }
+        const inlineOrPool = await lz4CompressBlockAsync(input);
+        const pooled = await lz4CompressBlockAsync(input, undefined, undefined, "background");
+        expectBuffersEqual(inlineOrPool, pooled);
+        expectBuffersEqual(await lz4DecompressBlockAsync(inlineOrPool, size), input);
+        expectBuffersEqual(
+          await lz4DecompressBlockAsync(pooled, size, undefined, undefined, "background"),
+          input
+        );
+      }
+    });
+
+    it("background priority round-trips alongside interactive work", async () => {
+      const [compressed, interactive] = await Promise.all([
+        lz4CompressBlockAsync(testData, undefined, undefined, "background"),
+        lz4CompressBlockAsync(testData),
+      ]);
+      expectBuffersEqual(compressed, interactive);
+      const decompressed = await lz4DecompressBlockAsync(compressed, testData.length, undefined, undefined, "background");
+      expectBuffersEqual(decompressed, testData);
+    });
   });
 });
@@ -0,0 +1,143 @@
+/**
+ * Tests: thread-count autotuning (FAST_FS_HASH_AUTOTUNE / _PROFILE).
+ *
+ * The tuner is process-wide and configured once, so each run happens in a
+ * child. Tuning may only change how many threads hash — never the digests.
+ */
+
+import type { ChildProcess } from "node:child_process";
+import type { ThreadPoolTuning } from "fast-fs-hash";
+
+import { fork } from "node:child_process";
+import { existsSync, mkdirSync, readFileSync, rmSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { digestFilesParallel, threadPoolTuning } from "fast-fs-hash";
+import { afterAll, afterEach, beforeAll, describe, expect, it } from "vitest";
+
+const TEST_DIR = path.resolve(import.meta.dirname, "tmp/fhc-pool-autotune");
+const PROFILE = path.join(TEST_DIR, "autotune.profile");
+const CHILD_SCRIPT = path.resolve(import.meta.dirname, "../_child-process-helper.mjs");
+
+// Above ThreadTuner::MIN_SAMPLE_FILES (256), so every call is a sample.
+const FILE_COUNT = 300;
+// ThreadTuner::SAMPLES_PER_STEP is 3: a dozen calls move the cap at least once.
+const ITERATIONS = 12;
+
+interface AutotuneResult {
+  tuning: ThreadPoolTuning;
+  digest: string;
+}
+
+const activeChildren: Set<ChildProcess> = new Set();
+
+const files: string[] = [];
+let expectedDigest = "";
+
+function autotuneInChild(env: Record<string, string>, iterations = ITERATIONS): Promise<AutotuneResult> {
+  return new Promise((resolve, reject) => {
+    const child = fork(CHILD_SCRIPT, [JSON.stringify({ mode: "autotune", files, iterations })], {
+      stdio: "pipe",
+      env: { ...process.env, FAST_FS_HASH_AUTOTUNE: "", FAST_FS_HASH_AUTOTUNE_PROFILE: "", ...env },
+    });
+    activeChildren.add(child);
+    // The profile is saved at env teardown: wait for a clean exit.
+    let result: AutotuneResult | undefined;
+    child.on("message", (msg: AutotuneResult) => {
+      result = msg;
+    });
+    child.on("error", reject);
+    child.on("exit", (code) => {
+      activeChildren.delete(child);
+      if (code === 0 && result) {
+        resolve(result);
+      } else {
+        reject(new Error(`autotune child exited with code ${code}`));
+      }
+    });
+  });
+}
+
+beforeAll(async () => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+  mkdirSync(TEST_DIR, { recursive: true });
+  for (let i = 0; i < FILE_COUNT; i++) {
+    const file = path.join(TEST_DIR, `f${i}.txt`);
+    writeFileSync(file, `file ${i}\n`.repeat((i % 17) + 1));
+    files.push(file);
+  }
+  expectedDigest = (await digestFilesParallel(files)).toString("hex");
+});
+
+afterEach(() => {
+  for (const child of activeChildren) {
+    child.kill("SIGKILL");
+  }
+  activeChildren.clear();
+});
+
+afterAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+});
+
+describe("threadPoolTuning", () => {
+  it("is disabled by default", () => {
+    if (process.env.FAST_FS_HASH_AUTOTUNE || process.env.FAST_FS_HASH_AUTOTUNE_PROFILE) {
+      return;
+    }
+    const tuning = threadPoolTuning();
+    expect(tuning.enabled).toBe(false);
+    expect(tuning.profilePath).toBeNull();
+    expect(tuning.profiles).toEqual([]);
+  });
+
+  it("learns a hashFiles profile without changing digests", async () => {
+    const { tuning, digest } = await autotuneInChild({ FAST_FS_HASH_AUTOTUNE: "1" });
+    expect(digest).toBe(expectedDigest);
+    expect(tuning.enabled).toBe(true);
+    expect(tuning.profilePath).toBeNull();
+
+    const profile = tuning.profiles.find((p) => p.op === "hashFiles");
+    expect(profile).toBeDefined();
+    expect(profile!.threads).toBeGreaterThanOrEqual(1);
+    expect(profile!.samples.length).toBeGreaterThanOrEqual(1);
+    let total = 0;
+    for (const s of profile!.samples) {
+      expect(s.threads).toBeGreaterThanOrEqual(1);
+      expect(s.filesPerSec).toBeGreaterThan(0);
+      expect(s.bytesPerSec).toBeGreaterThan(0);
+      total += s.samples;
+    }
+    expect(total).toBeGreaterThanOrEqual(1);
+  });
+
+  it("saves the profile and loads it in the next process", async () => {
+    rmSync(PROFILE, { force: true });
+    const first = await autotuneInChild({ FAST_FS_HASH_AUTOTUNE_PROFILE: PROFILE });
+    expect(first.digest).toBe(expectedDigest);
+    expect(first.tuning.profilePath).toBe(PROFILE);
+    expect(existsSync(PROFILE)).toBe(true);
+
+    const lines = readFileSync(PROFILE, "utf8").trim().split("\n");
+    expect(lines[0]).toBe("fast-fs-hash-autotune 1");
+    expect(lines.length).toBeGreaterThanOrEqual(2);
+    for (const line of lines.slice(1)) {
+      expect(line).toMatch(/^\d \d+ \d+ -?1( \d+:[\d.e+-]+:[\d.e+-]+:\d+)*$/);
+    }
+
+    // No calls: the snapshot is exactly what was loaded from disk.
+    const second = await autotuneInChild({ FAST_FS_HASH_AUTOTUNE_PROFILE: PROFILE }, 0);
+    const saved = first.tuning.profiles.find((p) => p.op === "hashFiles");
+    const loaded = second.tuning.profiles.find((p) => p.op === "hashFiles");
+    expect(loaded).toBeDefined();
+    expect(loaded!.device).toBe(saved!.device);
+    expect(loaded!.samples.length).toBeGreaterThanOrEqual(1);
+  });
+
+  it("ignores a corrupt profile", async () => {
+    writeFileSync(PROFILE, "not a profile\n1 2 3\n");
+    const { tuning, digest } = await autotuneInChild({ FAST_FS_HASH_AUTOTUNE_PROFILE: PROFILE }, 0);
+    expect(digest).toBe("");
+    expect(tuning.enabled).toBe(true);
+    expect(tuning.profiles).toEqual([]);
+  });
+});
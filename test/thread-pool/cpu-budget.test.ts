@@ -0,0 +1,126 @@
+/**
+ * Tests: threadPoolCpuBudget — affinity and cgroup quota detection.
+ *
+ * The budget is detected once per process, so each fake cgroup layout runs
+ * in a child with FAST_FS_HASH_CGROUP_ROOT pointing at a temp directory.
+ */
+
+import type { ChildProcess } from "node:child_process";
+
+import { fork } from "node:child_process";
+import { mkdirSync, rmSync, writeFileSync } from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import { threadPoolCpuBudget } from "fast-fs-hash";
+import { afterAll, afterEach, beforeAll, describe, expect, it } from "vitest";
+
+const TEST_DIR = path.resolve(import.meta.dirname, "tmp/fhc-cpu-budget");
+const CHILD_SCRIPT = path.resolve(import.meta.dirname, "../_child-process-helper.mjs");
+
+const activeChildren: Set<ChildProcess> = new Set();
+
+let rootCounter = 0;
+
+/** Create a fake cgroup root populated with the given files (relative path → content). */
+function fakeCgroupRoot(files: Record<string, string>): string {
+  const root = path.join(TEST_DIR, `root-${++rootCounter}`);
+  mkdirSync(root, { recursive: true });
+  for (const [rel, content] of Object.entries(files)) {
+    const file = path.join(root, rel);
+    mkdirSync(path.dirname(file), { recursive: true });
+    writeFileSync(file, content);
+  }
+  return root;
+}
+
+function cpuBudgetInChild(cgroupRoot: string): Promise<number> {
+  return new Promise((resolve, reject) => {
+    const child = fork(CHILD_SCRIPT, [JSON.stringify({ mode: "cpu-budget" })], {
+      stdio: "pipe",
+      env: { ...process.env, FAST_FS_HASH_CGROUP_ROOT: cgroupRoot },
+    });
+    activeChildren.add(child);
+    child.on("message", (msg: { cpuBudget: number }) => {
+      resolve(msg.cpuBudget);
+      child.kill("SIGKILL");
+    });
+    child.on("error", reject);
+    child.on("exit", (code, signal) => {
+      activeChildren.delete(child);
+      if (code !== 0 && signal !== "SIGKILL") {
+        reject(new Error(`cpu-budget child exited with code ${code}`));
+      }
+    });
+  });
+}
+
+let unlimited = 0;
+
+beforeAll(async () => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+  mkdirSync(TEST_DIR, { recursive: true });
+  // An empty root has no quota files: the budget is online CPUs ∩ affinity.
+  unlimited = await cpuBudgetInChild(fakeCgroupRoot({}));
+});
+
+afterEach(() => {
+  for (const child of activeChildren) {
+    child.kill("SIGKILL");
+  }
+  activeChildren.clear();
+});
+
+afterAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+});
+
+describe.skipIf(process.platform !== "linux")("threadPoolCpuBudget (fake cgroup root)", () => {
+  it("returns a positive integer bounded by the CPU count", () => {
+    const budget = threadPoolCpuBudget();
+    expect(Number.isInteger(budget)).toBe(true);
+    expect(budget).toBeGreaterThanOrEqual(1);
+    expect(budget).toBeLessThanOrEqual(os.cpus().length);
+    expect(unlimited).toBeGreaterThanOrEqual(1);
+  });
+
+  it("cgroup v2 cpu.max 'max' means no limit", async () => {
+    const root = fakeCgroupRoot({ "cpu.max": "max 100000\n" });
+    expect(await cpuBudgetInChild(root)).toBe(unlimited);
+  });
+
+  it("cgroup v2 cpu.max quota caps the budget", async () => {
+    const root = fakeCgroupRoot({ "cpu.max": "200000 100000\n" });
+    expect(await cpuBudgetInChild(root)).toBe(Math.min(2, unlimited));
+  });
+
+  it("fractional quota rounds up", async () => {
+    const root = fakeCgroupRoot({ "cpu.max": "150000 100000\n" });
+    expect(await cpuBudgetInChild(root)).toBe(Math.min(2, unlimited));
+  });
+
+  it("sub-CPU quota still yields 1", async () => {
+    const root = fakeCgroupRoot({ "cpu.max": "10000 100000\n" });
+    expect(await cpuBudgetInChild(root)).toBe(1);
+  });
+
+  it("cgroup v1 cfs_quota_us caps the budget", async () => {
+    const root = fakeCgroupRoot({
+      "cpu,cpuacct/cpu.cfs_quota_us": "50000\n",
+      "cpu,cpuacct/cpu.cfs_period_us": "100000\n",
+    });
+    expect(await cpuBudgetInChild(root)).toBe(1);
+  });
+
+  it("cgroup v1 quota of -1 means no limit", async () => {
+    const root = fakeCgroupRoot({
+      "cpu/cpu.cfs_quota_us": "-1\n",
+      "cpu/cpu.cfs_period_us": "100000\n",
+    });
+    expect(await cpuBudgetInChild(root)).toBe(unlimited);
+  });
+
+  it("malformed quota files are ignored", async () => {
+    const root = fakeCgroupRoot({ "cpu.max": "garbage\n" });
+    expect(await cpuBudgetInChild(root)).toBe(unlimited);
+  });
+});
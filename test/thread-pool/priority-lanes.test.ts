@@ -0,0 +1,32 @@
+/**
+ * Tests: interactive and background lanes of the native thread pool.
+ */
+
+import { lz4CompressBlockAsync, threadPoolStats } from "fast-fs-hash";
+import { describe, expect, it } from "vitest";
+
+describe("thread pool priority lanes", () => {
+  it("serves an interactive task before queued background work", async () => {
+    const { maxThreads } = threadPoolStats();
+    const input = Buffer.alloc(4 << 20);
+    for (let i = 0; i < input.length; i++) {
+      input[i] = (i * 2654435761) >>> 27;
+    }
+
+    // Enough background tasks to keep every thread busy several times over.
+    const order: string[] = [];
+    const backgroundCount = maxThreads * 6;
+    const pending: Promise<unknown>[] = [];
+    for (let i = 0; i < backgroundCount; i++) {
+      pending.push(lz4CompressBlockAsync(input, undefined, undefined, "background").then(() => order.push("bg")));
+    }
+    pending.push(lz4CompressBlockAsync(input).then(() => order.push("interactive")));
+    await Promise.all(pending);
+
+    // The interactive task skips the background queue: it runs as soon as
+    // any thread frees up, not after the tasks queued before it.
+    expect(order.indexOf("interactive")).toBeLessThan(backgroundCount / 2);
+    // And the pool never grows past its CPU budget to do so.
+    expect(threadPoolStats().threadCount).toBeLessThanOrEqual(maxThreads);
+  });
+});
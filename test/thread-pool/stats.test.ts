@@ -0,0 +1,117 @@
+/**
+ * Tests: threadPoolStats — native pool counters.
+ *
+ * The pool is process-wide and other test files share it, so exact task
+ * counts are checked in a child process.
+ */
+
+import type { ChildProcess } from "node:child_process";
+
+import { fork } from "node:child_process";
+import { mkdirSync, rmSync, writeFileSync } from "node:fs";
+import path from "node:path";
+import { digestFilesParallel, lz4CompressBlockAsync, threadPoolStats } from "fast-fs-hash";
+import { afterAll, afterEach, beforeAll, describe, expect, it, vi } from "vitest";
+
+const TEST_DIR = path.resolve(import.meta.dirname, "tmp/fhc-pool-stats");
+const CHILD_SCRIPT = path.resolve(import.meta.dirname, "../_child-process-helper.mjs");
+
+const activeChildren: Set<ChildProcess> = new Set();
+
+function poolTaskDeltaInChild(calls: number): Promise<number> {
+  return new Promise((resolve, reject) => {
+    const child = fork(CHILD_SCRIPT, [JSON.stringify({ mode: "pool-tasks", calls })], { stdio: "pipe" });
+    activeChildren.add(child);
+    child.on("message", (msg: { delta: number }) => {
+      resolve(msg.delta);
+      child.kill("SIGKILL");
+    });
+    child.on("error", reject);
+    child.on("exit", (code, signal) => {
+      activeChildren.delete(child);
+      if (code !== 0 && signal !== "SIGKILL") {
+        reject(new Error(`pool-tasks child exited with code ${code}`));
+      }
+    });
+  });
+}
+
+const files: string[] = [];
+
+beforeAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+  mkdirSync(TEST_DIR, { recursive: true });
+  for (let i = 0; i < 32; i++) {
+    const file = path.join(TEST_DIR, `f${i}.txt`);
+    writeFileSync(file, `file ${i}\n`.repeat(i + 1));
+    files.push(file);
+  }
+});
+
+afterEach(() => {
+  for (const child of activeChildren) {
+    child.kill("SIGKILL");
+  }
+  activeChildren.clear();
+});
+
+afterAll(() => {
+  rmSync(TEST_DIR, { recursive: true, force: true });
+});
+
+describe("threadPoolStats", () => {
+  it("returns a well-formed snapshot", () => {
+    const stats = threadPoolStats();
+    expect(stats.threadCount).toBeGreaterThanOrEqual(0);
+    expect(stats.idleCount).toBeGreaterThanOrEqual(0);
+    expect(stats.idleCount).toBeLessThanOrEqual(stats.threadCount);
+    expect(stats.maxThreads).toBeGreaterThanOrEqual(2);
+    expect(Array.isArray(stats.threads)).toBe(true);
+    for (const t of stats.threads) {
+      expect(t.slot).toBeGreaterThanOrEqual(0);
+      expect(typeof t.live).toBe("boolean");
+      expect(t.busyNs).toBeGreaterThanOrEqual(0);
+      expect(t.idleNs).toBeGreaterThanOrEqual(0);
+    }
+  });
+
+  it("counts tasks executed on pool threads", async () => {
+    const before = threadPoolStats();
+    await digestFilesParallel(files);
+    // Background priority never runs inline, so this is always a pool task.
+    await lz4CompressBlockAsync(Buffer.alloc(4096, 1), undefined, undefined, "background");
+    // A task is counted after run() returns, which can be just after its
+    // promise settles on the JS thread.
+    await vi.waitFor(() => {
+      expect(threadPoolStats().tasksExecuted).toBeGreaterThanOrEqual(before.tasksExecuted + 2);
+    });
+    const after = threadPoolStats();
+
+    expect(after.threadCount).toBeGreaterThanOrEqual(1);
+    expect(after.threads.length).toBeGreaterThanOrEqual(1);
+    expect(after.threads.some((t) => t.live)).toBe(true);
+
+    let sum = 0;
+    let busy = 0;
+    for (const t of after.threads) {
+      sum += t.tasks;
+      busy += t.busyNs;
+    }
+    expect(sum).toBe(after.tasksExecuted);
+    expect(busy).toBeGreaterThan(0);
+  });
+
+  it("counts exactly one task per pooled call", async () => {
+    expect(await poolTaskDeltaInChild(5)).toBe(5);
+  });
+
+  it("counters never decrease", async () => {
+    const a = threadPoolStats();
+    await digestFilesParallel(files);
+    const b = threadPoolStats();
+    expect(b.tasksExecuted).toBeGreaterThanOrEqual(a.tasksExecuted);
+    expect(b.spinHits + b.sleeps).toBeGreaterThanOrEqual(a.spinHits + a.sleeps);
+    expect(b.expandCalls).toBeGreaterThanOrEqual(a.expandCalls);
+    expect(b.queueHighWater).toBeGreaterThanOrEqual(a.queueHighWater);
+  });
+});
@@ -2,17 +2,19 @@
  * Tests that fast-fs-hash works correctly inside Node.js Worker Threads.
  *
  * The native addon uses N-API (context-aware), so each Worker Thread gets
- * its own module instance. This test verifies:
+ * its own module instance; the native compute pool is shared process-wide.
+ * This test verifies:
  *   1. The native binding loads and initializes in a Worker Thread.
  *   2. Hashing produces correct results (matching main-thread values).
  *   3. Multiple Workers can hash concurrently without interference.
+ *   4. Worker Threads run on the same native pool as the main thread.
  */
 
 import { mkdirSync, rmSync, writeFileSync } from "node:fs";
 import path from "node:path";
 import { Worker } from "node:worker_threads";
-import { digestFilesParallel, FileHashCache, XxHash128Stream } from "fast-fs-hash";
-import { afterAll, beforeAll, describe, expect, it } from "vitest";
+import { digestFilesParallel, FileHashCache, threadPoolStats, XxHash128Stream } from "fast-fs-hash";
+import { afterAll, beforeAll, describe, expect, it, vi } from "vitest";
 
 //  - Known values (same as xxhash128.test.ts)
 
@@ -132,6 +134,37 @@ describe("Worker Threads", () => {
     }
   });
 
+  it("Workers run on the process-wide native pool", async () => {
+    const before = threadPoolStats().tasksExecuted;
+
+    // Only Workers submit work here, yet the main thread's stats see it.
+    await Promise.all(Array.from({ length: 4 }, () => runBulkInWorker(FIXTURES_DIR, 50)));
+
+    await vi.waitFor(() => {
+      expect(threadPoolStats().tasksExecuted).toBeGreaterThan(before);
+    });
+    const stats = threadPoolStats();
+    expect(stats.threadCount).toBeLessThanOrEqual(stats.threads.length);
+  });
+
+  it("terminating a Worker mid-hash leaves the shared pool usable", async () => {
+    const worker = new Worker(WORKER_SCRIPT, {
+      workerData: { mode: "bulk", fixturesDir: FIXTURES_DIR, fileCount: 20000 },
+    });
+    await new Promise<void>((resolve, reject) => {
+      worker.once("online", resolve);
+      worker.once("error", reject);
+    });
+    await worker.terminate();
+
+    const files = Array.from({ length: 50 }, () => fileA());
+    const [hex, again] = await Promise.all([
+      digestFilesParallel(files).then((buf) => buf.toString("hex")),
+      runBulkInWorker(FIXTURES_DIR, 50),
+    ]);
+    expect(again.hex).toBe(hex);
+  });
+
   // - Cross-thread FileHashCache lock serialization
   //
   // Regression test for the worker_threads correctness bug:
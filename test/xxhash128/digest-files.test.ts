@@ -171,6 +171,20 @@ describe.each(ALL_BACKENDS)("%s backend", (_name, backend) => {
       expect(r1).toBe(r2);
     });
 
+    it("background priority produces the same digest as interactive", async () => {
+      const paths = [];
+      for (let i = 0; i < 16; i++) {
+        paths.push(writeFixture(`par-prio-${i}.bin`, makeBuffer(700 + i * 37, i)));
+      }
+      const interactive = hex(await digestFilesParallel(paths, 0, true, "interactive"));
+      const [background, concurrent] = await Promise.all([
+        digestFilesParallel(paths, 0, true, "background"),
+        digestFilesParallel(paths),
+      ]);
+      expect(hex(background)).toBe(interactive);
+      expect(hex(concurrent)).toBe(interactive);
+    });
+
     it("missing file rejects with throwOnError=true (default)", async () => {
       const p1 = writeFixture("par-throw.bin", makeBuffer(200));
       await expect(digestFilesParallel([p1, "/tmp/no-such-file.bin"])).rejects.toThrow();